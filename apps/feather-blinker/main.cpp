@@ -26,6 +26,7 @@
 #include "driver/adc.hpp"
 #include "gpio.h"
 #include "memio.h"
+#include "nrf52/rtc.hpp"
 
 namespace {
 
@@ -39,6 +40,11 @@ class RTCTickHandler : public driver::EventHandler {
         }
 } rtc_tick_handler;
 
+using TickRTC = nrf52::RTC<11>;
+constexpr auto kTickConfig = driver::prescaler::for_rate(TickRTC::kPrescalerSpace, TickRTC::kBaseRate,
+                                                         configTICK_RATE_HZ);
+static_assert(kTickConfig.is_valid() && kTickConfig.error_ppm == 0, "RTC0 can't tick at configTICK_RATE_HZ");
+
 extern "C" {
 
     const int __attribute__((used)) uxTopUsedPriority = configMAX_PRIORITIES;
@@ -48,8 +54,7 @@ extern "C" {
 
     void vPortSetupTimerInterrupt(void) {
         auto* rtc = driver::Timer::request_by_id(driver::Timer::ID::RTC0);
-        auto rate = rtc->get_rate();
-        rtc->set_prescaler(rate / configTICK_RATE_HZ);
+        rtc->set_prescaler(kTickConfig.presc);
         rtc->add_event_handler(0, &rtc_tick_handler);
         rtc->enable_tick_interrupt();
         rtc->start();
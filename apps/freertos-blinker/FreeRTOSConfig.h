@@ -30,7 +30,7 @@
 #define configUSE_PREEMPTION        1
 #define configUSE_IDLE_HOOK         0
 #define configUSE_TICK_HOOK         (0)
-#define configUSE_TICKLESS_IDLE     (0)
+#define configUSE_TICKLESS_IDLE     (2)
 
 /* This is passed in from compiler command line */
 #define configCPU_CLOCK_HZ          (16000000UL)
@@ -20,12 +20,14 @@
 #include <stdio.h>
 
 #include "core/freertos_thread.hpp"
+#include "core/freertos_tickless.hpp"
 #include "core/init.hpp"
 #include "driver/timer.hpp"
 #include "driver/uart.hpp"
 #include "driver/adc.hpp"
 #include "gpio.h"
 #include "memio.h"
+#include "nrf52/rtc.hpp"
 
 namespace {
 
@@ -46,6 +48,13 @@ class RTCTickHandler : public driver::EventHandler {
         }
 } rtc_tick_handler;
 
+os::TicklessIdle tickless_idle{&rtc_tick_handler};
+
+using TickRTC = nrf52::RTC<11>;
+constexpr auto kTickConfig = driver::prescaler::for_rate(TickRTC::kPrescalerSpace, TickRTC::kBaseRate,
+                                                         configTICK_RATE_HZ);
+static_assert(kTickConfig.is_valid() && kTickConfig.error_ppm == 0, "RTC0 can't tick at configTICK_RATE_HZ");
+
 extern "C" {
 
     const int __attribute__((used)) uxTopUsedPriority = configMAX_PRIORITIES;
@@ -55,13 +64,17 @@ extern "C" {
 
     void vPortSetupTimerInterrupt(void) {
         auto* rtc = driver::Timer::request_by_id(driver::Timer::ID::RTC0);
-        auto rate = rtc->get_rate();
-        rtc->set_prescaler(rate / configTICK_RATE_HZ);
+        rtc->set_prescaler(kTickConfig.presc);
         rtc->add_event_handler(0, &rtc_tick_handler);
+        tickless_idle.init(rtc, 0);
         rtc->enable_tick_interrupt();
         rtc->start();
     }
 
+    void vPortSuppressTicksAndSleep(TickType_t expected_idle_time) {
+        os::suppress_ticks_and_sleep(&tickless_idle, expected_idle_time);
+    }
+
 }  // extern "C"
 
 class BlinkerThread : public os::ThreadStatic<2 * configMINIMAL_STACK_SIZE> {
@@ -18,11 +18,14 @@
 
 #include "cutils.h"
 #include "memio.h"
+#include "nvic.h"
 #include "pinctrl.hpp"
 
 #include "nrf52/peripheral.hpp"
 #include "nrf52/periph_utils.hpp"
 #include "nrf52/pinctrl.hpp"
+#include "nrf52/ppi.hpp"
+#include "nrf52/timer.hpp"
 
 namespace driver {
 
@@ -30,9 +33,12 @@ namespace {
 
 constexpr auto kSaadcID = 7;
 
+void saadc_irq_handler();
+
 class SAADC : public ADC, public nrf52::Peripheral {
     public:
-        SAADC(unsigned int id) : driver::Peripheral(periph::id_to_base(id), id) {}
+        SAADC(unsigned int id, irq_handler_func_t irq_handler) : driver::Peripheral(periph::id_to_base(id), id),
+            irq_handler_{irq_handler} {}
 
         int request() override {
             if (configured_) {
@@ -49,6 +55,7 @@ class SAADC : public ADC, public nrf52::Peripheral {
                 auto pin = pinctrl::request_function(func + pf::SAADC_CHAN_POS);
                 if (pin > pinctrl::saadc::NC) {
                     raw_write32(base_ + pselp(chan), pin);
+                    write_channel_config(chan);
                     chan_offset_map_[chan] = num_channels_;
                     ++num_channels_;
                 } else {
@@ -59,7 +66,7 @@ class SAADC : public ADC, public nrf52::Peripheral {
             }
 
             raw_writeptr(base_ + kResultPtrOffset, result_buffer_);
-            raw_write32(base_ + kResultMaxCnt, sizeof(result_buffer_) * 2);
+            raw_write32(base_ + kResultMaxCnt, kResultBufferSamples);
 
             // Enable Peripheral
             raw_write32(base_ + kEnableOffset, 1);
@@ -69,11 +76,22 @@ class SAADC : public ADC, public nrf52::Peripheral {
         }
 
         int start(int max_samples) override {
+            if (stream_buffer_) {
+                return 0;
+            }
+
+            if (is_calibration_due()) {
+                calibrate();
+            }
+
+            // The stream leaves its own MAXCNT behind
             raw_writeptr(base_ + kResultPtrOffset, result_buffer_);
+            raw_write32(base_ + kResultMaxCnt, kResultBufferSamples);
             trigger_task(Task::START);
             busy_wait_and_clear_event(Event::STARTED);
+            ++acquisitions_;
 
-            auto num_samples = MIN(static_cast<unsigned>(max_samples), (sizeof(result_buffer_) / 2) / num_channels_);
+            auto num_samples = MIN(static_cast<unsigned>(max_samples), kResultBufferSamples / num_channels_);
             for (unsigned i = 0; i < num_samples; ++i) {
                 trigger_task(Task::SAMPLE);
                 busy_wait_and_clear_event(Event::DONE);
@@ -82,6 +100,219 @@ class SAADC : public ADC, public nrf52::Peripheral {
             return num_samples;
         }
 
+        unsigned int start_stream(unsigned int rate, int16_t* buffer, size_t size, EventHandler* handler) override {
+            if (stream_buffer_ || !num_channels_ || !rate || rate > get_max_rate()) {
+                return 0;
+            }
+
+            const size_t half = (size / 2) / num_channels_ * num_channels_;
+            if (!half) {
+                return 0;
+            }
+
+            const uint32_t compare = MAX(kTimerRate / rate, 1u);
+
+            timer_id_ = nrf52::TimerPool::request()->alloc();
+            if (timer_id_ < 0) {
+                return 0;
+            }
+            timer_base_ = periph::id_to_base(timer_id_);
+
+            if (is_calibration_due()) {
+                calibrate();
+            }
+
+            auto* ppi = nrf52::PPI::request();
+            sample_ppi_channel_ = ppi->alloc_channel(timer_base_ + kTimerEvtCompare0, get_task_addr(Task::SAMPLE));
+            restart_ppi_channel_ = ppi->alloc_channel(get_event_addr(Event::END), get_task_addr(Task::START));
+            if (sample_ppi_channel_ < 0 || restart_ppi_channel_ < 0) {
+                free_sample_trigger();
+                return 0;
+            }
+
+            stream_buffer_ = buffer;
+            stream_buffer_len_ = half;
+            stream_handler_ = handler;
+            stream_cur_ = 0;
+            stream_calibration_ = Calibration::NONE;
+
+            // The conversions are triggered by the timer, and each full buffer is followed by the next one
+            // without the CPU being involved. The interrupts are only for the buffer switching.
+            raw_write32(timer_base_ + kTimerTasksStop, 1);
+            raw_write32(timer_base_ + kTimerModeOffset, kTimerModeTimer);
+            raw_write32(timer_base_ + kTimerBitModeOffset, kTimerBitMode32);
+            raw_write32(timer_base_ + kTimerPrescalerOffset, 0);
+            raw_write32(timer_base_ + kTimerCc0, compare);
+            raw_write32(timer_base_ + kTimerShortsOffset, kTimerShortCompare0Clear);
+            raw_write32(timer_base_ + kTimerTasksClear, 1);
+
+            ppi->enable_channels(nrf52::PPI::channel_mask(sample_ppi_channel_) |
+                                 nrf52::PPI::channel_mask(restart_ppi_channel_));
+
+            clear_event(Event::END);
+            raw_writeptr(base_ + kResultPtrOffset, stream_buffer_);
+            raw_write32(base_ + kResultMaxCnt, half);
+            trigger_task(Task::START);
+            busy_wait_and_clear_event(Event::STARTED);
+            // RESULT.PTR is latched on START, the next buffer can be set right away
+            raw_writeptr(base_ + kResultPtrOffset, stream_buffer_ + half);
+            check_stream_calibration();
+
+            set_irq_handler(irq_handler_);
+            raw_write32(base_ + kIntenSetOffset, kIntStarted | kIntEnd);
+            enable_irq();
+
+            raw_write32(timer_base_ + kTimerTasksStart, 1);
+
+            return kTimerRate / compare;
+        }
+
+        size_t get_stream_buffer_len() const override {
+            return stream_buffer_len_;
+        }
+
+        void stop() override {
+            if (!stream_buffer_) {
+                return;
+            }
+
+            free_sample_trigger();
+            raw_write32(base_ + kIntenClrOffset, kIntStarted | kIntEnd | kIntCalibrateDone);
+
+            if (stream_calibration_ == Calibration::RUNNING) {
+                busy_wait_and_clear_event(Event::CALIBRATEDONE);
+                acquisitions_ = 0;
+                calibrated_ = true;
+            }
+            stream_calibration_ = Calibration::NONE;
+
+            // The partially filled buffer is dropped
+            trigger_task(Task::STOP);
+            busy_wait_and_clear_event(Event::STOPPED);
+            clear_event(Event::END);
+            clear_event(Event::STARTED);
+
+            stream_buffer_ = nullptr;
+            stream_buffer_len_ = 0;
+        }
+
+        void handle_irq() {
+            // END must be handled before STARTED: the restart follows END immediately,
+            // and STARTED is for the buffer after the one just finished.
+            if (is_event_active(Event::END)) {
+                clear_event(Event::END);
+                if (stream_buffer_) {
+                    const int16_t* done = stream_buffer_ + stream_cur_ * stream_buffer_len_;
+                    stream_cur_ ^= 1;
+                    ++acquisitions_;
+                    if (stream_calibration_ == Calibration::PENDING) {
+                        stream_calibration_ = Calibration::RUNNING;
+                        // The SAADC has not been restarted, calibrate it while it's idle.
+                        // The sampling triggers are dropped in the meantime.
+                        nrf52::PPI::request()->disable_channels(nrf52::PPI::channel_mask(sample_ppi_channel_));
+                        raw_write32(base_ + kIntenSetOffset, kIntCalibrateDone);
+                        trigger_task(Task::CALIBRATEOFFSET);
+                    }
+                    if (stream_handler_) {
+                        EventInfo e_info;
+                        e_info.irq_n = irq_n_;
+                        e_info.evt_id = ADC::Event::BUFFER_DONE;
+                        e_info.src = this;
+                        e_info.data = done;
+                        stream_handler_->handle_event(&e_info);
+                    }
+                }
+            }
+
+            if (is_event_active(Event::STARTED)) {
+                clear_event(Event::STARTED);
+                if (stream_buffer_) {
+                    // The hardware fills the current buffer, the next one
+                    // is the one that has been handed out before it.
+                    raw_writeptr(base_ + kResultPtrOffset, stream_buffer_ + (stream_cur_ ^ 1) * stream_buffer_len_);
+                    check_stream_calibration();
+                }
+            }
+
+            if (is_event_active(Event::CALIBRATEDONE)) {
+                clear_event(Event::CALIBRATEDONE);
+                raw_write32(base_ + kIntenClrOffset, kIntCalibrateDone);
+                if (stream_buffer_ && stream_calibration_ == Calibration::RUNNING) {
+                    stream_calibration_ = Calibration::NONE;
+                    acquisitions_ = 0;
+                    calibrated_ = true;
+                    nrf52::PPI::request()->enable_channels(nrf52::PPI::channel_mask(sample_ppi_channel_) |
+                                                           nrf52::PPI::channel_mask(restart_ppi_channel_));
+                    trigger_task(Task::START);
+                }
+            }
+        }
+
+        int configure_channel(unsigned channel, const ChannelConfig& config) override {
+            if (channel >= kMaxChannels || stream_buffer_) {
+                return -1;
+            }
+
+            if (config.acq_time_us > kAcqTimesUs[kNumAcqTimes - 1]) {
+                return -1;
+            }
+
+            chan_config_[channel] = config;
+            write_channel_config(channel);
+            return 0;
+        }
+
+        int set_resolution(unsigned int bits) override {
+            if (stream_buffer_ || bits < 8 || bits > 14 || (bits % 2)) {
+                return -1;
+            }
+
+            raw_write32(base_ + kResolutionOffset, (bits - 8) / 2);
+            return 0;
+        }
+
+        unsigned int set_oversample(unsigned int samples) override {
+            if (stream_buffer_ || !samples) {
+                return 0;
+            }
+
+            unsigned int oversample_log2 = 0;
+            while ((2u << oversample_log2) <= samples && oversample_log2 < kMaxOversampleLog2) {
+                ++oversample_log2;
+            }
+
+            oversample_log2_ = oversample_log2;
+            raw_write32(base_ + kOversampleOffset, oversample_log2_);
+            // With BURST the channel is sampled repeatedly on a single SAMPLE task, so that
+            // oversampling works with the scan of several channels, and each sample still
+            // takes a single trigger.
+            for (unsigned int chan = 0; chan < kMaxChannels; ++chan) {
+                if (chan_offset_map_[chan] != 0xff) {
+                    write_channel_config(chan);
+                }
+            }
+
+            return 1 << oversample_log2_;
+        }
+
+        int calibrate() override {
+            if (stream_buffer_) {
+                return -1;
+            }
+
+            trigger_task(Task::CALIBRATEOFFSET);
+            busy_wait_and_clear_event(Event::CALIBRATEDONE);
+            acquisitions_ = 0;
+            calibrated_ = true;
+
+            return 0;
+        }
+
+        void set_calibration_interval(unsigned int acquisitions) override {
+            calibration_interval_ = acquisitions;
+            calibrated_ = false;
+        }
+
         unsigned get_num_channels() const override {
             return num_channels_;
         }
@@ -96,7 +327,7 @@ class SAADC : public ADC, public nrf52::Peripheral {
             }
 
             unsigned result_offset = sample * num_channels_ + chan_offset_map_[channel];
-            if (result_offset >= sizeof(result_buffer_) / 2) {
+            if (result_offset >= kResultBufferSamples) {
                 return 0;
             }
 
@@ -115,10 +346,22 @@ class SAADC : public ADC, public nrf52::Peripheral {
             STARTED,
             END,
             DONE,
+            RESULTDONE,
+            CALIBRATEDONE,
+            STOPPED,
         };
 
+        static constexpr auto kEventsOffset = 0x100;
+        static constexpr auto kIntenSetOffset = 0x304;
+        static constexpr auto kIntenClrOffset = 0x308;
+        static constexpr uint32_t kIntStarted = (1 << Event::STARTED);
+        static constexpr uint32_t kIntEnd = (1 << Event::END);
+        static constexpr uint32_t kIntCalibrateDone = (1 << Event::CALIBRATEDONE);
+
         static constexpr auto kEnableOffset = 0x500;
         static constexpr auto kChan0Offset = 0x510;
+        static constexpr auto kResolutionOffset = 0x5f0;
+        static constexpr auto kOversampleOffset = 0x5f4;
         static constexpr auto kResultPtrOffset = 0x62c;
         static constexpr auto kResultMaxCnt = 0x630;
 
@@ -126,18 +369,136 @@ class SAADC : public ADC, public nrf52::Peripheral {
             return kChan0Offset + 16 * ch;
         }
 
+        static constexpr uint32_t config(unsigned int ch) {
+            return kChan0Offset + 16 * ch + 4;
+        }
+
+        static constexpr auto kConfigGainShift = 8;
+        static constexpr auto kConfigRefSelShift = 12;
+        static constexpr auto kConfigTAcqShift = 16;
+        static constexpr uint32_t kConfigBurst = (1 << 24);
+
+        static constexpr unsigned int kAcqTimesUs[] = {3, 5, 10, 15, 20, 40};
+        static constexpr unsigned int kNumAcqTimes = sizeof(kAcqTimesUs) / sizeof(kAcqTimesUs[0]);
+        static constexpr unsigned int kConversionTimeUs = 2;
+        static constexpr unsigned int kMaxOversampleLog2 = 8;
+
+        static unsigned int acq_time_index(unsigned int acq_time_us) {
+            unsigned int index = 0;
+            while (index < kNumAcqTimes - 1 && kAcqTimesUs[index] < acq_time_us) {
+                ++index;
+            }
+
+            return index;
+        }
+
+        void write_channel_config(unsigned int chan) {
+            const auto& conf = chan_config_[chan];
+            uint32_t value = (static_cast<uint32_t>(conf.gain) << kConfigGainShift) |
+                             (static_cast<uint32_t>(conf.reference) << kConfigRefSelShift) |
+                             (acq_time_index(conf.acq_time_us) << kConfigTAcqShift);
+            if (oversample_log2_) {
+                value |= kConfigBurst;
+            }
+
+            raw_write32(base_ + config(chan), value);
+        }
+
+        // Highest rate of SAMPLE tasks that the SAADC can keep up with
+        unsigned int get_max_rate() const {
+            unsigned int sample_time_us = 0;
+            for (unsigned int chan = 0; chan < kMaxChannels; ++chan) {
+                if (chan_offset_map_[chan] != 0xff) {
+                    const auto acq_time = kAcqTimesUs[acq_time_index(chan_config_[chan].acq_time_us)];
+                    sample_time_us += (acq_time + kConversionTimeUs) << oversample_log2_;
+                }
+            }
+
+            return sample_time_us ? 1000000 / sample_time_us : 0;
+        }
+
+        void free_sample_trigger() {
+            auto* ppi = nrf52::PPI::request();
+            ppi->free_channel(sample_ppi_channel_);
+            ppi->free_channel(restart_ppi_channel_);
+            sample_ppi_channel_ = -1;
+            restart_ppi_channel_ = -1;
+
+            raw_write32(timer_base_ + kTimerTasksStop, 1);
+            nrf52::TimerPool::request()->free(timer_id_);
+            timer_id_ = -1;
+        }
+
+        bool is_calibration_due() const {
+            return calibration_interval_ && (!calibrated_ || acquisitions_ >= calibration_interval_);
+        }
+
+        // Called when the hardware has started the next buffer: if the calibration is due
+        // after it, the SAADC should not be restarted at its END.
+        void check_stream_calibration() {
+            if (calibration_interval_ && acquisitions_ + 1 >= calibration_interval_) {
+                stream_calibration_ = Calibration::PENDING;
+                nrf52::PPI::request()->disable_channels(nrf52::PPI::channel_mask(restart_ppi_channel_));
+            }
+        }
+
         static constexpr auto kResultBufferLen = 32;
+        // RESULT.MAXCNT counts 16 bit samples
+        static constexpr unsigned int kResultBufferSamples = kResultBufferLen * sizeof(uint32_t) / sizeof(int16_t);
         uint32_t result_buffer_[kResultBufferLen];
 
         static constexpr auto kMaxChannels = 8;
         uint8_t chan_offset_map_[kMaxChannels];
+        ChannelConfig chan_config_[kMaxChannels];
+        unsigned int oversample_log2_ = 0;
+
+
+        // TIMER triggering the conversions of the stream, from the TimerPool
+        int timer_id_ = -1;
+        uint32_t timer_base_ = 0;
+        static constexpr auto kTimerTasksStart = 0x000;
+        static constexpr auto kTimerTasksStop = 0x004;
+        static constexpr auto kTimerTasksClear = 0x00c;
+        static constexpr auto kTimerEvtCompare0 = 0x140;
+        static constexpr auto kTimerShortsOffset = 0x200;
+        static constexpr auto kTimerModeOffset = 0x504;
+        static constexpr auto kTimerBitModeOffset = 0x508;
+        static constexpr auto kTimerPrescalerOffset = 0x510;
+        static constexpr auto kTimerCc0 = 0x540;
+        static constexpr uint32_t kTimerShortCompare0Clear = (1 << 0);
+        static constexpr uint32_t kTimerModeTimer = 0;
+        static constexpr uint32_t kTimerBitMode32 = 3;
+        static constexpr unsigned int kTimerRate = 16000000;
 
 
         bool configured_ = false;
         unsigned num_channels_ = 0;
+        irq_handler_func_t irq_handler_;
+
+        int16_t* stream_buffer_ = nullptr;
+        size_t stream_buffer_len_ = 0;
+        unsigned int stream_cur_ = 0;
+        EventHandler* stream_handler_ = nullptr;
+        int sample_ppi_channel_ = -1;
+        int restart_ppi_channel_ = -1;
+        // The SAADC is stopped after the current buffer for the calibration
+        enum class Calibration {
+            NONE,
+            PENDING,
+            RUNNING,
+        };
+        volatile Calibration stream_calibration_ = Calibration::NONE;
+
+        unsigned int calibration_interval_ = 0;
+        unsigned int acquisitions_ = 0;
+        bool calibrated_ = false;
 };
 
-SAADC saadc{kSaadcID};
+SAADC saadc{kSaadcID, saadc_irq_handler};
+
+void saadc_irq_handler() {
+    saadc.handle_irq();
+}
 
 }  // namespace
 
@@ -30,9 +30,8 @@ class BleAir : public ble::Air {
         void init_ble() {
             radio_->set_mode(Radio::Mode::BLE);
             radio_->set_ifs(ble::kInterFrameSpaceUs);
-            radio_->set_whitening(true);
             radio_->configure_crc(3, true, ble::kCrcPoly);
-            radio_->set_base_addr_len(3);
+            radio_->configure_framing(3, true);
             radio_->set_addr_base(0, ble::kAdvAccessAddress << 8);
             radio_->set_addr_prefix(0, ble::kAdvAccessAddress >> 24);
             // Note: This configuration only supports Uncoded PHY,
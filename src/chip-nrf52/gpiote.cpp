@@ -0,0 +1,58 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "nrf52/gpiote.hpp"
+
+#include "core/critical_section.hpp"
+#include "memio.h"
+
+namespace nrf52 {
+
+GPIOTE GPIOTE::gpiote_;
+
+GPIOTE* GPIOTE::request() {
+    return &gpiote_;
+}
+
+int GPIOTE::alloc_output(unsigned int pin, bool init_high) {
+    os::CriticalSection cs;
+    for (unsigned int ch = 0; ch < kNumChannels; ++ch) {
+        if (!(allocated_channels_ & (1u << ch))) {
+            allocated_channels_ |= (1u << ch);
+
+            uint32_t config = kConfigModeTask | (pin << kConfigPselShift) | kConfigPolarityToggle;
+            if (init_high) {
+                config |= kConfigOutInitHigh;
+            }
+            raw_write32(base_ + kConfigOffset + ch * 4, config);
+            return ch;
+        }
+    }
+
+    return -1;
+}
+
+void GPIOTE::free_channel(int ch) {
+    os::CriticalSection cs;
+    if (!is_allocated(ch)) {
+        return;
+    }
+
+    raw_write32(base_ + kConfigOffset + ch * 4, 0);
+    allocated_channels_ &= ~(1u << ch);
+}
+
+}  // namespace nrf52
@@ -2,11 +2,16 @@
 
 #include "cutils.h"
 #include "memio.h"
+#include "nvic.h"
 #include "pinctrl.hpp"
 
+#include "nrf52/easydma.hpp"
 #include "nrf52/peripheral.hpp"
 #include "nrf52/periph_utils.hpp"
 #include "nrf52/pinctrl.hpp"
+#include "nrf52/ppi.hpp"
+#include "nrf52/shared_instances.hpp"
+#include "nrf52/timer.hpp"
 
 
 namespace driver {
@@ -16,11 +21,38 @@ namespace {
 constexpr auto kTwim0ID = 3;
 constexpr auto kTwim1ID = 4;
 
+void twim0_irq_handler();
+
+void twim1_irq_handler();
+
+void twim0_counter_irq_handler();
+
+void twim1_counter_irq_handler();
+
+struct FrequencyConfig {
+    unsigned int freq;
+    uint32_t conf_value;
+};
+
+// Sorted by the frequency, descending
+constexpr FrequencyConfig supported_frequencies[] = {
+    { .freq = 400 * 1000, .conf_value = 0x06400000 },
+    { .freq = 250 * 1000, .conf_value = 0x04000000 },
+    { .freq = 100 * 1000, .conf_value = 0x01980000 },
+};
+
 class TWIM : public I2C, public nrf52::Peripheral {
     public:
-        TWIM(unsigned int id) : driver::Peripheral(periph::id_to_base(id), id) {}
+        TWIM(unsigned int id, irq_handler_func_t irq_handler, irq_handler_func_t counter_irq_handler) :
+            driver::Peripheral(periph::id_to_base(id), id), irq_handler_{irq_handler},
+            counter_irq_handler_{counter_irq_handler} {}
 
         int request() override {
+            // TWIM0 and TWIM1 share the instances with SPIM0 and SPIM1
+            if (nrf52::SharedInstances::request()->claim(irq_n_, this) < 0) {
+                return -1;
+            }
+
             int ret = 0;
             if (irq_n_ == kTwim0ID) {
                 ret = pinctrl::request_function(pinctrl::function::TWIM0_GROUP);
@@ -29,15 +61,378 @@ class TWIM : public I2C, public nrf52::Peripheral {
             }
 
             if (ret < 0) {
+                if (!configured_) {
+                    nrf52::SharedInstances::request()->release(irq_n_, this);
+                }
                 return ret;
             }
 
+            if (!configured_) {
+                set_frequency(kDefaultFrequency);
+                raw_write32(base_ + kEnableOffset, kEnableValue);
+                configured_ = true;
+            }
+
             return ret;
         }
+
+        void release() override {
+            if (busy_) {
+                return;
+            }
+
+            disable_irq();
+            irq_enabled_ = false;
+            raw_write32(base_ + kEnableOffset, 0);
+            configured_ = false;
+            nrf52::SharedInstances::request()->release(irq_n_, this);
+        }
+
+        unsigned int set_frequency(unsigned int freq) override {
+            for (size_t i = 0; i < ARRAY_SIZE(supported_frequencies); ++i) {
+                if (supported_frequencies[i].freq <= freq) {
+                    raw_write32(base_ + kFrequency, supported_frequencies[i].conf_value);
+                    return supported_frequencies[i].freq;
+                }
+            }
+
+            return 0;
+        }
+
+        int write(uint8_t addr, const uint8_t* data, size_t size, EventHandler* handler) override {
+            if (busy_ || !load_tx(data, size)) {
+                return -1;
+            }
+
+            start_xfer(addr, data, handler);
+            raw_write32(base_ + kShortsOffset, kShortLastTxStop);
+            trigger_task(Task::START_TX);
+
+            return 0;
+        }
+
+        int read(uint8_t addr, uint8_t* data, size_t size, EventHandler* handler) override {
+            if (busy_ || !load_rx(data, size, kListDisabled)) {
+                return -1;
+            }
+
+            start_xfer(addr, data, handler);
+            raw_write32(base_ + kShortsOffset, kShortLastRxStop);
+            trigger_task(Task::START_RX);
+
+            return 0;
+        }
+
+        int write_read(uint8_t addr, const uint8_t* tx_data, size_t tx_size,
+                       uint8_t* rx_data, size_t rx_size, EventHandler* handler) override {
+            if (busy_ || !load_tx(tx_data, tx_size) || !load_rx(rx_data, rx_size, kListDisabled)) {
+                return -1;
+            }
+
+            start_xfer(addr, rx_data, handler);
+            // The read is started with the repeated start condition right after the write
+            raw_write32(base_ + kShortsOffset, kShortLastTxStartRx | kShortLastRxStop);
+            trigger_task(Task::START_TX);
+
+            return 0;
+        }
+
+        int read_samples(uint8_t addr, uint8_t reg, uint8_t* data, size_t sample_size,
+                         size_t count, EventHandler* handler) override {
+            if (busy_ || !count) {
+                return -1;
+            }
+
+            sample_reg_ = reg;
+            // RXD.LIST moves RXD.PTR by MAXCNT after each transaction, the samples
+            // are stored one after another without reprogramming the pointer.
+            if (!load_tx(&sample_reg_, 1) || !load_rx(data, sample_size, kListArrayList)
+                || !nrf52::is_dma_accessible(data, sample_size * count)) {
+                return -1;
+            }
+
+            if (count > 1 && setup_sample_chain(count) < 0) {
+                return -1;
+            }
+
+            start_xfer(addr, data, handler);
+            raw_write32(base_ + kShortsOffset, kShortLastTxStartRx | kShortLastRxStop);
+            trigger_task(Task::START_TX);
+
+            return 0;
+        }
+
+        bool is_busy() const override {
+            return busy_;
+        }
+
+        void handle_irq() {
+            if (is_event_active(Event::ERROR)) {
+                clear_event(Event::ERROR);
+                error_ = true;
+                raw_write32(base_ + kErrorSrc, raw_read32(base_ + kErrorSrc));
+                // Don't start any more transactions of the batch, and finish it on
+                // the stop condition, ignoring the STOPPED events left by the batch.
+                if (sample_group_ >= 0) {
+                    nrf52::PPI::request()->disable_group(sample_group_);
+                    clear_event(Event::STOPPED);
+                    raw_write32(base_ + kIntenSetOffset, kIntStopped);
+                }
+                // The bus is held until the stop condition is issued
+                trigger_task(Task::STOP);
+            }
+
+            if (is_event_active(Event::STOPPED)) {
+                clear_event(Event::STOPPED);
+                if (busy_) {
+                    finish_xfer();
+                }
+            }
+        }
+
+        // The last transaction of the batch is counted
+        void handle_counter_irq() {
+            if (counter_id_ < 0) {
+                return;
+            }
+
+            const uint32_t compare_event = counter_base_ + kTimerEventsCompare1;
+            if (raw_read32(compare_event)) {
+                raw_write32(compare_event, 0);
+                if (busy_) {
+                    finish_xfer();
+                }
+            }
+        }
+
+    private:
+        enum Task {
+            START_RX,
+            START_TX = 2,
+            STOP = 5,
+        };
+
+        enum Event {
+            STOPPED = 1,
+            ERROR = 9,
+        };
+
+        bool load_tx(const uint8_t* data, size_t size) {
+            // LASTTX never comes with MAXCNT of zero, the bus would be held forever
+            if (!size || size > kMaxCnt) {
+                return false;
+            }
+
+            const uint8_t* chunk = data;
+            if (!nrf52::is_dma_accessible(data, size)) {
+                if (size > kTxBufferSize) {
+                    return false;
+                }
+                for (size_t i = 0; i < size; ++i) {
+                    tx_buffer_[i] = data[i];
+                }
+                chunk = tx_buffer_;
+            }
+
+            raw_writeptr(base_ + kTxdPtr, const_cast<uint8_t*>(chunk));
+            raw_write32(base_ + kTxdMaxCnt, size);
+            raw_write32(base_ + kTxdList, kListDisabled);
+            return true;
+        }
+
+        bool load_rx(uint8_t* data, size_t size, uint32_t list) {
+            if (!size || size > kMaxCnt || !nrf52::is_dma_accessible(data, size)) {
+                return false;
+            }
+
+            raw_writeptr(base_ + kRxdPtr, data);
+            raw_write32(base_ + kRxdMaxCnt, size);
+            raw_write32(base_ + kRxdList, list);
+            return true;
+        }
+
+        // Repeat the transaction from STOPPED event until the counter of the
+        // transactions disables the repeating channel, all without the CPU.
+        // The counter's interrupt after the last transaction is the only one
+        // of the batch, TWIM interrupts only on an error.
+        int setup_sample_chain(size_t count) {
+            counter_id_ = nrf52::TimerPool::request()->alloc();
+            if (counter_id_ < 0) {
+                return -1;
+            }
+            counter_base_ = periph::id_to_base(counter_id_);
+
+            auto* ppi = nrf52::PPI::request();
+            restart_ppi_channel_ = ppi->alloc_channel(get_event_addr(Event::STOPPED), get_task_addr(Task::START_TX));
+            count_ppi_channel_ = ppi->alloc_channel(get_event_addr(Event::STOPPED), counter_base_ + kTimerTasksCount);
+            sample_group_ = ppi->alloc_group(nrf52::PPI::channel_mask(restart_ppi_channel_));
+            limit_ppi_channel_ = ppi->alloc_channel(counter_base_ + kTimerEventsCompare0,
+                                                    ppi->get_group_disable_task(sample_group_));
+            if (restart_ppi_channel_ < 0 || count_ppi_channel_ < 0 || limit_ppi_channel_ < 0 || sample_group_ < 0) {
+                free_sample_chain();
+                return -1;
+            }
+
+            raw_write32(counter_base_ + kTimerModeOffset, kTimerModeLowPowerCounter);
+            raw_write32(counter_base_ + kTimerBitModeOffset, kTimerBitMode32);
+            // The last transaction is started by the one before it
+            raw_write32(counter_base_ + kTimerCc0, count - 1);
+            raw_write32(counter_base_ + kTimerCc1, count);
+            raw_write32(counter_base_ + kTimerEventsCompare1, 0);
+            raw_write32(counter_base_ + kTimerTasksClear, 1);
+            raw_write32(counter_base_ + kTimerTasksStart, 1);
+            raw_write32(counter_base_ + kIntenSetOffset, kTimerIntCompare1);
+            nvic_set_handler(counter_id_, counter_irq_handler_);
+            nvic_enable_irq(counter_id_);
+
+            ppi->enable_channels(nrf52::PPI::channel_mask(count_ppi_channel_) |
+                                 nrf52::PPI::channel_mask(limit_ppi_channel_));
+            ppi->enable_group(sample_group_);
+
+            return 0;
+        }
+
+        void free_sample_chain() {
+            auto* ppi = nrf52::PPI::request();
+            ppi->free_group(sample_group_);
+            ppi->free_channel(restart_ppi_channel_);
+            ppi->free_channel(count_ppi_channel_);
+            ppi->free_channel(limit_ppi_channel_);
+            sample_group_ = -1;
+            restart_ppi_channel_ = -1;
+            count_ppi_channel_ = -1;
+            limit_ppi_channel_ = -1;
+            nvic_disable_irq(counter_id_);
+            raw_write32(counter_base_ + kIntenClrOffset, kTimerIntCompare1);
+            raw_write32(counter_base_ + kTimerTasksStop, 1);
+            nrf52::TimerPool::request()->free(counter_id_);
+            counter_id_ = -1;
+        }
+
+        void start_xfer(uint8_t addr, const void* data, EventHandler* handler) {
+            busy_ = true;
+            error_ = false;
+            xfer_data_ = data;
+            handler_ = handler;
+
+            raw_write32(base_ + kAddress, addr);
+            set_irq_handler(irq_handler_);
+            clear_event(Event::STOPPED);
+            clear_event(Event::ERROR);
+            // The batch is finished by the counter
+            raw_write32(base_ + kIntenSetOffset, sample_group_ >= 0 ? kIntError : kIntStopped | kIntError);
+            // Only once, the callers may keep the interrupt line masked for a while
+            if (!irq_enabled_) {
+                enable_irq();
+                irq_enabled_ = true;
+            }
+        }
+
+        void finish_xfer() {
+            raw_write32(base_ + kIntenClrOffset, kIntStopped | kIntError);
+            raw_write32(base_ + kShortsOffset, 0);
+            if (count_ppi_channel_ >= 0) {
+                free_sample_chain();
+            }
+            busy_ = false;
+
+            if (handler_) {
+                EventInfo e_info;
+                e_info.irq_n = irq_n_;
+                e_info.evt_id = error_ ? I2C::Event::XFER_ERROR : I2C::Event::XFER_DONE;
+                e_info.src = this;
+                e_info.data = xfer_data_;
+                handler_->handle_event(&e_info);
+            }
+        }
+
+        static constexpr auto kShortsOffset = 0x200;
+        static constexpr uint32_t kShortLastTxStartRx = (1 << 7);
+        static constexpr uint32_t kShortLastTxStop = (1 << 9);
+        static constexpr uint32_t kShortLastRxStop = (1 << 12);
+
+        static constexpr auto kIntenSetOffset = 0x304;
+        static constexpr auto kIntenClrOffset = 0x308;
+        static constexpr uint32_t kIntStopped = (1 << Event::STOPPED);
+        static constexpr uint32_t kIntError = (1 << Event::ERROR);
+
+        static constexpr auto kErrorSrc = 0x4c4;
+        static constexpr auto kEnableOffset = 0x500;
+        static constexpr auto kEnableValue = 6;
+        static constexpr auto kFrequency = 0x524;
+
+        static constexpr auto kRxdPtr = 0x534;
+        static constexpr auto kRxdMaxCnt = 0x538;
+        static constexpr auto kRxdList = 0x540;
+        static constexpr auto kTxdPtr = 0x544;
+        static constexpr auto kTxdMaxCnt = 0x548;
+        static constexpr auto kTxdList = 0x550;
+        static constexpr uint32_t kListDisabled = 0;
+        static constexpr uint32_t kListArrayList = 1;
+
+        static constexpr auto kAddress = 0x588;
+
+        // MAXCNT registers are 8 bits wide on nRF52832
+        static constexpr size_t kMaxCnt = 255;
+        static constexpr size_t kTxBufferSize = 16;
+        static constexpr auto kDefaultFrequency = 100 * 1000;
+
+        // TIMER registers, for the counter of the transactions
+        static constexpr auto kTimerTasksStart = 0x000;
+        static constexpr auto kTimerTasksStop = 0x004;
+        static constexpr auto kTimerTasksCount = 0x008;
+        static constexpr auto kTimerTasksClear = 0x00c;
+        static constexpr auto kTimerEventsCompare0 = 0x140;
+        static constexpr auto kTimerEventsCompare1 = 0x144;
+        static constexpr auto kTimerModeOffset = 0x504;
+        static constexpr auto kTimerBitModeOffset = 0x508;
+        static constexpr auto kTimerCc0 = 0x540;
+        static constexpr auto kTimerCc1 = 0x544;
+        static constexpr uint32_t kTimerModeLowPowerCounter = 2;
+        static constexpr uint32_t kTimerBitMode32 = 3;
+        static constexpr uint32_t kTimerIntCompare1 = (1 << 17);
+
+        bool configured_ = false;
+        bool irq_enabled_ = false;
+        irq_handler_func_t irq_handler_;
+        irq_handler_func_t counter_irq_handler_;
+        // Counter of the sampled transactions, from the TimerPool
+        int counter_id_ = -1;
+        uint32_t counter_base_ = 0;
+
+        // Bounce buffer for the data EasyDMA can't access
+        uint8_t tx_buffer_[kTxBufferSize];
+        uint8_t sample_reg_ = 0;
+
+        volatile bool busy_ = false;
+        bool error_ = false;
+        const void* xfer_data_ = nullptr;
+        EventHandler* handler_ = nullptr;
+
+        int restart_ppi_channel_ = -1;
+        int count_ppi_channel_ = -1;
+        int limit_ppi_channel_ = -1;
+        int sample_group_ = -1;
 };
 
-TWIM twim0{kTwim0ID};
-TWIM twim1{kTwim1ID};
+TWIM twim0{kTwim0ID, twim0_irq_handler, twim0_counter_irq_handler};
+TWIM twim1{kTwim1ID, twim1_irq_handler, twim1_counter_irq_handler};
+
+void twim0_irq_handler() {
+    twim0.handle_irq();
+}
+
+void twim1_irq_handler() {
+    twim1.handle_irq();
+}
+
+void twim0_counter_irq_handler() {
+    twim0.handle_counter_irq();
+}
+
+void twim1_counter_irq_handler() {
+    twim1.handle_counter_irq();
+}
 
 }  // namespace
 
@@ -52,8 +447,8 @@ I2C* I2C::request_by_id(int id) {
         break;
     }
 
-    if (res) {
-        res->request();
+    if (res && res->request() < 0) {
+        res = nullptr;
     }
 
     return res;
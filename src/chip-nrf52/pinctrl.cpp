@@ -30,6 +30,10 @@ constexpr uint32_t uarte1_base = 0x40028000;
 constexpr uint32_t twim0_base = 0x40003000;
 constexpr uint32_t twim1_base = 0x40004000;
 
+constexpr uint32_t spim0_base = 0x40003000;
+constexpr uint32_t spim1_base = 0x40004000;
+constexpr uint32_t spim2_base = 0x40023000;
+
 constexpr uint32_t twim_psel_offset(int func) {
     return 0x504 + 4 * func;
 }
@@ -38,6 +42,10 @@ constexpr uint32_t uarte_psel_offset(int func) {
     return 0x504 + 4 * func;
 }
 
+constexpr uint32_t spim_psel_offset(int func) {
+    return 0x504 + 4 * func;
+}
+
 void _configure_uarte(uint32_t base, int group) {
     constexpr uint32_t pin_disconnect_value = 0xffffffff;
     auto rts = pinctrl::get_pin(pf::UARTE_RTS + group);
@@ -88,6 +96,43 @@ int _configure_twim(uint32_t base, int group) {
     return 0;
 }
 
+int _configure_spim(uint32_t base, int group) {
+    constexpr uint32_t pin_disconnect_value = 0xffffffff;
+    auto sck = pinctrl::get_pin(pf::SPIM_SCK + group);
+    if (sck == -1) {
+        return -1;
+    }
+
+    // SCK idles low, until the mode is configured
+    gpio_set_option(0, (1 << sck), GPIO_OPT_OUTPUT);
+    gpio_clear(0, (1 << sck));
+    raw_write32(base + spim_psel_offset(pf::SPIM_SCK), sck);
+
+    auto mosi = pinctrl::get_pin(pf::SPIM_MOSI + group);
+    if (mosi != -1) {
+        gpio_set_option(0, (1 << mosi), GPIO_OPT_OUTPUT);
+        raw_write32(base + spim_psel_offset(pf::SPIM_MOSI), mosi);
+    } else {
+        raw_write32(base + spim_psel_offset(pf::SPIM_MOSI), pin_disconnect_value);
+    }
+
+    auto miso = pinctrl::get_pin(pf::SPIM_MISO + group);
+    if (miso != -1) {
+        gpio_set_option(0, (1 << miso), GPIO_OPT_INPUT);
+        raw_write32(base + spim_psel_offset(pf::SPIM_MISO), miso);
+    } else {
+        raw_write32(base + spim_psel_offset(pf::SPIM_MISO), pin_disconnect_value);
+    }
+
+    // Chip select is not asserted until the first transfer
+    auto cs = pinctrl::get_pin(pf::SPIM_CS + group);
+    if (cs != -1) {
+        gpio_set_option(0, (1 << cs), GPIO_OPT_OUTPUT);
+        gpio_set(0, (1 << cs));
+    }
+
+    return 0;
+}
 
 }  // namespace
 
@@ -114,6 +159,15 @@ int request_function(int pin_function) {
     case pf::TWIM1_GROUP:
         ret = _configure_twim(twim1_base, pin_function);
         break;
+    case pf::SPIM0_GROUP:
+        ret = _configure_spim(spim0_base, pin_function);
+        break;
+    case pf::SPIM1_GROUP:
+        ret = _configure_spim(spim1_base, pin_function);
+        break;
+    case pf::SPIM2_GROUP:
+        ret = _configure_spim(spim2_base, pin_function);
+        break;
     case pf::UARTE0_RXD:
     case pf::UARTE1_RXD:
     case pf::UARTE0_CTS:
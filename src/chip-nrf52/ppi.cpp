@@ -0,0 +1,120 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "nrf52/ppi.hpp"
+
+#include "core/critical_section.hpp"
+#include "memio.h"
+
+namespace nrf52 {
+
+PPI PPI::ppi_;
+
+PPI* PPI::request() {
+    return &ppi_;
+}
+
+int PPI::alloc_channel(uint32_t event_addr, uint32_t task_addr) {
+    os::CriticalSection cs;
+    for (unsigned int ch = 0; ch < kNumChannels; ++ch) {
+        if (!(allocated_channels_ & channel_mask(ch))) {
+            allocated_channels_ |= channel_mask(ch);
+
+            raw_write32(base_ + kChenClrOffset, channel_mask(ch));
+            raw_write32(base_ + kChEepOffset + ch * 8, event_addr);
+            raw_write32(base_ + kChTepOffset + ch * 8, task_addr);
+            raw_write32(base_ + kForkTepOffset + ch * 4, 0);
+            return ch;
+        }
+    }
+
+    return -1;
+}
+
+void PPI::free_channel(int ch) {
+    os::CriticalSection cs;
+    if (!is_allocated(ch)) {
+        return;
+    }
+
+    raw_write32(base_ + kChenClrOffset, channel_mask(ch));
+    raw_write32(base_ + kChEepOffset + ch * 8, 0);
+    raw_write32(base_ + kChTepOffset + ch * 8, 0);
+    raw_write32(base_ + kForkTepOffset + ch * 4, 0);
+
+    // The channel could be a member of a group
+    for (unsigned int group = 0; group < kNumGroups; ++group) {
+        if (allocated_groups_ & (1u << group)) {
+            raw_clrbits_le32(base_ + kChgOffset + group * 4, channel_mask(ch));
+        }
+    }
+
+    allocated_channels_ &= ~channel_mask(ch);
+}
+
+int PPI::set_fork(int ch, uint32_t task_addr) {
+    if (!is_allocated(ch)) {
+        return -1;
+    }
+
+    raw_write32(base_ + kForkTepOffset + ch * 4, task_addr);
+    return 0;
+}
+
+void PPI::enable_channels(uint32_t mask) {
+    raw_write32(base_ + kChenSetOffset, mask & allocated_channels_);
+}
+
+void PPI::disable_channels(uint32_t mask) {
+    raw_write32(base_ + kChenClrOffset, mask & allocated_channels_);
+}
+
+int PPI::alloc_group(uint32_t channel_mask) {
+    os::CriticalSection cs;
+    for (unsigned int group = 0; group < kNumGroups; ++group) {
+        if (!(allocated_groups_ & (1u << group))) {
+            allocated_groups_ |= (1u << group);
+            raw_write32(base_ + kChgOffset + group * 4, channel_mask & allocated_channels_);
+            return group;
+        }
+    }
+
+    return -1;
+}
+
+void PPI::free_group(int group) {
+    os::CriticalSection cs;
+    if (!is_group_allocated(group)) {
+        return;
+    }
+
+    raw_write32(base_ + kChgOffset + group * 4, 0);
+    allocated_groups_ &= ~(1u << group);
+}
+
+void PPI::enable_group(int group) {
+    if (is_group_allocated(group)) {
+        raw_write32(get_group_enable_task(group), 1);
+    }
+}
+
+void PPI::disable_group(int group) {
+    if (is_group_allocated(group)) {
+        raw_write32(get_group_disable_task(group), 1);
+    }
+}
+
+}  // namespace nrf52
@@ -31,22 +31,22 @@ int Radio::set_frequency(unsigned int freq_mhz) {
         return -1;
     }
 
-    raw_write32(base_ + kFrequencyOffset, freq_mhz - kMinFreq);
+    FrequencyReg::write(freq_mhz - kMinFreq);
 
     return 0;
 }
 
 void Radio::set_power(bool is_on) {
-    raw_write32(base_ + kPowerOffset, is_on ? 1 : 0);
+    PowerReg::write(is_on ? 1 : 0);
 }
 
 int Radio::set_txpower(int8_t txpower) {
-    raw_write32(base_ + kTxPowerOffset, txpower & 0xff);
+    TxPowerReg::write(txpower & 0xff);
     return 0;
 }
 
 void Radio::set_mode(enum Mode mode) {
-    raw_write32(base_ + kModeOffset, mode);
+    ModeReg::write(mode);
 }
 
 Radio* Radio::request() {
@@ -67,14 +67,12 @@ int Radio::configure_packet(uint8_t length_bits, uint8_t s0_bytes, uint8_t s1_bi
         return -3;
     }
 
-    constexpr uint32_t pconf_mask = (0xf | (1 << 8) | (0xf << 16));
-    uint32_t value = (length_bits | (s0_bytes << 8) | (s1_bits << 16));
-    raw_set_masked(base_ + kPcnf0Offset, pconf_mask, value);
+    Pcnf0Reg::modify(Pcnf0Lflen::value(length_bits), Pcnf0S0len::value(s0_bytes), Pcnf0S1len::value(s1_bits));
     return 0;
 }
 
 int Radio::set_maxlen(uint8_t maxlen) {
-    raw_set_masked(base_ + kPcnf1Offset, 0xff, maxlen);
+    Pcnf1Maxlen::write(maxlen);
     return 0;
 }
 
@@ -83,16 +81,21 @@ int Radio::set_base_addr_len(uint8_t base_addr_len) {
         return -1;
     }
 
-    raw_set_masked(base_ + kPcnf1Offset, (7 << 16), (base_addr_len << 16));
+    Pcnf1Balen::write(base_addr_len);
     return 0;
 }
 
 void Radio::set_whitening(bool enable) {
-    if (enable) {
-        raw_setbits_le32(base_ + kPcnf1Offset, (1 << 25));
-    } else {
-        raw_clrbits_le32(base_ + kPcnf1Offset, (1 << 25));
+    Pcnf1WhiteEn::write(enable);
+}
+
+int Radio::configure_framing(uint8_t base_addr_len, bool whitening) {
+    if (base_addr_len > 4 || base_addr_len < 2) {
+        return -1;
     }
+
+    Pcnf1Reg::modify(Pcnf1Balen::value(base_addr_len), Pcnf1WhiteEn::value(whitening));
+    return 0;
 }
 
 int Radio::set_addr_base(int index, uint32_t base_addr) {
@@ -100,7 +103,7 @@ int Radio::set_addr_base(int index, uint32_t base_addr) {
         return -1;
     }
 
-    const uint32_t reg_addr = base_ + kBase0Offset + 4 * index;
+    const uint32_t reg_addr = Base0Reg::kAddr + 4 * index;
     raw_write32(reg_addr, base_addr);
     return 0;
 }
@@ -110,7 +113,7 @@ int Radio::set_addr_prefix(int index, uint8_t prefix) {
         return -1;
     }
 
-    const uint32_t reg_addr = base_ + (index < 4 ? kPrefix0Offset : kPrefix1Offset);
+    const uint32_t reg_addr = index < 4 ? Prefix0Reg::kAddr : Prefix1Reg::kAddr;
     const unsigned prefix_shift = (index % 4) * 8;
     raw_set_masked(reg_addr, 0xff << prefix_shift, prefix << prefix_shift);
     return 0;
@@ -121,7 +124,7 @@ int Radio::select_tx_addr(int index) {
         return -1;
     }
 
-    raw_write32(base_ + kTxAddressOffset, index);
+    TxAddressReg::write(index);
 
     return 0;
 }
@@ -131,7 +134,7 @@ int Radio::enable_rx_addr(int index) {
         return -1;
     }
 
-    raw_setbits_le32(base_ + kRxAddressesOffset, (1 << index));
+    RxAddressesReg::write(RxAddressesReg::read() | (1 << index));
 
     return 0;
 }
@@ -141,28 +144,22 @@ int Radio::configure_crc(unsigned int len, bool skip_addr, uint32_t crc_poly) {
         return -1;
     }
 
-    raw_write32(base_ + kCrcPolyOffset, crc_poly);
-
-    uint32_t conf = len;
-    if (skip_addr) {
-        conf |= (1 << 8);
-    }
-
-    raw_write32(base_ + kCrcCnfOffset, conf);
+    CrcPolyReg::write(crc_poly);
+    CrcCnfReg::write(CrcCnfLen::value(len), CrcCnfSkipAddr::value(skip_addr));
 
     return 0;
 }
 
 void Radio::set_crc_init(uint32_t crc_init) {
-    raw_write32(base_ + kCrcInitOffset, crc_init);
+    CrcInitReg::write(crc_init);
 }
 
 void Radio::set_ifs(uint8_t ifs_us) {
-    raw_write32(base_ + kTifsOffset, ifs_us);
+    TifsReg::write(ifs_us);
 }
 
 void Radio::set_white_iv(uint8_t iv) {
-    raw_write32(base_ + kDataWhiteIVOffset, iv);
+    DataWhiteIVReg::write(iv);
 }
 
 }  // namespace nrf52
@@ -0,0 +1,56 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "nrf52/shared_instances.hpp"
+
+#include "core/critical_section.hpp"
+
+namespace nrf52 {
+
+SharedInstances SharedInstances::instances_;
+
+SharedInstances* SharedInstances::request() {
+    return &instances_;
+}
+
+int SharedInstances::claim(unsigned int id, const void* owner) {
+    if (!is_shared(id)) {
+        return 0;
+    }
+
+    os::CriticalSection cs;
+    auto& current = owners_[id - kFirstSharedID];
+    if (current && current != owner) {
+        return -1;
+    }
+
+    current = owner;
+    return 0;
+}
+
+void SharedInstances::release(unsigned int id, const void* owner) {
+    if (!is_shared(id)) {
+        return;
+    }
+
+    os::CriticalSection cs;
+    auto& current = owners_[id - kFirstSharedID];
+    if (current == owner) {
+        current = nullptr;
+    }
+}
+
+}  // namespace nrf52
@@ -0,0 +1,500 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "driver/spi.hpp"
+
+#include "cutils.h"
+#include "memio.h"
+#include "nvic.h"
+#include "pinctrl.hpp"
+
+#include "nrf52/easydma.hpp"
+#include "nrf52/gpiote.hpp"
+#include "nrf52/peripheral.hpp"
+#include "nrf52/periph_utils.hpp"
+#include "nrf52/pinctrl.hpp"
+#include "nrf52/ppi.hpp"
+#include "nrf52/shared_instances.hpp"
+#include "nrf52/timer.hpp"
+
+
+namespace driver {
+
+namespace {
+
+constexpr auto kSpim0ID = 3;
+constexpr auto kSpim1ID = 4;
+constexpr auto kSpim2ID = 35;
+
+void spim0_irq_handler();
+
+void spim1_irq_handler();
+
+void spim2_irq_handler();
+
+struct FrequencyConfig {
+    unsigned int freq;
+    uint32_t conf_value;
+};
+
+// Sorted by the frequency, descending
+constexpr FrequencyConfig supported_frequencies[] = {
+    { .freq = 8 * 1000 * 1000, .conf_value = 0x80000000 },
+    { .freq = 4 * 1000 * 1000, .conf_value = 0x40000000 },
+    { .freq = 2 * 1000 * 1000, .conf_value = 0x20000000 },
+    { .freq = 1000 * 1000, .conf_value = 0x10000000 },
+    { .freq = 500 * 1000, .conf_value = 0x08000000 },
+    { .freq = 250 * 1000, .conf_value = 0x04000000 },
+    { .freq = 125 * 1000, .conf_value = 0x02000000 },
+};
+
+class SPIM : public SPI, public nrf52::Peripheral {
+    public:
+        SPIM(unsigned int id, irq_handler_func_t irq_handler, int func_group) :
+            driver::Peripheral(periph::id_to_base(id), id), irq_handler_{irq_handler},
+            func_group_{func_group} {}
+
+        int request() override {
+            // SPIM0 and SPIM1 share the instances with TWIM0 and TWIM1
+            if (nrf52::SharedInstances::request()->claim(irq_n_, this) < 0) {
+                return -1;
+            }
+
+            int ret = pinctrl::request_function(func_group_);
+            if (ret < 0) {
+                if (!configured_) {
+                    nrf52::SharedInstances::request()->release(irq_n_, this);
+                }
+                return ret;
+            }
+
+            if (!configured_) {
+                set_frequency(kDefaultFrequency);
+                set_mode(Mode::MODE0);
+                raw_write32(base_ + kOrc, kDefaultOrc);
+                raw_write32(base_ + kEnableOffset, kEnableValue);
+                configured_ = true;
+            }
+
+            return ret;
+        }
+
+        void release() override {
+            if (busy_) {
+                return;
+            }
+
+            disable_irq();
+            raw_write32(base_ + kEnableOffset, 0);
+            configured_ = false;
+            nrf52::SharedInstances::request()->release(irq_n_, this);
+        }
+
+        unsigned int set_frequency(unsigned int freq) override {
+            for (size_t i = 0; i < ARRAY_SIZE(supported_frequencies); ++i) {
+                if (supported_frequencies[i].freq <= freq) {
+                    raw_write32(base_ + kFrequency, supported_frequencies[i].conf_value);
+                    return supported_frequencies[i].freq;
+                }
+            }
+
+            return 0;
+        }
+
+        int set_mode(Mode mode) override {
+            // MSB first
+            uint32_t config = 0;
+            if (mode == Mode::MODE1 || mode == Mode::MODE3) {
+                config |= kConfigCpha;
+            }
+            if (mode == Mode::MODE2 || mode == Mode::MODE3) {
+                config |= kConfigCpol;
+            }
+
+            raw_write32(base_ + kConfig, config);
+            return 0;
+        }
+
+        int transfer(const uint8_t* tx_data, size_t tx_size, uint8_t* rx_data, size_t rx_size,
+                     EventHandler* handler) override {
+            if (busy_ || !(tx_size || rx_size) || !nrf52::is_dma_accessible(tx_data, tx_size)
+                || !nrf52::is_dma_accessible(rx_data, rx_size)) {
+                return -1;
+            }
+
+            if (alloc_cs() < 0) {
+                return -1;
+            }
+
+            tx_data_ = tx_data;
+            tx_remaining_ = tx_size;
+            rx_data_ = rx_data;
+            rx_remaining_ = rx_size;
+            raw_write32(base_ + kTxdList, kListDisabled);
+            raw_write32(base_ + kRxdList, kListDisabled);
+
+            start_xfer(rx_data, handler);
+            // Buffers longer than MAXCNT are sent in chunks, the chip select
+            // stays asserted in between.
+            start_chunk();
+
+            return 0;
+        }
+
+        int stream(const uint8_t* tx_data, size_t tx_item_size, uint8_t* rx_data, size_t rx_item_size,
+                   size_t count, EventHandler* handler) override {
+            if (busy_ || !count || !(tx_item_size || rx_item_size)
+                || tx_item_size > kMaxCnt || rx_item_size > kMaxCnt
+                || !nrf52::is_dma_accessible(tx_data, tx_item_size * count)
+                || !nrf52::is_dma_accessible(rx_data, rx_item_size * count)) {
+                return -1;
+            }
+
+            if (alloc_cs() < 0) {
+                return -1;
+            }
+            if (count > 1 && setup_stream_chain(count) < 0) {
+                free_cs();
+                return -1;
+            }
+
+            // The pointers are moved by MAXCNT after each item
+            raw_writeptr(base_ + kTxdPtr, const_cast<uint8_t*>(tx_data));
+            raw_write32(base_ + kTxdMaxCnt, tx_item_size);
+            raw_write32(base_ + kTxdList, tx_item_size ? kListArrayList : kListDisabled);
+            raw_writeptr(base_ + kRxdPtr, rx_data);
+            raw_write32(base_ + kRxdMaxCnt, rx_item_size);
+            raw_write32(base_ + kRxdList, rx_item_size ? kListArrayList : kListDisabled);
+
+            tx_remaining_ = 0;
+            rx_remaining_ = 0;
+            start_xfer(rx_data, handler);
+            stream_count_ = count;
+            if (count == 1) {
+                enable_cs_release();
+            }
+            trigger_task(Task::START);
+
+            return 0;
+        }
+
+        bool is_busy() const override {
+            return busy_;
+        }
+
+        void handle_irq() {
+            if (is_event_active(Event::END)) {
+                clear_event(Event::END);
+                if (!busy_) {
+                    return;
+                }
+
+                if (tx_remaining_ || rx_remaining_) {
+                    start_chunk();
+                } else if (get_items_done() >= stream_count_) {
+                    finish_xfer();
+                }
+            }
+        }
+
+    private:
+        enum Task {
+            START = (0x010 >> 2),
+            STOP,
+        };
+
+        enum Event {
+            STOPPED = 1,
+            END_RX = 4,
+            END = 6,
+            END_TX = 8,
+            STARTED = 19,
+        };
+
+        // The chip select is deasserted by the END event of the last transfer through PPI,
+        // the channels are only held for the duration of the transfer.
+        int alloc_cs() {
+            const int cs_pin = pinctrl::get_pin(func_group_ + pinctrl::function::SPIM_CS);
+            if (cs_pin < 0) {
+                return 0;
+            }
+
+            auto* gpiote = nrf52::GPIOTE::request();
+            cs_channel_ = gpiote->alloc_output(cs_pin, true);
+            if (cs_channel_ < 0) {
+                return -1;
+            }
+
+            release_ppi_channel_ = nrf52::PPI::request()->alloc_channel(get_event_addr(Event::END),
+                                                                        gpiote->get_set_task(cs_channel_));
+            if (release_ppi_channel_ < 0) {
+                free_cs();
+                return -1;
+            }
+
+            return 0;
+        }
+
+        void free_cs() {
+            nrf52::PPI::request()->free_channel(release_ppi_channel_);
+            nrf52::GPIOTE::request()->free_channel(cs_channel_);
+            release_ppi_channel_ = -1;
+            cs_channel_ = -1;
+        }
+
+        void start_xfer(uint8_t* rx_data, EventHandler* handler) {
+            busy_ = true;
+            rx_start_ = rx_data;
+            handler_ = handler;
+            stream_count_ = 1;
+
+            set_irq_handler(irq_handler_);
+            clear_event(Event::END);
+            raw_write32(base_ + kIntenSetOffset, kIntEnd);
+            enable_irq();
+
+            if (cs_channel_ >= 0) {
+                raw_write32(nrf52::GPIOTE::request()->get_clr_task(cs_channel_), 1);
+            }
+        }
+
+        void start_chunk() {
+            const size_t remaining = MAX(tx_remaining_, rx_remaining_);
+            const size_t len = MIN(remaining, kMaxCnt);
+            const size_t tx_len = MIN(tx_remaining_, len);
+            const size_t rx_len = MIN(rx_remaining_, len);
+
+            raw_writeptr(base_ + kTxdPtr, const_cast<uint8_t*>(tx_data_));
+            raw_write32(base_ + kTxdMaxCnt, tx_len);
+            raw_writeptr(base_ + kRxdPtr, rx_data_);
+            raw_write32(base_ + kRxdMaxCnt, rx_len);
+
+            tx_data_ += tx_len;
+            tx_remaining_ -= tx_len;
+            rx_data_ = rx_data_ ? rx_data_ + rx_len : nullptr;
+            rx_remaining_ -= rx_len;
+
+            if (!tx_remaining_ && !rx_remaining_) {
+                enable_cs_release();
+            }
+            trigger_task(Task::START);
+        }
+
+        void enable_cs_release() {
+            if (release_ppi_channel_ >= 0) {
+                nrf52::PPI::request()->enable_channels(nrf52::PPI::channel_mask(release_ppi_channel_));
+            }
+        }
+
+        // The items are started from END event by PPI. The counter of the items
+        // disables the restarting channel, and lets the last END deassert the chip select.
+        int setup_stream_chain(size_t count) {
+            counter_id_ = nrf52::TimerPool::request()->alloc();
+            if (counter_id_ < 0) {
+                return -1;
+            }
+            counter_base_ = periph::id_to_base(counter_id_);
+
+            auto* ppi = nrf52::PPI::request();
+            restart_ppi_channel_ = ppi->alloc_channel(get_event_addr(Event::END), get_task_addr(Task::START));
+            count_ppi_channel_ = ppi->alloc_channel(get_event_addr(Event::END), counter_base_ + kTimerTasksCount);
+            restart_group_ = ppi->alloc_group(nrf52::PPI::channel_mask(restart_ppi_channel_));
+            limit_ppi_channel_ = ppi->alloc_channel(counter_base_ + kTimerEventsCompare0,
+                                                    ppi->get_group_disable_task(restart_group_));
+            if (restart_ppi_channel_ < 0 || count_ppi_channel_ < 0 || limit_ppi_channel_ < 0 || restart_group_ < 0) {
+                free_stream_chain();
+                return -1;
+            }
+
+            if (release_ppi_channel_ >= 0) {
+                release_group_ = ppi->alloc_group(nrf52::PPI::channel_mask(release_ppi_channel_));
+                if (release_group_ < 0) {
+                    free_stream_chain();
+                    return -1;
+                }
+                ppi->set_fork(limit_ppi_channel_, ppi->get_group_enable_task(release_group_));
+            }
+
+            raw_write32(counter_base_ + kTimerModeOffset, kTimerModeLowPowerCounter);
+            raw_write32(counter_base_ + kTimerBitModeOffset, kTimerBitMode32);
+            // The last item is started by the one before it
+            raw_write32(counter_base_ + kTimerCc0, count - 1);
+            raw_write32(counter_base_ + kTimerTasksClear, 1);
+            raw_write32(counter_base_ + kTimerTasksStart, 1);
+
+            ppi->enable_channels(nrf52::PPI::channel_mask(count_ppi_channel_) |
+                                 nrf52::PPI::channel_mask(limit_ppi_channel_));
+            ppi->enable_group(restart_group_);
+
+            return 0;
+        }
+
+        void free_stream_chain() {
+            auto* ppi = nrf52::PPI::request();
+            ppi->free_group(restart_group_);
+            ppi->free_group(release_group_);
+            ppi->free_channel(restart_ppi_channel_);
+            ppi->free_channel(count_ppi_channel_);
+            ppi->free_channel(limit_ppi_channel_);
+            restart_group_ = -1;
+            release_group_ = -1;
+            restart_ppi_channel_ = -1;
+            count_ppi_channel_ = -1;
+            limit_ppi_channel_ = -1;
+            raw_write32(counter_base_ + kTimerTasksStop, 1);
+            nrf52::TimerPool::request()->free(counter_id_);
+            counter_id_ = -1;
+        }
+
+        size_t get_items_done() {
+            if (count_ppi_channel_ < 0) {
+                return 1;
+            }
+
+            raw_write32(counter_base_ + kTimerTasksCapture1, 1);
+            return raw_read32(counter_base_ + kTimerCc1);
+        }
+
+        void finish_xfer() {
+            raw_write32(base_ + kIntenClrOffset, kIntEnd);
+            if (count_ppi_channel_ >= 0) {
+                free_stream_chain();
+            }
+            // The pin goes back to GPIO, which holds it high
+            free_cs();
+            busy_ = false;
+
+            if (handler_) {
+                EventInfo e_info;
+                e_info.irq_n = irq_n_;
+                e_info.evt_id = SPI::Event::XFER_DONE;
+                e_info.src = this;
+                e_info.data = rx_start_;
+                handler_->handle_event(&e_info);
+            }
+        }
+
+        static constexpr auto kIntenSetOffset = 0x304;
+        static constexpr auto kIntenClrOffset = 0x308;
+        static constexpr uint32_t kIntEnd = (1 << Event::END);
+
+        static constexpr auto kEnableOffset = 0x500;
+        static constexpr auto kEnableValue = 7;
+        static constexpr auto kFrequency = 0x524;
+
+        static constexpr auto kRxdPtr = 0x534;
+        static constexpr auto kRxdMaxCnt = 0x538;
+        static constexpr auto kRxdList = 0x540;
+        static constexpr auto kTxdPtr = 0x544;
+        static constexpr auto kTxdMaxCnt = 0x548;
+        static constexpr auto kTxdList = 0x550;
+        static constexpr uint32_t kListDisabled = 0;
+        static constexpr uint32_t kListArrayList = 1;
+
+        static constexpr auto kConfig = 0x554;
+        static constexpr uint32_t kConfigCpha = (1 << 1);
+        static constexpr uint32_t kConfigCpol = (1 << 2);
+        static constexpr auto kOrc = 0x5c0;
+
+        // MAXCNT registers are 8 bits wide on nRF52832
+        static constexpr size_t kMaxCnt = 255;
+        static constexpr auto kDefaultFrequency = 1000 * 1000;
+        static constexpr uint32_t kDefaultOrc = 0xff;
+
+        // TIMER registers, for the counter of the items
+        static constexpr auto kTimerTasksStart = 0x000;
+        static constexpr auto kTimerTasksStop = 0x004;
+        static constexpr auto kTimerTasksCount = 0x008;
+        static constexpr auto kTimerTasksClear = 0x00c;
+        static constexpr auto kTimerTasksCapture1 = 0x044;
+        static constexpr auto kTimerEventsCompare0 = 0x140;
+        static constexpr auto kTimerModeOffset = 0x504;
+        static constexpr auto kTimerBitModeOffset = 0x508;
+        static constexpr auto kTimerCc0 = 0x540;
+        static constexpr auto kTimerCc1 = 0x544;
+        static constexpr uint32_t kTimerModeLowPowerCounter = 2;
+        static constexpr uint32_t kTimerBitMode32 = 3;
+
+        bool configured_ = false;
+        irq_handler_func_t irq_handler_;
+        // Counter of the streamed items, from the TimerPool
+        int counter_id_ = -1;
+        uint32_t counter_base_ = 0;
+        const int func_group_;
+
+        int cs_channel_ = -1;
+        int release_ppi_channel_ = -1;
+
+        volatile bool busy_ = false;
+        uint8_t* rx_start_ = nullptr;
+        EventHandler* handler_ = nullptr;
+
+        // The rest of the chunked transfer
+        const uint8_t* tx_data_ = nullptr;
+        size_t tx_remaining_ = 0;
+        uint8_t* rx_data_ = nullptr;
+        size_t rx_remaining_ = 0;
+
+        size_t stream_count_ = 1;
+        int restart_ppi_channel_ = -1;
+        int count_ppi_channel_ = -1;
+        int limit_ppi_channel_ = -1;
+        int restart_group_ = -1;
+        int release_group_ = -1;
+};
+
+SPIM spim0{kSpim0ID, spim0_irq_handler, pinctrl::function::SPIM0_GROUP};
+SPIM spim1{kSpim1ID, spim1_irq_handler, pinctrl::function::SPIM1_GROUP};
+SPIM spim2{kSpim2ID, spim2_irq_handler, pinctrl::function::SPIM2_GROUP};
+
+void spim0_irq_handler() {
+    spim0.handle_irq();
+}
+
+void spim1_irq_handler() {
+    spim1.handle_irq();
+}
+
+void spim2_irq_handler() {
+    spim2.handle_irq();
+}
+
+}  // namespace
+
+SPI* SPI::request_by_id(SPI::ID id) {
+    SPI* ret = nullptr;
+    switch (id) {
+    case ID::SPIM0:
+        ret = &spim0;
+        break;
+    case ID::SPIM1:
+        ret = &spim1;
+        break;
+    case ID::SPIM2:
+        ret = &spim2;
+        break;
+    default:
+        break;
+    }
+
+    if (ret && ret->request() < 0) {
+        ret = nullptr;
+    }
+
+    return ret;
+}
+
+}  // namespace driver
@@ -15,20 +15,83 @@
 *******************************************************************************/
 
 #include "driver/timer.hpp"
+#include "driver/prescaler.hpp"
 
 #include "clk.h"
+#include "core/critical_section.hpp"
 #include "cutils.h"
 #include "memio.h"
 #include "nvic.h"
 #include "nrf52/clk.h"
+#include "nrf52/gpiote.hpp"
 #include "nrf52/peripheral.hpp"
 #include "nrf52/periph_utils.hpp"
+#include "nrf52/ppi.hpp"
+#include "nrf52/rtc.hpp"
+#include "nrf52/timer.hpp"
+
+namespace nrf52 {
+
+TimerPool TimerPool::pool_;
+
+TimerPool* TimerPool::request() {
+    return &pool_;
+}
+
+int TimerPool::get_index(unsigned int id) {
+    for (unsigned int i = 0; i < kNumTimers; ++i) {
+        if (kTimerIDs[i] == id) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int TimerPool::alloc() {
+    os::CriticalSection cs;
+    for (unsigned int i = 0; i < kNumTimers; ++i) {
+        if (!(allocated_ & (1u << i))) {
+            allocated_ |= (1u << i);
+            return kTimerIDs[i];
+        }
+    }
+
+    return -1;
+}
+
+int TimerPool::reserve(unsigned int id) {
+    const int index = get_index(id);
+    if (index < 0) {
+        return -1;
+    }
+
+    os::CriticalSection cs;
+    if (allocated_ & (1u << index)) {
+        return -1;
+    }
+
+    allocated_ |= (1u << index);
+    return 0;
+}
+
+void TimerPool::free(unsigned int id) {
+    const int index = get_index(id);
+    if (index < 0) {
+        return;
+    }
+
+    os::CriticalSection cs;
+    allocated_ &= ~(1u << index);
+}
+
+}  // namespace nrf52
 
 namespace driver {
 
 namespace {
 
-constexpr unsigned int kNumRTCEvents = 6;
+constexpr unsigned int kNumRTCEvents = 20;
 
 void rtc0_irq_handler();
 
@@ -36,111 +99,155 @@ void rtc1_irq_handler();
 
 void rtc2_irq_handler();
 
+// Shared by all of the RTCs
+bool lfclk_started = false;
+
+// Thin adapter of nrf52::RTC to the driver::Timer interface
+template <unsigned int PeriphID>
 class RTC : public Timer, public nrf52::Peripheral {
     public:
-        RTC(unsigned int id) : driver::Peripheral(periph::id_to_base(id), id, &evt_handler_storage_) {}
-        RTC(unsigned int id, irq_handler_func_t irq_handler) : driver::Peripheral(periph::id_to_base(id), id,
-                    &evt_handler_storage_),
+        using Regs = nrf52::RTC<PeriphID>;
+
+        RTC(irq_handler_func_t irq_handler) : driver::Peripheral(Regs::kBase, Regs::kIrqN, &evt_handler_storage_),
             irq_handler_{irq_handler} {}
 
+        // Given out by request_by_id() once, until release()
+        bool reserve() {
+            os::CriticalSection cs;
+            if (reserved_) {
+                return false;
+            }
+
+            reserved_ = true;
+            // The previous owner may have used the interrupt
+            irq_handler_configured_ = false;
+            return true;
+        }
+
+        void release() override {
+            if (!reserved_) {
+                return;
+            }
+
+            Regs::stop();
+            Regs::disable_event_interrupts(~0u);
+            reserved_ = false;
+        }
+
         void start() override {
             if (!lfclk_started) {
                 clk_request(kLfclkSrc);
                 lfclk_started = 1;
             }
-            trigger_task(Task::START);
+            Regs::start();
         }
 
         void stop() override {
-            trigger_task(Task::STOP);
+            Regs::stop();
         }
 
         unsigned int get_rate() const override {
-            auto presc = raw_read32(base_ + kPrescalerOffset);
-            return kBaseRate / ((presc & 0xfff) + 1);
+            return Regs::get_rate();
         }
 
         unsigned int get_base_rate() const override {
-            return kBaseRate;
+            return Regs::kBaseRate;
         }
 
         void set_prescaler(unsigned int presc) override {
             // TODO: debug assert that the timer is stopped
-            raw_write32(base_ + kPrescalerOffset, presc - 1);
+            Regs::set_prescaler(presc);
         }
 
         unsigned int request_rate(unsigned int req_rate) override {
-            constexpr unsigned int min_rate = kBaseRate / (1 << 12);
-            // This is the smallest possible rate right now.
-            if (req_rate < min_rate) {
-                return 0;
+            const auto config = driver::prescaler::for_rate(Regs::kPrescalerSpace, Regs::kBaseRate, req_rate);
+            if (config.is_valid()) {
+                set_prescaler(config.presc);
             }
 
-            req_rate = MIN(kBaseRate, req_rate);
-
-            unsigned int presc = MIN(kBaseRate / req_rate, kMaxPrescaler);
-            unsigned int new_rate = kBaseRate / presc;
-            if (new_rate > req_rate) {
-                ++presc;
-                new_rate = kBaseRate / presc;
-            }
-
-            set_prescaler(presc);
-            return kBaseRate / presc;
+            return config.rate;
         }
 
         void enable_interrupts(uint32_t mask) override {
             if (!irq_handler_configured_) {
                 if (irq_handler_) {
-                    set_irq_handler(irq_handler_);
+                    Regs::set_irq_handler(irq_handler_);
                     irq_handler_configured_ = true;
                 }
             }
-            raw_write32(base_ + kIntenSetOffset, mask);
-            raw_write32(base_ + kEvtenSetOffset, mask);
-            enable_irq();
+            Regs::enable_event_interrupts(mask);
+            Regs::enable_irq();
         }
 
         void disable_interrupts(uint32_t mask) override {
-            raw_write32(base_ + kIntenClrOffset, mask);
+            Regs::disable_interrupts(mask);
         }
 
         void enable_tick_interrupt() override {
-            enable_interrupts(kIntenTick);
+            enable_interrupts(1 << Regs::Event::TICK);
         }
 
-    private:
-        enum Task {
-            START,
-            STOP
-        };
+        void disable_tick_interrupt() override {
+            Regs::disable_tick_interrupt();
+        }
 
-        static constexpr auto kIntenSetOffset = 0x304;
-        static constexpr auto kIntenClrOffset = 0x308;
-        static constexpr auto kEvtenSetOffset = 0x344;
-        static constexpr auto kEvtenClrOffset = 0x348;
+        unsigned int get_num_channels() const override {
+            return Regs::kNumChannels;
+        }
 
-        static constexpr auto kPrescalerOffset = 0x508;
-        static constexpr unsigned int kBaseRate = 32768;
-        static constexpr unsigned int kMaxPrescaler = (1 << 12);
+        uint32_t get_counter_mask() const override {
+            return Regs::kCounterMask;
+        }
 
-        static constexpr uint32_t kIntenTick = (1 << 0);
+        uint32_t get_counter() const override {
+            return Regs::get_counter();
+        }
 
-        static bool lfclk_started;
+        int set_compare(unsigned int channel, uint32_t value) override {
+            if (channel >= Regs::kNumChannels) {
+                return -1;
+            }
+
+            Regs::set_compare(channel, value);
+            return 0;
+        }
+
+        int get_compare_event(unsigned int channel) const override {
+            if (channel >= Regs::kNumChannels) {
+                return -1;
+            }
+
+            return Regs::Event::COMPARE0 + channel;
+        }
+
+    protected:
+        // The event accesses of the interrupt handler are at the constant addresses
+        bool is_event_active(int evt) const override {
+            return Regs::is_event_active(evt);
+        }
+
+        void clear_event(int evt) override {
+            Regs::clear_event(evt);
+        }
+
+        uint32_t get_pending_events(uint32_t mask) const override {
+            return Regs::get_pending_events(mask);
+        }
+
+    private:
         // TODO: make this configurable
         static constexpr auto kLfclkSrc = NRF52_LFCLK_XTAL;
 
-        HandlerContainerT evt_handler_storage_{kNumRTCEvents, nullptr};
+        HandlerTable<kNumRTCEvents> evt_handler_storage_ = {};
 
         bool irq_handler_configured_ = false;
         irq_handler_func_t irq_handler_ = nullptr;
+        bool reserved_ = false;
 };
 
-bool RTC::lfclk_started = 0;
-
-RTC rtc0{11, rtc0_irq_handler};
-RTC rtc1{17, rtc1_irq_handler};
-RTC rtc2{36, rtc2_irq_handler};
+RTC<11> rtc0{rtc0_irq_handler};
+RTC<17> rtc1{rtc1_irq_handler};
+RTC<36> rtc2{rtc2_irq_handler};
 
 void rtc0_irq_handler() {
     rtc0.handle_events();
@@ -154,77 +261,305 @@ void rtc2_irq_handler() {
     rtc2.handle_events();
 }
 
+void timer0_irq_handler();
+
+void timer1_irq_handler();
+
+void timer2_irq_handler();
+
+void timer3_irq_handler();
+
+void timer4_irq_handler();
+
+// Adapter of nrf52::TIMER to the driver::Timer interface, with the pins driven by GPIOTE and PPI
+template <unsigned int PeriphID>
 class TimerCounter : public Timer, public nrf52::Peripheral {
     public:
-        enum Task {
-            START,
-            STOP,
-            COUNT,
-            CLEAR,
-            SHUTDOWN,
-        };
+        using Regs = nrf52::TIMER<PeriphID>;
+
+        TimerCounter(irq_handler_func_t irq_handler) : driver::Peripheral(Regs::kBase, Regs::kIrqN, &evt_handler_storage_),
+            irq_handler_{irq_handler} {}
 
-        TimerCounter(unsigned int id) : driver::Peripheral(periph::id_to_base(id), id, &evt_handler_storage_) {}
+        // Taken from the TimerPool by request_by_id(), until release()
+        bool reserve() {
+            if (!reserved_) {
+                reserved_ = (nrf52::TimerPool::request()->reserve(PeriphID) == 0);
+                // The previous owner may have used the interrupt
+                irq_handler_configured_ = false;
+            }
+
+            return reserved_;
+        }
+
+        void release() override {
+            if (!reserved_) {
+                return;
+            }
+
+            Regs::stop();
+            Regs::disable_interrupts(~0u);
+            disconnect_pins();
+            reserved_ = false;
+            nrf52::TimerPool::request()->free(PeriphID);
+        }
 
         void start() override {
-            trigger_task(Task::START);
+            Regs::start();
         }
 
         void stop() override {
-            trigger_task(Task::STOP);
+            Regs::stop();
         }
 
         unsigned int get_rate() const override {
-            unsigned int presc = raw_read32(base_ + kPrescalerOffset);
-
-            return kInputRate / (1 << presc);
+            return Regs::kBaseRate / (1 << Regs::get_prescaler());
         }
 
         unsigned int get_base_rate() const override {
-            return kInputRate;
+            return Regs::kBaseRate;
         }
 
         void set_prescaler(unsigned int presc) override {
-            unsigned int real_presc = MIN(presc, kMaxPrescaler);
-            raw_write32(base_ + kPrescalerOffset, real_presc);
+            Regs::set_prescaler(MIN(presc, Regs::kMaxPrescaler));
         }
 
         unsigned int request_rate(unsigned int req_rate) override {
-            unsigned int presc = 10;
-            const auto min_rate = kInputRate / (1 << (presc - 1));
-            // This is the smallest possible rate right now.
-            if (req_rate < min_rate) {
-                return 0;
+            const auto config = driver::prescaler::for_rate(Regs::kPrescalerSpace, Regs::kBaseRate, req_rate);
+            if (config.is_valid()) {
+                set_prescaler(config.presc);
             }
 
-            for (; presc > 0; --presc) {
-                if ((kInputRate / (1 << (presc - 1))) > req_rate) {
-                    break;
+            return config.rate;
+        }
+
+        void enable_interrupts(uint32_t mask) override {
+            if (!irq_handler_configured_) {
+                if (irq_handler_) {
+                    Regs::set_irq_handler(irq_handler_);
+                    irq_handler_configured_ = true;
                 }
             }
+            Regs::enable_interrupts(mask);
+            Regs::enable_irq();
+        }
+
+        void disable_interrupts(uint32_t mask) override {
+            Regs::disable_interrupts(mask);
+        }
+
+        // The tick is COMPARE0, the channel 0 with CompareAction::CLEAR sets its period
+        void enable_tick_interrupt() override {
+            enable_interrupts(1 << Regs::Event::COMPARE0);
+        }
+
+        void disable_tick_interrupt() override {
+            disable_interrupts(1 << Regs::Event::COMPARE0);
+        }
+
+        // The last CC channel is kept for get_counter()
+        unsigned int get_num_channels() const override {
+            return kNumUserChannels;
+        }
+
+        uint32_t get_counter_mask() const override {
+            switch (Regs::get_bit_mode()) {
+            case Regs::BitMode::BITS8:
+                return 0xff;
+            case Regs::BitMode::BITS24:
+                return 0xffffff;
+            case Regs::BitMode::BITS32:
+                return 0xffffffff;
+            default:
+                return 0xffff;
+            }
+        }
+
+        uint32_t get_counter() const override {
+            return Regs::capture(kCounterChannel);
+        }
+
+        int set_compare(unsigned int channel, uint32_t value) override {
+            if (channel >= kNumUserChannels) {
+                return -1;
+            }
+
+            Regs::set_compare(channel, value);
+            return 0;
+        }
+
+        int get_compare_event(unsigned int channel) const override {
+            if (channel >= kNumUserChannels) {
+                return -1;
+            }
+
+            return Regs::Event::COMPARE0 + channel;
+        }
+
+        int set_compare_action(unsigned int channel, CompareAction action) override {
+            if (channel >= kNumUserChannels) {
+                return -1;
+            }
+
+            Regs::set_compare_shorts(channel, action == CompareAction::CLEAR, action == CompareAction::STOP);
+            return 0;
+        }
+
+        int set_counter_width(unsigned int bits) override {
+            switch (bits) {
+            case 8:
+                Regs::set_bit_mode(Regs::BitMode::BITS8);
+                break;
+            case 16:
+                Regs::set_bit_mode(Regs::BitMode::BITS16);
+                break;
+            case 24:
+                Regs::set_bit_mode(Regs::BitMode::BITS24);
+                break;
+            case 32:
+                Regs::set_bit_mode(Regs::BitMode::BITS32);
+                break;
+            default:
+                return -1;
+            }
+
+            return 0;
+        }
+
+        int capture(unsigned int channel, uint32_t* value) override {
+            if (channel >= kNumUserChannels) {
+                return -1;
+            }
+
+            *value = Regs::capture(channel);
+            return 0;
+        }
+
+        int connect_pin(unsigned int channel, unsigned int pin, PinAction action) override {
+            if (channel >= kNumUserChannels || num_connections_ >= kMaxConnections) {
+                return -1;
+            }
 
-            set_prescaler(presc);
-            return kInputRate / (1 << presc);
+            const int gpiote_ch = get_pin_output(pin);
+            if (gpiote_ch < 0) {
+                return -1;
+            }
+
+            auto* gpiote = nrf52::GPIOTE::request();
+            uint32_t task = gpiote->get_out_task(gpiote_ch);
+            if (action == PinAction::SET) {
+                task = gpiote->get_set_task(gpiote_ch);
+            } else if (action == PinAction::CLEAR) {
+                task = gpiote->get_clr_task(gpiote_ch);
+            }
+
+            auto* ppi = nrf52::PPI::request();
+            const int ppi_ch = ppi->alloc_channel(Regs::get_event_addr(Regs::Event::COMPARE0 + channel), task);
+            if (ppi_ch < 0) {
+                return -1;
+            }
+
+            ppi_channels_[num_connections_++] = ppi_ch;
+            ppi->enable_channels(nrf52::PPI::channel_mask(ppi_ch));
+            return 0;
         }
 
-        void enable_tick_interrupt() override {}
+        void disconnect_pins() override {
+            auto* ppi = nrf52::PPI::request();
+            for (unsigned int i = 0; i < num_connections_; ++i) {
+                ppi->free_channel(ppi_channels_[i]);
+            }
+            num_connections_ = 0;
+
+            auto* gpiote = nrf52::GPIOTE::request();
+            for (unsigned int i = 0; i < num_pins_; ++i) {
+                gpiote->free_channel(pins_[i].gpiote_ch);
+            }
+            num_pins_ = 0;
+        }
+
+    protected:
+        bool is_event_active(int evt) const override {
+            return Regs::is_event_active(evt);
+        }
+
+        void clear_event(int evt) override {
+            Regs::clear_event(evt);
+        }
+
+        uint32_t get_pending_events(uint32_t mask) const override {
+            return Regs::get_pending_events(mask);
+        }
 
     private:
-        static constexpr unsigned kMaxPrescaler = 9;
-        static constexpr unsigned int kInputRate = 16 * 1000 * 1000;
+        static constexpr unsigned int kCounterChannel = Regs::kNumChannels - 1;
+        static constexpr unsigned int kNumUserChannels = kCounterChannel;
+        static constexpr unsigned int kNumTimerEvents = Regs::Event::COMPARE0 + Regs::kNumChannels;
+        // PPI channels, e.g. two for each of the PWM outputs
+        static constexpr unsigned int kMaxConnections = 6;
+        static constexpr unsigned int kMaxPins = 4;
+
+        struct PinOutput {
+            unsigned int pin;
+            int gpiote_ch;
+        };
+
+        // GPIOTE channel driving the pin, shared by the connections of the pin
+        int get_pin_output(unsigned int pin) {
+            for (unsigned int i = 0; i < num_pins_; ++i) {
+                if (pins_[i].pin == pin) {
+                    return pins_[i].gpiote_ch;
+                }
+            }
+
+            if (num_pins_ >= kMaxPins) {
+                return -1;
+            }
+
+            const int gpiote_ch = nrf52::GPIOTE::request()->alloc_output(pin, false);
+            if (gpiote_ch >= 0) {
+                pins_[num_pins_++] = PinOutput{pin, gpiote_ch};
+            }
 
-        static constexpr uint32_t kPrescalerOffset = 0x510;
+            return gpiote_ch;
+        }
 
-        static constexpr unsigned int kNumTimerEvents = 6;
-        HandlerContainerT evt_handler_storage_{kNumTimerEvents, nullptr};
+        HandlerTable<kNumTimerEvents> evt_handler_storage_ = {};
 
+        bool irq_handler_configured_ = false;
+        irq_handler_func_t irq_handler_ = nullptr;
+        bool reserved_ = false;
+
+        PinOutput pins_[kMaxPins] = {};
+        unsigned int num_pins_ = 0;
+        int ppi_channels_[kMaxConnections] = {};
+        unsigned int num_connections_ = 0;
 };
 
-TimerCounter timer0{8};
-TimerCounter timer1{9};
-TimerCounter timer2{10};
-TimerCounter timer3{26};
-TimerCounter timer4{27};
+TimerCounter<8> timer0{timer0_irq_handler};
+TimerCounter<9> timer1{timer1_irq_handler};
+TimerCounter<10> timer2{timer2_irq_handler};
+TimerCounter<26> timer3{timer3_irq_handler};
+TimerCounter<27> timer4{timer4_irq_handler};
+
+void timer0_irq_handler() {
+    timer0.handle_events();
+}
+
+void timer1_irq_handler() {
+    timer1.handle_events();
+}
+
+void timer2_irq_handler() {
+    timer2.handle_events();
+}
+
+void timer3_irq_handler() {
+    timer3.handle_events();
+}
+
+void timer4_irq_handler() {
+    timer4.handle_events();
+}
 
 // FIXME: Get the value from the board configuration.
 arm::SysTick systick(64'000'000);
@@ -235,28 +570,28 @@ Timer* Timer::request_by_id(ID id) {
     Timer* ret = nullptr;
     switch (id) {
     case ID::RTC0:
-        ret = &rtc0;
+        ret = rtc0.reserve() ? &rtc0 : nullptr;
         break;
     case ID::RTC1:
-        ret = &rtc1;
+        ret = rtc1.reserve() ? &rtc1 : nullptr;
         break;
     case ID::RTC2:
-        ret = &rtc2;
+        ret = rtc2.reserve() ? &rtc2 : nullptr;
         break;
     case ID::TIMER0:
-        ret = &timer0;
+        ret = timer0.reserve() ? &timer0 : nullptr;
         break;
     case ID::TIMER1:
-        ret = &timer1;
+        ret = timer1.reserve() ? &timer1 : nullptr;
         break;
     case ID::TIMER2:
-        ret = &timer2;
+        ret = timer2.reserve() ? &timer2 : nullptr;
         break;
     case ID::TIMER3:
-        ret = &timer3;
+        ret = timer3.reserve() ? &timer3 : nullptr;
         break;
     case ID::TIMER4:
-        ret = &timer4;
+        ret = timer4.reserve() ? &timer4 : nullptr;
         break;
     case ID::SYSTICK:
         ret = &systick;
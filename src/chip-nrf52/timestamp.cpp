@@ -0,0 +1,197 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "driver/timestamp.hpp"
+
+#include "driver/timer.hpp"
+#include "nrf52/rtc.hpp"
+#include "nrf52/timer.hpp"
+
+namespace driver {
+
+namespace time {
+
+namespace {
+
+/*
+ * Counter of Bits bits, extended by the number of its overflows.
+ *
+ * The overflow handler makes the sequence odd, clears the overflow event, and makes
+ * the sequence even. With the odd sequence the overflow is counted even if its event
+ * is still pending, so the readers, that can preempt the handler, don't wait for it.
+ */
+template <unsigned int Bits, uint32_t (*ReadCounter)(), bool (*IsOverflowPending)(), void (*ClearOverflow)()>
+class ExtendedCounter {
+    public:
+        static void reset() {
+            ClearOverflow();
+            seq_ = 0;
+        }
+
+        static uint64_t read() {
+            while (true) {
+                const uint32_t seq = seq_;
+                const bool pending = IsOverflowPending();
+                const uint32_t counter = ReadCounter();
+                // Retry if the counter overflowed, or the overflow was handled meanwhile
+                if (IsOverflowPending() != pending || seq_ != seq) {
+                    continue;
+                }
+
+                uint64_t overflows = (seq + 1) / 2;
+                if (pending && !(seq & 1)) {
+                    ++overflows;
+                }
+
+                return (overflows << Bits) | counter;
+            }
+        }
+
+        static void handle_overflow() {
+            seq_ = seq_ + 1;
+            ClearOverflow();
+            seq_ = seq_ + 1;
+        }
+
+    private:
+        static volatile uint32_t seq_;
+};
+
+template <unsigned int Bits, uint32_t (*ReadCounter)(), bool (*IsOverflowPending)(), void (*ClearOverflow)()>
+volatile uint32_t ExtendedCounter<Bits, ReadCounter, IsOverflowPending, ClearOverflow>::seq_ = 0;
+
+using LowPowerRTC = nrf52::RTC<36>;
+constexpr unsigned int kRTCBits = 24;
+
+bool is_rtc_overflow_pending() {
+    return LowPowerRTC::is_event_active(LowPowerRTC::Event::OVRFLW);
+}
+
+void clear_rtc_overflow() {
+    LowPowerRTC::clear_event(LowPowerRTC::Event::OVRFLW);
+}
+
+using RTCCounter = ExtendedCounter<kRTCBits, LowPowerRTC::get_counter, is_rtc_overflow_pending, clear_rtc_overflow>;
+
+class RTCOverflowHandler : public EventHandler {
+    public:
+        void handle_event(EventInfo* e_info) override {
+            (void)e_info;
+            RTCCounter::handle_overflow();
+        }
+} rtc_overflow_handler;
+
+// 32 bit timer, the compare channel at zero raises the overflow event
+constexpr unsigned int kHiresTimerID = 27;  // TIMER4, with the 6 channels
+using HiresTimer = nrf52::TIMER<kHiresTimerID>;
+constexpr unsigned int kHiresBits = 32;
+constexpr unsigned int kHiresOverflowChannel = 4;
+constexpr unsigned int kHiresCaptureChannel = 5;
+constexpr auto kHiresOverflowEvent = HiresTimer::Event::COMPARE0 + kHiresOverflowChannel;
+
+uint32_t capture_hires() {
+    return HiresTimer::capture(kHiresCaptureChannel);
+}
+
+bool is_hires_overflow_pending() {
+    return HiresTimer::is_event_active(kHiresOverflowEvent);
+}
+
+void clear_hires_overflow() {
+    HiresTimer::clear_event(kHiresOverflowEvent);
+}
+
+using HiresCounter = ExtendedCounter<kHiresBits, capture_hires, is_hires_overflow_pending, clear_hires_overflow>;
+
+void hires_irq_handler() {
+    if (is_hires_overflow_pending()) {
+        HiresCounter::handle_overflow();
+    }
+}
+
+// Kept from the first init() on
+Timer* low_power_rtc = nullptr;
+
+// Kept from the first init_hires() on
+bool hires_reserved = false;
+
+}  // namespace
+
+int init() {
+    if (!low_power_rtc) {
+        low_power_rtc = Timer::request_by_id(Timer::ID::RTC2);
+        if (!low_power_rtc) {
+            return -1;
+        }
+    }
+
+    auto* rtc = low_power_rtc;
+    rtc->stop();
+    rtc->set_prescaler(1);
+    LowPowerRTC::trigger_task(LowPowerRTC::Task::CLEAR);
+    RTCCounter::reset();
+
+    rtc->add_event_handler(LowPowerRTC::Event::OVRFLW, &rtc_overflow_handler);
+    rtc->enable_interrupts(1 << LowPowerRTC::Event::OVRFLW);
+    // Starts LFCLK as well
+    rtc->start();
+
+    return 0;
+}
+
+uint64_t now_ticks() {
+    return RTCCounter::read();
+}
+
+unsigned int get_tick_rate() {
+    return LowPowerRTC::kBaseRate;
+}
+
+int init_hires() {
+    if (!hires_reserved) {
+        if (nrf52::TimerPool::request()->reserve(kHiresTimerID) < 0) {
+            return -1;
+        }
+        hires_reserved = true;
+    }
+
+    HiresTimer::stop();
+    HiresTimer::set_mode(HiresTimer::Mode::TIMER);
+    HiresTimer::set_bit_mode(HiresTimer::BitMode::BITS32);
+    HiresTimer::set_prescaler(0);
+    HiresTimer::clear();
+    HiresTimer::set_compare(kHiresOverflowChannel, 0);
+    HiresCounter::reset();
+
+    HiresTimer::set_irq_handler(hires_irq_handler);
+    HiresTimer::enable_interrupts(1 << kHiresOverflowEvent);
+    HiresTimer::enable_irq();
+    HiresTimer::start();
+
+    return 0;
+}
+
+uint64_t now_hires_ticks() {
+    return HiresCounter::read();
+}
+
+unsigned int get_hires_rate() {
+    return HiresTimer::kBaseRate;
+}
+
+}  // namespace time
+
+}  // namespace driver
@@ -16,42 +16,43 @@
 
 #include "driver/uart.hpp"
 
+#include "core/critical_section.hpp"
 #include "cutils.h"
 #include "memio.h"
+#include "nvic.h"
 #include "pinctrl.hpp"
 
+#include "nrf52/easydma.hpp"
 #include "nrf52/peripheral.hpp"
 #include "nrf52/periph_utils.hpp"
 #include "nrf52/pinctrl.hpp"
+#include "nrf52/ppi.hpp"
+#include "nrf52/timer.hpp"
+#include "nrf52/uarte.hpp"
 
 
 namespace driver {
 
 namespace {
 
-// Offset for various registers
-
-const struct rate_config {
-    unsigned int rate;
-    uint32_t conf_value;
-    unsigned int actual_rate;
-} supported_rates[] = {
-    { .rate = 1200, .conf_value = 0x4f000, .actual_rate = 1205 },
-    { .rate = 2400, .conf_value = 0x9d000, .actual_rate = 2396 },
-    { .rate = 4800, .conf_value = 0x13b000, .actual_rate = 4808 },
-    // Skipped many values
-    { .rate = 56000, .conf_value = 0xe50000, .actual_rate = 55944 },
-    { .rate = 115200, .conf_value = 0x1d60000, .actual_rate = 115108 },
-    { .rate = 921600, .conf_value = 0xf000000, .actual_rate = 941176 },
-    { .rate = 1000 * 1000, .conf_value = 0x10000000, .actual_rate = 1000 * 1000 },
-};
+using nrf52::uarte::supported_rates;
 
 constexpr auto kUarte0ID = 2;
 constexpr auto kUarte1ID = 40;
 
+void uarte0_irq_handler();
+
+void uarte1_irq_handler();
+
+void uarte0_rx_idle_irq_handler();
+
+void uarte1_rx_idle_irq_handler();
+
 class UARTE : public UART, public nrf52::Peripheral {
     public:
-        UARTE(unsigned int id) : driver::Peripheral(periph::id_to_base(id), id) {}
+        UARTE(unsigned int id, irq_handler_func_t irq_handler, irq_handler_func_t rx_idle_irq_handler) :
+            driver::Peripheral(periph::id_to_base(id), id), irq_handler_{irq_handler},
+            rx_idle_irq_handler_{rx_idle_irq_handler} {}
 
         int request() override {
             if (configured_) {
@@ -64,11 +65,11 @@ class UARTE : public UART, public nrf52::Peripheral {
             auto func_group = base_ == periph::id_to_base(kUarte0ID) ? pf::UARTE0_GROUP : pf::UARTE1_GROUP;
             pinctrl::request_function(func_group);
 
-            raw_writeptr(base_ + kRxdPtr, rx_buffer_);
-            raw_write32(base_ + kRxdMaxCnt, sizeof(rx_buffer_));
+            raw_writeptr(base_ + kRxdPtr, rx_buffers_[0]);
+            raw_write32(base_ + kRxdMaxCnt, kRxBufferSize);
 
-            raw_writeptr(base_ + kTxdPtr, tx_buffer_);
-            raw_write32(base_ + kTxdMaxCnt, sizeof(tx_buffer_));
+            raw_writeptr(base_ + kTxdPtr, tx_buffers_[0]);
+            raw_write32(base_ + kTxdMaxCnt, kTxBufferSize);
 
             set_baudrate(kDefaultRate);
 
@@ -104,32 +105,210 @@ class UARTE : public UART, public nrf52::Peripheral {
         }
 
         size_t write_str(const char* str) override {
+            // Don't interfere with the asynchronous transmission
+            if (tx_busy_) {
+                return 0;
+            }
+
+            size_t len = 0;
+            while (str[len]) {
+                ++len;
+            }
+
+            const auto* data = reinterpret_cast<const uint8_t*>(str);
+            const bool zero_copy = nrf52::is_dma_accessible(data, len);
             size_t transferred = 0;
-            size_t amount = 0;
-            unsigned int i = 0;
-            while (*str) {
-                tx_buffer_[i] = *str;
-                ++amount;
-                ++i;
-                ++str;
-                if (!*str || amount == sizeof(tx_buffer_)) {
-                    raw_write32(base_ + kTxdMaxCnt, amount);
-                    trigger_task(Task::START_TX);
-                    busy_wait_and_clear_event(Event::END_TX);
-                    transferred += amount;
-
-                    if (!*str) {
-                        break;
-                    } else {
-                        amount = 0;
-                        i = 0;
-                    }
-                }
+            while (transferred < len) {
+                transferred += load_tx_chunk(data + transferred, len - transferred, zero_copy, tx_buffers_[0]);
+                trigger_task(Task::START_TX);
+                busy_wait_and_clear_event(Event::END_TX);
             }
 
             return transferred;
         }
 
+        int write(const uint8_t* data, size_t size, EventHandler* handler) override {
+            if (tx_busy_) {
+                return -1;
+            }
+
+            tx_busy_ = true;
+            tx_handler_ = handler;
+            tx_start_ = data;
+            tx_data_ = data;
+            tx_remaining_ = size;
+            tx_next_buffer_ = 0;
+            tx_zero_copy_ = nrf52::is_dma_accessible(data, size);
+
+            if (!size) {
+                finish_tx();
+                return 0;
+            }
+
+            set_irq_handler(irq_handler_);
+            clear_event(Event::END_TX);
+            clear_event(Event::TX_STARTED);
+            raw_write32(base_ + kIntenSetOffset, kIntEndTx | kIntTxStarted);
+            enable_irq();
+
+            prepare_tx_chunk();
+            tx_next_ready_ = false;
+            trigger_task(Task::START_TX);
+
+            return 0;
+        }
+
+        bool is_tx_busy() const override {
+            return tx_busy_;
+        }
+
+        int start_rx(os::SpscRing<uint8_t>* ring, EventHandler* handler) override {
+            if (rx_ring_) {
+                return -1;
+            }
+
+            auto* pool = nrf52::TimerPool::request();
+            rx_counter_id_ = pool->alloc();
+            if (rx_counter_id_ < 0) {
+                return -1;
+            }
+            rx_counter_base_ = periph::id_to_base(rx_counter_id_);
+
+            auto* ppi = nrf52::PPI::request();
+            rx_ppi_channel_ = ppi->alloc_channel(get_event_addr(Event::RXRDY), rx_counter_base_ + kTimerTasksCount);
+            if (rx_ppi_channel_ < 0 || (rx_idle_timeout_ && setup_rx_idle_timer() < 0)) {
+                ppi->free_channel(rx_ppi_channel_);
+                rx_ppi_channel_ = -1;
+                pool->free(rx_counter_id_);
+                rx_counter_id_ = -1;
+                return -1;
+            }
+
+            rx_ring_ = ring;
+            rx_handler_ = handler;
+            rx_stopping_ = false;
+            rx_cur_buffer_ = 0;
+            rx_consumed_ = 0;
+            rx_buffer_start_ = 0;
+
+            // The counter counts RXDRDY events, so that the driver knows how many bytes
+            // are in the current buffer without waiting for ENDRX.
+            raw_write32(rx_counter_base_ + kTimerModeOffset, kTimerModeLowPowerCounter);
+            raw_write32(rx_counter_base_ + kTimerBitModeOffset, kTimerBitMode32);
+            raw_write32(rx_counter_base_ + kTimerTasksClear, 1);
+            raw_write32(rx_counter_base_ + kTimerTasksStart, 1);
+
+            ppi->enable_channels(nrf52::PPI::channel_mask(rx_ppi_channel_));
+
+            set_irq_handler(irq_handler_);
+            clear_event(Event::END_RX);
+            clear_event(Event::RX_STARTED);
+            clear_event(Event::RX_TO);
+
+            raw_writeptr(base_ + kRxdPtr, rx_buffers_[0]);
+            raw_write32(base_ + kRxdMaxCnt, kRxBufferSize);
+            // The next buffer is started by the hardware, no bytes are lost in between
+            raw_write32(base_ + kShortsOffset, kShortEndRxStartRx);
+            raw_write32(base_ + kIntenSetOffset, kIntEndRx | kIntRxStarted | kIntRxTo);
+            enable_irq();
+
+            trigger_task(Task::START_RX);
+
+            return 0;
+        }
+
+        void stop_rx() override {
+            if (!rx_ring_ || rx_stopping_) {
+                return;
+            }
+
+            rx_stopping_ = true;
+            raw_write32(base_ + kShortsOffset, 0);
+            trigger_task(Task::STOP_RX);
+        }
+
+        size_t poll_rx() override {
+            if (!rx_ring_) {
+                return 0;
+            }
+
+            // The interrupt handlers are the other producers for the ring
+            os::CriticalSection cs;
+            raw_write32(rx_counter_base_ + kTimerTasksCapture0, 1);
+            const uint32_t received = raw_read32(rx_counter_base_ + kTimerCc0) - rx_buffer_start_;
+            return deliver_rx(MIN(received, static_cast<uint32_t>(kRxBufferSize)));
+        }
+
+        int set_rx_idle_timeout(unsigned int usecs) override {
+            if (rx_ring_) {
+                return -1;
+            }
+
+            rx_idle_timeout_ = usecs;
+            return 0;
+        }
+
+        void handle_rx_idle_irq() {
+            const uint32_t compare_event = rx_idle_timer_base_ + kTimerEventsCompare0;
+            if (raw_read32(compare_event)) {
+                raw_write32(compare_event, 0);
+                poll_rx();
+            }
+        }
+
+        void handle_irq() {
+            // ENDRX must be handled before RXSTARTED: with the shortcut both of them
+            // may be pending, and RXSTARTED is for the buffer after the one just finished.
+            if (is_event_active(Event::END_RX)) {
+                clear_event(Event::END_RX);
+                if (rx_ring_) {
+                    os::CriticalSection cs;
+                    const uint32_t amount = raw_read32(base_ + kRxdAmount);
+                    deliver_rx(amount);
+                    rx_buffer_start_ += amount;
+                    rx_cur_buffer_ ^= 1;
+                    rx_consumed_ = 0;
+                }
+            }
+
+            if (is_event_active(Event::RX_STARTED)) {
+                clear_event(Event::RX_STARTED);
+                if (rx_ring_ && !rx_stopping_) {
+                    // RXD.PTR is latched, the shortcut will use the other buffer next
+                    raw_writeptr(base_ + kRxdPtr, rx_buffers_[rx_cur_buffer_ ^ 1]);
+                }
+            }
+
+            if (is_event_active(Event::RX_TO)) {
+                clear_event(Event::RX_TO);
+                if (rx_stopping_) {
+                    finish_rx();
+                }
+            }
+
+            // TXD.PTR and TXD.MAXCNT are latched once TXSTARTED is generated,
+            // so the next chunk can be prepared while the current one is going out.
+            // TXSTARTED must be handled before ENDTX: if the interrupt is late, both of them
+            // may be pending, and the next chunk has to be ready when ENDTX is handled.
+            if (is_event_active(Event::TX_STARTED)) {
+                clear_event(Event::TX_STARTED);
+                if (tx_busy_ && !tx_next_ready_) {
+                    prepare_tx_chunk();
+                }
+            }
+
+            if (is_event_active(Event::END_TX)) {
+                clear_event(Event::END_TX);
+                if (tx_next_ready_) {
+                    // The next chunk is already waiting in the other buffer
+                    tx_next_ready_ = false;
+                    trigger_task(Task::START_TX);
+                } else if (tx_busy_) {
+                    finish_tx();
+                }
+            }
+        }
+
     private:
         enum Task {
             START_RX,
@@ -149,8 +328,153 @@ class UARTE : public UART, public nrf52::Peripheral {
             TXRDY,
             END_TX,
             ERROR,
+            RX_TO = (0x044 >> 2),
+            RX_STARTED = (0x04c >> 2),
+            TX_STARTED,
+            TX_STOPPED = (0x058 >> 2),
         };
 
+        // Point TXD.PTR at the next chunk of the data. The chunk is copied into
+        // the bounce buffer first, unless EasyDMA can read the data directly.
+        size_t load_tx_chunk(const uint8_t* data, size_t size, bool zero_copy, uint8_t* bounce_buffer) {
+            const uint8_t* chunk = data;
+            size_t amount = 0;
+            if (zero_copy) {
+                amount = MIN(size, static_cast<size_t>(kTxMaxCnt));
+            } else {
+                amount = MIN(size, static_cast<size_t>(kTxBufferSize));
+                for (size_t i = 0; i < amount; ++i) {
+                    bounce_buffer[i] = data[i];
+                }
+                chunk = bounce_buffer;
+            }
+
+            raw_writeptr(base_ + kTxdPtr, const_cast<uint8_t*>(chunk));
+            raw_write32(base_ + kTxdMaxCnt, amount);
+
+            return amount;
+        }
+
+        void prepare_tx_chunk() {
+            if (!tx_remaining_) {
+                return;
+            }
+
+            const auto amount = load_tx_chunk(tx_data_, tx_remaining_, tx_zero_copy_, tx_buffers_[tx_next_buffer_]);
+            tx_data_ += amount;
+            tx_remaining_ -= amount;
+            tx_next_buffer_ ^= 1;
+            tx_next_ready_ = true;
+        }
+
+        // Move the bytes [rx_consumed_; end) of the current RX buffer into the ring
+        size_t deliver_rx(uint32_t end) {
+            if (end <= rx_consumed_) {
+                return 0;
+            }
+
+            const size_t count = end - rx_consumed_;
+            rx_ring_->write(rx_buffers_[rx_cur_buffer_] + rx_consumed_, count);
+            rx_consumed_ = end;
+
+            if (rx_handler_) {
+                EventInfo e_info;
+                e_info.irq_n = irq_n_;
+                e_info.evt_id = UART::Event::RX_DATA;
+                e_info.src = this;
+                e_info.data = rx_ring_;
+                rx_handler_->handle_event(&e_info);
+            }
+
+            return count;
+        }
+
+        // A TIMER restarted by every received byte raises COMPARE0 once the line
+        // has been idle for the timeout, its interrupt delivers the partial buffer.
+        int setup_rx_idle_timer() {
+            rx_idle_timer_id_ = nrf52::TimerPool::request()->alloc();
+            if (rx_idle_timer_id_ < 0) {
+                return -1;
+            }
+            rx_idle_timer_base_ = periph::id_to_base(rx_idle_timer_id_);
+
+            auto* ppi = nrf52::PPI::request();
+            rx_idle_ppi_channel_ = ppi->alloc_channel(get_event_addr(Event::RXRDY),
+                                                      rx_idle_timer_base_ + kTimerTasksStart);
+            if (rx_idle_ppi_channel_ < 0) {
+                free_rx_idle_timer();
+                return -1;
+            }
+            ppi->set_fork(rx_ppi_channel_, rx_idle_timer_base_ + kTimerTasksClear);
+
+            raw_write32(rx_idle_timer_base_ + kTimerTasksStop, 1);
+            raw_write32(rx_idle_timer_base_ + kTimerModeOffset, kTimerModeTimer);
+            raw_write32(rx_idle_timer_base_ + kTimerBitModeOffset, kTimerBitMode32);
+            raw_write32(rx_idle_timer_base_ + kTimerPrescalerOffset, kTimerPrescaler1MHz);
+            raw_write32(rx_idle_timer_base_ + kTimerCc0, rx_idle_timeout_);
+            // Stopped until the next byte
+            raw_write32(rx_idle_timer_base_ + kTimerShortsOffset, kTimerShortCompare0Clear | kTimerShortCompare0Stop);
+            raw_write32(rx_idle_timer_base_ + kTimerTasksClear, 1);
+            raw_write32(rx_idle_timer_base_ + kTimerEventsCompare0, 0);
+            raw_write32(rx_idle_timer_base_ + kIntenSetOffset, kTimerIntCompare0);
+            nvic_set_handler(rx_idle_timer_id_, rx_idle_irq_handler_);
+            nvic_enable_irq(rx_idle_timer_id_);
+
+            ppi->enable_channels(nrf52::PPI::channel_mask(rx_idle_ppi_channel_));
+            return 0;
+        }
+
+        void free_rx_idle_timer() {
+            if (rx_idle_timer_id_ < 0) {
+                return;
+            }
+
+            nrf52::PPI::request()->free_channel(rx_idle_ppi_channel_);
+            rx_idle_ppi_channel_ = -1;
+            nvic_disable_irq(rx_idle_timer_id_);
+            raw_write32(rx_idle_timer_base_ + kIntenClrOffset, kTimerIntCompare0);
+            raw_write32(rx_idle_timer_base_ + kTimerTasksStop, 1);
+            raw_write32(rx_idle_timer_base_ + kTimerShortsOffset, 0);
+            nrf52::TimerPool::request()->free(rx_idle_timer_id_);
+            rx_idle_timer_id_ = -1;
+        }
+
+        void finish_rx() {
+            raw_write32(base_ + kIntenClrOffset, kIntEndRx | kIntRxStarted | kIntRxTo);
+            free_rx_idle_timer();
+            nrf52::PPI::request()->free_channel(rx_ppi_channel_);
+            rx_ppi_channel_ = -1;
+            raw_write32(rx_counter_base_ + kTimerTasksStop, 1);
+            nrf52::TimerPool::request()->free(rx_counter_id_);
+            rx_counter_id_ = -1;
+            rx_ring_ = nullptr;
+        }
+
+        void finish_tx() {
+            raw_write32(base_ + kIntenClrOffset, kIntEndTx | kIntTxStarted);
+            tx_busy_ = false;
+
+            if (tx_handler_) {
+                EventInfo e_info;
+                e_info.irq_n = irq_n_;
+                e_info.evt_id = UART::Event::TX_DONE;
+                e_info.src = this;
+                e_info.data = tx_start_;
+                tx_handler_->handle_event(&e_info);
+            }
+        }
+
+        static constexpr auto kIntenSetOffset = 0x304;
+        static constexpr auto kIntenClrOffset = 0x308;
+        static constexpr uint32_t kIntEndTx = (1 << Event::END_TX);
+        static constexpr uint32_t kIntTxStarted = (1 << Event::TX_STARTED);
+        static constexpr uint32_t kIntEndRx = (1 << Event::END_RX);
+        static constexpr uint32_t kIntRxStarted = (1 << Event::RX_STARTED);
+        static constexpr uint32_t kIntRxTo = (1 << Event::RX_TO);
+
+        static constexpr auto kShortsOffset = 0x200;
+        static constexpr uint32_t kShortEndRxStartRx = (1 << 5);
+
         static constexpr auto kEnableOffset = 0x500;
         static constexpr auto kEnableValue = 8;
 
@@ -174,22 +498,91 @@ class UARTE : public UART, public nrf52::Peripheral {
         static constexpr auto kConfig = 0x56c;
 
         static constexpr auto kTxBufferSize = 32;
-        static constexpr auto kRxBufferSize = 16;
+        // TXD.MAXCNT is 8 bits wide on nRF52832
+        static constexpr auto kTxMaxCnt = 255;
+        static constexpr auto kRxBufferSize = 32;
 
         static constexpr auto kDefaultRate = 115200;
         static constexpr auto kConfigHwFlow = (1 << 4);
 
         static constexpr auto kEvtEndTx = 0x120;
 
+        // TIMER registers, for the RX byte counter and the idle timeout
+        static constexpr auto kTimerTasksStart = 0x000;
+        static constexpr auto kTimerTasksStop = 0x004;
+        static constexpr auto kTimerTasksCount = 0x008;
+        static constexpr auto kTimerTasksClear = 0x00c;
+        static constexpr auto kTimerTasksCapture0 = 0x040;
+        static constexpr auto kTimerEventsCompare0 = 0x140;
+        static constexpr auto kTimerShortsOffset = 0x200;
+        static constexpr auto kTimerModeOffset = 0x504;
+        static constexpr auto kTimerBitModeOffset = 0x508;
+        static constexpr auto kTimerPrescalerOffset = 0x510;
+        static constexpr auto kTimerCc0 = 0x540;
+        static constexpr uint32_t kTimerModeTimer = 0;
+        static constexpr uint32_t kTimerModeLowPowerCounter = 2;
+        static constexpr uint32_t kTimerBitMode32 = 3;
+        static constexpr uint32_t kTimerPrescaler1MHz = 4;
+        static constexpr uint32_t kTimerShortCompare0Clear = (1 << 0);
+        static constexpr uint32_t kTimerShortCompare0Stop = (1 << 8);
+        static constexpr uint32_t kTimerIntCompare0 = (1 << 16);
+
         bool configured_ = false;
+        irq_handler_func_t irq_handler_;
+        irq_handler_func_t rx_idle_irq_handler_;
+
+        // Bounce buffers for the data EasyDMA can't access. The asynchronous
+        // transmission uses both: one is being sent, the other one is being filled.
+        uint8_t tx_buffers_[2][kTxBufferSize];
+        // RX DMA buffers, one is being filled while the other one is waiting.
+        uint8_t rx_buffers_[2][kRxBufferSize];
+
+        volatile bool tx_busy_ = false;
+        bool tx_next_ready_ = false;
+        bool tx_zero_copy_ = false;
+        unsigned int tx_next_buffer_ = 0;
+        const uint8_t* tx_start_ = nullptr;
+        const uint8_t* tx_data_ = nullptr;
+        size_t tx_remaining_ = 0;
+        EventHandler* tx_handler_ = nullptr;
+
+        // Counter of the received bytes, from the TimerPool
+        int rx_counter_id_ = -1;
+        uint32_t rx_counter_base_ = 0;
+        int rx_ppi_channel_ = -1;
+        // Idle timeout in microseconds, zero if disabled, and its TIMER from the TimerPool
+        unsigned int rx_idle_timeout_ = 0;
+        int rx_idle_timer_id_ = -1;
+        uint32_t rx_idle_timer_base_ = 0;
+        int rx_idle_ppi_channel_ = -1;
+        os::SpscRing<uint8_t>* rx_ring_ = nullptr;
+        EventHandler* rx_handler_ = nullptr;
+        bool rx_stopping_ = false;
+        // The buffer being filled, the number of its bytes already in the ring and
+        // the counter value when it was started.
+        unsigned int rx_cur_buffer_ = 0;
+        uint32_t rx_consumed_ = 0;
+        uint32_t rx_buffer_start_ = 0;
+};
 
-        uint8_t tx_buffer_[kTxBufferSize];
-        uint8_t rx_buffer_[kRxBufferSize];
+UARTE uarte0{kUarte0ID, uarte0_irq_handler, uarte0_rx_idle_irq_handler};
+UARTE uarte1{kUarte1ID, uarte1_irq_handler, uarte1_rx_idle_irq_handler};
 
-};
+void uarte0_irq_handler() {
+    uarte0.handle_irq();
+}
+
+void uarte1_irq_handler() {
+    uarte1.handle_irq();
+}
 
-UARTE uarte0{kUarte0ID};
-UARTE uarte1{kUarte1ID};
+void uarte0_rx_idle_irq_handler() {
+    uarte0.handle_rx_idle_irq();
+}
+
+void uarte1_rx_idle_irq_handler() {
+    uarte1.handle_rx_idle_irq();
+}
 
 }  // namespace
 
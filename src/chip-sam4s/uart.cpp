@@ -17,7 +17,9 @@
 #include "driver/uart.hpp"
 
 #include "clk.h"
+#include "cutils.h"
 #include "memio.h"
+#include "nvic.h"
 
 #include "sam4s/clk.h"
 
@@ -31,9 +33,14 @@ namespace driver {
 
 namespace internal {
 
+void uart0_irq_handler();
+
+void uart1_irq_handler();
+
 class UART : public ::driver::UART {
     public:
-        UART(uint32_t base, unsigned int id) : driver::Peripheral(base, id) {}
+        UART(uint32_t base, unsigned int id, irq_handler_func_t irq_handler) :
+            driver::Peripheral(base, id), irq_handler_{irq_handler} {}
 
         int request() override {
             if (configured_) {
@@ -108,6 +115,11 @@ class UART : public ::driver::UART {
         }
 
         size_t write_str(const char* str) override {
+            // Don't interfere with the PDC transmission
+            if (tx_busy_) {
+                return 0;
+            }
+
             size_t ret = 0;
             while (*str) {
                 wait_mask_le32(base_ + kStatusOffset, kStatusTxRdy);
@@ -119,7 +131,91 @@ class UART : public ::driver::UART {
             return ret;
         }
 
+        int write(const uint8_t* data, size_t size, EventHandler* handler) override {
+            if (tx_busy_) {
+                return -1;
+            }
+
+            tx_busy_ = true;
+            tx_handler_ = handler;
+            tx_start_ = data;
+            tx_data_ = data;
+            tx_remaining_ = size;
+
+            if (!size) {
+                finish_tx();
+                return 0;
+            }
+
+            // PDC can read from anywhere, the data is sent in place. The current and
+            // the next buffer registers are both loaded, the PDC switches between them
+            // without CPU involvement.
+            const auto amount = next_tx_chunk();
+            raw_writeptr(base_ + kPdcTprOffset, const_cast<uint8_t*>(tx_data_ - amount));
+            raw_write32(base_ + kPdcTcrOffset, amount);
+            queue_tx_chunk();
+
+            set_irq_handler(irq_handler_);
+            raw_write32(base_ + kIerOffset, tx_remaining_ ? kStatusEndTx : kStatusTxBufE);
+            enable_irq();
+            raw_write32(base_ + kPdcPtcrOffset, kPdcPtcrTxTEn);
+
+            return 0;
+        }
+
+        bool is_tx_busy() const override {
+            return tx_busy_;
+        }
+
+        void handle_irq() {
+            const auto status = raw_read32(base_ + kStatusOffset) & raw_read32(base_ + kImrOffset);
+
+            if (status & kStatusTxBufE) {
+                // The PDC is done with the data, the last bytes may still
+                // be in the transmitter.
+                finish_tx();
+            } else if (status & kStatusEndTx) {
+                // The next buffer has become the current one, queue more data.
+                queue_tx_chunk();
+                if (!tx_remaining_) {
+                    raw_write32(base_ + kIdrOffset, kStatusEndTx);
+                    raw_write32(base_ + kIerOffset, kStatusTxBufE);
+                }
+            }
+        }
+
     private:
+        // Take the next chunk of data for the PDC, returns its size
+        size_t next_tx_chunk() {
+            const size_t amount = MIN(tx_remaining_, static_cast<size_t>(kPdcMaxCount));
+            tx_data_ += amount;
+            tx_remaining_ -= amount;
+            return amount;
+        }
+
+        // Load the next chunk into the next buffer registers. Writing TNCR
+        // also acknowledges ENDTX.
+        void queue_tx_chunk() {
+            const auto amount = next_tx_chunk();
+            raw_writeptr(base_ + kPdcTnprOffset, const_cast<uint8_t*>(tx_data_ - amount));
+            raw_write32(base_ + kPdcTncrOffset, amount);
+        }
+
+        void finish_tx() {
+            raw_write32(base_ + kIdrOffset, kStatusEndTx | kStatusTxBufE);
+            raw_write32(base_ + kPdcPtcrOffset, kPdcPtcrTxTDis);
+            tx_busy_ = false;
+
+            if (tx_handler_) {
+                EventInfo e_info;
+                e_info.irq_n = irq_n_;
+                e_info.evt_id = ::driver::UART::Event::TX_DONE;
+                e_info.src = this;
+                e_info.data = tx_start_;
+                tx_handler_->handle_event(&e_info);
+            }
+        }
+
         static constexpr auto kCrOffset = 0;
         static constexpr uint32_t kCrTxEn = (1 << 6);
         static constexpr uint32_t kCrRxEn = (1 << 4);
@@ -128,19 +224,49 @@ class UART : public ::driver::UART {
         static constexpr uint32_t kMrParMask = 7;
         static constexpr uint32_t kMrParShift = 9;
 
+        static constexpr auto kIerOffset = 0x08;
+        static constexpr auto kIdrOffset = 0x0c;
+        static constexpr auto kImrOffset = 0x10;
+
         static constexpr auto kStatusOffset = 0x14;
         static constexpr auto kStatusTxRdy = (1 << 1);
+        static constexpr uint32_t kStatusEndTx = (1 << 4);
+        static constexpr uint32_t kStatusTxBufE = (1 << 11);
 
         static constexpr auto kThrOffset = 0x1c;
 
         static constexpr auto kBrgrOffset = 0x20;
 
+        // Peripheral DMA Controller
+        static constexpr auto kPdcTprOffset = 0x108;
+        static constexpr auto kPdcTcrOffset = 0x10c;
+        static constexpr auto kPdcTnprOffset = 0x118;
+        static constexpr auto kPdcTncrOffset = 0x11c;
+        static constexpr auto kPdcPtcrOffset = 0x120;
+        static constexpr uint32_t kPdcPtcrTxTEn = (1 << 8);
+        static constexpr uint32_t kPdcPtcrTxTDis = (1 << 9);
+        static constexpr uint32_t kPdcMaxCount = 0xffff;
 
         bool configured_ = false;
+        irq_handler_func_t irq_handler_;
+
+        volatile bool tx_busy_ = false;
+        const uint8_t* tx_start_ = nullptr;
+        const uint8_t* tx_data_ = nullptr;
+        size_t tx_remaining_ = 0;
+        EventHandler* tx_handler_ = nullptr;
 };
 
-UART uart0{0x400E0600, 8};
-UART uart1{0x400E0800, 9};
+UART uart0{0x400E0600, 8, uart0_irq_handler};
+UART uart1{0x400E0800, 9, uart1_irq_handler};
+
+void uart0_irq_handler() {
+    uart0.handle_irq();
+}
+
+void uart1_irq_handler() {
+    uart1.handle_irq();
+}
 
 }  // internal
 
@@ -0,0 +1,50 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "nvic.h"
+
+namespace os {
+
+/**
+ * @brief Masks the interrupts, and with them the task switches, while in scope.
+ *
+ * For the short updates of the state shared by the tasks and the interrupt handlers.
+ * Can be nested and used from the handlers as well.
+ *
+ *     {
+ *         os::CriticalSection cs;
+ *         allocated_ |= mask;
+ *     }
+ */
+class CriticalSection {
+    public:
+        CriticalSection() : state_{nvic_save_and_disable_irqs()} {}
+        CriticalSection(const CriticalSection&) = delete;
+        CriticalSection& operator=(const CriticalSection&) = delete;
+
+        ~CriticalSection() {
+            nvic_restore_irqs(state_);
+        }
+
+    private:
+        const uint32_t state_;
+};
+
+}  // namespace os
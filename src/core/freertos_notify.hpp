@@ -0,0 +1,68 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include "driver/peripheral.hpp"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+namespace os {
+
+/**
+ * @brief Event handler that wakes up a waiting task with a direct to task notification.
+ *
+ * Lets a task block on asynchronous driver operations instead of busy waiting, e.g.
+ *
+ *     os::TaskNotifier done;
+ *     done.prepare();
+ *     uart->write(data, size, &done);
+ *     done.wait(portMAX_DELAY);
+ */
+class TaskNotifier : public driver::EventHandler {
+    public:
+        /**
+         * @brief Select the calling task as the one to be notified.
+         *
+         * Must be called before starting the operation.
+         */
+        void prepare() {
+            task_ = xTaskGetCurrentTaskHandle();
+            ulTaskNotifyTake(pdTRUE, 0);
+        }
+
+        /**
+         * @brief Block until the event is handled.
+         *
+         * @return true if the event was handled before the timeout.
+         */
+        bool wait(TickType_t timeout) {
+            return ulTaskNotifyTake(pdTRUE, timeout) > 0;
+        }
+
+        void handle_event(driver::EventInfo* e_info) override {
+            (void)e_info;
+            BaseType_t higher_prio_woken = pdFALSE;
+            vTaskNotifyGiveFromISR(task_, &higher_prio_woken);
+            portYIELD_FROM_ISR(higher_prio_woken);
+        }
+
+    private:
+        TaskHandle_t task_ = nullptr;
+};
+
+}  // namespace os
@@ -0,0 +1,43 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include "core/tickless.hpp"
+#include "nvic.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+namespace os {
+
+/**
+ * @brief Body of vPortSuppressTicksAndSleep(), for configUSE_TICKLESS_IDLE set to 2.
+ *
+ *     extern "C" void vPortSuppressTicksAndSleep(TickType_t expected_idle_time) {
+ *         os::suppress_ticks_and_sleep(&tickless_idle, expected_idle_time);
+ *     }
+ */
+inline void suppress_ticks_and_sleep(TicklessIdle* idle, TickType_t expected_idle_time) {
+    nvic_disable_irqs();
+    // A task could have been made ready by an interrupt since the idle time was calculated
+    if (eTaskConfirmSleepModeStatus() != eAbortSleep) {
+        vTaskStepTick(idle->sleep(expected_idle_time));
+    }
+    nvic_enable_irqs();
+}
+
+}  // namespace os
@@ -0,0 +1,109 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace os {
+
+/**
+ * @brief Lock-free single producer, single consumer ring buffer.
+ *
+ * One context (e.g. an interrupt handler) writes to the ring, another one
+ * (e.g. a task) reads from it, no locking is needed. The size of the storage
+ * must be a power of two.
+ */
+template <typename T>
+class SpscRing {
+    public:
+        SpscRing(T* storage, size_t size) : storage_{storage}, mask_{size - 1} {}
+        SpscRing(const SpscRing&) = delete;
+
+        size_t capacity() const {
+            return mask_ + 1;
+        }
+
+        size_t size() const {
+            return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        /**
+         * @brief Add the items to the ring. Producer only.
+         *
+         * @return Number of items added, less than count if the ring is full.
+         */
+        size_t write(const T* data, size_t count) {
+            const auto head = head_.load(std::memory_order_relaxed);
+            const auto free = capacity() - (head - tail_.load(std::memory_order_acquire));
+            if (count > free) {
+                count = free;
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                storage_[(head + i) & mask_] = data[i];
+            }
+
+            head_.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        /**
+         * @brief Take up to count items from the ring. Consumer only.
+         *
+         * @return Number of items taken.
+         */
+        size_t read(T* data, size_t count) {
+            const auto tail = tail_.load(std::memory_order_relaxed);
+            const auto available = head_.load(std::memory_order_acquire) - tail;
+            if (count > available) {
+                count = available;
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                data[i] = storage_[(tail + i) & mask_];
+            }
+
+            tail_.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+    private:
+        T* const storage_;
+        const size_t mask_;
+
+        // Free running counters, the difference is the number of items in the ring
+        std::atomic<size_t> head_{0};
+        std::atomic<size_t> tail_{0};
+};
+
+template <typename T, size_t Size>
+class SpscRingStatic : public SpscRing<T> {
+    public:
+        static_assert((Size & (Size - 1)) == 0, "Size must be a power of two");
+
+        SpscRingStatic() : SpscRing<T>(buffer_, Size) {}
+
+    private:
+        T buffer_[Size];
+};
+
+}  // namespace os
@@ -0,0 +1,88 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "core/tickless.hpp"
+
+#include "cutils.h"
+#include "syscontrol.h"
+
+namespace os {
+
+int TicklessIdle::init(driver::Timer* timer, unsigned int channel) {
+    const int evt = timer->get_compare_event(channel);
+    if (evt < 0 || !timer->get_counter_mask() || !tick_handler_) {
+        return -1;
+    }
+
+    timer_ = timer;
+    channel_ = channel;
+    compare_mask_ = (1 << evt);
+    timer_->add_event_handler(evt, this);
+    // The sleep is ended by the timer's interrupt, pended while the interrupts are disabled
+    syscontrol_enable_sev_on_pend();
+
+    return 0;
+}
+
+uint32_t TicklessIdle::get_max_sleep_ticks() const {
+    // Keep the elapsed time unambiguous when the counter wraps around
+    return timer_->get_counter_mask() / 2;
+}
+
+uint32_t TicklessIdle::sleep(uint32_t expected_ticks) {
+    if (!suppress(expected_ticks)) {
+        return 0;
+    }
+
+    syscontrol_wait_for_event();
+    return resume();
+}
+
+bool TicklessIdle::suppress(uint32_t expected_ticks) {
+    if (!timer_ || expected_ticks < kMinSleepTicks) {
+        return false;
+    }
+
+    expected_ = MIN(expected_ticks, get_max_sleep_ticks());
+    timer_->disable_tick_interrupt();
+    start_ = timer_->get_counter();
+    timer_->set_compare(channel_, start_ + expected_);
+    timer_->enable_interrupts(compare_mask_);
+
+    return true;
+}
+
+uint32_t TicklessIdle::resume() {
+    // The compare event is still generated, only its interrupt is held back
+    timer_->disable_interrupts(compare_mask_);
+    const uint32_t elapsed = (timer_->get_counter() - start_) & timer_->get_counter_mask();
+    timer_->enable_tick_interrupt();
+
+    if (elapsed < expected_) {
+        return elapsed;
+    }
+
+    // The compare event is the last tick, the later ones are dropped
+    timer_->enable_interrupts(compare_mask_);
+    return expected_ - 1;
+}
+
+void TicklessIdle::handle_event(driver::EventInfo* e_info) {
+    timer_->disable_interrupts(compare_mask_);
+    tick_handler_->handle_event(e_info);
+}
+
+}  // namespace os
@@ -0,0 +1,106 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "driver/timer.hpp"
+
+namespace os {
+
+/**
+ * @brief Sleep through the idle ticks, waking up on a compare channel of the tick timer.
+ *
+ * The tick stays suppressed while sleeping, the number of ticks that passed is read
+ * from the counter on wakeup. When the compare channel ends the sleep, its event is
+ * forwarded to the tick handler as the last tick, so that the tasks waiting for it
+ * are unblocked by the tick handler as usual.
+ *
+ * An increment of the counter in the few cycles between suppressing or resuming the tick
+ * and reading the counter is not counted, the OS time may drift by it.
+ *
+ *     os::TicklessIdle tickless_idle{&rtc_tick_handler};
+ *
+ *     rtc->add_event_handler(0, &rtc_tick_handler);
+ *     tickless_idle.init(rtc, 0);
+ *     rtc->enable_tick_interrupt();
+ *     rtc->start();
+ *
+ * See core/freertos_tickless.hpp for the FreeRTOS integration.
+ */
+class TicklessIdle : public driver::EventHandler {
+    public:
+        // The compare event is not guaranteed closer to the counter
+        static constexpr uint32_t kMinSleepTicks = 2;
+
+        explicit TicklessIdle(driver::EventHandler* tick_handler) : tick_handler_{tick_handler} {}
+
+        /**
+         * @brief Use the channel of the timer, whose tick event is handled by the tick handler.
+         *
+         * @return 0 on success, negative value if the timer doesn't have the channel or its counter
+         *         can't be read.
+         */
+        int init(driver::Timer* timer, unsigned int channel);
+
+        /**
+         * @brief Get the longest sleep, longer ones are cut to it.
+         */
+        uint32_t get_max_sleep_ticks() const;
+
+        /**
+         * @brief Sleep until the expected number of ticks pass, or until an interrupt.
+         *
+         * Must be called with the interrupts disabled, the interrupt that ends the sleep
+         * is handled after they are enabled again.
+         *
+         * @return Number of the ticks to step the OS tick count by.
+         */
+        uint32_t sleep(uint32_t expected_ticks);
+
+        /**
+         * @brief Suppress the tick, set the compare channel expected_ticks ahead.
+         *
+         * The first half of sleep(), for the users that sleep by themselves.
+         *
+         * @return false if the sleep is too short, the tick is not suppressed then.
+         */
+        bool suppress(uint32_t expected_ticks);
+
+        /**
+         * @brief Resume the tick after suppress().
+         *
+         * @return Number of the ticks to step the OS tick count by.
+         */
+        uint32_t resume();
+
+        /**
+         * @brief Compare event of the sleep, forwarded as the last tick.
+         */
+        void handle_event(driver::EventInfo* e_info) override;
+
+    private:
+        driver::EventHandler* const tick_handler_;
+        driver::Timer* timer_ = nullptr;
+        unsigned int channel_ = 0;
+        uint32_t compare_mask_ = 0;
+
+        uint32_t start_ = 0;
+        uint32_t expected_ = 0;
+};
+
+}  // namespace os
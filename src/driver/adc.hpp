@@ -32,6 +32,33 @@ class ADC : virtual public Peripheral {
             ADC5,
         };
 
+        enum Event {
+            BUFFER_DONE,
+        };
+
+        enum class Gain {
+            GAIN1_6,
+            GAIN1_5,
+            GAIN1_4,
+            GAIN1_3,
+            GAIN1_2,
+            GAIN1,
+            GAIN2,
+            GAIN4,
+        };
+
+        enum class Reference {
+            INTERNAL,
+            VDD_DIV4,
+        };
+
+        struct ChannelConfig {
+            Gain gain = Gain::GAIN1_6;
+            Reference reference = Reference::INTERNAL;
+            // Acquisition time, rounded up to the nearest supported value
+            unsigned int acq_time_us = 10;
+        };
+
         ADC() {}
         ADC(uint32_t base, unsigned int irq_n) : Peripheral(base, irq_n) {}
 
@@ -43,6 +70,35 @@ class ADC : virtual public Peripheral {
             return 0;
         }
         virtual void stop() {}
+
+        /**
+         * @brief Start continuous sampling of the channels at the given rate.
+         *
+         * The samples of all of the channels are stored interleaved, into the two halves
+         * of the buffer in turn. When one half is full, the handler is called from the
+         * interrupt context with Event::BUFFER_DONE, EventInfo::data pointing to it.
+         * The data must be consumed before the other half fills up.
+         * The sampling goes on until stop() is called.
+         *
+         * @param rate Sampling rate in Hz.
+         * @param buffer Storage for the samples, must stay valid until stop().
+         * @param size Size of the buffer in samples.
+         * @returns Actual sampling rate in Hz, or zero if the sampling can't be started.
+         */
+        virtual unsigned int start_stream(unsigned int rate, int16_t* buffer, size_t size, EventHandler* handler) {
+            (void)rate;
+            (void)buffer;
+            (void)size;
+            (void)handler;
+            return 0;
+        }
+
+        /**
+         * @brief Number of samples in each buffer passed to the BUFFER_DONE handler.
+         */
+        virtual size_t get_stream_buffer_len() const {
+            return 0;
+        }
         virtual unsigned get_num_channels() const {
             return 0;
         }
@@ -52,6 +108,58 @@ class ADC : virtual public Peripheral {
             return 0;
         }
 
+        virtual int configure_channel(unsigned channel, const ChannelConfig& config) {
+            (void)channel;
+            (void)config;
+            return -1;
+        }
+
+        /**
+         * @brief Set the resolution of the results in bits.
+         *
+         * @returns 0 on success, negative value if the resolution is not supported.
+         */
+        virtual int set_resolution(unsigned int bits) {
+            (void)bits;
+            return -1;
+        }
+
+        /**
+         * @brief Average the given number of conversions into each result in hardware.
+         *
+         * The number is rounded down to the nearest supported value. Each sample
+         * still takes a single trigger, but the conversion takes longer.
+         *
+         * @returns Actual number of conversions averaged, or zero on error.
+         */
+        virtual unsigned int set_oversample(unsigned int samples) {
+            (void)samples;
+            return 0;
+        }
+
+        /**
+         * @brief Run the offset calibration.
+         *
+         * Blocks until the calibration is done.
+         *
+         * @returns 0 on success, negative value if the ADC is busy.
+         */
+        virtual int calibrate() {
+            return -1;
+        }
+
+        /**
+         * @brief Calibrate the offset periodically.
+         *
+         * The calibration runs before the next acquisition, and then after each
+         * interval of the given number of acquisitions. A blocking measurement
+         * and each buffer of the continuous sampling count as one acquisition.
+         * Zero disables the periodic calibration.
+         */
+        virtual void set_calibration_interval(unsigned int acquisitions) {
+            (void)acquisitions;
+        }
+
         static ADC* request_by_id(ID id);
 };
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 #include "driver/peripheral.hpp"
@@ -8,6 +9,12 @@ namespace driver {
 
 class I2C : virtual public Peripheral {
     public:
+        enum Event {
+            XFER_DONE,
+            // The slave didn't acknowledge the address or the data
+            XFER_ERROR,
+        };
+
         I2C() {}
         I2C(uint32_t base, unsigned int irq_n) : Peripheral(base, irq_n) {}
 
@@ -15,6 +22,101 @@ class I2C : virtual public Peripheral {
             return -1;
         }
 
+        /**
+         * @brief Disable the peripheral, e.g. to let another driver use the shared instance.
+         *
+         * Does nothing while a transfer is in progress.
+         */
+        virtual void release() {}
+
+        /**
+         * @brief Set the SCL frequency, rounded down to the nearest supported value.
+         *
+         * @return Actual frequency, or 0 if the requested one is too low.
+         */
+        virtual unsigned int set_frequency(unsigned int freq) {
+            (void)freq;
+            return 0;
+        }
+
+        /**
+         * @brief Start asynchronous write of the data to the slave.
+         *
+         * The transaction is completed with the stop condition. The data must stay valid
+         * until then. When it is, the handler (if not nullptr) is called from the interrupt
+         * context with Event::XFER_DONE or Event::XFER_ERROR, EventInfo::data pointing to the data.
+         *
+         * The data can't be empty. The data that the bus DMA can't read, e.g. in flash,
+         * is copied to the driver's buffer first, which limits its size (16 bytes on nRF52).
+         *
+         * @return 0 on success, negative value if another transaction is in progress,
+         * or the data is empty or too long.
+         */
+        virtual int write(uint8_t addr, const uint8_t* data, size_t size, EventHandler* handler) {
+            (void)addr;
+            (void)data;
+            (void)size;
+            (void)handler;
+            return -1;
+        }
+
+        /**
+         * @brief Same as write(), but reads the data from the slave into the buffer.
+         *
+         * EventInfo::data points to the buffer.
+         */
+        virtual int read(uint8_t addr, uint8_t* data, size_t size, EventHandler* handler) {
+            (void)addr;
+            (void)data;
+            (void)size;
+            (void)handler;
+            return -1;
+        }
+
+        /**
+         * @brief Write the data, then read from the slave after the repeated start condition.
+         *
+         * E.g. write the register address, then read its value. EventInfo::data points
+         * to the read buffer.
+         */
+        virtual int write_read(uint8_t addr, const uint8_t* tx_data, size_t tx_size,
+                               uint8_t* rx_data, size_t rx_size, EventHandler* handler) {
+            (void)addr;
+            (void)tx_data;
+            (void)tx_size;
+            (void)rx_data;
+            (void)rx_size;
+            (void)handler;
+            return -1;
+        }
+
+        /**
+         * @brief Read a batch of samples, each in its own write_read() transaction of the register.
+         *
+         * Meant for reading the FIFO of a sensor. The samples are stored one after
+         * another into the buffer of sample_size * count bytes. The handler is called once,
+         * when all of them are read.
+         */
+        virtual int read_samples(uint8_t addr, uint8_t reg, uint8_t* data, size_t sample_size,
+                                 size_t count, EventHandler* handler) {
+            (void)addr;
+            (void)reg;
+            (void)data;
+            (void)sample_size;
+            (void)count;
+            (void)handler;
+            return -1;
+        }
+
+        virtual bool is_busy() const {
+            return false;
+        }
+
+        /**
+         * @brief Get the configured peripheral.
+         *
+         * @return The peripheral, or nullptr if it isn't configured or its instance is used by another driver.
+         */
         static I2C* request_by_id(int id);
 };
 
@@ -0,0 +1,110 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "driver/i2c_queue.hpp"
+
+#include "core/critical_section.hpp"
+
+namespace driver {
+
+int I2CQueue::submit(Transaction* t) {
+    // Masks the completion interrupt and the other tasks submitting
+    os::CriticalSection cs;
+    if (t->queued) {
+        return -1;
+    }
+
+    t->next = nullptr;
+    t->queued = true;
+    if (tail_) {
+        tail_->next = t;
+    } else {
+        head_ = t;
+    }
+    tail_ = t;
+
+    // The handlers run from the completion interrupt, which starts the transaction
+    // after the handler returns.
+    if (!in_handler_) {
+        start_next();
+    }
+
+    return 0;
+}
+
+void I2CQueue::handle_event(EventInfo* e_info) {
+    // Higher priority interrupts may submit as well
+    os::CriticalSection cs;
+    if (!started_) {
+        return;
+    }
+
+    started_ = false;
+    auto* done = pop();
+    // Keep the bus busy first, then report
+    start_next();
+    complete(done, e_info->evt_id);
+    // The handler could have submitted to the empty queue
+    start_next();
+}
+
+int I2CQueue::start(Transaction* t) {
+    if (t->tx_size && t->rx_size) {
+        return bus_->write_read(t->addr, t->tx_data, t->tx_size, t->rx_data, t->rx_size, this);
+    } else if (t->rx_size) {
+        return bus_->read(t->addr, t->rx_data, t->rx_size, this);
+    }
+
+    return bus_->write(t->addr, t->tx_data, t->tx_size, this);
+}
+
+void I2CQueue::start_next() {
+    while (head_ && !started_) {
+        // The completion may come before the bus driver returns
+        started_ = true;
+        if (start(head_) < 0) {
+            started_ = false;
+            complete(pop(), I2C::Event::XFER_ERROR);
+        }
+    }
+}
+
+I2CQueue::Transaction* I2CQueue::pop() {
+    auto* t = head_;
+    head_ = t->next;
+    if (!head_) {
+        tail_ = nullptr;
+    }
+
+    return t;
+}
+
+void I2CQueue::complete(Transaction* t, int evt_id) {
+    t->queued = false;
+    if (t->handler) {
+        EventInfo e_info;
+        e_info.irq_n = bus_->get_irq_num();
+        e_info.evt_id = evt_id;
+        e_info.src = this;
+        e_info.data = t;
+
+        in_handler_ = true;
+        t->handler->handle_event(&e_info);
+        in_handler_ = false;
+    }
+}
+
+}  // namespace driver
@@ -0,0 +1,108 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "driver/i2c.hpp"
+
+namespace driver {
+
+/**
+ * @brief Queue of the transactions on one I2C bus, shared by several tasks.
+ *
+ * The transactions are run back to back: the next one is started from the completion
+ * interrupt of the previous one, so the bus doesn't wait for the submitting task
+ * to be scheduled. All of the transfers on the bus should go through the queue.
+ *
+ *     os::TaskNotifier done;
+ *     driver::I2CQueue::Transaction read_temp;
+ *     read_temp.addr = kSensorAddr;
+ *     read_temp.tx_data = &kTempReg;
+ *     read_temp.tx_size = 1;
+ *     read_temp.rx_data = temp;
+ *     read_temp.rx_size = sizeof(temp);
+ *     read_temp.handler = &done;
+ *
+ *     done.prepare();
+ *     queue.submit(&read_temp);
+ *     done.wait(portMAX_DELAY);
+ */
+class I2CQueue : public EventHandler {
+    public:
+        /**
+         * @brief Transaction descriptor, owned by the submitter.
+         *
+         * The transaction writes tx_data, reads rx_data, or does both with the repeated start
+         * in between. The descriptor and the data must stay valid until the transaction is complete.
+         */
+        struct Transaction {
+            uint8_t addr = 0;
+            const uint8_t* tx_data = nullptr;
+            size_t tx_size = 0;
+            uint8_t* rx_data = nullptr;
+            size_t rx_size = 0;
+
+            /**
+             * Called from the interrupt context with I2C::Event::XFER_DONE or
+             * I2C::Event::XFER_ERROR, EventInfo::data pointing to the transaction.
+             */
+            EventHandler* handler = nullptr;
+
+            // Owned by the queue
+            Transaction* next = nullptr;
+            volatile bool queued = false;
+        };
+
+        explicit I2CQueue(I2C* bus) : bus_{bus} {}
+
+        /**
+         * @brief Add the transaction to the end of the queue.
+         *
+         * Can be called from any task, or from the handler of another transaction. The transactions
+         * rejected by the bus, e.g. too long ones, are completed with I2C::Event::XFER_ERROR.
+         *
+         * @return 0 on success, negative value if the transaction is already queued.
+         */
+        int submit(Transaction* t);
+
+        bool is_idle() const {
+            return head_ == nullptr;
+        }
+
+        /**
+         * @brief Completion of the current transfer, called by the bus driver.
+         */
+        void handle_event(EventInfo* e_info) override;
+
+    private:
+        int start(Transaction* t);
+        // Start the head of the queue, failing the transactions the bus rejects
+        void start_next();
+        Transaction* pop();
+        void complete(Transaction* t, int evt_id);
+
+        I2C* const bus_;
+        Transaction* head_ = nullptr;
+        Transaction* tail_ = nullptr;
+        // The head is on the bus
+        bool started_ = false;
+        bool in_handler_ = false;
+};
+
+}  // namespace driver
@@ -36,8 +36,17 @@ bool Peripheral::is_event_active(int) const {
     return false;
 }
 
-Peripheral::Peripheral(uint32_t base, unsigned int irq_n, HandlerContainerT* evt_handlers) :
-    base_{base}, irq_n_{irq_n}, evt_handlers_{evt_handlers} {
+uint32_t Peripheral::get_pending_events(uint32_t mask) const {
+    uint32_t pending = 0;
+    while (mask) {
+        const unsigned int evt = __builtin_ctz(mask);
+        mask &= mask - 1;
+        if (is_event_active(evt)) {
+            pending |= (1u << evt);
+        }
+    }
+
+    return pending;
 }
 
 void Peripheral::handle_events() {
@@ -46,22 +55,30 @@ void Peripheral::handle_events() {
     }
 
     struct EventInfo e_info;
-    for (size_t i = 0; i < evt_handlers_->size(); ++i) {
-        if ((*evt_handlers_)[i] && is_event_active(i)) {
-            e_info.irq_n = irq_n_;
-            e_info.evt_id = i;
-            (*evt_handlers_)[i]->handle_event(&e_info);
-            clear_event(i);
-        }
+    e_info.irq_n = irq_n_;
+    uint32_t pending = get_pending_events(handler_mask_);
+    while (pending) {
+        // Lowest pending event first
+        const unsigned int evt = __builtin_ctz(pending);
+        pending &= pending - 1;
+
+        e_info.evt_id = evt;
+        evt_handlers_[evt]->handle_event(&e_info);
+        clear_event(evt);
     }
 }
 
 int Peripheral::add_event_handler(unsigned int evt, EventHandler* handler) {
-    if (evt >= evt_handlers_->size()) {
+    if (evt >= num_evt_handlers_) {
         return -1;
     }
 
-    (*evt_handlers_)[evt] = handler;
+    evt_handlers_[evt] = handler;
+    if (handler) {
+        handler_mask_ |= (1u << evt);
+    } else {
+        handler_mask_ &= ~(1u << evt);
+    }
     return 0;
 }
 
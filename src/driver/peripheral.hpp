@@ -20,7 +20,7 @@
 #include <cstddef>
 #include <cstdbool>
 
-#include <vector>
+#include <array>
 
 namespace driver {
 
@@ -38,10 +38,23 @@ class EventHandler {
 
 class Peripheral {
     public:
-        using HandlerContainerT = std::vector<EventHandler*>;
+        /**
+         * @brief Event handlers, indexed by the event number.
+         *
+         * Sized by the number of the peripheral's events, and zero initialized,
+         * so it doesn't need the heap or the startup code.
+         */
+        template <size_t N>
+        using HandlerTable = std::array<EventHandler*, N>;
+
         Peripheral() : base_{0}, irq_n_{0} {};
         Peripheral(uint32_t base, unsigned int irq_n) : base_ {base}, irq_n_{irq_n} {}
-        Peripheral(uint32_t base, unsigned int irq_n, HandlerContainerT* evt_handlers);
+
+        template <size_t N>
+        Peripheral(uint32_t base, unsigned int irq_n, HandlerTable<N>* evt_handlers) :
+            base_{base}, irq_n_{irq_n}, evt_handlers_{evt_handlers->data()}, num_evt_handlers_{N} {
+            static_assert(N <= kMaxEvents, "The events are dispatched by 32 bit masks");
+        }
         Peripheral(const Peripheral&) = delete;
 
         uint32_t get_base() const {
@@ -66,12 +79,28 @@ class Peripheral {
         virtual bool is_event_active(int evt) const;
         virtual void clear_event(int evt);
 
+        /**
+         * @brief Get the events of the mask that are pending.
+         *
+         * Called from handle_events() with the events that have the handlers. The default
+         * implementation checks them one by one, the peripherals that can tell which
+         * of the events are enabled should only check those.
+         *
+         * @return Bit mask of the pending events, bit N for the event N.
+         */
+        virtual uint32_t get_pending_events(uint32_t mask) const;
+
         const uint32_t base_;
         const unsigned int irq_n_;
 
     private:
+        // The events are dispatched by the bit masks
+        static constexpr size_t kMaxEvents = 32;
 
-        HandlerContainerT* evt_handlers_ = nullptr;
+        EventHandler** const evt_handlers_ = nullptr;
+        const size_t num_evt_handlers_ = 0;
+        // The events that have the handlers
+        uint32_t handler_mask_ = 0;
 };
 
 }  // namespace driver
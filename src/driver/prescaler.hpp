@@ -0,0 +1,137 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Prescaler solver shared by the timers.
+ *
+ * Each timer describes the values its set_prescaler() accepts as a Space, the solver picks
+ * the one giving the fastest rate not above the requested one. All of it is constexpr,
+ * with constant arguments the configuration is computed by the compiler:
+ *
+ *     constexpr auto kTick = driver::prescaler::for_rate(nrf52::RTC<11>::kPrescalerSpace,
+ *                                                        nrf52::RTC<11>::kBaseRate, configTICK_RATE_HZ);
+ *     static_assert(kTick.is_valid() && kTick.error_ppm == 0, "Tick rate can't be set exactly");
+ *     rtc->set_prescaler(kTick.presc);
+ */
+namespace driver {
+namespace prescaler {
+
+enum class Scale {
+    // The base rate is divided by the prescaler value
+    LINEAR,
+    // The base rate is divided by 2 to the power of the prescaler value
+    POW2,
+};
+
+struct Space {
+    Scale scale;
+    unsigned int min;
+    unsigned int max;
+
+    constexpr uint64_t get_divider(unsigned int presc) const {
+        return scale == Scale::POW2 ? (uint64_t{1} << presc) : presc;
+    }
+};
+
+struct Config {
+    // Value for Timer::set_prescaler()
+    unsigned int presc = 0;
+    uint64_t divider = 0;
+    // Resulting rate in Hz, rounded down
+    unsigned int rate = 0;
+    // How much slower the timer is than requested, in parts per million
+    uint32_t error_ppm = 0;
+
+    constexpr bool is_valid() const {
+        return divider != 0;
+    }
+};
+
+namespace internal {
+
+constexpr uint64_t kMillion = 1000 * 1000;
+
+// Smallest prescaler in the space, that divides by at least min_divider
+constexpr Config solve(const Space& space, unsigned int base_rate, uint64_t min_divider) {
+    Config config;
+    unsigned int presc = 0;
+    if (space.scale == Scale::POW2) {
+        presc = min_divider <= 1 ? 0 : (64 - __builtin_clzll(min_divider - 1));
+    } else if (min_divider <= space.max) {
+        presc = static_cast<unsigned int>(min_divider);
+    } else {
+        return config;
+    }
+
+    if (presc > space.max) {
+        return config;
+    }
+
+    config.presc = presc < space.min ? space.min : presc;
+    config.divider = space.get_divider(config.presc);
+    config.rate = static_cast<unsigned int>(base_rate / config.divider);
+    return config;
+}
+
+}  // namespace internal
+
+/**
+ * @brief Prescaler for the fastest rate that doesn't exceed req_rate.
+ *
+ * The rates above the fastest one the timer has are clamped to it.
+ *
+ * @return Configuration, not valid if even the slowest rate is faster than req_rate.
+ */
+constexpr Config for_rate(const Space& space, unsigned int base_rate, unsigned int req_rate) {
+    if (req_rate == 0) {
+        return Config{};
+    }
+
+    auto config = internal::solve(space, base_rate, (uint64_t{base_rate} + req_rate - 1) / req_rate);
+    if (config.is_valid()) {
+        const uint64_t scaled_req = config.divider * req_rate;
+        config.error_ppm = static_cast<uint32_t>((scaled_req - base_rate) * internal::kMillion / scaled_req);
+    }
+
+    return config;
+}
+
+/**
+ * @brief Prescaler for the shortest tick period that isn't shorter than period_us.
+ *
+ * Unlike for_rate(), the periods, that aren't a whole number of Hz, are exact.
+ */
+constexpr Config for_period_us(const Space& space, unsigned int base_rate, uint32_t period_us) {
+    const uint64_t base_ticks = uint64_t{base_rate} * period_us;
+    if (base_ticks == 0) {
+        return Config{};
+    }
+
+    auto config = internal::solve(space, base_rate, (base_ticks + internal::kMillion - 1) / internal::kMillion);
+    if (config.is_valid()) {
+        const uint64_t actual_ticks = config.divider * internal::kMillion;
+        config.error_ppm = static_cast<uint32_t>((actual_ticks - base_ticks) * internal::kMillion / base_ticks);
+    }
+
+    return config;
+}
+
+}  // namespace prescaler
+}  // namespace driver
@@ -0,0 +1,129 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "driver/peripheral.hpp"
+
+namespace driver {
+
+class SPI : virtual public Peripheral {
+    public:
+        enum class ID {
+            SPIM0,
+            SPIM1,
+            SPIM2,
+        };
+
+        // Clock polarity and phase
+        enum class Mode {
+            MODE0,
+            MODE1,
+            MODE2,
+            MODE3,
+        };
+
+        enum Event {
+            XFER_DONE,
+        };
+
+        SPI() {}
+        SPI(uint32_t base, unsigned int irq_n) : Peripheral(base, irq_n) {}
+
+        virtual int request() {
+            return -1;
+        }
+
+        /**
+         * @brief Disable the peripheral, e.g. to let another driver use the shared instance.
+         *
+         * Does nothing while a transfer is in progress.
+         */
+        virtual void release() {}
+
+        /**
+         * @brief Set the SCK frequency, rounded down to the nearest supported value.
+         *
+         * @return Actual frequency, or 0 if the requested one is too low.
+         */
+        virtual unsigned int set_frequency(unsigned int freq) {
+            (void)freq;
+            return 0;
+        }
+
+        virtual int set_mode(Mode mode) {
+            (void)mode;
+            return -1;
+        }
+
+        /**
+         * @brief Start asynchronous full duplex transfer, with the chip select asserted.
+         *
+         * The number of bytes clocked is the larger of the sizes. The bytes after the end
+         * of tx_data are sent as the over-read character, the bytes after the end of rx_data
+         * are dropped. Either of the buffers may be nullptr with zero size.
+         *
+         * The buffers must stay valid until the transfer is finished. When it is,
+         * the handler (if not nullptr) is called from the interrupt context with
+         * Event::XFER_DONE, EventInfo::data pointing to rx_data.
+         *
+         * @return 0 on success, negative value if another transfer is in progress,
+         * or the buffers can't be used.
+         */
+        virtual int transfer(const uint8_t* tx_data, size_t tx_size, uint8_t* rx_data, size_t rx_size,
+                             EventHandler* handler) {
+            (void)tx_data;
+            (void)tx_size;
+            (void)rx_data;
+            (void)rx_size;
+            (void)handler;
+            return -1;
+        }
+
+        /**
+         * @brief Stream the count items of the arrays back to back, in a single chip select.
+         *
+         * Each item of tx_data is tx_item_size long, each item of rx_data is rx_item_size long.
+         * The items follow each other without the CPU involvement, e.g. to feed the lines
+         * of the display. The handler is called once, when all of them are done.
+         */
+        virtual int stream(const uint8_t* tx_data, size_t tx_item_size, uint8_t* rx_data, size_t rx_item_size,
+                           size_t count, EventHandler* handler) {
+            (void)tx_data;
+            (void)tx_item_size;
+            (void)rx_data;
+            (void)rx_item_size;
+            (void)count;
+            (void)handler;
+            return -1;
+        }
+
+        virtual bool is_busy() const {
+            return false;
+        }
+
+        /**
+         * @brief Get the configured peripheral.
+         *
+         * @return The peripheral, or nullptr if it isn't configured or its instance is used by another driver.
+         */
+        static SPI* request_by_id(ID id);
+};
+
+}  // namespace driver
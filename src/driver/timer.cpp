@@ -74,9 +74,12 @@ unsigned int SysTick::request_rate(unsigned int req_rate) {
         return 0;
     }
 
-    auto presc = base_rate_ / req_rate;
-    set_prescaler(presc);
-    return base_rate_ / presc;
+    const auto config = driver::prescaler::for_rate(kPrescalerSpace, base_rate_, req_rate);
+    if (config.is_valid()) {
+        set_prescaler(config.presc);
+    }
+
+    return config.rate;
 }
 
 void SysTick::enable_tick_interrupt() {
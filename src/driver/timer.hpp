@@ -20,6 +20,7 @@
 
 #include "nvic.h"
 #include "driver/peripheral.hpp"
+#include "driver/prescaler.hpp"
 
 namespace driver {
 
@@ -53,8 +54,32 @@ class Timer : virtual public Peripheral {
             SYSTICK,
         };
 
+        // What the hardware does when the counter reaches the compare value
+        enum class CompareAction {
+            NONE,
+            CLEAR,
+            STOP,
+        };
+
+        // What the hardware does to the pin on the compare event
+        enum class PinAction {
+            SET,
+            CLEAR,
+            TOGGLE,
+        };
+
+        /**
+         * @brief Get the timer with the ID.
+         *
+         * @returns The timer, or nullptr if there is no such timer or it is used by another driver.
+         */
         static Timer* request_by_id(ID id);
 
+        /**
+         * @brief Stop the timer and let the other drivers use it.
+         */
+        virtual void release() {}
+
         virtual void start() = 0;
         virtual void stop() = 0;
         virtual unsigned int get_rate() const = 0;
@@ -91,6 +116,120 @@ class Timer : virtual public Peripheral {
         virtual unsigned int request_rate(unsigned int req_rate);
 
         virtual void enable_tick_interrupt() = 0;
+
+        virtual void disable_tick_interrupt() {}
+
+        /**
+         * @brief Get the number of compare channels, zero if the timer has none.
+         */
+        virtual unsigned int get_num_channels() const {
+            return 0;
+        }
+
+        /**
+         * @brief Get the mask of the counter bits, the counter wraps around to zero after it.
+         *
+         * Zero if the counter can't be read with get_counter().
+         */
+        virtual uint32_t get_counter_mask() const {
+            return 0;
+        }
+
+        /**
+         * @brief Read the current value of the counter.
+         */
+        virtual uint32_t get_counter() const {
+            return 0;
+        }
+
+        /**
+         * @brief Raise the compare event of the channel when the counter reaches the value.
+         *
+         * The pending compare event of the channel is cleared. Use get_compare_event()
+         * to add the handler and to enable the interrupt of the event, the event is
+         * raised with its interrupt disabled as well.
+         *
+         * @return 0 on success, negative value if there's no such channel.
+         */
+        virtual int set_compare(unsigned int channel, uint32_t value) {
+            (void)channel;
+            (void)value;
+            return -1;
+        }
+
+        /**
+         * @return Event number of the channel's compare event, negative value
+         * if there's no such channel.
+         */
+        virtual int get_compare_event(unsigned int channel) const {
+            (void)channel;
+            return -1;
+        }
+
+        /**
+         * @brief Clear or stop the counter by the hardware on the compare event of the channel.
+         *
+         * With CompareAction::CLEAR the channel sets the period of the counter.
+         *
+         * @return 0 on success, negative value if there's no such channel or action.
+         */
+        virtual int set_compare_action(unsigned int channel, CompareAction action) {
+            (void)channel;
+            (void)action;
+            return -1;
+        }
+
+        /**
+         * @brief Set the width of the counter, e.g. 16 or 32 bits.
+         *
+         * @return 0 on success, negative value if the width is not supported.
+         */
+        virtual int set_counter_width(unsigned int bits) {
+            (void)bits;
+            return -1;
+        }
+
+        /**
+         * @brief Copy the counter to the channel's register and return it in value.
+         *
+         * The channel's compare value is overwritten.
+         *
+         * @return 0 on success, negative value if there's no such channel.
+         */
+        virtual int capture(unsigned int channel, uint32_t* value) {
+            (void)channel;
+            (void)value;
+            return -1;
+        }
+
+        /**
+         * @brief Drive the pin by the hardware on the compare event of the channel.
+         *
+         * The pin is taken from the GPIO control and driven low until the first event.
+         * Several channels can drive the same pin, e.g. the PWM output is set by
+         * the channel with CompareAction::CLEAR, and cleared by the duty cycle one:
+         *
+         *     timer->request_rate(1000000);
+         *     timer->set_compare(1, 1000);
+         *     timer->set_compare_action(1, driver::Timer::CompareAction::CLEAR);
+         *     timer->connect_pin(1, pin, driver::Timer::PinAction::SET);
+         *     timer->set_compare(0, 250);
+         *     timer->connect_pin(0, pin, driver::Timer::PinAction::CLEAR);
+         *     timer->start();
+         *
+         * @return 0 on success, negative value if there's no such channel, or no resources left.
+         */
+        virtual int connect_pin(unsigned int channel, unsigned int pin, PinAction action) {
+            (void)channel;
+            (void)pin;
+            (void)action;
+            return -1;
+        }
+
+        /**
+         * @brief Return all of the connected pins to the GPIO control.
+         */
+        virtual void disconnect_pins() {}
 };
 
 }  // namespace driver
@@ -100,6 +239,9 @@ namespace arm {
 
 class SysTick : public driver::Timer {
     public:
+        // The reload value divides the base rate
+        static constexpr driver::prescaler::Space kPrescalerSpace{driver::prescaler::Scale::LINEAR, 1, (1 << 24) - 1};
+
         SysTick();
         SysTick(unsigned int base_rate) : driver::Peripheral(kBaseAddr, IRQ_SYSTICK), base_rate_{base_rate} {}
 
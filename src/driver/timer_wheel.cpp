@@ -0,0 +1,299 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "driver/timer_wheel.hpp"
+
+#include "core/critical_section.hpp"
+#include "cutils.h"
+
+namespace driver {
+
+int TimerWheel::init() {
+    const int evt = timer_->get_compare_event(channel_);
+    if (evt < 0 || !timer_->get_counter_mask()) {
+        return -1;
+    }
+
+    counter_mask_ = timer_->get_counter_mask();
+    compare_mask_ = (1 << evt);
+    timer_->add_event_handler(evt, this);
+    sync();
+    now_ = base_;
+
+    return 0;
+}
+
+int TimerWheel::start(SoftTimer* t, uint32_t delay) {
+    if (!compare_mask_) {
+        return -1;
+    }
+
+    os::CriticalSection cs;
+    if (t->pprev) {
+        unlink(t);
+    }
+    if (t->ready_pprev) {
+        unlink_ready(t);
+    }
+
+    if (is_empty() && !in_handler_) {
+        // The counter could have wrapped around since the last interrupt
+        sync();
+        now_ = base_;
+    }
+
+    t->expiry = get_time(timer_->get_counter()) + MIN(MAX(delay, 1u), kMaxDelay);
+    place(t);
+    // The handler sets the compare channel when it's done
+    if (!in_handler_) {
+        schedule();
+    }
+
+    return 0;
+}
+
+void TimerWheel::cancel(SoftTimer* t) {
+    os::CriticalSection cs;
+    // The compare channel is left as it is, the interrupt finds nothing to expire then
+    if (t->pprev) {
+        unlink(t);
+    }
+    if (t->ready_pprev) {
+        unlink_ready(t);
+    }
+}
+
+void TimerWheel::run_deferred() {
+    EventInfo e_info;
+    e_info.irq_n = timer_->get_irq_num();
+    e_info.evt_id = Event::EXPIRED;
+    e_info.src = this;
+
+    while (true) {
+        SoftTimer* t = nullptr;
+        {
+            os::CriticalSection cs;
+            t = ready_head_;
+            if (t) {
+                unlink_ready(t);
+            }
+        }
+
+        if (!t) {
+            break;
+        }
+
+        if (t->handler) {
+            e_info.data = t;
+            t->handler->handle_event(&e_info);
+        }
+    }
+}
+
+void TimerWheel::handle_event(EventInfo* e_info) {
+    bool deferred = false;
+    {
+        // The higher priority interrupts may start and cancel the timers too
+        os::CriticalSection cs;
+        in_handler_ = true;
+        sync();
+        deferred = process(base_);
+        schedule();
+        in_handler_ = false;
+    }
+
+    if (deferred && deferred_handler_) {
+        deferred_handler_->handle_event(e_info);
+    }
+}
+
+void TimerWheel::sync() {
+    const uint32_t counter = timer_->get_counter();
+    base_ = get_time(counter);
+    counter_ = counter;
+}
+
+bool TimerWheel::is_empty() const {
+    uint64_t occupied = 0;
+    for (auto bits : occupied_) {
+        occupied |= bits;
+    }
+
+    return occupied == 0;
+}
+
+void TimerWheel::place(SoftTimer* t) {
+    uint32_t delta = t->expiry - now_;
+    if (delta >= kRange) {
+        delta = kRange - 1;
+        t->expiry = now_ + delta;
+    }
+
+    // The level is the one that spans the delta. The delta is zero only for the timers
+    // moved down to level 0 at their expiry, they are expired right away then.
+    unsigned int level = 0;
+    while (delta >= (1u << ((level + 1) * kLevelBits))) {
+        ++level;
+    }
+    const unsigned int slot = (t->expiry >> (level * kLevelBits)) & kSlotMask;
+
+    auto** head = &slots_[level][slot];
+    t->level = level;
+    t->slot = slot;
+    t->next = *head;
+    if (t->next) {
+        t->next->pprev = &t->next;
+    }
+    t->pprev = head;
+    *head = t;
+    occupied_[level] |= (1ull << slot);
+}
+
+void TimerWheel::unlink(SoftTimer* t) {
+    *t->pprev = t->next;
+    if (t->next) {
+        t->next->pprev = t->pprev;
+    }
+    t->pprev = nullptr;
+    t->next = nullptr;
+
+    if (!slots_[t->level][t->slot]) {
+        occupied_[t->level] &= ~(1ull << t->slot);
+    }
+}
+
+void TimerWheel::unlink_ready(SoftTimer* t) {
+    *t->ready_pprev = t->ready_next;
+    if (t->ready_next) {
+        t->ready_next->ready_pprev = t->ready_pprev;
+    } else {
+        ready_tail_ = t->ready_pprev;
+    }
+    t->ready_pprev = nullptr;
+    t->ready_next = nullptr;
+}
+
+bool TimerWheel::expire(SoftTimer* t) {
+    if (t->period) {
+        // From the expiry time, so the period doesn't drift with the interrupt latency
+        t->expiry += t->period;
+        place(t);
+    }
+
+    if (t->deferred) {
+        if (!t->ready_pprev) {
+            t->ready_next = nullptr;
+            t->ready_pprev = ready_tail_;
+            *ready_tail_ = t;
+            ready_tail_ = &t->ready_next;
+        }
+        return true;
+    }
+
+    if (t->handler) {
+        EventInfo e_info;
+        e_info.irq_n = timer_->get_irq_num();
+        e_info.evt_id = Event::EXPIRED;
+        e_info.src = this;
+        e_info.data = t;
+        t->handler->handle_event(&e_info);
+    }
+
+    return false;
+}
+
+bool TimerWheel::process(uint32_t target) {
+    bool deferred = false;
+    uint32_t time;
+    while (get_next_slot_time(&time) && static_cast<int32_t>(time - target) <= 0) {
+        now_ = time;
+        // Move the timers down from the slots that start now, then expire level 0 slot
+        for (unsigned int level = kLevels - 1; level > 0; --level) {
+            const unsigned int shift = level * kLevelBits;
+            if (now_ & ((1u << shift) - 1)) {
+                continue;
+            }
+
+            auto** head = &slots_[level][(now_ >> shift) & kSlotMask];
+            while (*head) {
+                auto* t = *head;
+                unlink(t);
+                place(t);
+            }
+        }
+
+        auto** head = &slots_[0][now_ & kSlotMask];
+        while (*head) {
+            auto* t = *head;
+            unlink(t);
+            deferred |= expire(t);
+        }
+    }
+
+    now_ = target;
+    return deferred;
+}
+
+bool TimerWheel::get_next_slot_time(uint32_t* time) const {
+    bool found = false;
+    for (unsigned int level = 0; level < kLevels; ++level) {
+        const uint64_t occupied = occupied_[level];
+        if (!occupied) {
+            continue;
+        }
+
+        // The first occupied slot after the current one, a full turn for the current one
+        const unsigned int shift = level * kLevelBits;
+        const uint32_t pos = now_ >> shift;
+        const unsigned int first = (pos + 1) & kSlotMask;
+        const uint64_t rotated = first ? ((occupied >> first) | (occupied << (kSlots - first))) : occupied;
+        const uint32_t slot_time = (pos + 1 + __builtin_ctzll(rotated)) << shift;
+        if (!found || slot_time - now_ < *time - now_) {
+            *time = slot_time;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+void TimerWheel::schedule() {
+    uint32_t time;
+    if (!get_next_slot_time(&time)) {
+        timer_->disable_interrupts(compare_mask_);
+        return;
+    }
+
+    while (true) {
+        const uint32_t counter = timer_->get_counter();
+        int32_t delta = time - get_time(counter);
+        delta = MAX(delta, static_cast<int32_t>(kMinCompareTicks));
+        // The interrupt keeps the software extension of the counter unambiguous
+        delta = MIN(delta, static_cast<int32_t>(counter_mask_ / 2));
+
+        const uint32_t compare = counter + delta;
+        timer_->set_compare(channel_, compare);
+        // The counter could have moved on while setting the compare value
+        const uint32_t ahead = (compare - timer_->get_counter()) & counter_mask_;
+        if (ahead >= kMinCompareTicks && ahead <= static_cast<uint32_t>(delta)) {
+            break;
+        }
+    }
+
+    timer_->enable_interrupts(compare_mask_);
+}
+
+}  // namespace driver
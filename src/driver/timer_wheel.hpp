@@ -0,0 +1,185 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "driver/timer.hpp"
+
+namespace driver {
+
+/**
+ * @brief Software timers multiplexed on the counter and one compare channel of a Timer.
+ *
+ * The timers are kept in a hierarchical wheel: kLevels levels of kSlots slots, the slot
+ * of level L spans kSlots^L ticks. Starting and cancelling a timer is O(1), the compare
+ * channel is set for the next slot that has the timers, so the interrupt doesn't come
+ * on every tick. The timers of the higher levels are moved down when their slot is reached.
+ *
+ * The handlers are called from the timer's interrupt with all of the interrupts masked,
+ * so they should be short, or from run_deferred() in a task for the deferred timers.
+ * The Timer should be configured and started by the user, its counter ticks are
+ * the units of the delays:
+ *
+ *     driver::TimerWheel wheel{rtc1, 0};
+ *     os::TaskNotifier expired;
+ *     driver::TimerWheel::SoftTimer timeout;
+ *     timeout.handler = &expired;
+ *
+ *     rtc1->request_rate(32768);
+ *     rtc1->start();
+ *     wheel.init();
+ *     expired.prepare();
+ *     wheel.start(&timeout, 328);
+ *     expired.wait(portMAX_DELAY);
+ */
+class TimerWheel : public EventHandler {
+    public:
+        enum Event {
+            EXPIRED,
+        };
+
+        /**
+         * @brief Timer descriptor, owned by the user.
+         */
+        struct SoftTimer {
+            // Ticks between the expiries, zero for a one-shot timer
+            uint32_t period = 0;
+
+            /**
+             * Called with Event::EXPIRED, EventInfo::data pointing to the timer. A periodic
+             * timer is already restarted, a one-shot one can be started again from the handler.
+             */
+            EventHandler* handler = nullptr;
+
+            /**
+             * Call the handler from run_deferred() instead of the interrupt. The expiries
+             * of a periodic timer are coalesced while it waits for run_deferred().
+             */
+            bool deferred = false;
+
+            // Owned by the wheel
+            uint32_t expiry = 0;
+            SoftTimer* next = nullptr;
+            SoftTimer** pprev = nullptr;
+            SoftTimer* ready_next = nullptr;
+            SoftTimer** ready_pprev = nullptr;
+            uint8_t level = 0;
+            uint8_t slot = 0;
+        };
+
+        static constexpr unsigned int kLevelBits = 6;
+        static constexpr unsigned int kSlots = (1 << kLevelBits);
+        static constexpr unsigned int kLevels = 4;
+        static constexpr uint32_t kMaxDelay = (1 << (kLevels * kLevelBits - 1));
+
+        TimerWheel(Timer* timer, unsigned int channel) : timer_{timer}, channel_{channel} {}
+
+        /**
+         * @brief Attach to the compare channel of the timer.
+         *
+         * @return 0 on success, negative value if the timer has no such channel or its counter
+         *         can't be read.
+         */
+        int init();
+
+        /**
+         * @brief Start or restart the timer, to expire after delay ticks.
+         *
+         * The delay is at least one tick, at most kMaxDelay. Can be called from the tasks,
+         * from the handlers, and from any interrupt.
+         *
+         * @return 0 on success, negative value if the wheel is not initialized.
+         */
+        int start(SoftTimer* t, uint32_t delay);
+
+        /**
+         * @brief Stop the timer, its handler is not called after this.
+         */
+        void cancel(SoftTimer* t);
+
+        bool is_active(const SoftTimer* t) const {
+            return t->pprev != nullptr || t->ready_pprev != nullptr;
+        }
+
+        /**
+         * @brief Set the handler to be called from the interrupt when the deferred timers expire.
+         *
+         * E.g. os::TaskNotifier of the task that calls run_deferred().
+         */
+        void set_deferred_handler(EventHandler* handler) {
+            deferred_handler_ = handler;
+        }
+
+        /**
+         * @brief Call the handlers of the expired deferred timers, from the task context.
+         */
+        void run_deferred();
+
+        /**
+         * @brief Compare event of the timer.
+         */
+        void handle_event(EventInfo* e_info) override;
+
+    private:
+        static constexpr uint32_t kSlotMask = kSlots - 1;
+        static constexpr uint32_t kRange = (1 << (kLevels * kLevelBits));
+        // The compare event is not guaranteed closer to the counter
+        static constexpr uint32_t kMinCompareTicks = 2;
+
+        // Time of the counter value, the counter is extended in software
+        uint32_t get_time(uint32_t counter) const {
+            return base_ + ((counter - counter_) & counter_mask_);
+        }
+
+        void sync();
+        bool is_empty() const;
+
+        void place(SoftTimer* t);
+        void unlink(SoftTimer* t);
+        void unlink_ready(SoftTimer* t);
+        // Returns true if the timer is deferred to run_deferred()
+        bool expire(SoftTimer* t);
+        // Expire the timers up to the target time, returns true if any are deferred
+        bool process(uint32_t target);
+        // Time of the next slot that has the timers, false if the wheel is empty
+        bool get_next_slot_time(uint32_t* time) const;
+        void schedule();
+
+        Timer* const timer_;
+        const unsigned int channel_;
+        uint32_t compare_mask_ = 0;
+        uint32_t counter_mask_ = 0;
+
+        // The wheel's time, all the timers expire after it
+        uint32_t now_ = 0;
+        // Time of the counter value, last read by sync()
+        uint32_t base_ = 0;
+        uint32_t counter_ = 0;
+
+        SoftTimer* slots_[kLevels][kSlots] = {};
+        uint64_t occupied_[kLevels] = {};
+
+        SoftTimer* ready_head_ = nullptr;
+        SoftTimer** ready_tail_ = &ready_head_;
+        EventHandler* deferred_handler_ = nullptr;
+
+        bool in_handler_ = false;
+};
+
+}  // namespace driver
@@ -0,0 +1,73 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+namespace driver {
+
+/**
+ * @brief Monotonic 64 bit timestamps, cheap to take from any context.
+ *
+ * The hardware counters are extended in software by counting their overflows.
+ * The reads don't lock, they retry if an overflow is handled meanwhile, and account
+ * for an overflow that is not handled yet, e.g. when called with the interrupts disabled.
+ *
+ *     driver::time::init();
+ *     const auto start = driver::time::now_ticks();
+ *     ...
+ *     const auto elapsed_us = (driver::time::now_ticks() - start) * 1000000 / driver::time::get_tick_rate();
+ *
+ * On nRF52 the timestamps use RTC2 and TIMER4, reserved for them once initialized.
+ */
+namespace time {
+
+/**
+ * @brief Start the low power counter of now_ticks().
+ *
+ * @return 0 on success, negative value if the chip doesn't provide it,
+ *         or the counter is used by another driver.
+ */
+int init();
+
+/**
+ * @brief Ticks since init(), at get_tick_rate().
+ */
+uint64_t now_ticks();
+
+unsigned int get_tick_rate();
+
+/**
+ * @brief Start the high resolution counter of now_hires_ticks().
+ *
+ * It runs from HFCLK, so it takes more power than the one of now_ticks().
+ *
+ * @return 0 on success, negative value if the chip doesn't provide it, or the timer it
+ *         needs is used by another driver.
+ */
+int init_hires();
+
+/**
+ * @brief Ticks since init_hires(), at get_hires_rate().
+ */
+uint64_t now_hires_ticks();
+
+unsigned int get_hires_rate();
+
+}  // namespace time
+
+}  // namespace driver
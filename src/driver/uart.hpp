@@ -18,6 +18,7 @@
 
 #include <cstdint>
 
+#include "core/spsc_ring.hpp"
 #include "driver/peripheral.hpp"
 
 namespace driver {
@@ -54,6 +55,11 @@ class UART : virtual public Peripheral {
             USART4,
         };
 
+        enum Event {
+            TX_DONE,
+            RX_DATA,
+        };
+
         UART() {}
         UART(uint32_t base, unsigned int irq_n) : Peripheral(base, irq_n) {}
 
@@ -73,6 +79,73 @@ class UART : virtual public Peripheral {
             return 0;
         }
 
+        /**
+         * @brief Start asynchronous transmission of the data.
+         *
+         * The data must stay valid until the transmission is finished. When it is,
+         * the handler (if not nullptr) is called from the interrupt context with
+         * Event::TX_DONE event, EventInfo::data pointing to the data.
+         *
+         * @return 0 on success, negative value if another transmission is still in progress.
+         */
+        virtual int write(const uint8_t* data, size_t size, EventHandler* handler) {
+            (void)data;
+            (void)size;
+            (void)handler;
+            return -1;
+        }
+
+        virtual bool is_tx_busy() const {
+            return false;
+        }
+
+        /**
+         * @brief Start continuous reception into the ring.
+         *
+         * The received data is written to the ring from the interrupt context, then
+         * the handler (if not nullptr) is called with Event::RX_DATA event, EventInfo::data
+         * pointing to the ring. The data that doesn't fit into the ring is dropped.
+         *
+         * The data may be delivered in batches. The rest of a batch is delivered when the line
+         * has been idle for the set_rx_idle_timeout(), or when the reader calls poll_rx().
+         *
+         * @return 0 on success, negative value if the reception is already running, or the resources
+         *         it needs are used by the other drivers.
+         */
+        virtual int start_rx(os::SpscRing<uint8_t>* ring, EventHandler* handler) {
+            (void)ring;
+            (void)handler;
+            return -1;
+        }
+
+        /**
+         * @brief Deliver the received data once the line has been idle for the time.
+         *
+         * Used by the following start_rx(), zero disables the timeout.
+         *
+         * @return 0 on success, negative value if the reception is running or the timeout isn't supported.
+         */
+        virtual int set_rx_idle_timeout(unsigned int usecs) {
+            (void)usecs;
+            return -1;
+        }
+
+        /**
+         * @brief Stop the reception.
+         *
+         * The data received so far is still delivered to the ring.
+         */
+        virtual void stop_rx() {}
+
+        /**
+         * @brief Deliver the data received so far to the ring, without waiting for the batch to complete.
+         *
+         * @return Number of bytes delivered.
+         */
+        virtual size_t poll_rx() {
+            return 0;
+        }
+
         static UART* request_by_id(ID id);
 };
 
@@ -44,6 +44,12 @@ uint32_t raw_read32(uint32_t addr);
 uint16_t raw_read16(uint16_t addr);
 uint8_t raw_read8(uint8_t addr);
 
+/* Lets the MMIO mock trace interrupt dispatches, see nvic_dispatch() */
+void raw_irq_dispatched(int irqn);
+
+/* Lets the MMIO mock decide which buffers the DMA can access */
+int raw_dma_accessible(const void* ptr, uint32_t size);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -0,0 +1,49 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "memio.h"
+
+namespace nrf52 {
+
+// EasyDMA can only access Data RAM (up to 256 KiB on nRF52840)
+constexpr uintptr_t kDmaRamStart = 0x20000000;
+constexpr uintptr_t kDmaRamEnd = kDmaRamStart + 256 * 1024;
+
+/**
+ * @brief Check if the buffer can be used by EasyDMA directly.
+ *
+ * The buffers in flash, e.g. string literals, need to be copied to RAM first.
+ * Empty buffers are never accessed, so they are accepted wherever they point, nullptr too.
+ */
+inline bool is_dma_accessible(const void* ptr, size_t size) {
+    if (!size) {
+        return true;
+    }
+
+#ifdef TEST_MEMIO
+    return raw_dma_accessible(ptr, size);
+#else
+    const auto addr = reinterpret_cast<uintptr_t>(ptr);
+    return addr >= kDmaRamStart && addr + size <= kDmaRamEnd;
+#endif
+}
+
+}  // namespace nrf52
@@ -0,0 +1,96 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "nrf52/peripheral.hpp"
+#include "nrf52/periph_utils.hpp"
+
+namespace nrf52 {
+
+/**
+ * @brief GPIO tasks and events.
+ *
+ * The output channels let the pins be driven by PPI, e.g. a chip select
+ * deasserted at the end of the transfer without the CPU involvement.
+ *
+ * The channels can be allocated and freed from the interrupt handlers as well.
+ */
+class GPIOTE : public nrf52::Peripheral {
+    public:
+        static constexpr unsigned int kNumChannels = 8;
+
+        static GPIOTE* request();
+
+        /**
+         * @brief Allocate a channel in task mode, driving the pin.
+         *
+         * The pin is driven to its initial level right away.
+         *
+         * @returns Channel number, or negative value if there are no free channels.
+         */
+        int alloc_output(unsigned int pin, bool init_high);
+
+        /**
+         * @brief Return the pin to the GPIO control and the channel to the pool.
+         */
+        void free_channel(int ch);
+
+        /**
+         * @brief Task that drives the pin high, e.g. for PPI.
+         */
+        uint32_t get_set_task(int ch) const {
+            return base_ + kTasksSetOffset + ch * 4;
+        }
+
+        uint32_t get_clr_task(int ch) const {
+            return base_ + kTasksClrOffset + ch * 4;
+        }
+
+        /**
+         * @brief Task that toggles the pin.
+         */
+        uint32_t get_out_task(int ch) const {
+            return base_ + kTasksOutOffset + ch * 4;
+        }
+
+    private:
+        GPIOTE() : driver::Peripheral(periph::id_to_base(kGpioteID), kGpioteID) {}
+
+        static constexpr auto kGpioteID = 6;
+
+        static constexpr auto kTasksOutOffset = 0x000;
+        static constexpr auto kTasksSetOffset = 0x030;
+        static constexpr auto kTasksClrOffset = 0x060;
+        static constexpr auto kConfigOffset = 0x510;
+
+        static constexpr uint32_t kConfigModeTask = 3;
+        static constexpr unsigned int kConfigPselShift = 8;
+        static constexpr uint32_t kConfigPolarityToggle = (3 << 16);
+        static constexpr uint32_t kConfigOutInitHigh = (1 << 20);
+
+        bool is_allocated(int ch) const {
+            return ch >= 0 && static_cast<unsigned>(ch) < kNumChannels && (allocated_channels_ & (1u << ch));
+        }
+
+        uint32_t allocated_channels_ = 0;
+
+        static GPIOTE gpiote_;
+};
+
+}  // namespace nrf52
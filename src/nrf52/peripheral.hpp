@@ -47,6 +47,28 @@ class Peripheral : virtual public driver::Peripheral {
             raw_write32(base_ + kEnableOffset, 1);
         }
 
+        /**
+         * @brief Address of the task register, e.g. for PPI.
+         */
+        uint32_t get_task_addr(int task) const {
+            return base_ + task * 4;
+        }
+
+        /**
+         * @brief Address of the event register, e.g. for PPI.
+         */
+        uint32_t get_event_addr(int evt) const {
+            return base_ + kEventsOffset + evt * 4;
+        }
+
+        void enable_interrupts(uint32_t mask) override {
+            raw_write32(base_ + kIntenSetOffset, mask);
+        }
+
+        void disable_interrupts(uint32_t mask) override {
+            raw_write32(base_ + kIntenClrOffset, mask);
+        }
+
     protected:
         void clear_event(int evt) override {
             raw_write32(base_ + kEventsOffset + evt * 4, 0);
@@ -56,8 +78,16 @@ class Peripheral : virtual public driver::Peripheral {
             return raw_read32(base_ + kEventsOffset + evt * 4);
         }
 
+        uint32_t get_pending_events(uint32_t mask) const override {
+            // INTEN bit N is for the event N, reading INTENSET returns INTEN.
+            // Only the enabled events could have raised the interrupt.
+            return driver::Peripheral::get_pending_events(mask & raw_read32(base_ + kIntenSetOffset));
+        }
+
     private:
         static constexpr auto kEventsOffset = 0x100;
+        static constexpr auto kIntenSetOffset = 0x304;
+        static constexpr auto kIntenClrOffset = 0x308;
         static constexpr auto kEnableOffset = 0x500;
 };
 
@@ -41,6 +41,11 @@ enum function {
     SAADC_CHAN_NEG = 2,
     TWIM_SCL = 1,
     TWIM_SDA = 2,
+    SPIM_SCK = 1,
+    SPIM_MOSI = 2,
+    SPIM_MISO = 3,
+    // Driven by GPIOTE, not by the peripheral
+    SPIM_CS = 4,
 
     MIN_PIN_FUNCTION,
     UARTE0_GROUP,
@@ -96,6 +101,24 @@ enum function {
     TWIM1_SCL,
     TWIM1_SDA,
 
+    SPIM0_GROUP,
+    SPIM0_SCK,
+    SPIM0_MOSI,
+    SPIM0_MISO,
+    SPIM0_CS,
+
+    SPIM1_GROUP,
+    SPIM1_SCK,
+    SPIM1_MOSI,
+    SPIM1_MISO,
+    SPIM1_CS,
+
+    SPIM2_GROUP,
+    SPIM2_SCK,
+    SPIM2_MOSI,
+    SPIM2_MISO,
+    SPIM2_CS,
+
     MAX_PIN_FUNCTION,
 };
 
@@ -48,7 +48,7 @@ class Power : public nrf52::Peripheral {
 
         bool is_initialized = false;
 
-        HandlerContainerT event_handlers_{Event::NUM_EVENTS, nullptr};
+        HandlerTable<Event::NUM_EVENTS> event_handlers_ = {};
 
         static constexpr uint32_t kUSBRegStatusOffset = 0x438;
         static constexpr uint32_t kUSBRegStatusVbusDetect = 1;
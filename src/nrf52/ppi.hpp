@@ -0,0 +1,126 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "nrf52/peripheral.hpp"
+#include "nrf52/periph_utils.hpp"
+
+namespace nrf52 {
+
+/**
+ * @brief Programmable Peripheral Interconnect.
+ *
+ * Connects the events of the peripherals to the tasks, so that the tasks are triggered
+ * by the hardware without the CPU involvement. The addresses of the events and the tasks
+ * can be taken from nrf52::Peripheral::get_event_addr() and get_task_addr().
+ *
+ * The drivers allocate the channels and the groups they need, and free them when they
+ * are done. The allocation and the freeing can be done from the interrupt handlers as well.
+ */
+class PPI : public nrf52::Peripheral {
+    public:
+        // Only the programmable channels, the rest of them are pre-programmed
+        static constexpr unsigned int kNumChannels = 20;
+        static constexpr unsigned int kNumGroups = 6;
+
+        static PPI* request();
+
+        /**
+         * @brief Allocate a channel, connecting the event to the task.
+         *
+         * The channel is not enabled.
+         *
+         * @returns Channel number, or negative value if there are no free channels.
+         */
+        int alloc_channel(uint32_t event_addr, uint32_t task_addr);
+
+        /**
+         * @brief Disable the channel and return it to the pool.
+         */
+        void free_channel(int ch);
+
+        /**
+         * @brief Trigger one more task by the channel's event.
+         *
+         * Zero address removes the fork.
+         */
+        int set_fork(int ch, uint32_t task_addr);
+
+        void enable_channels(uint32_t mask);
+        void disable_channels(uint32_t mask);
+
+        /**
+         * @brief Allocate a group of channels, which can be enabled or disabled at once.
+         *
+         * @returns Group number, or negative value if there are no free groups.
+         */
+        int alloc_group(uint32_t channel_mask);
+
+        void free_group(int group);
+
+        void enable_group(int group);
+        void disable_group(int group);
+
+        /**
+         * @brief Address of the task that enables the group.
+         *
+         * E.g. to be used as the task of another channel.
+         */
+        uint32_t get_group_enable_task(int group) const {
+            return base_ + kTasksChgOffset + group * 8;
+        }
+
+        uint32_t get_group_disable_task(int group) const {
+            return get_group_enable_task(group) + 4;
+        }
+
+        static constexpr uint32_t channel_mask(int ch) {
+            return 1u << ch;
+        }
+
+    private:
+        PPI() : driver::Peripheral(periph::id_to_base(kPpiID), kPpiID) {}
+
+        static constexpr auto kPpiID = 31;
+
+        static constexpr auto kTasksChgOffset = 0x000;
+        static constexpr auto kChenSetOffset = 0x504;
+        static constexpr auto kChenClrOffset = 0x508;
+        static constexpr auto kChEepOffset = 0x510;
+        static constexpr auto kChTepOffset = 0x514;
+        static constexpr auto kChgOffset = 0x800;
+        static constexpr auto kForkTepOffset = 0x910;
+
+        static constexpr uint32_t kAllChannels = (1u << kNumChannels) - 1;
+
+        bool is_allocated(int ch) const {
+            return ch >= 0 && static_cast<unsigned>(ch) < kNumChannels && (allocated_channels_ & channel_mask(ch));
+        }
+
+        bool is_group_allocated(int group) const {
+            return group >= 0 && static_cast<unsigned>(group) < kNumGroups && (allocated_groups_ & (1u << group));
+        }
+
+        uint32_t allocated_channels_ = 0;
+        uint32_t allocated_groups_ = 0;
+
+        static PPI ppi_;
+};
+
+}  // namespace nrf52
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "reg.hpp"
 #include "nrf52/peripheral.hpp"
 #include "nrf52/periph_utils.hpp"
 
@@ -29,7 +30,7 @@ class Radio : public nrf52::Peripheral {
             BLE = 3,
         };
 
-        Radio() : driver::Peripheral(periph::id_to_base(1), 1) {}
+        Radio() : driver::Peripheral(kBase, kID) {}
 
         int set_frequency(unsigned int freq_mhz);
 
@@ -45,6 +46,11 @@ class Radio : public nrf52::Peripheral {
 
         void set_whitening(bool enable);
 
+        /**
+         * @brief Set the base address length and the whitening in one register update.
+         */
+        int configure_framing(uint8_t base_addr_len, bool whitening);
+
         void set_white_iv(uint8_t iv);
 
         int set_addr_base(int index, uint32_t base_addr);
@@ -73,25 +79,39 @@ class Radio : public nrf52::Peripheral {
         static constexpr unsigned int kMaxFreq = 2500;
         static constexpr auto kMaxAddrIndex = 7;
 
-        static constexpr auto kFrequencyOffset = 0x508;
-        static constexpr auto kTxPowerOffset = 0x50c;
-        static constexpr auto kModeOffset = 0x510;
-        static constexpr auto kPcnf0Offset = 0x514;
-        static constexpr auto kPcnf1Offset = 0x518;
-        static constexpr auto kBase0Offset = 0x51c;
-        static constexpr auto kPrefix0Offset = 0x524;
-        static constexpr auto kPrefix1Offset = 0x528;
-        static constexpr auto kTxAddressOffset = 0x52c;
-        static constexpr auto kRxAddressesOffset = 0x530;
-        static constexpr auto kCrcCnfOffset = 0x534;
-        static constexpr auto kCrcPolyOffset = 0x538;
-        static constexpr auto kCrcInitOffset = 0x53c;
-        static constexpr auto kTifsOffset = 0x544;
-        static constexpr auto kDataWhiteIVOffset = 0x554;
-
-
-        static constexpr auto kPowerOffset = 0xffc;
+        static constexpr unsigned int kID = 1;
+        static constexpr uint32_t kBase = periph::id_to_base(kID);
+
+        using FrequencyReg = reg::Reg<kBase + 0x508>;
+        using TxPowerReg = reg::Reg<kBase + 0x50c>;
+        using ModeReg = reg::Reg<kBase + 0x510>;
+
+        using Pcnf0Reg = reg::Reg<kBase + 0x514>;
+        using Pcnf0Lflen = reg::Field<Pcnf0Reg, 0, 4>;
+        using Pcnf0S0len = reg::Field<Pcnf0Reg, 8, 1>;
+        using Pcnf0S1len = reg::Field<Pcnf0Reg, 16, 4>;
+
+        using Pcnf1Reg = reg::Reg<kBase + 0x518>;
+        using Pcnf1Maxlen = reg::Field<Pcnf1Reg, 0, 8>;
+        using Pcnf1Balen = reg::Field<Pcnf1Reg, 16, 3>;
+        using Pcnf1WhiteEn = reg::Field<Pcnf1Reg, 25, 1>;
+
+        using Base0Reg = reg::Reg<kBase + 0x51c>;
+        using Prefix0Reg = reg::Reg<kBase + 0x524>;
+        using Prefix1Reg = reg::Reg<kBase + 0x528>;
+        using TxAddressReg = reg::Reg<kBase + 0x52c>;
+        using RxAddressesReg = reg::Reg<kBase + 0x530>;
+
+        using CrcCnfReg = reg::Reg<kBase + 0x534>;
+        using CrcCnfLen = reg::Field<CrcCnfReg, 0, 2>;
+        using CrcCnfSkipAddr = reg::Field<CrcCnfReg, 8, 1>;
+
+        using CrcPolyReg = reg::Reg<kBase + 0x538>;
+        using CrcInitReg = reg::Reg<kBase + 0x53c>;
+        using TifsReg = reg::Reg<kBase + 0x544>;
+        using DataWhiteIVReg = reg::Reg<kBase + 0x554>;
 
+        using PowerReg = reg::Reg<kBase + 0xffc>;
 };
 
 }  // namespace nrf52
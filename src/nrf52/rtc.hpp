@@ -0,0 +1,131 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "driver/prescaler.hpp"
+#include "memio.h"
+#include "nrf52/periph_utils.hpp"
+#include "nrf52/static_peripheral.hpp"
+
+namespace nrf52 {
+
+/**
+ * @brief Real time counter with the ID known at compile time.
+ *
+ * driver::Timer::request_by_id() provides the same RTCs behind the virtual interface,
+ * to one user at a time.
+ * Starting LFCLK is up to the user, the driver::Timer does it in start().
+ */
+template <unsigned int ID>
+class RTC : public StaticPeripheral<periph::id_to_base(ID), ID> {
+    public:
+        using Regs = StaticPeripheral<periph::id_to_base(ID), ID>;
+
+        enum Task {
+            START,
+            STOP,
+            CLEAR,
+            TRIGOVRFLW,
+        };
+
+        enum Event {
+            TICK,
+            OVRFLW,
+            COMPARE0 = 16,
+            COMPARE1,
+            COMPARE2,
+            COMPARE3,
+        };
+
+        static constexpr unsigned int kBaseRate = 32768;
+        static constexpr unsigned int kMaxPrescaler = (1 << 12);
+        static constexpr driver::prescaler::Space kPrescalerSpace{driver::prescaler::Scale::LINEAR, 1, kMaxPrescaler};
+        // RTC0 has one less
+        static constexpr unsigned int kNumChannels = (ID == 11) ? 3 : 4;
+        static constexpr uint32_t kCounterMask = 0xffffff;
+
+        static void start() {
+            Regs::trigger_task(Task::START);
+        }
+
+        static void stop() {
+            Regs::trigger_task(Task::STOP);
+        }
+
+        static unsigned int get_rate() {
+            const auto presc = raw_read32(Regs::kBase + kPrescalerOffset);
+            return kBaseRate / ((presc & 0xfff) + 1);
+        }
+
+        /**
+         * @brief Divide the base rate by presc, 1 to kMaxPrescaler.
+         *
+         * The counter should be stopped.
+         */
+        static void set_prescaler(unsigned int presc) {
+            raw_write32(Regs::kBase + kPrescalerOffset, presc - 1);
+        }
+
+        static uint32_t get_counter() {
+            return raw_read32(Regs::kBase + kCounterOffset);
+        }
+
+        /**
+         * @brief Raise COMPAREn event when the counter reaches value, the old event is cleared.
+         *
+         * The event is not guaranteed if the value is less than 2 ticks ahead of the counter.
+         */
+        static void set_compare(unsigned int channel, uint32_t value) {
+            Regs::clear_event(Event::COMPARE0 + channel);
+            raw_write32(Regs::kBase + kCCOffset + channel * 4, value & kCounterMask);
+        }
+
+        /**
+         * @brief Enable the interrupt and the PPI routing of the events.
+         */
+        static void enable_event_interrupts(uint32_t mask) {
+            Regs::enable_interrupts(mask);
+            raw_write32(Regs::kBase + kEvtenSetOffset, mask);
+        }
+
+        /**
+         * @brief Disable both, the events are not generated at all then.
+         */
+        static void disable_event_interrupts(uint32_t mask) {
+            Regs::disable_interrupts(mask);
+            raw_write32(Regs::kBase + kEvtenClrOffset, mask);
+        }
+
+        static void enable_tick_interrupt() {
+            enable_event_interrupts(1 << Event::TICK);
+        }
+
+        static void disable_tick_interrupt() {
+            disable_event_interrupts(1 << Event::TICK);
+        }
+
+    private:
+        static constexpr uint32_t kEvtenSetOffset = 0x344;
+        static constexpr uint32_t kEvtenClrOffset = 0x348;
+        static constexpr uint32_t kCounterOffset = 0x504;
+        static constexpr uint32_t kPrescalerOffset = 0x508;
+        static constexpr uint32_t kCCOffset = 0x540;
+};
+
+}  // namespace nrf52
@@ -0,0 +1,62 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+namespace nrf52 {
+
+/**
+ * @brief Owners of the serial instances shared by SPIM and TWIM.
+ *
+ * SPIM0/TWIM0 and SPIM1/TWIM1 are the same hardware, with the same registers, ENABLE and
+ * interrupt. The driver claiming the instance first keeps it until it releases it, so that
+ * the other one can't reconfigure it under a transfer. Can be used from the interrupt
+ * handlers as well.
+ */
+class SharedInstances {
+    public:
+        static SharedInstances* request();
+
+        /**
+         * @brief Claim the instance with the peripheral ID for the owner.
+         *
+         * Claiming it again by the same owner, or claiming an instance that isn't shared, succeeds.
+         *
+         * @returns 0 on success, negative value if another driver owns the instance.
+         */
+        int claim(unsigned int id, const void* owner);
+
+        /**
+         * @brief Let the other drivers claim the instance, if it is owned by the owner.
+         */
+        void release(unsigned int id, const void* owner);
+
+    private:
+        SharedInstances() = default;
+
+        static constexpr unsigned int kFirstSharedID = 3;
+        static constexpr unsigned int kNumShared = 2;
+
+        static bool is_shared(unsigned int id) {
+            return id >= kFirstSharedID && id < kFirstSharedID + kNumShared;
+        }
+
+        const void* owners_[kNumShared] = {};
+
+        static SharedInstances instances_;
+};
+
+}  // namespace nrf52
@@ -0,0 +1,114 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "memio.h"
+#include "nvic.h"
+
+namespace nrf52 {
+
+/**
+ * @brief Register access of the peripheral with the base address and the interrupt
+ * known at compile time.
+ *
+ * All of the methods are static, so the register accesses compile to the stores
+ * and the loads at the constant addresses, and can be inlined into the interrupt
+ * handlers. The drivers implementing driver:: interfaces use it for the register
+ * accesses, while the code that doesn't need the runtime polymorphism can use
+ * the peripheral directly, e.g. the tick interrupt of the OS:
+ *
+ *     using TickRTC = nrf52::RTC<11>;
+ *     TickRTC::clear_event(TickRTC::Event::TICK);
+ *
+ * The offsets are the same as in nrf52::Peripheral.
+ */
+template <uint32_t Base, unsigned int IrqN>
+class StaticPeripheral {
+    public:
+        static constexpr uint32_t kBase = Base;
+        static constexpr unsigned int kIrqN = IrqN;
+
+        static void trigger_task(int task) {
+            raw_write32(get_task_addr(task), 1);
+        }
+
+        static void clear_event(int evt) {
+            raw_write32(get_event_addr(evt), 0);
+        }
+
+        static bool is_event_active(int evt) {
+            return raw_read32(get_event_addr(evt));
+        }
+
+        static constexpr uint32_t get_task_addr(int task) {
+            return Base + task * 4;
+        }
+
+        static constexpr uint32_t get_event_addr(int evt) {
+            return Base + kEventsOffset + evt * 4;
+        }
+
+        static void enable_interrupts(uint32_t mask) {
+            raw_write32(Base + kIntenSetOffset, mask);
+        }
+
+        static void disable_interrupts(uint32_t mask) {
+            raw_write32(Base + kIntenClrOffset, mask);
+        }
+
+        /**
+         * @brief Get the events of the mask that are pending and enabled.
+         *
+         * Same as driver::Peripheral::get_pending_events().
+         */
+        static uint32_t get_pending_events(uint32_t mask) {
+            // INTEN bit N is for the event N, reading INTENSET returns INTEN
+            mask &= raw_read32(Base + kIntenSetOffset);
+
+            uint32_t pending = 0;
+            while (mask) {
+                const unsigned int evt = __builtin_ctz(mask);
+                mask &= mask - 1;
+                if (is_event_active(evt)) {
+                    pending |= (1u << evt);
+                }
+            }
+
+            return pending;
+        }
+
+        static int set_irq_handler(void (*handler)(void)) {
+            return nvic_set_handler(IrqN, handler);
+        }
+
+        static void enable_irq() {
+            nvic_enable_irq(IrqN);
+        }
+
+        static void disable_irq() {
+            nvic_disable_irq(IrqN);
+        }
+
+    protected:
+        static constexpr uint32_t kEventsOffset = 0x100;
+        static constexpr uint32_t kIntenSetOffset = 0x304;
+        static constexpr uint32_t kIntenClrOffset = 0x308;
+};
+
+}  // namespace nrf52
@@ -0,0 +1,203 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "driver/prescaler.hpp"
+#include "memio.h"
+#include "nrf52/periph_utils.hpp"
+#include "nrf52/static_peripheral.hpp"
+
+namespace nrf52 {
+
+/**
+ * @brief Owners of the TIMERs.
+ *
+ * The drivers counting or timing with a TIMER allocate any free one while they use it, the users
+ * of a particular TIMER, e.g. driver::Timer::request_by_id(), reserve it by its ID. Both fail
+ * if the TIMER is taken, instead of reprogramming it under its owner. The allocation and
+ * the freeing can be done from the interrupt handlers as well.
+ */
+class TimerPool {
+    public:
+        static constexpr unsigned int kNumTimers = 5;
+
+        static TimerPool* request();
+
+        /**
+         * @brief Allocate a free TIMER.
+         *
+         * @returns Peripheral ID of the TIMER, or negative value if all of them are taken.
+         */
+        int alloc();
+
+        /**
+         * @brief Reserve the TIMER with the peripheral ID.
+         *
+         * @returns 0 on success, negative value if the TIMER is taken or the ID isn't a TIMER.
+         */
+        int reserve(unsigned int id);
+
+        /**
+         * @brief Return the TIMER to the pool, the caller stops it first.
+         */
+        void free(unsigned int id);
+
+    private:
+        TimerPool() = default;
+
+        static constexpr unsigned int kTimerIDs[kNumTimers] = {8, 9, 10, 26, 27};
+
+        static int get_index(unsigned int id);
+
+        uint32_t allocated_ = 0;
+
+        static TimerPool pool_;
+};
+
+/**
+ * @brief TIMER with the ID known at compile time.
+ *
+ * driver::Timer::request_by_id() provides the same TIMERs behind the virtual interface.
+ * The users reserve the TIMER in TimerPool first.
+ */
+template <unsigned int ID>
+class TIMER : public StaticPeripheral<periph::id_to_base(ID), ID> {
+    public:
+        using Regs = StaticPeripheral<periph::id_to_base(ID), ID>;
+
+        enum Task {
+            START,
+            STOP,
+            COUNT,
+            CLEAR,
+            SHUTDOWN,
+            CAPTURE0 = 16,
+            CAPTURE1,
+            CAPTURE2,
+            CAPTURE3,
+            CAPTURE4,
+            CAPTURE5,
+        };
+
+        enum Event {
+            COMPARE0 = 16,
+            COMPARE1,
+            COMPARE2,
+            COMPARE3,
+            COMPARE4,
+            COMPARE5,
+        };
+
+        enum class Mode {
+            TIMER,
+            COUNTER,
+            LOW_POWER_COUNTER,
+        };
+
+        enum class BitMode {
+            BITS16,
+            BITS8,
+            BITS24,
+            BITS32,
+        };
+
+        static constexpr unsigned int kBaseRate = 16 * 1000 * 1000;
+        static constexpr unsigned int kMaxPrescaler = 9;
+        static constexpr driver::prescaler::Space kPrescalerSpace{driver::prescaler::Scale::POW2, 0, kMaxPrescaler};
+        // TIMER3 and TIMER4 have more of them
+        static constexpr unsigned int kNumChannels = (ID >= 26) ? 6 : 4;
+
+        static void start() {
+            Regs::trigger_task(Task::START);
+        }
+
+        static void stop() {
+            Regs::trigger_task(Task::STOP);
+        }
+
+        static void clear() {
+            Regs::trigger_task(Task::CLEAR);
+        }
+
+        static void set_mode(Mode mode) {
+            raw_write32(Regs::kBase + kModeOffset, static_cast<uint32_t>(mode));
+        }
+
+        static void set_bit_mode(BitMode bit_mode) {
+            raw_write32(Regs::kBase + kBitModeOffset, static_cast<uint32_t>(bit_mode));
+        }
+
+        static BitMode get_bit_mode() {
+            return static_cast<BitMode>(raw_read32(Regs::kBase + kBitModeOffset) & 3);
+        }
+
+        /**
+         * @brief Divide the base rate by 2^presc, 0 to kMaxPrescaler.
+         */
+        static void set_prescaler(unsigned int presc) {
+            raw_write32(Regs::kBase + kPrescalerOffset, presc);
+        }
+
+        static unsigned int get_prescaler() {
+            return raw_read32(Regs::kBase + kPrescalerOffset) & 0xf;
+        }
+
+        /**
+         * @brief Clear and/or stop the timer by the hardware when COMPAREn event is raised.
+         */
+        static void set_compare_shorts(unsigned int channel, bool clear, bool stop) {
+            const uint32_t mask = (kShortCompareClear | kShortCompareStop) << channel;
+            uint32_t shorts = raw_read32(Regs::kBase + kShortsOffset) & ~mask;
+            if (clear) {
+                shorts |= (kShortCompareClear << channel);
+            }
+            if (stop) {
+                shorts |= (kShortCompareStop << channel);
+            }
+            raw_write32(Regs::kBase + kShortsOffset, shorts);
+        }
+
+        /**
+         * @brief Copy the counter to CC[channel], and return it.
+         */
+        static uint32_t capture(unsigned int channel) {
+            Regs::trigger_task(Task::CAPTURE0 + channel);
+            return raw_read32(Regs::kBase + kCCOffset + channel * 4);
+        }
+
+        /**
+         * @brief Raise COMPAREn event when the counter reaches value, the old event is cleared.
+         */
+        static void set_compare(unsigned int channel, uint32_t value) {
+            Regs::clear_event(Event::COMPARE0 + channel);
+            raw_write32(Regs::kBase + kCCOffset + channel * 4, value);
+        }
+
+    private:
+        static constexpr uint32_t kShortsOffset = 0x200;
+        static constexpr uint32_t kModeOffset = 0x504;
+        static constexpr uint32_t kBitModeOffset = 0x508;
+        static constexpr uint32_t kPrescalerOffset = 0x510;
+        static constexpr uint32_t kCCOffset = 0x540;
+
+        static constexpr uint32_t kShortCompareClear = (1 << 0);
+        static constexpr uint32_t kShortCompareStop = (1 << 8);
+};
+
+}  // namespace nrf52
@@ -0,0 +1,45 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+namespace nrf52 {
+
+namespace uarte {
+
+struct RateConfig {
+    unsigned int rate;
+    uint32_t conf_value;
+    unsigned int actual_rate;
+};
+
+// BAUDRATE register values and the baud rates they actually produce
+inline constexpr RateConfig supported_rates[] = {
+    { .rate = 1200, .conf_value = 0x4f000, .actual_rate = 1205 },
+    { .rate = 2400, .conf_value = 0x9d000, .actual_rate = 2396 },
+    { .rate = 4800, .conf_value = 0x13b000, .actual_rate = 4808 },
+    // Skipped many values
+    { .rate = 56000, .conf_value = 0xe50000, .actual_rate = 55944 },
+    { .rate = 115200, .conf_value = 0x1d60000, .actual_rate = 115108 },
+    { .rate = 921600, .conf_value = 0xf000000, .actual_rate = 941176 },
+    { .rate = 1000 * 1000, .conf_value = 0x10000000, .actual_rate = 1000 * 1000 },
+};
+
+}  // namespace uarte
+
+}  // namespace nrf52
@@ -74,6 +74,12 @@ int nvic_set_handler(int irqn, irq_handler_func_t handler_func) {
     return 0;
 }
 
+#ifdef CHIP_NATIVETEST
+/* Host emulation of PRIMASK, the interrupts dispatched while it is set run when it's cleared */
+static uint32_t host_primask;
+static uint8_t host_pending[ARRAY_SIZE(vector_table)];
+#endif
+
 int nvic_dispatch(int irqn) {
     const size_t offset = irqn - IRQ_OFFSET;
     if (offset > ARRAY_SIZE(vector_table)) {
@@ -84,6 +90,17 @@ int nvic_dispatch(int irqn) {
         return -2;
     }
 
+#ifdef CHIP_NATIVETEST
+    /* NMI and HardFault are not masked */
+    if (host_primask && irqn > IRQ_HARD_FAULT) {
+        host_pending[offset] = 1;
+        return 0;
+    }
+#endif
+
+#ifdef TEST_MEMIO
+    raw_irq_dispatched(irqn);
+#endif
     vector_table[offset]();
     return 0;
 }
@@ -127,6 +144,34 @@ void nvic_disable_irqs() {
 #endif
 }
 
+uint32_t nvic_save_and_disable_irqs(void) {
+    uint32_t state = 0;
+#if defined(__arm__) && defined(__thumb__)
+    __asm__ volatile("mrs %0, primask\n"
+                     "cpsid i" : "=r"(state) :: "memory");
+#elif defined(CHIP_NATIVETEST)
+    state = host_primask;
+    host_primask = 1;
+#endif
+    return state;
+}
+
+void nvic_restore_irqs(uint32_t state) {
+#if defined(__arm__) && defined(__thumb__)
+    __asm__ volatile("msr primask, %0" :: "r"(state) : "memory");
+#elif defined(CHIP_NATIVETEST)
+    host_primask = state;
+    for (size_t i = 0; i < ARRAY_SIZE(vector_table) && !host_primask; ++i) {
+        if (host_pending[i]) {
+            host_pending[i] = 0;
+            nvic_dispatch((int)i + IRQ_OFFSET);
+        }
+    }
+#else
+    (void)state;
+#endif
+}
+
 void nvic_enable_irq(int irqn) {
     raw_write32(NVIC_ISER(NVIC_IRQ_REGN(irqn)), NVIC_IRQ_MASK(irqn));
 }
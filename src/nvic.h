@@ -17,6 +17,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 enum {
     IRQ_OFFSET = -16,
@@ -55,6 +56,17 @@ int nvic_irqset(int irqn);
 void nvic_enable_irqs(void);
 void nvic_disable_irqs(void);
 
+/**
+ * @brief Mask all of the configurable priority interrupts.
+ *
+ * The critical sections can be nested, each one restores the state it found.
+ * On the host the interrupts dispatched meanwhile are run by nvic_restore_irqs().
+ *
+ * @returns Previous state for nvic_restore_irqs().
+ */
+uint32_t nvic_save_and_disable_irqs(void);
+void nvic_restore_irqs(uint32_t state);
+
 void nvic_enable_irq(int irqn);
 void nvic_disable_irq(int irqn);
 
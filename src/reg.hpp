@@ -0,0 +1,142 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "memio.h"
+
+/**
+ * @file
+ *
+ * Register and field descriptions with the addresses, the shifts and the widths
+ * known at compile time.
+ *
+ *     using Pcnf1 = reg::Reg<kRadioBase + 0x518>;
+ *     using Maxlen = reg::Field<Pcnf1, 0, 8>;
+ *     using Balen = reg::Field<Pcnf1, 16, 3>;
+ *     using WhiteEn = reg::Field<Pcnf1, 25, 1>;
+ *
+ *     // One read-modify-write for all of the fields
+ *     Pcnf1::modify(Balen::value(3), WhiteEn::value(1));
+ *     // One write, the rest of the register is zero
+ *     Pcnf1::write(Maxlen::value(255), Balen::value(3));
+ *
+ * The values of the fields of different registers can't be mixed. The masks and,
+ * for the constant values, the bits are combined at compile time. All of the accesses
+ * go through raw_read32() and raw_write32(), so they can be mocked with TEST_MEMIO.
+ */
+
+namespace reg {
+
+enum class Access {
+    RW,
+    RO,
+    WO,
+};
+
+/**
+ * @brief Bits of the fields of the register R, and the mask of those fields.
+ */
+template <typename R>
+struct FieldValue {
+    uint32_t mask;
+    uint32_t bits;
+
+    constexpr FieldValue operator|(FieldValue other) const {
+        return FieldValue{mask | other.mask, bits | other.bits};
+    }
+};
+
+template <uint32_t Addr, Access A = Access::RW>
+class Reg {
+    public:
+        static constexpr uint32_t kAddr = Addr;
+
+        static uint32_t read() {
+            static_assert(A != Access::WO, "The register is write only");
+            return raw_read32(Addr);
+        }
+
+        static void write(uint32_t value) {
+            static_assert(A != Access::RO, "The register is read only");
+            raw_write32(Addr, value);
+        }
+
+        /**
+         * @brief Write the fields, the rest of the register is zero. No read.
+         */
+        template <typename... Values>
+        static void write(FieldValue<Reg> first, Values... rest) {
+            write(combine(first, rest...).bits);
+        }
+
+        /**
+         * @brief Change the fields, keep the rest of the register.
+         *
+         * A single read-modify-write for all of the fields.
+         */
+        template <typename... Values>
+        static void modify(FieldValue<Reg> first, Values... rest) {
+            static_assert(A == Access::RW, "The register can't be modified");
+            const auto value = combine(first, rest...);
+            raw_write32(Addr, (raw_read32(Addr) & ~value.mask) | value.bits);
+        }
+
+    private:
+        static constexpr FieldValue<Reg> combine(FieldValue<Reg> value) {
+            return value;
+        }
+
+        template <typename... Values>
+        static constexpr FieldValue<Reg> combine(FieldValue<Reg> first, FieldValue<Reg> second, Values... rest) {
+            return combine(first | second, rest...);
+        }
+};
+
+template <typename R, unsigned int Shift, unsigned int Width>
+class Field {
+    public:
+        static_assert(Width > 0 && Shift + Width <= 32, "The field doesn't fit in the register");
+
+        using RegT = R;
+
+        static constexpr uint32_t kShift = Shift;
+        static constexpr uint32_t kMask = (Width == 32 ? ~0u : ((1u << Width) - 1)) << Shift;
+
+        /**
+         * @brief The field set to v, to be written with Reg::write() or Reg::modify().
+         *
+         * The bits of v that don't fit in the field are dropped.
+         */
+        static constexpr FieldValue<R> value(uint32_t v) {
+            return FieldValue<R>{kMask, (v << Shift) & kMask};
+        }
+
+        static uint32_t read() {
+            return (R::read() & kMask) >> Shift;
+        }
+
+        /**
+         * @brief Read-modify-write of the field alone.
+         */
+        static void write(uint32_t v) {
+            R::modify(value(v));
+        }
+};
+
+}  // namespace reg
@@ -22,6 +22,9 @@
 
 #define SCB_ICSR        (SCB_BASE + 0x04)
 #define SCB_VTOR        (SCB_BASE + 0x08)
+#define SCB_SCR         (SCB_BASE + 0x10)
+
+#define SCB_SCR_SEVONPEND   (1 << 4)
 
 void syscontrol_relocate_vt(uintptr_t new_addr, unsigned num_vectors) {
     uint32_t old_location = raw_read32(SCB_VTOR);
@@ -35,3 +38,13 @@ void syscontrol_relocate_vt(uintptr_t new_addr, unsigned num_vectors) {
 
     raw_write32(SCB_VTOR, new_addr);
 }
+
+void syscontrol_enable_sev_on_pend(void) {
+    raw_setbits_le32(SCB_SCR, SCB_SCR_SEVONPEND);
+}
+
+void syscontrol_wait_for_event(void) {
+#if defined(__arm__) && defined(__thumb__)
+    __asm__ volatile("dsb\n\twfe" ::: "memory");
+#endif
+}
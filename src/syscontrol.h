@@ -24,6 +24,15 @@ extern "C" {
 
 void syscontrol_relocate_vt(uintptr_t new_addr, unsigned num_vectors);
 
+/*
+ * Make the interrupts that become pending wake up WFE,
+ * even if they are masked or disabled.
+ */
+void syscontrol_enable_sev_on_pend(void);
+
+/* Sleep until an event, e.g. a pending interrupt, no-op on the host. */
+void syscontrol_wait_for_event(void);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -0,0 +1,121 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/*
+ * Microbenchmarks for the Memory IO mock.
+ *
+ * These are hidden from the default test run. To run them:
+ *
+ *   ./run_all_tests "[benchmark]"
+ */
+
+#include "mock_memio.hpp"
+
+#include <map>
+
+#include "third_party/catch2/catch.hpp"
+
+namespace {
+
+constexpr unsigned kNumIterations = 1000 * 1000;
+
+// Register block similar to an nRF52 peripheral: tasks, events and configuration
+const uint32_t kPeriphBase = 0x40002000;
+const uint32_t kOffsets[] = {0x000, 0x008, 0x100, 0x120, 0x304, 0x500, 0x524, 0x544, 0x548, 0x56c};
+constexpr auto kNumOffsets = sizeof(kOffsets) / sizeof(kOffsets[0]);
+
+/*
+ * The storage that mock::Memory used before the paged store, kept here
+ * as a reference point.
+ */
+class MapMemory {
+    public:
+        void write32(uint32_t addr, uint32_t value) {
+            mem_map_[addr] = value;
+        }
+
+        uint32_t read32(uint32_t addr) const {
+            const auto it = mem_map_.find(addr);
+            return it != mem_map_.end() ? it->second : 0;
+        }
+
+    private:
+        std::map<uint32_t, uint32_t> mem_map_;
+};
+
+}  // namespace
+
+TEST_CASE("Memory mock storage", "[.][benchmark]") {
+    mock::Memory mem;
+    mem.set_value_at(0x20000000, 1);
+    mem.set_value_at(0xe000e100, 1);
+
+    MapMemory map_mem;
+    map_mem.write32(0x20000000, 1);
+    map_mem.write32(0xe000e100, 1);
+
+    uint32_t paged_sum = 0;
+    BENCHMARK("Paged store: set_value_at/get_value_at") {
+        for (unsigned i = 0; i < kNumIterations; ++i) {
+            const auto addr = kPeriphBase + kOffsets[i % kNumOffsets];
+            mem.set_value_at(addr, mem.get_value_at(addr, 0) + i);
+            paged_sum += mem.get_value_at(addr, 0);
+        }
+    }
+
+    uint32_t map_sum = 0;
+    BENCHMARK("std::map store: write/read") {
+        for (unsigned i = 0; i < kNumIterations; ++i) {
+            const auto addr = kPeriphBase + kOffsets[i % kNumOffsets];
+            map_mem.write32(addr, map_mem.read32(addr) + i);
+            map_sum += map_mem.read32(addr);
+        }
+    }
+
+    CHECK(paged_sum == map_sum);
+}
+
+TEST_CASE("Memory mock IO handler dispatch", "[.][benchmark]") {
+    mock::Memory mem;
+    mock::IOHandlerStub stub;
+
+    BENCHMARK("Register handler for 1 MiB peripheral block") {
+        for (unsigned i = 0; i < 1000; ++i) {
+            mem.reset();
+            mem.set_addr_io_handler(kPeriphBase, kPeriphBase + 0x100000, &stub);
+        }
+    }
+
+    uint32_t sum = 0;
+    BENCHMARK("Dispatch to the handler") {
+        for (unsigned i = 0; i < kNumIterations; ++i) {
+            const auto addr = kPeriphBase + kOffsets[i % kNumOffsets];
+            mem.write32(addr, i);
+            sum += mem.read32(addr);
+        }
+    }
+
+    mem.reset();
+    BENCHMARK("Access without handlers") {
+        for (unsigned i = 0; i < kNumIterations; ++i) {
+            const auto addr = kPeriphBase + kOffsets[i % kNumOffsets];
+            mem.write32(addr, i);
+            sum += mem.read32(addr);
+        }
+    }
+
+    CHECK(sum > 0);
+}
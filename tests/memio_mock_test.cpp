@@ -16,6 +16,10 @@
 
 #include "mock_memio.hpp"
 
+#include <unistd.h>
+
+#include <cstring>
+
 #include "third_party/catch2/catch.hpp"
 
 namespace {
@@ -57,6 +61,54 @@ TEST_CASE("Test Memory IO stubbing") {
         static_assert(write_addr < range_end, "Invalid test value");
         mem.write32(write_addr, 0xdecafbad);
         CHECK(mem.get_value_at(write_addr) == (~test_value));
+
+        // Addresses just outside of the range are not handled
+        mem.write32(range_start - 4, test_value);
+        CHECK(mem.get_value_at(range_start - 4) == test_value);
+        mem.write32(range_end, test_value);
+        CHECK(mem.get_value_at(range_end) == test_value);
+    }
+
+    SECTION("Setting handler for a large range") {
+        constexpr uint32_t range_start = 0x40000000;
+        constexpr uint32_t range_end = 0x40100000;
+
+        mem.set_addr_io_handler(range_start, range_end, &bit_flipper);
+
+        for (auto addr : {range_start, range_start + 0x1000, range_end - 4}) {
+            mem.write32(addr, 0);
+            CHECK(mem.get_value_at(addr) == 0xffffffff);
+        }
+
+        mem.write32(range_end, 0);
+        CHECK(mem.get_value_at(range_end) == 0);
+    }
+
+    SECTION("Overlapping ranges keep the first handler") {
+        mock::IgnoreWrites ignore_writes;
+
+        mem.set_addr_io_handler(0x110, &ignore_writes);
+        mem.set_addr_io_handler(0x100, 0x200, &bit_flipper);
+        mem.set_addr_io_handler(0x180, 0x300, &ignore_writes);
+
+        mem.write32(0x10c, 0xf0);
+        CHECK(mem.get_value_at(0x10c) == ~0xf0u);
+        mem.write32(0x110, 0xf0);
+        CHECK(mem.get_value_at(0x110) == 0);
+        mem.write32(0x114, 0xf0);
+        CHECK(mem.get_value_at(0x114) == ~0xf0u);
+        mem.write32(0x1fc, 0xf0);
+        CHECK(mem.get_value_at(0x1fc) == ~0xf0u);
+        mem.write32(0x200, 0xf0);
+        CHECK(mem.get_value_at(0x200) == 0);
+    }
+
+    SECTION("Reset removes handlers") {
+        mem.set_addr_io_handler(0x100, 0x200, &bit_flipper);
+        mem.reset();
+
+        mem.write32(0x100, 0xf0);
+        CHECK(mem.get_value_at(0x100) == 0xf0);
     }
 }
 
@@ -90,6 +142,22 @@ TEST_CASE("Test Basic Memory RW") {
     CHECK(mem.read32(test_addr) == 0);
 }
 
+TEST_CASE("Test DMA Accessibility") {
+    mock::Memory mem;
+    static const char flash_string[] = "flash";
+    uint8_t ram_buffer[4] = {};
+    mem.add_flash_region(flash_string, sizeof(flash_string));
+
+    CHECK(mem.is_dma_accessible(ram_buffer, sizeof(ram_buffer)));
+    CHECK_FALSE(mem.is_dma_accessible(flash_string, sizeof(flash_string)));
+    CHECK_FALSE(mem.is_dma_accessible(flash_string + 2, 1));
+
+    // Same as on the target: nothing is accessed for the empty buffers
+    CHECK(mem.is_dma_accessible(nullptr, 0));
+    CHECK(mem.is_dma_accessible(flash_string, 0));
+    CHECK_FALSE(mem.is_dma_accessible(nullptr, 1));
+}
+
 TEST_CASE("Test Memory Journal") {
     mock::Memory mem;
 
@@ -130,3 +198,85 @@ TEST_CASE("Test Write One To Clear (W1C) Handler Stub") {
     mem.write32(0x8000, 0xb0d);
     CHECK(mem.get_value_at(0x8000) == 0xa0e0);
 }
+
+TEST_CASE("Test Memory Journal Modes") {
+    mock::Memory mem;
+    using Op = mock::Memory::Op;
+    using JournalMode = mock::Memory::JournalMode;
+
+    CHECK(mem.get_journal_mode() == JournalMode::FULL);
+
+    SECTION("Off") {
+        mem.set_journal_mode(JournalMode::OFF);
+        mem.write32(0x100, 1);
+        CHECK(mem.read32(0x100) == 1);
+
+        CHECK(mem.get_journal().empty());
+        CHECK(mem.get_op_count(Op::WRITE32) == 0);
+        CHECK(mem.get_op_count(Op::READ32, 0x100) == 0);
+    }
+
+    SECTION("Ring") {
+        mem.set_journal_ring_size(4);
+        mem.set_journal_mode(JournalMode::RING);
+
+        for (uint32_t i = 0; i < 10; ++i) {
+            mem.write32(0x100 + 4 * i, i);
+        }
+
+        const auto& journal = mem.get_journal();
+        REQUIRE(journal.size() == 4);
+        for (uint32_t i = 0; i < 4; ++i) {
+            CHECK(std::get<0>(journal[i]) == Op::WRITE32);
+            CHECK(std::get<1>(journal[i]) == 0x100 + 4 * (i + 6));
+            CHECK(std::get<2>(journal[i]) == i + 6);
+        }
+
+        // Counters still see all of the operations
+        CHECK(mem.get_op_count(Op::WRITE32) == 10);
+        CHECK(mem.get_op_count(Op::WRITE32, 0x100) == 1);
+    }
+
+    SECTION("Streaming") {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+
+        mem.set_journal_stream_fd(fds[1]);
+        mem.set_journal_mode(JournalMode::STREAMING);
+        mem.write32(0x40001000, 0xdeadbeef);
+        CHECK(mem.read16(0x40001002) == 0xdead);
+        mem.flush_journal();
+
+        CHECK(mem.get_journal().empty());
+        CHECK(mem.get_op_count(Op::WRITE32, 0x40001000) == 1);
+
+        uint8_t records[2 * mock::Memory::kJournalRecordSize];
+        REQUIRE(read(fds[0], records, sizeof(records)) == sizeof(records));
+
+        const uint8_t expected[] = {
+            static_cast<uint8_t>(Op::WRITE32), 0x00, 0x10, 0x00, 0x40, 0xef, 0xbe, 0xad, 0xde,
+            static_cast<uint8_t>(Op::READ16), 0x02, 0x10, 0x00, 0x40, 0xad, 0xde, 0x00, 0x00,
+        };
+        CHECK(std::memcmp(records, expected, sizeof(expected)) == 0);
+
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    SECTION("Operation counters") {
+        mem.write32(0x100, 1);
+        mem.write32(0x100, 2);
+        mem.write32(0x104, 3);
+        mem.read32(0x104);
+
+        CHECK(mem.get_op_count(Op::WRITE32) == 3);
+        CHECK(mem.get_op_count(Op::WRITE32, 0x100) == 2);
+        CHECK(mem.get_op_count(Op::WRITE32, 0x104) == 1);
+        CHECK(mem.get_op_count(Op::READ32, 0x104) == 1);
+        CHECK(mem.get_op_count(Op::READ32, 0x100) == 0);
+
+        mem.reset();
+        CHECK(mem.get_op_count(Op::WRITE32) == 0);
+        CHECK(mem.get_op_count(Op::WRITE32, 0x100) == 0);
+    }
+}
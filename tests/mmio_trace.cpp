@@ -0,0 +1,300 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "mmio_trace.hpp"
+
+#include <cstring>
+#include <iomanip>
+
+namespace mock {
+
+namespace trace {
+
+namespace {
+
+uint32_t zigzag_encode(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t zigzag_decode(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+bool is_read(uint8_t kind) {
+    using Op = Memory::Op;
+    switch (static_cast<Op>(kind)) {
+    case Op::READ8:
+    case Op::READ16:
+    case Op::READ32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool is_write(uint8_t kind) {
+    using Op = Memory::Op;
+    switch (static_cast<Op>(kind)) {
+    case Op::WRITE8:
+    case Op::WRITE16:
+    case Op::WRITE32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+unsigned access_width(uint8_t kind) {
+    using Op = Memory::Op;
+    switch (static_cast<Op>(kind)) {
+    case Op::READ8:
+    case Op::WRITE8:
+        return 8;
+    case Op::READ16:
+    case Op::WRITE16:
+        return 16;
+    default:
+        return 32;
+    }
+}
+
+uint32_t access_mask(const Record& record) {
+    const auto width = access_width(record.kind);
+    const uint32_t mask = width == 32 ? 0xffffffff : ((1u << width) - 1);
+    return mask << (8 * (record.addr & 3));
+}
+
+}  // namespace
+
+const char* kind_name(uint8_t kind) {
+    if (kind == kIrqKind) {
+        return "IRQ";
+    }
+
+    using Op = Memory::Op;
+    switch (static_cast<Op>(kind)) {
+    case Op::READ8:
+        return "R8";
+    case Op::READ16:
+        return "R16";
+    case Op::READ32:
+        return "R32";
+    case Op::READPTR:
+        return "RPTR";
+    case Op::WRITE8:
+        return "W8";
+    case Op::WRITE16:
+        return "W16";
+    case Op::WRITE32:
+        return "W32";
+    case Op::WRITEPTR:
+        return "WPTR";
+    default:
+        return "XX";
+    }
+}
+
+void print_record(std::ostream& os, const Record& record) {
+    const auto flags = os.flags();
+    os << std::dec << record.timestamp << " " << kind_name(record.kind) << ": ";
+    if (record.is_irq()) {
+        os << static_cast<int32_t>(record.addr);
+    } else {
+        os << std::hex << record.addr << " " << record.value;
+    }
+    os.flags(flags);
+}
+
+Writer::Writer(std::ostream& os) : os_{os} {
+    os_.write(kTraceMagic, sizeof(kTraceMagic));
+}
+
+void Writer::put_varint(uint64_t value) {
+    char buf[10];
+    size_t len = 0;
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if (value) {
+            byte |= 0x80;
+        }
+        buf[len++] = byte;
+    } while (value);
+
+    os_.write(buf, len);
+}
+
+void Writer::write(const Record& record) {
+    os_.put(record.kind);
+    put_varint(record.timestamp - last_timestamp_);
+    last_timestamp_ = record.timestamp;
+
+    if (record.is_irq()) {
+        put_varint(zigzag_encode(record.addr));
+    } else {
+        put_varint(zigzag_encode(record.addr - last_addr_));
+        put_varint(record.value);
+        last_addr_ = record.addr;
+    }
+}
+
+Reader::Reader(std::istream& is) : is_{is} {
+    char magic[sizeof(kTraceMagic)];
+    if (!is_.read(magic, sizeof(magic)) || std::memcmp(magic, kTraceMagic, sizeof(magic))) {
+        valid_ = false;
+    }
+}
+
+bool Reader::get_varint(uint64_t* value) {
+    uint64_t result = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        const auto byte = is_.get();
+        if (byte == std::istream::traits_type::eof()) {
+            return false;
+        }
+
+        result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Reader::next(Record* record) {
+    if (!valid_) {
+        return false;
+    }
+
+    const auto kind = is_.get();
+    if (kind == std::istream::traits_type::eof()) {
+        return false;
+    }
+
+    uint64_t ts_delta = 0;
+    uint64_t addr = 0;
+    uint64_t value = 0;
+    if (!get_varint(&ts_delta) || !get_varint(&addr)) {
+        valid_ = false;
+        return false;
+    }
+
+    record->kind = kind;
+    record->timestamp = last_timestamp_ + ts_delta;
+    last_timestamp_ = record->timestamp;
+
+    if (record->is_irq()) {
+        record->addr = zigzag_decode(addr);
+        record->value = 0;
+    } else {
+        if (!get_varint(&value)) {
+            valid_ = false;
+            return false;
+        }
+        record->addr = last_addr_ + zigzag_decode(addr);
+        record->value = value;
+        last_addr_ = record->addr;
+    }
+
+    return true;
+}
+
+std::vector<Record> Reader::read_all() {
+    std::vector<Record> records;
+    Record record;
+    while (next(&record)) {
+        records.push_back(record);
+    }
+
+    return records;
+}
+
+Replayer::Replayer(std::vector<Record> records) : records_{std::move(records)} {}
+
+void Replayer::install(Memory& mem) {
+    mem_ = &mem;
+    std::set<uint32_t> addresses;
+    for (const auto& record : records_) {
+        if (is_read(record.kind) || is_write(record.kind)) {
+            addresses.insert(record.addr & ~3);
+        }
+    }
+
+    for (auto addr : addresses) {
+        mem.set_addr_io_handler(addr, this);
+    }
+}
+
+const Record* Replayer::expected() {
+    while (pos_ < records_.size()) {
+        const auto& record = records_[pos_];
+        if (is_read(record.kind) || is_write(record.kind)) {
+            return &record;
+        }
+        ++pos_;
+    }
+
+    return nullptr;
+}
+
+bool Replayer::is_done() const {
+    for (auto i = pos_; i < records_.size(); ++i) {
+        if (is_read(records_[i].kind) || is_write(records_[i].kind)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t Replayer::read32(uint32_t addr, uint32_t value) {
+    if (mem_ && mem_->is_rmw_read()) {
+        return value;
+    }
+
+    const auto* record = expected();
+    if (!record || !is_read(record->kind) || (record->addr & ~3) != addr) {
+        ++mismatch_count_;
+        return value;
+    }
+
+    ++pos_;
+    const auto mask = access_mask(*record);
+    return (value & ~mask) | ((record->value << (8 * (record->addr & 3))) & mask);
+}
+
+uint32_t Replayer::write32(uint32_t addr, uint32_t old_value, uint32_t new_value) {
+    (void)old_value;
+    const auto* record = expected();
+    if (!record || !is_write(record->kind) || (record->addr & ~3) != addr) {
+        ++mismatch_count_;
+        return new_value;
+    }
+
+    ++pos_;
+    const auto mask = access_mask(*record);
+    if ((new_value & mask) != ((record->value << (8 * (record->addr & 3))) & mask)) {
+        ++mismatch_count_;
+    }
+
+    return new_value;
+}
+
+}  // namespace trace
+
+}  // namespace mock
@@ -0,0 +1,206 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/**
+ * @file
+ *
+ * Compact binary trace of the memory IO operations and interrupt dispatches.
+ *
+ * The trace starts with an 8 byte magic (kTraceMagic), followed by the records.
+ * Each record is:
+ *
+ *  - Kind, one byte: Memory::Op value for memory IO, or kIrqKind for interrupt dispatch.
+ *  - Timestamp, delta from the previous record, as unsigned LEB128 varint.
+ *  - For memory IO: address delta from the previous memory IO record, zigzag encoded varint,
+ *    followed by the value as unsigned varint.
+ *  - For interrupt dispatch: the interrupt number, zigzag encoded varint.
+ *
+ * Consecutive accesses to the registers of the same peripheral typically take 3-5 bytes per record.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mock_memio.hpp"
+
+namespace mock {
+
+namespace trace {
+
+constexpr char kTraceMagic[8] = {'M', 'M', 'I', 'O', 'T', 'R', 'C', 1};
+constexpr uint8_t kIrqKind = 0x80;
+
+/**
+ * @brief Single trace record.
+ */
+struct Record {
+    uint64_t timestamp;
+    /** Memory::Op value, or kIrqKind */
+    uint8_t kind;
+    /** Memory address for memory IO, interrupt number for interrupt dispatch */
+    uint32_t addr;
+    /** Value read or written, zero for interrupt dispatch */
+    uint32_t value;
+
+    bool is_irq() const {
+        return kind == kIrqKind;
+    }
+
+    bool operator==(const Record& other) const {
+        return timestamp == other.timestamp && kind == other.kind
+               && addr == other.addr && value == other.value;
+    }
+
+    bool operator!=(const Record& other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * @brief Human readable name of the record kind, i.e. "W32" or "IRQ".
+ */
+const char* kind_name(uint8_t kind);
+
+/**
+ * @brief Print the record as a single line of text, without the line ending.
+ */
+void print_record(std::ostream& os, const Record& record);
+
+/**
+ * @brief Encodes the records into a stream.
+ */
+class Writer {
+    public:
+        /**
+         * @brief Create the writer and write the trace header into the stream.
+         *
+         * Writer does not own the stream.
+         */
+        explicit Writer(std::ostream& os);
+
+        void write(const Record& record);
+
+        void write_mem_op(uint64_t timestamp, Memory::Op op, uint32_t addr, uint32_t value) {
+            write({timestamp, static_cast<uint8_t>(op), addr, value});
+        }
+
+        void write_irq(uint64_t timestamp, int irqn) {
+            write({timestamp, kIrqKind, static_cast<uint32_t>(irqn), 0});
+        }
+
+    private:
+        void put_varint(uint64_t value);
+
+        std::ostream& os_;
+        uint64_t last_timestamp_ = 0;
+        uint32_t last_addr_ = 0;
+};
+
+/**
+ * @brief Decodes the records from a stream.
+ */
+class Reader {
+    public:
+        /**
+         * @brief Create the reader and check the trace header.
+         *
+         * Reader does not own the stream.
+         */
+        explicit Reader(std::istream& is);
+
+        /**
+         * @brief Returns false if the header was wrong or the trace was truncated.
+         */
+        bool is_valid() const {
+            return valid_;
+        }
+
+        /**
+         * @brief Read the next record.
+         *
+         * @return false at the end of the trace or on error.
+         */
+        bool next(Record* record);
+
+        /**
+         * @brief Read all of the remaining records.
+         */
+        std::vector<Record> read_all();
+
+    private:
+        bool get_varint(uint64_t* value);
+
+        std::istream& is_;
+        bool valid_ = true;
+        uint64_t last_timestamp_ = 0;
+        uint32_t last_addr_ = 0;
+};
+
+/**
+ * @brief Replays the memory reads recorded in a trace.
+ *
+ * The replayer registers itself as an IO handler for every address accessed in the trace.
+ * The reads return the recorded values in the recorded order, so the code under test
+ * sees the same hardware behavior as during the recording, without the IO handlers
+ * that produced it. The writes are compared with the recorded ones.
+ *
+ * Any access that does not match the next expected record is counted as
+ * a mismatch and is handled as a plain memory access. Interrupt dispatches and the
+ * pointer accesses are not replayed, neither are the reads of the sub-word writes,
+ * which aren't in the trace.
+ */
+class Replayer : public IOHandlerStub {
+    public:
+        explicit Replayer(std::vector<Record> records);
+
+        /**
+         * @brief Register the replayer as IO handler for all of the addresses in the trace.
+         */
+        void install(Memory& mem);
+
+        uint32_t write32(uint32_t addr, uint32_t old_value, uint32_t new_value) override;
+        uint32_t read32(uint32_t addr, uint32_t value) override;
+
+        /**
+         * @brief Number of accesses that did not match the trace.
+         */
+        unsigned get_mismatch_count() const {
+            return mismatch_count_;
+        }
+
+        /**
+         * @brief Returns true if all of the memory IO records were replayed.
+         */
+        bool is_done() const;
+
+    private:
+        const Record* expected();
+
+        const Memory* mem_ = nullptr;
+        std::vector<Record> records_;
+        size_t pos_ = 0;
+        unsigned mismatch_count_ = 0;
+};
+
+}  // namespace trace
+
+}  // namespace mock
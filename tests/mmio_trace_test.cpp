@@ -0,0 +1,199 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "third_party/catch2/catch.hpp"
+
+#include <sstream>
+
+#include "mmio_trace.hpp"
+#include "mock_memio.hpp"
+
+#include "memio.h"
+#include "nvic.h"
+
+namespace {
+
+using mock::trace::Record;
+using Op = mock::Memory::Op;
+
+constexpr uint32_t kStatusAddr = 0x40002100;
+constexpr uint32_t kDataAddr = 0x40002518;
+constexpr uint32_t kTaskAddr = 0x40002008;
+
+int irq_counter = 0;
+
+void test_irq_handler() {
+    ++irq_counter;
+}
+
+/*
+ * Simple "driver": start the peripheral, wait for the status and
+ * read out the data.
+ */
+uint32_t run_driver() {
+    raw_write32(kTaskAddr, 1);
+    while (!raw_read32(kStatusAddr));
+    raw_write32(kStatusAddr, 0);
+
+    return raw_read32(kDataAddr) + raw_read32(kDataAddr);
+}
+
+}  // namespace
+
+TEST_CASE("Test MMIO trace encoding") {
+    std::stringstream buffer;
+    const std::vector<Record> records = {
+        {1, static_cast<uint8_t>(Op::WRITE32), 0x40002000, 1},
+        {2, static_cast<uint8_t>(Op::READ32), 0x40002100, 0},
+        {2, mock::trace::kIrqKind, static_cast<uint32_t>(IRQ_SYSTICK), 0},
+        {7, static_cast<uint8_t>(Op::READ32), 0x40001000, 0xdeadbeef},
+        {1ull << 40, static_cast<uint8_t>(Op::WRITE16), 0x20000002, 0xcafe},
+    };
+
+    {
+        mock::trace::Writer writer{buffer};
+        for (const auto& record : records) {
+            writer.write(record);
+        }
+    }
+
+    // Should be smaller than fixed size records, even without the timestamps
+    CHECK(buffer.str().size() < sizeof(mock::trace::kTraceMagic)
+          + records.size() * mock::Memory::kJournalRecordSize);
+
+    mock::trace::Reader reader{buffer};
+    REQUIRE(reader.is_valid());
+    CHECK(reader.read_all() == records);
+    CHECK(reader.is_valid());
+
+    SECTION("Bad header") {
+        std::stringstream bad{"not a trace"};
+        mock::trace::Reader bad_reader{bad};
+        CHECK_FALSE(bad_reader.is_valid());
+        Record record;
+        CHECK_FALSE(bad_reader.next(&record));
+    }
+
+    SECTION("Truncated trace") {
+        auto data = buffer.str();
+        std::stringstream truncated{data.substr(0, data.size() - 1)};
+        mock::trace::Reader truncated_reader{truncated};
+        CHECK(truncated_reader.read_all().size() == records.size() - 1);
+        CHECK_FALSE(truncated_reader.is_valid());
+    }
+}
+
+TEST_CASE("Test MMIO trace record and replay") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    nvic_init();
+
+    std::stringstream buffer;
+    uint32_t recorded_result = 0;
+    {
+        mock::SourceIOHandler status;
+        status.add_value(0);
+        status.add_value(0);
+        status.add_value(1);
+        mem.set_addr_io_handler(kStatusAddr, &status);
+
+        mock::SourceIOHandler data;
+        data.add_value(0x1234);
+        data.add_value(0x4321);
+        mem.set_addr_io_handler(kDataAddr, &data);
+
+        nvic_set_handler(IRQ_SYSTICK, test_irq_handler);
+
+        mock::trace::Writer writer{buffer};
+        mem.set_trace_writer(&writer);
+        recorded_result = run_driver();
+        nvic_dispatch(IRQ_SYSTICK);
+        mem.set_trace_writer(nullptr);
+    }
+
+    CHECK(recorded_result == 0x5555);
+
+    mock::trace::Reader reader{buffer};
+    auto records = reader.read_all();
+    REQUIRE(reader.is_valid());
+    // Task, three status reads, status clear, two data reads and IRQ
+    REQUIRE(records.size() == 8);
+    const auto start = records[0].timestamp;
+    CHECK(records[0] == Record{start, static_cast<uint8_t>(Op::WRITE32), kTaskAddr, 1});
+    CHECK(records[3] == Record{start + 3, static_cast<uint8_t>(Op::READ32), kStatusAddr, 1});
+    CHECK(records[7].is_irq());
+    CHECK(records[7].timestamp == records[6].timestamp);
+    CHECK(static_cast<int>(records[7].addr) == IRQ_SYSTICK);
+
+    SECTION("Replay") {
+        // No handlers this time, all of the reads come from the trace
+        mem.reset();
+        mock::trace::Replayer replayer{records};
+        replayer.install(mem);
+
+        CHECK(run_driver() == recorded_result);
+        CHECK(replayer.get_mismatch_count() == 0);
+        CHECK(replayer.is_done());
+    }
+
+    SECTION("Replay detects divergence") {
+        mem.reset();
+        mock::trace::Replayer replayer{records};
+        replayer.install(mem);
+
+        raw_write32(kTaskAddr, 2);
+        CHECK(replayer.get_mismatch_count() == 1);
+        CHECK_FALSE(replayer.is_done());
+    }
+}
+
+TEST_CASE("Test MMIO trace replay with sub-word writes") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+
+    // The register keeps the writes, so that the reads see them
+    mock::IOHandlerStub reg;
+    mem.set_addr_io_handler(kDataAddr, &reg);
+
+    const auto run_subword_driver = [&mem]() {
+        mem.write16(kDataAddr + 2, 0xcafe);
+        mem.write8(kDataAddr, 0x42);
+        mem.write8(kDataAddr + 1, 0x17);
+        return raw_read32(kDataAddr);
+    };
+
+    std::stringstream buffer;
+    {
+        mock::trace::Writer writer{buffer};
+        mem.set_trace_writer(&writer);
+        CHECK(run_subword_driver() == 0xcafe1742);
+        mem.set_trace_writer(nullptr);
+    }
+
+    mock::trace::Reader reader{buffer};
+    auto records = reader.read_all();
+    REQUIRE(reader.is_valid());
+    // The reads of the read-modify-write aren't recorded
+    REQUIRE(records.size() == 4);
+
+    mem.reset();
+    mock::trace::Replayer replayer{records};
+    replayer.install(mem);
+
+    CHECK(run_subword_driver() == 0xcafe1742);
+    CHECK(replayer.get_mismatch_count() == 0);
+    CHECK(replayer.is_done());
+}
@@ -0,0 +1,176 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/*
+ * Command line tool for the MMIO traces, see mmio_trace.hpp for the format.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "mmio_trace.hpp"
+
+namespace {
+
+using mock::trace::Record;
+
+constexpr unsigned kMaxReportedDiffs = 10;
+
+int usage(const char* name) {
+    std::cerr << "Usage:" << std::endl
+              << "  " << name << " dump TRACE" << std::endl
+              << "  " << name << " filter TRACE START END OUTPUT" << std::endl
+              << "      Keep memory IO in [START; END) address range and all IRQ dispatches." << std::endl
+              << "  " << name << " diff TRACE_A TRACE_B" << std::endl
+              << "      Compare the traces, ignoring timestamps." << std::endl;
+    return 2;
+}
+
+bool open_trace(const char* path, std::ifstream& is) {
+    is.open(path, std::ios::binary);
+    if (!is) {
+        std::cerr << "Can't open " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int check_reader(const mock::trace::Reader& reader, const char* path) {
+    if (!reader.is_valid()) {
+        std::cerr << path << ": invalid or truncated trace" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+int dump(const char* path) {
+    std::ifstream is;
+    if (!open_trace(path, is)) {
+        return 1;
+    }
+
+    mock::trace::Reader reader{is};
+    Record record;
+    while (reader.next(&record)) {
+        mock::trace::print_record(std::cout, record);
+        std::cout << std::endl;
+    }
+
+    return check_reader(reader, path);
+}
+
+int filter(const char* path, uint32_t start, uint32_t end, const char* out_path) {
+    std::ifstream is;
+    if (!open_trace(path, is)) {
+        return 1;
+    }
+
+    std::ofstream os{out_path, std::ios::binary};
+    if (!os) {
+        std::cerr << "Can't open " << out_path << std::endl;
+        return 1;
+    }
+
+    mock::trace::Reader reader{is};
+    mock::trace::Writer writer{os};
+    Record record;
+    while (reader.next(&record)) {
+        if (record.is_irq() || (record.addr >= start && record.addr < end)) {
+            writer.write(record);
+        }
+    }
+
+    return check_reader(reader, path);
+}
+
+bool same_event(const Record& a, const Record& b) {
+    return a.kind == b.kind && a.addr == b.addr && a.value == b.value;
+}
+
+int diff(const char* path_a, const char* path_b) {
+    std::ifstream is_a, is_b;
+    if (!open_trace(path_a, is_a) || !open_trace(path_b, is_b)) {
+        return 1;
+    }
+
+    mock::trace::Reader reader_a{is_a};
+    mock::trace::Reader reader_b{is_b};
+
+    unsigned long index = 0;
+    unsigned long num_diffs = 0;
+    Record a, b;
+    while (true) {
+        const bool has_a = reader_a.next(&a);
+        const bool has_b = reader_b.next(&b);
+        if (!has_a && !has_b) {
+            break;
+        }
+
+        if (has_a != has_b || !same_event(a, b)) {
+            if (num_diffs < kMaxReportedDiffs) {
+                std::cout << "#" << index << std::endl;
+                if (has_a) {
+                    std::cout << "< ";
+                    mock::trace::print_record(std::cout, a);
+                    std::cout << std::endl;
+                }
+                if (has_b) {
+                    std::cout << "> ";
+                    mock::trace::print_record(std::cout, b);
+                    std::cout << std::endl;
+                }
+            }
+            ++num_diffs;
+        }
+        ++index;
+    }
+
+    if (check_reader(reader_a, path_a) || check_reader(reader_b, path_b)) {
+        return 2;
+    }
+
+    if (num_diffs) {
+        std::cout << num_diffs << " of " << index << " records differ" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        return usage(argv[0]);
+    }
+
+    const std::string cmd{argv[1]};
+    if (cmd == "dump" && argc == 3) {
+        return dump(argv[2]);
+    } else if (cmd == "filter" && argc == 6) {
+        const uint32_t start = std::strtoul(argv[3], nullptr, 0);
+        const uint32_t end = std::strtoul(argv[4], nullptr, 0);
+        return filter(argv[2], start, end, argv[5]);
+    } else if (cmd == "diff" && argc == 4) {
+        return diff(argv[2], argv[3]);
+    }
+
+    return usage(argv[0]);
+}
@@ -16,7 +16,13 @@
 
 #include "mock_memio.hpp"
 
+#include "mmio_trace.hpp"
+#include "mock_scheduler.hpp"
+
+#include <unistd.h>
+
 #include <algorithm>
+#include <iterator>
 
 namespace mock {
 
@@ -43,36 +49,180 @@ extern "C" void* raw_readptr(uint32_t addr) {
     return g_memory.readptr(addr);
 }
 
+extern "C" void raw_irq_dispatched(int irqn) {
+    g_memory.record_irq(irqn);
+}
+
+extern "C" int raw_dma_accessible(const void* ptr, uint32_t size) {
+    return g_memory.is_dma_accessible(ptr, size);
+}
+
 }  // namespace
 
+const Memory::Page* Memory::find_page(uint32_t addr) const {
+    const auto& table = page_dir_[addr >> kDirShift];
+    if (!table) {
+        return nullptr;
+    }
+
+    return (*table)[(addr >> kPageShift) & (kTableEntries - 1)].get();
+}
+
+Memory::Page& Memory::get_page(uint32_t addr) {
+    auto& table = page_dir_[addr >> kDirShift];
+    if (!table) {
+        table.reset(new PageTable{});
+    }
+
+    auto& page = (*table)[(addr >> kPageShift) & (kTableEntries - 1)];
+    if (!page) {
+        page.reset(new Page{});
+    }
+
+    return *page;
+}
+
+IOHandlerStub* Memory::find_io_handler(uint32_t addr) const {
+    const auto page = addr >> kPageShift;
+    if (!(io_handler_pages_[page / 32] & (1u << (page % 32)))) {
+        return nullptr;
+    }
+
+    auto it = io_regions_.upper_bound(addr);
+    if (it == io_regions_.begin()) {
+        return nullptr;
+    }
+
+    --it;
+    return addr < it->second.end ? it->second.handler : nullptr;
+}
+
 void Memory::priv_write32(uint32_t addr, uint32_t value) {
-    const auto& it = addr_handler_map_.find(addr);
-    if (it != addr_handler_map_.end()) {
+    auto* handler = find_io_handler(addr);
+    if (handler) {
         uint32_t old_value = get_value_at(addr, 0);
-        mem_map_[addr] = it->second->write32(addr, old_value, value);
+        set_value_at(addr, handler->write32(addr, old_value, value));
     } else {
-        mem_map_[addr] = value;
+        set_value_at(addr, value);
     }
 }
 
 uint32_t Memory::priv_read32(uint32_t addr) const {
     uint32_t ret = 0;
-    const auto& it = addr_handler_map_.find(addr);
-    if (it != addr_handler_map_.end()) {
+    auto* handler = find_io_handler(addr);
+    if (handler) {
         uint32_t old_value = get_value_at(addr, 0);
-        ret = it->second->read32(addr, old_value);
+        ret = handler->read32(addr, old_value);
     } else {
-        const auto it = mem_map_.find(addr);
-        if (it != mem_map_.end()) {
-            ret = it->second;
-        }
+        ret = get_value_at(addr, 0);
     }
 
     return ret;
 }
 
+Memory::~Memory() {
+    flush_journal();
+}
+
+uint64_t Memory::get_timestamp() const {
+    return scheduler_ ? scheduler_->now() : timestamp_;
+}
+
+void Memory::advance_time(Op op) const {
+    if (scheduler_) {
+        scheduler_->advance(access_cycles_[static_cast<size_t>(op)]);
+    }
+}
+
+void Memory::record_op(Op op, uint32_t addr, uint32_t value) const {
+    ++timestamp_;
+    if (trace_writer_) {
+        trace_writer_->write_mem_op(get_timestamp(), op, addr, value);
+    }
+
+    switch (journal_mode_) {
+    case JournalMode::OFF:
+        return;
+    case JournalMode::RING:
+        if (journal_.size() < ring_size_) {
+            journal_.emplace_back(op, addr, value);
+        } else if (ring_size_ > 0) {
+            journal_[ring_head_] = std::make_tuple(op, addr, value);
+            ring_head_ = (ring_head_ + 1) % ring_size_;
+        }
+        break;
+    case JournalMode::FULL:
+        journal_.emplace_back(op, addr, value);
+        break;
+    case JournalMode::STREAMING: {
+        const uint8_t record[kJournalRecordSize] = {
+            static_cast<uint8_t>(op),
+            static_cast<uint8_t>(addr), static_cast<uint8_t>(addr >> 8),
+            static_cast<uint8_t>(addr >> 16), static_cast<uint8_t>(addr >> 24),
+            static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+            static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24),
+        };
+        stream_buffer_.insert(stream_buffer_.end(), record, record + sizeof(record));
+        if (stream_buffer_.size() >= kStreamBufferSize) {
+            flush_journal();
+        }
+        break;
+    }
+    }
+
+    ++op_counts_[static_cast<size_t>(op)];
+    ++addr_op_counts_[op_count_key(op, addr)];
+}
+
+void Memory::record_irq(int irqn) const {
+    if (trace_writer_) {
+        trace_writer_->write_irq(get_timestamp(), irqn);
+    }
+}
+
+void Memory::flush_journal() const {
+    if (stream_fd_ >= 0) {
+        size_t written = 0;
+        while (written < stream_buffer_.size()) {
+            auto res = ::write(stream_fd_, stream_buffer_.data() + written, stream_buffer_.size() - written);
+            if (res <= 0) {
+                break;
+            }
+            written += res;
+        }
+    }
+
+    stream_buffer_.clear();
+}
+
+void Memory::clear_journal() {
+    flush_journal();
+    journal_.clear();
+    ring_head_ = 0;
+    op_counts_.fill(0);
+    addr_op_counts_.clear();
+}
+
+void Memory::set_journal_mode(JournalMode mode) {
+    clear_journal();
+    journal_mode_ = mode;
+}
+
+void Memory::set_journal_ring_size(size_t size) {
+    ring_size_ = size;
+    if (journal_mode_ == JournalMode::RING) {
+        clear_journal();
+    }
+}
+
+void Memory::set_journal_stream_fd(int fd) {
+    flush_journal();
+    stream_fd_ = fd;
+}
+
 void Memory::write32(uint32_t addr, uint32_t value) {
-    journal_.push_back(std::make_tuple(Memory::Op::WRITE32, addr, value));
+    advance_time(Memory::Op::WRITE32);
+    record_op(Memory::Op::WRITE32, addr, value);
     priv_write32(addr, value);
 }
 
@@ -90,46 +240,68 @@ void* Memory::readptr(uint32_t addr) const {
 }
 
 void Memory::write16(uint32_t addr, uint16_t value) {
-    journal_.push_back(std::make_tuple(Memory::Op::WRITE16, addr, value));
+    advance_time(Memory::Op::WRITE16);
+    record_op(Memory::Op::WRITE16, addr, value);
     const auto write_addr = addr & (~3);
+    rmw_read_ = true;
     uint32_t old_value = priv_read32(write_addr);
+    rmw_read_ = false;
     auto new_value = (old_value & (~(0xffff << (8 * (addr & 2)))))
                      | (value << (8 * (addr & 2)));
 
     priv_write32(write_addr, new_value);
 }
 
+void Memory::write8(uint32_t addr, uint8_t value) {
+    advance_time(Memory::Op::WRITE8);
+    record_op(Memory::Op::WRITE8, addr, value);
+    const auto write_addr = addr & (~3);
+    rmw_read_ = true;
+    uint32_t old_value = priv_read32(write_addr);
+    rmw_read_ = false;
+    auto new_value = (old_value & (~(0xff << (8 * (addr & 3)))))
+                     | (value << (8 * (addr & 3)));
+
+    priv_write32(write_addr, new_value);
+}
+
 uint32_t Memory::read32(uint32_t addr) const {
+    advance_time(Memory::Op::READ32);
     uint32_t res = priv_read32(addr);
 
-    journal_.push_back(std::make_tuple(Memory::Op::READ32, addr, res));
+    record_op(Memory::Op::READ32, addr, res);
 
     return res;
 }
 
 // NOTE: This does not allow unaligned reads
 uint16_t Memory::read16(uint32_t addr) const {
+    advance_time(Memory::Op::READ16);
     const auto lookup_addr = addr & (~3);
     uint32_t res = priv_read32(lookup_addr);
     res >>= ((addr & 2) ? 16 : 0);
 
-    journal_.push_back(std::make_tuple(Memory::Op::READ16, addr, res));
+    record_op(Memory::Op::READ16, addr, res);
 
     return res;
 }
 
 uint8_t Memory::read8(uint32_t addr) const {
+    advance_time(Memory::Op::READ8);
     const auto lookup_addr = addr & (~3);
     uint32_t res = priv_read32(lookup_addr);
     res >>= (8 * (addr & 3));
 
-    journal_.push_back(std::make_tuple(Memory::Op::READ8, addr, res));
+    record_op(Memory::Op::READ8, addr, res);
 
     return res;
 }
 
 void Memory::set_value_at(uint32_t addr, uint32_t value) {
-    mem_map_[addr] = value;
+    auto& page = get_page(addr);
+    const auto index = word_index(addr);
+    page.words[index] = value;
+    page.valid[index / 32] |= (1u << (index % 32));
 }
 
 uint32_t Memory::get_value_at(uint32_t addr) const {
@@ -152,69 +324,143 @@ void Memory::set_ptr_at(uint32_t addr, void* ptr) {
 
 uint32_t Memory::get_value_at(uint32_t addr, uint32_t default_value) const {
     auto result = default_value;
-    const auto& it = mem_map_.find(addr);
-    if (it != mem_map_.end()) {
-        result = it->second;
+    const auto* page = find_page(addr);
+    if (page) {
+        const auto index = word_index(addr);
+        if (is_word_valid(*page, index)) {
+            result = page->words[index];
+        }
     }
 
     return result;
 }
 
 const Memory::JournalT& Memory::get_journal() const {
+    if (ring_head_) {
+        // Put the oldest entry first
+        std::rotate(journal_.begin(), journal_.begin() + ring_head_, journal_.end());
+        ring_head_ = 0;
+    }
+
     return journal_;
 }
 
 unsigned int Memory::get_op_count(Op op) const {
-    return std::count_if(journal_.begin(), journal_.end(), [&](JournalEntry & entry) -> bool{
-        return std::get<0>(entry) == op;
-    });
+    return op_counts_[static_cast<size_t>(op)];
 }
 
 unsigned int Memory::get_op_count(Op op, uint32_t addr) const {
-    return std::count_if(journal_.begin(), journal_.end(), [&](JournalEntry & entry) -> bool{
-        return std::get<0>(entry) == op && std::get<1>(entry) == addr;
-    });
+    const auto it = addr_op_counts_.find(op_count_key(op, addr));
+    return it != addr_op_counts_.end() ? it->second : 0;
 }
 
 void Memory::reset() {
-    mem_map_.clear();
+    for (auto& table : page_dir_) {
+        table.reset();
+    }
     mem_ptr_map_.clear();
-    journal_.clear();
-    addr_handler_map_.clear();
+    clear_journal();
+    timestamp_ = 0;
+    scheduler_ = nullptr;
+    io_regions_.clear();
+    io_handler_pages_.fill(0);
+    flash_regions_.clear();
+}
+
+void Memory::add_flash_region(const void* start, size_t size) {
+    const auto addr = reinterpret_cast<uintptr_t>(start);
+    flash_regions_.emplace_back(addr, addr + size);
+}
+
+bool Memory::is_dma_accessible(const void* ptr, size_t size) const {
+    if (!size) {
+        return true;
+    }
+
+    // Same as the addresses below the RAM on the target
+    if (!ptr) {
+        return false;
+    }
+
+    const auto start = reinterpret_cast<uintptr_t>(ptr);
+    const auto end = start + size;
+    for (const auto& region : flash_regions_) {
+        if (start < region.second && end > region.first) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 void Memory::set_addr_io_handler(uint32_t addr, IOHandlerStub* io_handler) {
-    addr_handler_map_.insert(std::make_pair(addr, io_handler));
-    io_handler->set_memory(this);
+    set_addr_io_handler(addr, addr + sizeof(addr), io_handler);
 }
 
 void Memory::set_addr_io_handler(uint32_t range_start, uint32_t range_end, IOHandlerStub* io_handler) {
-    for (auto addr = range_start; addr < range_end; addr += sizeof(addr)) {
-        addr_handler_map_.insert(std::make_pair(addr, io_handler));
-    }
     io_handler->set_memory(this);
-}
+    if (range_start >= range_end) {
+        return;
+    }
 
-void Memory::print_journal() const {
-    for (const auto& entry : journal_)  {
-        std::string op = "XX";
-        switch (std::get<0>(entry)) {
-        case Memory::Op::WRITE32:
-            op = "W32";
-            break;
-        case Memory::Op::READ32:
-            op = "R32";
-        default:
+    // Start from the region that may contain range_start.
+    auto it = io_regions_.upper_bound(range_start);
+    if (it != io_regions_.begin()) {
+        auto prev = std::prev(it);
+        if (prev->second.end > range_start) {
+            it = prev;
+        }
+    }
+
+    // Only fill the gaps between already registered regions,
+    // these keep their handlers.
+    auto pos = range_start;
+    while (pos < range_end) {
+        if (it == io_regions_.end() || it->first >= range_end) {
+            io_regions_.emplace_hint(it, pos, IORegion{range_end, io_handler});
             break;
         }
 
+        if (it->first > pos) {
+            io_regions_.emplace_hint(it, pos, IORegion{it->first, io_handler});
+        }
+
+        pos = std::max(pos, it->second.end);
+        ++it;
+    }
+
+    for (auto page = range_start >> kPageShift; page <= ((range_end - 1) >> kPageShift); ++page) {
+        io_handler_pages_[page / 32] |= (1u << (page % 32));
+    }
+}
+
+void Memory::print_journal() const {
+    for (const auto& entry : get_journal())  {
+        const auto* op = trace::kind_name(static_cast<uint8_t>(std::get<0>(entry)));
         std::cout << op << ": " << std::hex << std::get<1>(entry) << " " << std::get<2>(entry) << std::endl;
     }
 }
 
 void Memory::print_map() const {
-    for (const auto& item : mem_map_) {
-        std::cout << std::hex << item.first << " => " << item.second << std::endl;
+    for (size_t dir_index = 0; dir_index < kDirEntries; ++dir_index) {
+        const auto& table = page_dir_[dir_index];
+        if (!table) {
+            continue;
+        }
+
+        for (size_t table_index = 0; table_index < kTableEntries; ++table_index) {
+            const auto& page = (*table)[table_index];
+            if (!page) {
+                continue;
+            }
+
+            const uint32_t page_addr = (dir_index << kDirShift) | (table_index << kPageShift);
+            for (unsigned i = 0; i < kPageWords; ++i) {
+                if (is_word_valid(*page, i)) {
+                    std::cout << std::hex << (page_addr + 4 * i) << " => " << page->words[i] << std::endl;
+                }
+            }
+        }
     }
 }
 
@@ -226,8 +472,24 @@ void IOHandlerStub::set_mem_value(uint32_t addr, uint32_t value) {
     mem_->set_value_at(addr, value);
 }
 
+void IOHandlerStub::hw_write_mem_value(uint32_t addr, uint32_t value) {
+    mem_->hw_write32(addr, value);
+}
+
 uint32_t IOHandlerStub::get_mem_value(uint32_t addr) const {
     return mem_->get_value_at(addr, 0);
 }
 
+void* IOHandlerStub::get_mem_ptr(uint32_t addr) const {
+    return mem_->get_ptr_at(addr);
+}
+
+void IOHandlerStub::set_mem_ptr(uint32_t addr, void* ptr) {
+    mem_->set_ptr_at(addr, ptr);
+}
+
+bool IOHandlerStub::is_dma_accessible(const void* ptr, size_t size) const {
+    return mem_->is_dma_accessible(ptr, size);
+}
+
 }  // namespace mock
@@ -24,15 +24,24 @@
 #pragma once
 
 #include <iostream>
+#include <array>
 #include <cstdint>
 #include <list>
 #include <map>
+#include <memory>
 #include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace mock {
 
 class Memory;
+class Scheduler;
+
+namespace trace {
+class Writer;
+}  // namespace trace
 
 /**
  * @brief Base class for more complex IO handlers.
@@ -91,11 +100,31 @@ class IOHandlerStub {
          */
         void set_mem_value(uint32_t addr, uint32_t value);
 
+        /**
+         * @brief Same as mem_->hw_write32(uint32_t, uint32_t)
+         */
+        void hw_write_mem_value(uint32_t addr, uint32_t value);
+
         /**
          * @brief Same as mem_->get_value_at(uint32_t)
          */
         uint32_t get_mem_value(uint32_t addr) const;
 
+        /**
+         * @brief Same as mem_->get_ptr_at(uint32_t)
+         */
+        void* get_mem_ptr(uint32_t addr) const;
+
+        /**
+         * @brief Same as mem_->set_ptr_at(uint32_t, void*)
+         */
+        void set_mem_ptr(uint32_t addr, void* ptr);
+
+        /**
+         * @brief Same as mem_->is_dma_accessible(const void*, size_t)
+         */
+        bool is_dma_accessible(const void* ptr, size_t size) const;
+
     private:
         /**
          * @brief Pointer to global virtual memory object
@@ -297,6 +326,8 @@ class Memory {
     public:
         Memory() = default;
         Memory(const Memory&) = delete;
+        ~Memory();
+
         enum class Op {
             READ8,
             READ16,
@@ -306,8 +337,33 @@ class Memory {
             WRITE16,
             WRITE32,
             WRITEPTR,
+
+            NUM_OPS,
         };
 
+        /**
+         * @brief How the memory IO operations are recorded.
+         */
+        enum class JournalMode {
+            /** Nothing is recorded, operation counters are not updated either. */
+            OFF,
+            /** Only the last get_journal_ring_size() operations are kept in the journal. */
+            RING,
+            /** All of the operations are kept in the journal. This is the default. */
+            FULL,
+            /**
+             * The operations are written to a file descriptor as packed binary records
+             * and are not kept in the journal.
+             *
+             * Each record is 9 bytes: the Op (1 byte), followed by the address and the value,
+             * both little endian 32 bit integers.
+             */
+            STREAMING,
+        };
+
+        static constexpr size_t kDefaultJournalRingSize = 4096;
+        static constexpr size_t kJournalRecordSize = 9;
+
         /**
          * @brief MemoryIO operations journal entry.
          *
@@ -327,6 +383,9 @@ class Memory {
          *
          * There should not be any reason to modify the journal,
          * so this return a constant reference.
+         *
+         * The journal is empty in JournalMode::OFF and JournalMode::STREAMING modes,
+         * in JournalMode::RING mode it has only the most recent operations, oldest first.
          */
         const JournalT& get_journal() const;
 
@@ -336,9 +395,45 @@ class Memory {
          * This clears the journal, all IO handlers and all of the virtual
          * memory contents. The test suite should call this before
          * performing any of the IO operations.
+         *
+         * The journal mode is preserved. In streaming mode the pending records are
+         * flushed to the file descriptor.
          */
         void reset();
 
+        /**
+         * @brief Select how the memory IO operations are recorded.
+         *
+         * Changing the mode clears the journal and the operation counters.
+         */
+        void set_journal_mode(JournalMode mode);
+
+        JournalMode get_journal_mode() const {
+            return journal_mode_;
+        }
+
+        /**
+         * @brief Set the number of operations kept in JournalMode::RING mode.
+         */
+        void set_journal_ring_size(size_t size);
+
+        size_t get_journal_ring_size() const {
+            return ring_size_;
+        }
+
+        /**
+         * @brief Set the file descriptor for JournalMode::STREAMING mode.
+         *
+         * Memory object does not own the file descriptor, the caller must keep it
+         * open while streaming is active. Negative value disables the output.
+         */
+        void set_journal_stream_fd(int fd);
+
+        /**
+         * @brief Write out all of the buffered records in JournalMode::STREAMING mode.
+         */
+        void flush_journal() const;
+
         /**
          * @brief Read pointer from virtual memory address.
          *
@@ -401,6 +496,27 @@ class Memory {
          */
         void write8(uint32_t addr, uint8_t value);
 
+        /**
+         * @brief Returns true while write16() or write8() reads the word they modify.
+         *
+         * The read is not recorded, the IO handlers replaying the recorded accesses
+         * should let it through.
+         */
+        bool is_rmw_read() const {
+            return rmw_read_;
+        }
+
+        /**
+         * @brief Store 32 bit value at virtual memory address on behalf of the simulated hardware.
+         *
+         * The value goes through the IO handlers, same as with write32(), but the operation
+         * is not recorded and does not take any virtual time. Device models use this to
+         * trigger each other's tasks, e.g. through PPI.
+         */
+        void hw_write32(uint32_t addr, uint32_t value) {
+            priv_write32(addr, value);
+        }
+
         /**
          * @brief Store value at virtual memory address.
          *
@@ -465,6 +581,11 @@ class Memory {
          *
          * The range is [range_start; range_end).
          *
+         * The range is stored as a single entry, so the cost of registering the handler and
+         * dispatching the IO operations to it does not depend on the size of the range.
+         * If some addresses in the range already have a handler, the old handler is kept
+         * for these addresses.
+         *
          * @param[in] range_start Virtual memory address. Must be 32 bit aligned.
          * @param[in] range_end Virtual memory address. Must be 32 bit aligned.
          * @param[in] io_handler All memory IO operations on the address will
@@ -476,8 +597,9 @@ class Memory {
         /**
          * @brief Count the number of operations performed.
          *
-         * This basically looks at the journal and counts how many operations
-         * are of this type.
+         * Returns how many operations of this type were performed since the last
+         * reset. The counters are kept in all journal modes, except JournalMode::OFF,
+         * even if the journal itself does not have the operations anymore.
          *
          * @param[in] op The operation the caller is interested in.
          */
@@ -486,14 +608,84 @@ class Memory {
         /**
          * @brief Count the number of operations performed.
          *
-         * This basically looks at the journal and counts how many operations
-         * are of this type and at a given address.
+         * Same as get_op_count(Op), but only counts the operations
+         * at a given address.
          *
          * @param[in] op The operation the caller is interested in.
          * @param[in] addr The address the caller is interested in.
          */
         unsigned int get_op_count(Op op, uint32_t addr) const;
 
+        /**
+         * @brief Record all memory IO operations and interrupt dispatches into a trace.
+         *
+         * The trace is recorded independently of the journal mode.
+         * Memory object does not own the writer, nullptr stops the recording.
+         */
+        void set_trace_writer(trace::Writer* writer) {
+            trace_writer_ = writer;
+        }
+
+        /**
+         * @brief Record interrupt dispatch in the trace.
+         *
+         * Called by the simulation, see nvic_dispatch().
+         */
+        void record_irq(int irqn) const;
+
+        /**
+         * @brief Get the current timestamp.
+         *
+         * This is the virtual time in cycles if a Scheduler is attached, otherwise
+         * the number of memory IO operations performed since the last reset.
+         */
+        uint64_t get_timestamp() const;
+
+        /**
+         * @brief Attach the virtual clock.
+         *
+         * Every memory IO operation performed by the simulation will advance the clock
+         * of the scheduler by the operation's cost (see set_access_cycles()) and run
+         * the events that become due, before the operation itself is performed.
+         *
+         * Memory object does not own the scheduler. reset() detaches it.
+         */
+        void set_scheduler(Scheduler* scheduler) {
+            scheduler_ = scheduler;
+        }
+
+        Scheduler* get_scheduler() const {
+            return scheduler_;
+        }
+
+        /**
+         * @brief Set the number of cycles the operation takes in virtual time.
+         *
+         * The default is one cycle for every operation. This is not reset by reset().
+         */
+        void set_access_cycles(Op op, uint64_t cycles) {
+            access_cycles_[static_cast<size_t>(op)] = cycles;
+        }
+
+        /**
+         * @brief Mark host memory as flash.
+         *
+         * On the real hardware DMA can only access RAM. In tests all of the host memory
+         * is treated as RAM, except for the regions marked by this method, e.g. the string
+         * literals that would be placed in flash. reset() clears the regions.
+         */
+        void add_flash_region(const void* start, size_t size);
+
+        /**
+         * @brief Check if the buffer can be accessed by DMA.
+         *
+         * Follows the rules of the target: empty buffers are accepted, nullptr
+         * with non-zero size and the flash regions are not.
+         *
+         * Called by the simulation, see raw_dma_accessible().
+         */
+        bool is_dma_accessible(const void* ptr, size_t size) const;
+
         /**
          * @brief Print the journal to stdout.
          *
@@ -514,14 +706,106 @@ class Memory {
         void priv_write32(uint32_t addr, uint32_t value);
         uint32_t priv_read32(uint32_t addr) const;
 
-        std::map<uint32_t, uint32_t> mem_map_;
+        void advance_time(Op op) const;
+        void record_op(Op op, uint32_t addr, uint32_t value) const;
+        void clear_journal();
+
+        static constexpr uint64_t op_count_key(Op op, uint32_t addr) {
+            return (static_cast<uint64_t>(op) << 32) | addr;
+        }
+
+        /*
+         * Virtual memory is stored in lazily allocated 4 KiB pages.
+         *
+         * The pages are found through a two level table: bits [31:22] of the address
+         * select the page table in page_dir_, bits [21:12] select the page in that table
+         * and bits [11:2] select the word within the page. Each page keeps a bitmap of
+         * the words that were actually stored, so that uninitialized cells can still be told
+         * apart from the ones holding zero.
+         */
+        static constexpr unsigned kPageShift = 12;
+        static constexpr unsigned kDirShift = 22;
+        static constexpr size_t kPageWords = (1 << kPageShift) / sizeof(uint32_t);
+        static constexpr size_t kTableEntries = (1 << (kDirShift - kPageShift));
+        static constexpr size_t kDirEntries = (1 << (32 - kDirShift));
+
+        struct Page {
+            uint32_t words[kPageWords];
+            uint32_t valid[kPageWords / 32];
+        };
+
+        using PageTable = std::array<std::unique_ptr<Page>, kTableEntries>;
+
+        /*
+         * Return the page for the address, or nullptr if the page was never written to.
+         */
+        const Page* find_page(uint32_t addr) const;
+
+        /*
+         * Return the page for the address, allocating it if necessary.
+         */
+        Page& get_page(uint32_t addr);
+
+        static constexpr unsigned word_index(uint32_t addr) {
+            return (addr & ((1 << kPageShift) - 1)) >> 2;
+        }
+
+        static bool is_word_valid(const Page& page, unsigned index) {
+            return page.valid[index / 32] & (1u << (index % 32));
+        }
+
+        std::array<std::unique_ptr<PageTable>, kDirEntries> page_dir_;
         std::map<uint32_t, void*> mem_ptr_map_;
+
+        /*
+         * Return the IO handler for the address, or nullptr if there is none.
+         */
+        IOHandlerStub* find_io_handler(uint32_t addr) const;
+
+        /*
+         * Address range [start; end) served by a single IO handler.
+         */
+        struct IORegion {
+            uint32_t end;
+            IOHandlerStub* handler;
+        };
+
         // Note, memory mock does not own the pointers.
         // It is the responsibility of the caller to clean them up.
         // Special care needs to be taken in the case of the global
         // memory map object.
-        std::map<uint32_t, IOHandlerStub*> addr_handler_map_;
+        //
+        // The regions are keyed by their start address and never overlap.
+        std::map<uint32_t, IORegion> io_regions_;
+
+        // One bit per virtual memory page, set if any address in the page has
+        // an IO handler. Lets the accesses to plain memory skip the region lookup.
+        static constexpr size_t kNumPages = (1ull << (32 - kPageShift));
+        std::array<uint32_t, kNumPages / 32> io_handler_pages_{};
+        // Host memory ranges [start; end) that are treated as flash
+        std::vector<std::pair<uintptr_t, uintptr_t>> flash_regions_;
+
+        trace::Writer* trace_writer_ = nullptr;
+        mutable uint64_t timestamp_ = 0;
+
+        Scheduler* scheduler_ = nullptr;
+        bool rmw_read_ = false;
+        std::array<uint64_t, static_cast<size_t>(Op::NUM_OPS)> access_cycles_{1, 1, 1, 1, 1, 1, 1, 1};
+
+        JournalMode journal_mode_ = JournalMode::FULL;
         mutable JournalT journal_;
+
+        // Position of the oldest entry in the journal in RING mode,
+        // once the journal has reached ring_size_ entries.
+        mutable size_t ring_head_ = 0;
+        size_t ring_size_ = kDefaultJournalRingSize;
+
+        static constexpr size_t kStreamBufferSize = 4096;
+        int stream_fd_ = -1;
+        mutable std::vector<uint8_t> stream_buffer_;
+
+        mutable std::array<unsigned int, static_cast<size_t>(Op::NUM_OPS)> op_counts_{};
+        mutable std::unordered_map<uint64_t, unsigned int> addr_op_counts_;
 };
 
 /**
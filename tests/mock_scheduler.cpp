@@ -0,0 +1,120 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "mock_scheduler.hpp"
+
+#include "mock_memio.hpp"
+
+namespace mock {
+
+namespace {
+
+Scheduler g_scheduler;
+
+}  // namespace
+
+Scheduler::EventId Scheduler::schedule_at(Cycles when, Callback callback) {
+    const auto id = next_id_++;
+    callbacks_.emplace(id, std::move(callback));
+    queue_.push({when, id});
+
+    return id;
+}
+
+Scheduler::EventId Scheduler::schedule_value_at(Cycles delay, Memory& mem, uint32_t addr, uint32_t value) {
+    return schedule_in(delay, [&mem, addr, value]() {
+        mem.set_value_at(addr, value);
+    });
+}
+
+Scheduler::EventId Scheduler::schedule_irq(Cycles delay, int irqn) {
+    return schedule_in(delay, [this, irqn]() {
+        if (irq_dispatcher_) {
+            irq_dispatcher_(irqn);
+        }
+    });
+}
+
+bool Scheduler::cancel(EventId id) {
+    return callbacks_.erase(id) > 0;
+}
+
+void Scheduler::run_until(Cycles when) {
+    // The callbacks may perform memory IO and move the clock themselves,
+    // only the outermost call runs the events.
+    if (running_events_) {
+        if (when > now_) {
+            now_ = when;
+        }
+        return;
+    }
+
+    running_events_ = true;
+    while (!queue_.empty() && queue_.top().when <= when) {
+        const auto entry = queue_.top();
+        queue_.pop();
+
+        auto it = callbacks_.find(entry.id);
+        if (it == callbacks_.end()) {
+            continue;
+        }
+
+        // Each event sees the clock at its own time, so that the events
+        // it schedules are relative to it.
+        if (entry.when > now_) {
+            now_ = entry.when;
+        }
+        auto callback = std::move(it->second);
+        callbacks_.erase(it);
+        callback();
+    }
+    running_events_ = false;
+
+    if (when > now_) {
+        now_ = when;
+    }
+}
+
+void Scheduler::advance(Cycles cycles) {
+    run_until(now_ + cycles);
+}
+
+bool Scheduler::run_next() {
+    while (!queue_.empty() && !callbacks_.count(queue_.top().id)) {
+        queue_.pop();
+    }
+
+    if (queue_.empty()) {
+        return false;
+    }
+
+    run_until(queue_.top().when);
+    return true;
+}
+
+void Scheduler::reset() {
+    now_ = 0;
+    // A callback that threw would leave it set and stop the clock for good
+    running_events_ = false;
+    queue_ = decltype(queue_)();
+    callbacks_.clear();
+}
+
+Scheduler& get_global_scheduler() {
+    return g_scheduler;
+}
+
+}  // namespace mock
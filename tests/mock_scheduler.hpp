@@ -0,0 +1,174 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/**
+ * @file
+ *
+ * Virtual time for the simulated hardware.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mock {
+
+class Memory;
+
+/**
+ * @brief Discrete event scheduler with a virtual clock.
+ *
+ * The clock counts simulated CPU cycles. It only moves forward when the simulation
+ * tells it to: either explicitly with advance(), run_next() or run_until(), or implicitly,
+ * when the scheduler is attached to the Memory object (see Memory::set_scheduler())
+ * and the firmware performs memory IO operations.
+ *
+ * The device models use the scheduler to complete their operations after a realistic
+ * delay, e.g. set an event register and dispatch an interrupt when a DMA transfer would
+ * have been finished. Busy-wait loops in the drivers will then spin until the event is due.
+ *
+ * The events that are due at the same time run in the order they were scheduled.
+ */
+class Scheduler {
+    public:
+        using Cycles = uint64_t;
+        using EventId = uint64_t;
+        using Callback = std::function<void()>;
+        using IrqDispatcher = std::function<void(int irqn)>;
+
+        Scheduler() = default;
+        Scheduler(const Scheduler&) = delete;
+
+        /**
+         * @brief Current virtual time in cycles.
+         */
+        Cycles now() const {
+            return now_;
+        }
+
+        /**
+         * @brief Schedule the callback to run at the given time.
+         *
+         * If the time is in the past, the callback runs at the next opportunity.
+         *
+         * @return ID of the event, that can be used to cancel it.
+         */
+        EventId schedule_at(Cycles when, Callback callback);
+
+        /**
+         * @brief Schedule the callback to run after the given delay.
+         */
+        EventId schedule_in(Cycles delay, Callback callback) {
+            return schedule_at(now_ + delay, std::move(callback));
+        }
+
+        /**
+         * @brief Schedule a write to the virtual memory address.
+         *
+         * The value is stored with Memory::set_value_at(), so it bypasses the IO handlers
+         * and the journal, the same way hardware updates its own registers.
+         */
+        EventId schedule_value_at(Cycles delay, Memory& mem, uint32_t addr, uint32_t value);
+
+        /**
+         * @brief Set the function that dispatches the interrupts, usually nvic_dispatch().
+         *
+         * The scheduler doesn't depend on the NVIC code, so that the host tools
+         * can link it without the firmware library. reset() keeps the dispatcher.
+         */
+        void set_irq_dispatcher(IrqDispatcher dispatcher) {
+            irq_dispatcher_ = std::move(dispatcher);
+        }
+
+        /**
+         * @brief Schedule interrupt dispatch through the IRQ dispatcher.
+         *
+         * The interrupt is dropped if no dispatcher is set.
+         */
+        EventId schedule_irq(Cycles delay, int irqn);
+
+        /**
+         * @brief Cancel the scheduled event.
+         *
+         * @return true if the event was pending.
+         */
+        bool cancel(EventId id);
+
+        /**
+         * @brief Move the clock forward, running all of the events that become due.
+         */
+        void advance(Cycles cycles);
+
+        /**
+         * @brief Move the clock to the given time, running all of the events that become due.
+         *
+         * Does nothing if the time is in the past.
+         */
+        void run_until(Cycles when);
+
+        /**
+         * @brief Move the clock to the next pending event and run it.
+         *
+         * @return false if there are no pending events.
+         */
+        bool run_next();
+
+        /**
+         * @brief Number of pending events.
+         */
+        size_t get_pending_count() const {
+            return callbacks_.size();
+        }
+
+        /**
+         * @brief Drop all of the pending events and set the clock back to zero.
+         */
+        void reset();
+
+    private:
+        struct QueueEntry {
+            Cycles when;
+            EventId id;
+
+            bool operator>(const QueueEntry& other) const {
+                return when > other.when || (when == other.when && id > other.id);
+            }
+        };
+
+        Cycles now_ = 0;
+        EventId next_id_ = 1;
+        bool running_events_ = false;
+        IrqDispatcher irq_dispatcher_;
+
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue_;
+        // Cancelled events are removed only from here and skipped when popped from the queue.
+        std::unordered_map<EventId, Callback> callbacks_;
+};
+
+/**
+ * @brief Return global Scheduler object.
+ *
+ * Not attached to the global Memory object by default, the tests that
+ * need virtual time should attach it after resetting the memory.
+ */
+Scheduler& get_global_scheduler();
+
+}  // namespace mock
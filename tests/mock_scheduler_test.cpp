@@ -0,0 +1,186 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "third_party/catch2/catch.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+#include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+
+#include "memio.h"
+#include "nvic.h"
+
+namespace {
+
+int irq_counter = 0;
+
+void test_irq_handler() {
+    ++irq_counter;
+}
+
+}  // namespace
+
+TEST_CASE("Test Scheduler") {
+    mock::Scheduler sched;
+    std::vector<int> order;
+
+    SECTION("Events run in time order") {
+        sched.schedule_at(30, [&order]() {
+            order.push_back(3);
+        });
+        sched.schedule_at(10, [&order]() {
+            order.push_back(1);
+        });
+        sched.schedule_at(20, [&order]() {
+            order.push_back(2);
+        });
+        // Same time as the first one, scheduled later
+        sched.schedule_at(10, [&order]() {
+            order.push_back(4);
+        });
+
+        CHECK(sched.get_pending_count() == 4);
+        sched.advance(9);
+        CHECK(order.empty());
+
+        sched.advance(1);
+        CHECK(order == std::vector<int> {1, 4});
+
+        CHECK(sched.run_next());
+        CHECK(sched.now() == 20);
+        sched.run_until(100);
+        CHECK(order == std::vector<int> {1, 4, 2, 3});
+        CHECK(sched.now() == 100);
+        CHECK_FALSE(sched.run_next());
+    }
+
+    SECTION("Cancel") {
+        auto id = sched.schedule_in(10, [&order]() {
+            order.push_back(1);
+        });
+        sched.schedule_in(20, [&order]() {
+            order.push_back(2);
+        });
+
+        CHECK(sched.cancel(id));
+        CHECK_FALSE(sched.cancel(id));
+        CHECK(sched.get_pending_count() == 1);
+
+        CHECK(sched.run_next());
+        CHECK(sched.now() == 20);
+        CHECK(order == std::vector<int> {2});
+    }
+
+    SECTION("Events can schedule more events") {
+        sched.schedule_in(10, [&sched, &order]() {
+            order.push_back(1);
+            sched.schedule_in(5, [&order]() {
+                order.push_back(2);
+            });
+        });
+
+        sched.advance(100);
+        CHECK(order == std::vector<int> {1, 2});
+    }
+
+    SECTION("Reset") {
+        sched.schedule_in(10, [&order]() {
+            order.push_back(1);
+        });
+        sched.advance(5);
+        sched.reset();
+
+        CHECK(sched.now() == 0);
+        CHECK(sched.get_pending_count() == 0);
+        sched.advance(100);
+        CHECK(order.empty());
+    }
+
+    SECTION("Reset after a throwing event") {
+        sched.schedule_in(10, []() {
+            throw std::runtime_error("model failure");
+        });
+        CHECK_THROWS(sched.advance(10));
+        sched.reset();
+
+        sched.schedule_in(10, [&order]() {
+            order.push_back(1);
+        });
+        sched.advance(10);
+        CHECK(order == std::vector<int> {1});
+    }
+}
+
+TEST_CASE("Test Virtual Time in Memory") {
+    constexpr uint32_t event_addr = 0x40002120;
+    constexpr uint32_t task_addr = 0x40002008;
+
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    SECTION("Memory IO advances the clock") {
+        raw_write32(task_addr, 1);
+        CHECK(sched.now() == 1);
+
+        mem.set_access_cycles(mock::Memory::Op::READ32, 4);
+        raw_read32(event_addr);
+        CHECK(sched.now() == 5);
+        CHECK(mem.get_timestamp() == 5);
+        mem.set_access_cycles(mock::Memory::Op::READ32, 1);
+
+        // Test access is not simulation
+        mem.get_value_at(event_addr);
+        CHECK(sched.now() == 5);
+    }
+
+    SECTION("Busy wait finishes when the event is due") {
+        const auto start = sched.now();
+        raw_write32(task_addr, 1);
+        sched.schedule_value_at(1000, mem, event_addr, 1);
+
+        wait_mask_le32(event_addr, 1);
+
+        const auto latency = sched.now() - start;
+        CHECK(latency >= 1000);
+        CHECK(latency <= 1002);
+    }
+
+    SECTION("Scheduled interrupt") {
+        nvic_init();
+        nvic_set_handler(20, test_irq_handler);
+        irq_counter = 0;
+        sched.set_irq_dispatcher(nvic_dispatch);
+
+        sched.schedule_irq(10, 20);
+        for (int i = 0; i < 9; ++i) {
+            raw_read32(event_addr);
+        }
+        CHECK(irq_counter == 0);
+        raw_read32(event_addr);
+        CHECK(irq_counter == 1);
+    }
+
+    SECTION("Reset detaches the scheduler") {
+        mem.reset();
+        raw_read32(event_addr);
+        CHECK(sched.now() == 0);
+    }
+}
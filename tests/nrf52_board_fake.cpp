@@ -66,6 +66,31 @@ PINCTRL_ENTRY_LIST_START
         .function = function::TWIM1_SDA,
         .pin = 16,
     },
+    {
+        .function = function::SPIM0_SCK,
+        .pin = 25,
+    },
+    {
+        .function = function::SPIM0_MOSI,
+        .pin = 26,
+    },
+    {
+        .function = function::SPIM0_MISO,
+        .pin = 27,
+    },
+    {
+        .function = function::SPIM0_CS,
+        .pin = 28,
+    },
+    // SPIM2 is write only, without the chip select
+    {
+        .function = function::SPIM2_SCK,
+        .pin = 19,
+    },
+    {
+        .function = function::SPIM2_MOSI,
+        .pin = 20,
+    },
 PINCTRL_ENTRY_LIST_END;
 // *INDENT-ON*
 
@@ -0,0 +1,91 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "nrf52_gpiote_fake.hpp"
+
+namespace mock {
+
+namespace {
+
+constexpr unsigned int kConfigPselShift = 8;
+constexpr uint32_t kConfigPselMask = 0x1f;
+
+// The task toggles the pin
+constexpr int kToggle = -1;
+
+}  // namespace
+
+void GPIOTEModel::install(Memory& mem) {
+    set_memory(&mem);
+    mem.set_addr_io_handler(kBase, kBase + kRegBlockSize, this);
+}
+
+uint32_t GPIOTEModel::write32(uint32_t addr, uint32_t old_value, uint32_t new_value) {
+    const auto offset = addr - kBase;
+    if (offset >= kConfig && offset < kConfig + kNumChannels * 4) {
+        if ((new_value & kConfigModeMask) == kConfigModeTask) {
+            const unsigned int pin = (new_value >> kConfigPselShift) & kConfigPselMask;
+            const bool high = new_value & kConfigOutInitHigh;
+            levels_[pin] = high;
+            if (pin_listener_) {
+                pin_listener_(pin, high);
+            }
+        }
+        return new_value;
+    }
+
+    // Tasks are write only
+    if (offset < kTasksOut + kNumChannels * 4) {
+        if (new_value & 1) {
+            drive((offset - kTasksOut) / 4, kToggle);
+        }
+        return 0;
+    } else if (offset >= kTasksSet && offset < kTasksSet + kNumChannels * 4) {
+        if (new_value & 1) {
+            drive((offset - kTasksSet) / 4, 1);
+        }
+        return 0;
+    } else if (offset >= kTasksClr && offset < kTasksClr + kNumChannels * 4) {
+        if (new_value & 1) {
+            drive((offset - kTasksClr) / 4, 0);
+        }
+        return 0;
+    }
+
+    (void)old_value;
+    return new_value;
+}
+
+bool GPIOTEModel::get_pin_level(unsigned int pin) const {
+    const auto it = levels_.find(pin);
+    return it != levels_.end() && it->second;
+}
+
+void GPIOTEModel::drive(unsigned int ch, int level) {
+    const auto config = reg(kConfig + ch * 4);
+    if ((config & kConfigModeMask) != kConfigModeTask) {
+        return;
+    }
+
+    const unsigned int pin = (config >> kConfigPselShift) & kConfigPselMask;
+    const bool high = level == kToggle ? !get_pin_level(pin) : level;
+    levels_[pin] = high;
+    if (pin_listener_) {
+        pin_listener_(pin, high);
+    }
+}
+
+}  // namespace mock
@@ -0,0 +1,86 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/**
+ * @file
+ *
+ * Behavioral model of nRF52 GPIOTE output channels.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+
+#include "mock_memio.hpp"
+
+namespace mock {
+
+/**
+ * @brief GPIOTE model, only the channels in the task mode.
+ *
+ * CONFIG[n] in the task mode drives the pin to OUTINIT level. TASKS_SET[n], TASKS_CLR[n]
+ * and TASKS_OUT[n] (toggle) change the level of the pin, e.g. when triggered by PPI.
+ * The events and the interrupts are not modelled.
+ */
+class GPIOTEModel : public IOHandlerStub {
+    public:
+        static constexpr uint32_t kBase = 0x40006000;
+        static constexpr unsigned int kNumChannels = 8;
+
+        static constexpr uint32_t kTasksOut = 0x000;
+        static constexpr uint32_t kTasksSet = 0x030;
+        static constexpr uint32_t kTasksClr = 0x060;
+        static constexpr uint32_t kConfig = 0x510;
+
+        static constexpr uint32_t kConfigModeMask = 3;
+        static constexpr uint32_t kConfigModeTask = 3;
+        static constexpr uint32_t kConfigOutInitHigh = (1 << 20);
+
+        static constexpr uint32_t kRegBlockSize = 0x1000;
+
+        /**
+         * @brief Register the model as the IO handler for GPIOTE registers.
+         */
+        void install(Memory& mem);
+
+        uint32_t write32(uint32_t addr, uint32_t old_value, uint32_t new_value) override;
+
+        /**
+         * @brief Set the function to be called when a pin driven by the model changes its level.
+         */
+        void set_pin_listener(std::function<void(unsigned int pin, bool high)> listener) {
+            pin_listener_ = std::move(listener);
+        }
+
+        /**
+         * @brief Last level the pin was driven to, false for the pins never driven.
+         */
+        bool get_pin_level(unsigned int pin) const;
+
+    private:
+        uint32_t reg(uint32_t offset) const {
+            return get_mem_value(kBase + offset);
+        }
+
+        void drive(unsigned int ch, int level);
+
+        std::function<void(unsigned int, bool)> pin_listener_;
+        std::map<unsigned int, bool> levels_;
+};
+
+}  // namespace mock
@@ -0,0 +1,250 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "third_party/catch2/catch.hpp"
+
+#include <vector>
+
+#include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+#include "nrf52_twim_fake.hpp"
+
+#include "driver/i2c_queue.hpp"
+#include "nrf52/peripheral.hpp"
+
+namespace {
+
+constexpr uint32_t twim0_base = 0x40003000;
+constexpr uint8_t kAccelAddr = 0x19;
+constexpr uint8_t kBaroAddr = 0x77;
+
+struct CompletionLog : public driver::EventHandler {
+    void handle_event(driver::EventInfo* e_info) override {
+        done.push_back(static_cast<const driver::I2CQueue::Transaction*>(e_info->data));
+        events.push_back(e_info->evt_id);
+        times.push_back(sched->now());
+        if (resubmit) {
+            auto* t = resubmit;
+            resubmit = nullptr;
+            CHECK(queue->submit(t) == 0);
+        }
+    }
+
+    mock::Scheduler* sched = nullptr;
+    driver::I2CQueue* queue = nullptr;
+    driver::I2CQueue::Transaction* resubmit = nullptr;
+
+    std::vector<const driver::I2CQueue::Transaction*> done;
+    std::vector<int> events;
+    std::vector<mock::Scheduler::Cycles> times;
+};
+
+// Completes the writes before returning from them, like a bus interrupt
+// taken right after the transfer was started
+class InstantBus : public driver::I2C {
+    public:
+        int write(uint8_t addr, const uint8_t* data, size_t size, driver::EventHandler* handler) override {
+            (void)size;
+            addrs.push_back(addr);
+            driver::EventInfo e_info;
+            e_info.evt_id = (addr == kAccelAddr) ? driver::I2C::Event::XFER_DONE : driver::I2C::Event::XFER_ERROR;
+            e_info.data = data;
+            handler->handle_event(&e_info);
+            return 0;
+        }
+
+        std::vector<uint8_t> addrs;
+};
+
+}  // namespace
+
+TEST_CASE("Test I2C Queue with instant completion") {
+    InstantBus bus;
+    driver::I2CQueue queue{&bus};
+    CompletionLog log;
+    log.queue = &queue;
+    mock::Scheduler sched;
+    log.sched = &sched;
+
+    const uint8_t data[] = {0x20, 0x57};
+    driver::I2CQueue::Transaction nack;
+    nack.addr = kBaroAddr;
+    nack.tx_data = data;
+    nack.tx_size = sizeof(data);
+    nack.handler = &log;
+    driver::I2CQueue::Transaction write;
+    write.addr = kAccelAddr;
+    write.tx_data = data;
+    write.tx_size = sizeof(data);
+    write.handler = &log;
+
+    REQUIRE(queue.submit(&nack) == 0);
+    REQUIRE(log.done.size() == 1);
+    CHECK(log.events[0] == driver::I2C::Event::XFER_ERROR);
+    CHECK(queue.is_idle());
+
+    // The queue isn't stuck
+    REQUIRE(queue.submit(&write) == 0);
+    REQUIRE(log.done.size() == 2);
+    CHECK(log.done[1] == &write);
+    CHECK(log.events[1] == driver::I2C::Event::XFER_DONE);
+    CHECK(queue.is_idle());
+    CHECK(bus.addrs == std::vector<uint8_t> {kBaroAddr, kAccelAddr});
+}
+
+TEST_CASE("Test I2C Queue") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    mock::TWIMModel model{twim0_base, 3};
+    model.install(mem, sched);
+    mock::I2CSlaveModel accel{kAccelAddr, 0x40};
+    mock::I2CSlaveModel baro{kBaroAddr, 0x100};
+    model.add_slave(&accel);
+    model.add_slave(&baro);
+
+    auto* twim = driver::I2C::request_by_id(nrf52::TWIM0);
+    REQUIRE(twim != nullptr);
+    REQUIRE(twim->set_frequency(400 * 1000) == 400 * 1000);
+    const auto byte_cycles = model.get_byte_cycles();
+    const auto stop_cycles = byte_cycles / mock::TWIMModel::kBitsPerByte;
+
+    driver::I2CQueue queue{twim};
+    CompletionLog log;
+    log.sched = &sched;
+    log.queue = &queue;
+
+    accel.set_reg(0x28, 0x12);
+    accel.set_reg(0x29, 0x34);
+    baro.set_reg(0xd0, 0x58);
+
+    const uint8_t accel_reg = 0x28;
+    uint8_t accel_data[2] = {};
+    driver::I2CQueue::Transaction read_accel;
+    read_accel.addr = kAccelAddr;
+    read_accel.tx_data = &accel_reg;
+    read_accel.tx_size = 1;
+    read_accel.rx_data = accel_data;
+    read_accel.rx_size = sizeof(accel_data);
+    read_accel.handler = &log;
+
+    const uint8_t baro_reg = 0xd0;
+    uint8_t baro_id = 0;
+    driver::I2CQueue::Transaction read_baro;
+    read_baro.addr = kBaroAddr;
+    read_baro.tx_data = &baro_reg;
+    read_baro.tx_size = 1;
+    read_baro.rx_data = &baro_id;
+    read_baro.rx_size = 1;
+    read_baro.handler = &log;
+
+    const uint8_t accel_config[] = {0x20, 0x57};
+    driver::I2CQueue::Transaction write_accel;
+    write_accel.addr = kAccelAddr;
+    write_accel.tx_data = accel_config;
+    write_accel.tx_size = sizeof(accel_config);
+    write_accel.handler = &log;
+
+    SECTION("Back to back") {
+        REQUIRE(queue.submit(&write_accel) == 0);
+        REQUIRE(queue.submit(&read_accel) == 0);
+        REQUIRE(queue.submit(&read_baro) == 0);
+        CHECK(queue.submit(&read_accel) < 0);
+        CHECK_FALSE(queue.is_idle());
+
+        while (sched.run_next());
+
+        CHECK(queue.is_idle());
+        REQUIRE(log.done.size() == 3);
+        CHECK(log.done[0] == &write_accel);
+        CHECK(log.done[1] == &read_accel);
+        CHECK(log.done[2] == &read_baro);
+        for (auto evt : log.events) {
+            CHECK(evt == driver::I2C::Event::XFER_DONE);
+        }
+
+        CHECK(accel.get_reg(0x20) == 0x57);
+        CHECK(accel_data[0] == 0x12);
+        CHECK(accel_data[1] == 0x34);
+        CHECK(baro_id == 0x58);
+
+        // The next transaction is started from the completion interrupt, the bus doesn't
+        // wait for the thread context. Each transaction takes its bytes, including the
+        // addresses, and the stop condition, only the driver's register accesses are extra.
+        constexpr mock::Scheduler::Cycles kDriverCycles = 64;
+        CHECK(log.times[0] - (3 * byte_cycles + stop_cycles) < kDriverCycles);
+        CHECK(log.times[1] - log.times[0] - (5 * byte_cycles + stop_cycles) < kDriverCycles);
+        CHECK(log.times[2] - log.times[1] - (4 * byte_cycles + stop_cycles) < kDriverCycles);
+    }
+
+    SECTION("Errors don't stop the queue") {
+        driver::I2CQueue::Transaction missing = read_baro;
+        missing.addr = 0x42;
+        uint8_t too_long[300] = {};
+        driver::I2CQueue::Transaction rejected;
+        rejected.addr = kAccelAddr;
+        rejected.rx_data = too_long;
+        rejected.rx_size = sizeof(too_long);
+        rejected.handler = &log;
+
+        REQUIRE(queue.submit(&missing) == 0);
+        REQUIRE(queue.submit(&rejected) == 0);
+        REQUIRE(queue.submit(&read_baro) == 0);
+        while (sched.run_next());
+
+        // The rejected one is reported while starting the next transaction,
+        // before the completion of the one that was on the bus.
+        REQUIRE(log.done.size() == 3);
+        CHECK(log.done[0] == &rejected);
+        CHECK(log.events[0] == driver::I2C::Event::XFER_ERROR);
+        CHECK(log.done[1] == &missing);
+        CHECK(log.events[1] == driver::I2C::Event::XFER_ERROR);
+        CHECK(log.done[2] == &read_baro);
+        CHECK(log.events[2] == driver::I2C::Event::XFER_DONE);
+        CHECK(baro_id == 0x58);
+
+        // Rejected right away on the idle bus
+        REQUIRE(queue.submit(&rejected) == 0);
+        REQUIRE(log.done.size() == 4);
+        CHECK(log.events[3] == driver::I2C::Event::XFER_ERROR);
+        CHECK(queue.is_idle());
+    }
+
+    SECTION("Submit from the handler") {
+        log.resubmit = &read_accel;
+        REQUIRE(queue.submit(&read_baro) == 0);
+        while (sched.run_next());
+
+        REQUIRE(log.done.size() == 2);
+        CHECK(log.done[0] == &read_baro);
+        CHECK(log.done[1] == &read_accel);
+        CHECK(accel_data[0] == 0x12);
+        CHECK(queue.is_idle());
+
+        // The completed transaction can be submitted again from its own handler
+        log.resubmit = &read_baro;
+        REQUIRE(queue.submit(&read_baro) == 0);
+        while (sched.run_next());
+        REQUIRE(log.done.size() == 4);
+        CHECK(log.done[2] == &read_baro);
+        CHECK(log.done[3] == &read_baro);
+    }
+
+    twim->release();
+}
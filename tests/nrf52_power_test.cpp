@@ -26,6 +26,7 @@ constexpr uint32_t evt_usbdetected = power_base + 0x11c;
 constexpr uint32_t evt_usbremoved = power_base + 0x120;
 constexpr uint32_t evt_usbpwrrdy = power_base + 0x124;
 
+constexpr uint32_t power_intenset = power_base + 0x304;
 constexpr uint32_t usb_regstatus = power_base + 0x438;
 
 namespace {
@@ -95,6 +96,13 @@ TEST_CASE("Test Power IRQ/Event Handling", "[power,irq]") {
     DummyEventHandler dummy_event_handler;
     CHECK(power->add_event_handler(Power::Event::USBDETECTED, &dummy_event_handler) >= 0);
 
+    // Only the enabled events are dispatched
+    mem.set_value_at(evt_usbdetected, 1);
+    CHECK(nvic_dispatch(power_irqnum) >= 0);
+    CHECK(dummy_event_handler.evt_counter == 0);
+    power->enable_interrupts(1 << Power::Event::USBDETECTED);
+    CHECK(mem.get_value_at(power_intenset) == (1 << Power::Event::USBDETECTED));
+
     mem.set_value_at(evt_usbdetected, 0);
     mem.set_value_at(evt_usbpwrrdy, 1);
     CHECK(nvic_dispatch(power_irqnum) >= 0);
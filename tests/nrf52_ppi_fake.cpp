@@ -0,0 +1,80 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "nrf52_ppi_fake.hpp"
+
+namespace mock {
+
+void PPIModel::install(Memory& mem) {
+    mem.set_addr_io_handler(kBase, kBase + kRegBlockSize, this);
+}
+
+uint32_t PPIModel::write32(uint32_t addr, uint32_t old_value, uint32_t new_value) {
+    const auto offset = addr - kBase;
+    if (offset < kNumGroups * 8) {
+        // Group tasks are write only
+        if (new_value & 1) {
+            const auto group_channels = reg(kChg + (offset / 8) * 4);
+            if (offset % 8 == kTasksChgEn) {
+                set_reg(kChen, reg(kChen) | group_channels);
+            } else {
+                set_reg(kChen, reg(kChen) & ~group_channels);
+            }
+        }
+        return 0;
+    }
+
+    switch (offset) {
+    case kChenSet:
+        set_reg(kChen, reg(kChen) | new_value);
+        return 0;
+    case kChenClr:
+        set_reg(kChen, reg(kChen) & ~new_value);
+        return 0;
+    default:
+        break;
+    }
+
+    (void)old_value;
+    return new_value;
+}
+
+uint32_t PPIModel::read32(uint32_t addr, uint32_t value) {
+    const auto offset = addr - kBase;
+    if (offset == kChenSet || offset == kChenClr) {
+        return reg(kChen);
+    }
+
+    return value;
+}
+
+void PPIModel::event_raised(uint32_t event_addr) {
+    const auto enabled = reg(kChen);
+    for (unsigned int ch = 0; ch < kNumChannels; ++ch) {
+        if ((enabled & (1u << ch)) && reg(kChEep + ch * 8) == event_addr) {
+            const auto task_addr = reg(kChTep + ch * 8);
+            if (task_addr) {
+                hw_write_mem_value(task_addr, 1);
+            }
+            const auto fork_addr = reg(kForkTep + ch * 4);
+            if (fork_addr) {
+                hw_write_mem_value(fork_addr, 1);
+            }
+        }
+    }
+}
+
+}  // namespace mock
@@ -0,0 +1,82 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/**
+ * @file
+ *
+ * Behavioral model of nRF52 PPI.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "mock_memio.hpp"
+
+namespace mock {
+
+/**
+ * @brief PPI model: connects events of the device models to tasks.
+ *
+ * The device models report their events with event_raised(), the model then triggers
+ * the tasks and the fork tasks of all enabled channels with that event, through
+ * Memory::hw_write32(). The group tasks enable and disable the channels of the group,
+ * both when written by the firmware and when triggered by a channel.
+ */
+class PPIModel : public IOHandlerStub {
+    public:
+        static constexpr uint32_t kBase = 0x4001f000;
+        static constexpr unsigned int kNumChannels = 32;
+        static constexpr unsigned int kNumGroups = 6;
+
+        static constexpr uint32_t kTasksChgEn = 0x000;
+        static constexpr uint32_t kTasksChgDis = 0x004;
+        static constexpr uint32_t kChen = 0x500;
+        static constexpr uint32_t kChenSet = 0x504;
+        static constexpr uint32_t kChenClr = 0x508;
+        static constexpr uint32_t kChEep = 0x510;
+        static constexpr uint32_t kChTep = 0x514;
+        static constexpr uint32_t kChg = 0x800;
+        static constexpr uint32_t kForkTep = 0x910;
+
+        static constexpr uint32_t kRegBlockSize = 0x1000;
+
+        /**
+         * @brief Register the model as the IO handler for PPI registers.
+         */
+        void install(Memory& mem);
+
+        uint32_t write32(uint32_t addr, uint32_t old_value, uint32_t new_value) override;
+        uint32_t read32(uint32_t addr, uint32_t value) override;
+
+        /**
+         * @brief Trigger the tasks connected to the event.
+         *
+         * @param event_addr Address of the event register.
+         */
+        void event_raised(uint32_t event_addr);
+
+    private:
+        uint32_t reg(uint32_t offset) const {
+            return get_mem_value(kBase + offset);
+        }
+
+        void set_reg(uint32_t offset, uint32_t value) {
+            set_mem_value(kBase + offset, value);
+        }
+};
+
+}  // namespace mock
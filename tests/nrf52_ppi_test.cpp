@@ -0,0 +1,202 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "third_party/catch2/catch.hpp"
+
+#include <vector>
+
+#include "mock_memio.hpp"
+#include "nrf52_ppi_fake.hpp"
+#include "nrf52_timer_fake.hpp"
+
+#include "memio.h"
+#include "nrf52/ppi.hpp"
+
+namespace {
+
+constexpr uint32_t kPpiBase = mock::PPIModel::kBase;
+constexpr uint32_t timer0_base = 0x40008000;
+constexpr uint32_t timer1_base = 0x40009000;
+// Any event address would do, the events are raised by the test itself
+constexpr uint32_t kEventAddr = 0x40002108;
+
+uint32_t get_chen(mock::Memory& mem) {
+    return mem.get_value_at(kPpiBase + mock::PPIModel::kChen);
+}
+
+}  // namespace
+
+TEST_CASE("Test PPI Channel Allocation") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    mock::PPIModel ppi_model;
+    ppi_model.install(mem);
+
+    auto* ppi = nrf52::PPI::request();
+    REQUIRE(ppi != nullptr);
+    CHECK(ppi == nrf52::PPI::request());
+
+    std::vector<int> channels;
+    for (unsigned int i = 0; i < nrf52::PPI::kNumChannels; ++i) {
+        const auto ch = ppi->alloc_channel(kEventAddr + i * 4, timer0_base + i * 4);
+        REQUIRE(ch >= 0);
+        channels.push_back(ch);
+
+        CHECK(mem.get_value_at(kPpiBase + mock::PPIModel::kChEep + ch * 8) == kEventAddr + i * 4);
+        CHECK(mem.get_value_at(kPpiBase + mock::PPIModel::kChTep + ch * 8) == timer0_base + i * 4);
+    }
+
+    // All channels are different
+    for (unsigned int i = 0; i < channels.size(); ++i) {
+        for (unsigned int j = i + 1; j < channels.size(); ++j) {
+            CHECK(channels[i] != channels[j]);
+        }
+    }
+
+    CHECK(ppi->alloc_channel(kEventAddr, timer0_base) < 0);
+    // Allocated channels are not enabled
+    CHECK(get_chen(mem) == 0);
+
+    const auto freed = channels[5];
+    ppi->set_fork(freed, timer1_base);
+    CHECK(mem.get_value_at(kPpiBase + mock::PPIModel::kForkTep + freed * 4) == timer1_base);
+    ppi->free_channel(freed);
+    CHECK(mem.get_value_at(kPpiBase + mock::PPIModel::kChEep + freed * 8) == 0);
+    CHECK(mem.get_value_at(kPpiBase + mock::PPIModel::kChTep + freed * 8) == 0);
+    CHECK(mem.get_value_at(kPpiBase + mock::PPIModel::kForkTep + freed * 4) == 0);
+    CHECK(ppi->set_fork(freed, timer1_base) < 0);
+
+    // Freeing twice or freeing garbage does nothing
+    ppi->free_channel(freed);
+    ppi->free_channel(-1);
+    ppi->free_channel(nrf52::PPI::kNumChannels);
+
+    CHECK(ppi->alloc_channel(kEventAddr, timer0_base) == freed);
+    CHECK(ppi->alloc_channel(kEventAddr, timer0_base) < 0);
+
+    // Only allocated channels can be enabled
+    ppi->free_channel(channels[0]);
+    ppi->enable_channels(~0u);
+    CHECK(get_chen(mem) == (((1u << nrf52::PPI::kNumChannels) - 1) & ~nrf52::PPI::channel_mask(channels[0])));
+    ppi->disable_channels(nrf52::PPI::channel_mask(channels[1]));
+    CHECK((get_chen(mem) & nrf52::PPI::channel_mask(channels[1])) == 0);
+
+    for (auto ch : channels) {
+        ppi->free_channel(ch);
+    }
+    CHECK(get_chen(mem) == 0);
+}
+
+TEST_CASE("Test PPI Event Propagation") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+
+    mock::PPIModel ppi_model;
+    ppi_model.install(mem);
+    mock::TimerModel counter0{timer0_base};
+    counter0.install(mem);
+    mock::TimerModel counter1{timer1_base};
+    counter1.install(mem);
+
+    // Both timers count the triggers of TASKS_COUNT
+    for (auto base : {timer0_base, timer1_base}) {
+        raw_write32(base + mock::TimerModel::kMode, 1);
+        raw_write32(base + mock::TimerModel::kBitMode, 3);
+        raw_write32(base + mock::TimerModel::kTasksStart, 1);
+    }
+
+    auto* ppi = nrf52::PPI::request();
+    const auto ch = ppi->alloc_channel(kEventAddr, timer0_base + mock::TimerModel::kTasksCount);
+    REQUIRE(ch >= 0);
+
+    // Disabled channel does nothing
+    ppi_model.event_raised(kEventAddr);
+    CHECK(counter0.get_counter() == 0);
+
+    ppi->enable_channels(nrf52::PPI::channel_mask(ch));
+    ppi_model.event_raised(kEventAddr);
+    ppi_model.event_raised(kEventAddr + 4);
+    CHECK(counter0.get_counter() == 1);
+    CHECK(counter1.get_counter() == 0);
+
+    SECTION("Fork") {
+        REQUIRE(ppi->set_fork(ch, timer1_base + mock::TimerModel::kTasksCount) == 0);
+        ppi_model.event_raised(kEventAddr);
+        CHECK(counter0.get_counter() == 2);
+        CHECK(counter1.get_counter() == 1);
+
+        REQUIRE(ppi->set_fork(ch, 0) == 0);
+        ppi_model.event_raised(kEventAddr);
+        CHECK(counter0.get_counter() == 3);
+        CHECK(counter1.get_counter() == 1);
+    }
+
+    SECTION("Groups") {
+        const auto ch1 = ppi->alloc_channel(kEventAddr, timer1_base + mock::TimerModel::kTasksCount);
+        REQUIRE(ch1 >= 0);
+        const auto group = ppi->alloc_group(nrf52::PPI::channel_mask(ch) | nrf52::PPI::channel_mask(ch1));
+        REQUIRE(group >= 0);
+
+        ppi->enable_group(group);
+        ppi_model.event_raised(kEventAddr);
+        CHECK(counter0.get_counter() == 2);
+        CHECK(counter1.get_counter() == 1);
+
+        ppi->disable_group(group);
+        CHECK(get_chen(mem) == 0);
+        ppi_model.event_raised(kEventAddr);
+        CHECK(counter0.get_counter() == 2);
+
+        // Another channel disables the group when its event is raised
+        const auto ctrl = ppi->alloc_channel(kEventAddr + 4, ppi->get_group_disable_task(group));
+        REQUIRE(ctrl >= 0);
+        ppi->enable_group(group);
+        ppi->enable_channels(nrf52::PPI::channel_mask(ctrl));
+        ppi_model.event_raised(kEventAddr);
+        ppi_model.event_raised(kEventAddr + 4);
+        ppi_model.event_raised(kEventAddr);
+        CHECK(counter0.get_counter() == 3);
+        CHECK(counter1.get_counter() == 2);
+        CHECK(get_chen(mem) == nrf52::PPI::channel_mask(ctrl));
+
+        // The freed channel leaves the group
+        ppi->free_channel(ch1);
+        CHECK(mem.get_value_at(kPpiBase + mock::PPIModel::kChg + group * 4) == nrf52::PPI::channel_mask(ch));
+
+        ppi->free_channel(ctrl);
+        ppi->free_group(group);
+        CHECK(mem.get_value_at(kPpiBase + mock::PPIModel::kChg + group * 4) == 0);
+    }
+
+    SECTION("Group exhaustion") {
+        std::vector<int> groups;
+        for (unsigned int i = 0; i < nrf52::PPI::kNumGroups; ++i) {
+            const auto group = ppi->alloc_group(nrf52::PPI::channel_mask(ch));
+            REQUIRE(group >= 0);
+            groups.push_back(group);
+        }
+        CHECK(ppi->alloc_group(0) < 0);
+
+        for (auto group : groups) {
+            ppi->free_group(group);
+        }
+        const auto group = ppi->alloc_group(0);
+        CHECK(group >= 0);
+        ppi->free_group(group);
+    }
+
+    ppi->free_channel(ch);
+}
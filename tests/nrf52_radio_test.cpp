@@ -114,6 +114,19 @@ TEST_CASE("Radio API") {
         CHECK(shift_mask(pcnf1, 0, 0xff) == maxlen);
         CHECK(shift_mask(pcnf1, 16, 7) == base_addr_len);
         CHECK((pcnf1 & (1 << 25)) > 0);
+
+        // Both fields in one read-modify-write
+        const auto reads = mem.get_op_count(mock::Memory::Op::READ32, radio_base + 0x518);
+        const auto writes = mem.get_op_count(mock::Memory::Op::WRITE32, radio_base + 0x518);
+        CHECK(radio->configure_framing(1, true) < 0);
+        CHECK(radio->configure_framing(4, false) >= 0);
+        CHECK(mem.get_op_count(mock::Memory::Op::READ32, radio_base + 0x518) == reads + 1);
+        CHECK(mem.get_op_count(mock::Memory::Op::WRITE32, radio_base + 0x518) == writes + 1);
+
+        const auto new_pcnf1 = get_reg_value(0x518);
+        CHECK(shift_mask(new_pcnf1, 0, 0xff) == maxlen);
+        CHECK(shift_mask(new_pcnf1, 16, 7) == 4);
+        CHECK((new_pcnf1 & (1 << 25)) == 0);
     }
 
     SECTION("On-Air Address Configuration") {
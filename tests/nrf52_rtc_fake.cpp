@@ -0,0 +1,107 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "nrf52_rtc_fake.hpp"
+
+namespace mock {
+
+void RTCModel::install(Memory& mem) {
+    mem.set_addr_io_handler(base_, base_ + kRegBlockSize, this);
+}
+
+void RTCModel::set_counter(uint32_t counter) {
+    set_reg(kCounter, counter & kCounterMask);
+}
+
+void RTCModel::raise_event(unsigned int evt) {
+    if ((reg(kInten) | reg(kEvten)) & (1 << evt)) {
+        set_reg(kEventsTick + evt * 4, 1);
+    }
+}
+
+void RTCModel::advance(uint32_t ticks) {
+    if (!running_) {
+        return;
+    }
+
+    for (; ticks > 0; --ticks) {
+        const auto counter = (get_counter() + 1) & kCounterMask;
+        set_reg(kCounter, counter);
+        raise_event(kTickEvent);
+        if (counter == 0) {
+            raise_event(kOvrflwEvent);
+        }
+        for (unsigned int n = 0; n < kNumCC; ++n) {
+            if ((reg(kCC + n * 4) & kCounterMask) == counter) {
+                raise_event(kCompareEvent0 + n);
+            }
+        }
+    }
+}
+
+uint32_t RTCModel::write32(uint32_t addr, uint32_t old_value, uint32_t new_value) {
+    const auto offset = addr - base_;
+    switch (offset) {
+    case kTasksStart:
+        if (new_value & 1) {
+            running_ = true;
+        }
+        return 0;
+    case kTasksStop:
+        if (new_value & 1) {
+            running_ = false;
+        }
+        return 0;
+    case kTasksClear:
+        if (new_value & 1) {
+            set_reg(kCounter, 0);
+        }
+        return 0;
+    case kIntenSet:
+        set_reg(kInten, reg(kInten) | new_value);
+        return reg(kInten);
+    case kIntenClr:
+        set_reg(kInten, reg(kInten) & ~new_value);
+        return reg(kInten);
+    case kEvtenSet:
+        set_reg(kEvten, reg(kEvten) | new_value);
+        return reg(kEvten);
+    case kEvtenClr:
+        set_reg(kEvten, reg(kEvten) & ~new_value);
+        return reg(kEvten);
+    case kCounter:
+        // Read only
+        return old_value;
+    default:
+        break;
+    }
+
+    return new_value;
+}
+
+uint32_t RTCModel::read32(uint32_t addr, uint32_t value) {
+    const auto offset = addr - base_;
+    if (offset == kIntenSet || offset == kIntenClr) {
+        return reg(kInten);
+    }
+    if (offset == kEvtenSet || offset == kEvtenClr) {
+        return reg(kEvten);
+    }
+
+    return value;
+}
+
+}  // namespace mock
@@ -0,0 +1,111 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/**
+ * @file
+ *
+ * Behavioral model of nRF52 RTC.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "mock_memio.hpp"
+
+namespace mock {
+
+/**
+ * @brief RTC model, advanced explicitly by the test.
+ *
+ * INTENSET/INTENCLR and EVTENSET/EVTENCLR are supported. The events are raised
+ * only when they are enabled in either of them, as on the hardware. COMPARE[n]
+ * event is raised when the counter reaches CC[n], OVRFLW when it wraps around.
+ * Interrupts are not modelled.
+ */
+class RTCModel : public IOHandlerStub {
+    public:
+        static constexpr unsigned int kNumCC = 4;
+        static constexpr uint32_t kCounterMask = 0xffffff;
+
+        static constexpr uint32_t kTasksStart = 0x000;
+        static constexpr uint32_t kTasksStop = 0x004;
+        static constexpr uint32_t kTasksClear = 0x008;
+        static constexpr uint32_t kEventsTick = 0x100;
+        static constexpr uint32_t kEventsCompare = 0x140;
+        static constexpr uint32_t kInten = 0x300;
+        static constexpr uint32_t kIntenSet = 0x304;
+        static constexpr uint32_t kIntenClr = 0x308;
+        static constexpr uint32_t kEvten = 0x340;
+        static constexpr uint32_t kEvtenSet = 0x344;
+        static constexpr uint32_t kEvtenClr = 0x348;
+        static constexpr uint32_t kCounter = 0x504;
+        static constexpr uint32_t kCC = 0x540;
+
+        static constexpr unsigned int kTickEvent = 0;
+        static constexpr unsigned int kOvrflwEvent = 1;
+        static constexpr unsigned int kCompareEvent0 = 16;
+
+        static constexpr uint32_t kRegBlockSize = 0x1000;
+
+        explicit RTCModel(uint32_t base) : base_{base} {}
+
+        /**
+         * @brief Register the model as the IO handler for the RTC's registers.
+         */
+        void install(Memory& mem);
+
+        uint32_t write32(uint32_t addr, uint32_t old_value, uint32_t new_value) override;
+        uint32_t read32(uint32_t addr, uint32_t value) override;
+
+        /**
+         * @brief Count the ticks, if the RTC is running.
+         */
+        void advance(uint32_t ticks);
+
+        /**
+         * @brief Set the counter, e.g. close to the wrap around.
+         */
+        void set_counter(uint32_t counter);
+
+        uint32_t get_counter() const {
+            return reg(kCounter);
+        }
+
+        uint32_t get_inten() const {
+            return reg(kInten);
+        }
+
+        bool is_running() const {
+            return running_;
+        }
+
+    private:
+        uint32_t reg(uint32_t offset) const {
+            return get_mem_value(base_ + offset);
+        }
+
+        void set_reg(uint32_t offset, uint32_t value) {
+            set_mem_value(base_ + offset, value);
+        }
+
+        void raise_event(unsigned int evt);
+
+        const uint32_t base_;
+        bool running_ = false;
+};
+
+}  // namespace mock
@@ -20,6 +20,7 @@
 
 #include "nvic.h"
 #include "driver/timer.hpp"
+#include "nrf52/rtc.hpp"
 
 namespace {
 
@@ -112,11 +113,18 @@ TEST_CASE("RTC API") {
         auto* rtc0 = driver::Timer::request_by_id(driver::Timer::ID::RTC0);
         REQUIRE(rtc0 != nullptr);
         CHECK(rtc0->get_irq_num() == 11);
+        // CC[0..2] only
+        CHECK(rtc0->get_num_channels() == 3);
+        CHECK(rtc0->get_compare_event(2) == 18);
+        CHECK(rtc0->get_compare_event(3) < 0);
+        CHECK(rtc0->set_compare(3, 0) < 0);
+        CHECK(mem.get_op_count(mock::Memory::Op::WRITE32, rtc0_base + 0x54c) == 0);
 
         test_start_stop(rtc0, rtc0_base);
         test_prescaler(rtc0, rtc0_base);
         test_enable_interrupt(rtc0, rtc0_base);
         test_request_rate(rtc0, rtc0_base);
+        rtc0->release();
     }
 
     SECTION("RTC1") {
@@ -124,11 +132,13 @@ TEST_CASE("RTC API") {
         auto* rtc1 = driver::Timer::request_by_id(driver::Timer::ID::RTC1);
         REQUIRE(rtc1 != nullptr);
         CHECK(rtc1->get_irq_num() == 17);
+        CHECK(rtc1->get_num_channels() == 4);
 
         test_start_stop(rtc1, rtc1_base);
         test_prescaler(rtc1, rtc1_base);
         test_enable_interrupt(rtc1, rtc1_base);
         test_request_rate(rtc1, rtc1_base);
+        rtc1->release();
     }
 
     SECTION("RTC2") {
@@ -141,5 +151,49 @@ TEST_CASE("RTC API") {
         test_prescaler(rtc2, rtc2_base);
         test_enable_interrupt(rtc2, rtc2_base);
         test_request_rate(rtc2, rtc2_base);
+
+        // One user at a time
+        CHECK(driver::Timer::request_by_id(driver::Timer::ID::RTC2) == nullptr);
+        rtc2->release();
+        CHECK(mem.get_value_at(rtc2_base + 0x348, 0) == ~0u);
+        CHECK(driver::Timer::request_by_id(driver::Timer::ID::RTC2) == rtc2);
+        rtc2->release();
     }
 }
+
+TEST_CASE("Static RTC") {
+    using StaticRTC = nrf52::RTC<11>;
+    constexpr uint32_t rtc0_base = 0x4000b000;
+
+    // Resolved at compile time
+    static_assert(StaticRTC::kBase == rtc0_base, "RTC0 base");
+    static_assert(StaticRTC::kIrqN == 11, "RTC0 IRQ");
+    static_assert(StaticRTC::get_event_addr(StaticRTC::Event::COMPARE0) == rtc0_base + 0x140, "COMPARE0");
+    static_assert(StaticRTC::get_task_addr(StaticRTC::Task::CLEAR) == rtc0_base + 0x8, "CLEAR");
+    static_assert(StaticRTC::kNumChannels == 3 && nrf52::RTC<17>::kNumChannels == 4, "RTC0 has 3 channels");
+
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+
+    StaticRTC::start();
+    CHECK(mem.get_value_at(rtc0_base, 0) == 1);
+    StaticRTC::set_prescaler(8);
+    CHECK(StaticRTC::get_rate() == 32768 / 8);
+
+    // The same registers are behind the driver::Timer interface
+    auto* rtc0 = driver::Timer::request_by_id(driver::Timer::ID::RTC0);
+    REQUIRE(rtc0 != nullptr);
+    CHECK(rtc0->get_rate() == 32768 / 8);
+
+    StaticRTC::enable_tick_interrupt();
+    CHECK(mem.get_value_at(rtc0_base + 0x304, 0) == 1);
+    CHECK(mem.get_value_at(rtc0_base + 0x344, 0) == 1);
+
+    // Only the enabled events are pending
+    mem.set_value_at(rtc0_base + 0x100, 1);
+    mem.set_value_at(rtc0_base + 0x104, 1);
+    CHECK(StaticRTC::get_pending_events(0x3) == 0x1);
+    StaticRTC::clear_event(StaticRTC::Event::TICK);
+    CHECK(StaticRTC::get_pending_events(0x3) == 0);
+    rtc0->release();
+}
@@ -0,0 +1,210 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "nrf52_saadc_fake.hpp"
+
+#include "nvic.h"
+
+namespace mock {
+
+void SAADCModel::install(Memory& mem, Scheduler& sched) {
+    set_memory(&mem);
+    sched_ = &sched;
+    mem.set_addr_io_handler(kBase, kBase + kRegBlockSize, this);
+}
+
+uint32_t SAADCModel::write32(uint32_t addr, uint32_t old_value, uint32_t new_value) {
+    (void)old_value;
+    const auto offset = addr - kBase;
+    // Tasks are write only
+    switch (offset) {
+    case kTasksStart:
+        if (new_value & 1) {
+            start();
+        }
+        return 0;
+    case kTasksSample:
+        if (new_value & 1) {
+            sample();
+        }
+        return 0;
+    case kTasksStop:
+        if (new_value & 1) {
+            stop();
+        }
+        return 0;
+    case kTasksCalibrateOffset:
+        if (new_value & 1) {
+            calibrate();
+        }
+        return 0;
+    case kIntenSet:
+        set_reg(kInten, reg(kInten) | new_value);
+        return reg(kInten);
+    case kIntenClr:
+        set_reg(kInten, reg(kInten) & ~new_value);
+        return reg(kInten);
+    default:
+        break;
+    }
+
+    return new_value;
+}
+
+uint32_t SAADCModel::read32(uint32_t addr, uint32_t value) {
+    const auto offset = addr - kBase;
+    if (offset == kIntenSet || offset == kIntenClr) {
+        return reg(kInten);
+    }
+
+    return value;
+}
+
+void SAADCModel::raise_event(uint32_t offset) {
+    set_reg(offset, 1);
+    if (event_listener_) {
+        event_listener_(kBase + offset);
+    }
+
+    const uint32_t event_mask = 1 << ((offset - kEventsStarted) / 4);
+    if ((reg(kInten) & event_mask) && !irq_pending_) {
+        irq_pending_ = true;
+        sched_->schedule_in(0, [this]() {
+            irq_pending_ = false;
+            nvic_dispatch(kIrqN);
+        });
+    }
+}
+
+void SAADCModel::start() {
+    // RESULT.PTR and RESULT.MAXCNT are double buffered: the values are latched here,
+    // the firmware may prepare the next buffer right after STARTED.
+    result_ptr_ = static_cast<int16_t*>(get_mem_ptr(kBase + kResultPtr));
+    result_maxcnt_ = reg(kResultMaxCnt) & 0x7fff;
+    if (result_ptr_ && !is_dma_accessible(result_ptr_, result_maxcnt_ * sizeof(int16_t))) {
+        result_ptr_ = nullptr;
+    }
+    result_amount_ = 0;
+    started_ = true;
+    raise_event(kEventsStarted);
+}
+
+Scheduler::Cycles SAADCModel::get_conversion_cycles(unsigned int channel) const {
+    static constexpr unsigned int acq_times_us[] = {3, 5, 10, 15, 20, 40, 40, 40};
+    const auto tacq = acq_times_us[(reg(kChConfig + channel * 16) >> 16) & 7];
+    const auto cycles = (tacq + kConversionTimeUs) * kCyclesPerUs;
+
+    return is_burst(channel) ? cycles << (reg(kOversample) & 0xf) : cycles;
+}
+
+void SAADCModel::sample() {
+    if (!started_ || converting_ || calibrating_) {
+        ++lost_count_;
+        return;
+    }
+
+    Scheduler::Cycles duration = 0;
+    for (unsigned int ch = 0; ch < kNumChannels; ++ch) {
+        if (is_channel_enabled(ch)) {
+            duration += get_conversion_cycles(ch);
+        }
+    }
+
+    if (!duration) {
+        return;
+    }
+
+    converting_ = true;
+    conversion_event_ = sched_->schedule_in(duration, [this]() {
+        conversion_done();
+    });
+}
+
+void SAADCModel::conversion_done() {
+    converting_ = false;
+    const unsigned int oversample = 1 << (reg(kOversample) & 0xf);
+    ++accumulated_;
+    for (unsigned int ch = 0; ch < kNumChannels && started_; ++ch) {
+        if (!is_channel_enabled(ch)) {
+            continue;
+        }
+
+        raise_event(kEventsDone);
+        if (is_burst(ch)) {
+            int32_t sum = 0;
+            for (unsigned int i = 0; i < oversample; ++i) {
+                sum += input_ ? input_(ch) : 0;
+            }
+            accumulator_[ch] = sum;
+        } else {
+            accumulator_[ch] += input_ ? input_(ch) : 0;
+            if (accumulated_ < oversample) {
+                continue;
+            }
+        }
+
+        const int16_t value = accumulator_[ch] / static_cast<int32_t>(oversample);
+        accumulator_[ch] = 0;
+        if (result_ptr_) {
+            result_ptr_[result_amount_] = value;
+        }
+        ++result_amount_;
+        ++sample_count_;
+        raise_event(kEventsResultDone);
+
+        if (result_amount_ == result_maxcnt_) {
+            end();
+        }
+    }
+
+    if (accumulated_ >= oversample) {
+        accumulated_ = 0;
+    }
+}
+
+void SAADCModel::calibrate() {
+    if (calibrating_) {
+        return;
+    }
+
+    calibrating_ = true;
+    sched_->schedule_in(kCalibrationTimeUs * kCyclesPerUs, [this]() {
+        calibrating_ = false;
+        ++calibration_count_;
+        raise_event(kEventsCalibrateDone);
+    });
+}
+
+void SAADCModel::stop() {
+    if (converting_) {
+        sched_->cancel(conversion_event_);
+        converting_ = false;
+    }
+
+    if (started_) {
+        end();
+    }
+
+    raise_event(kEventsStopped);
+}
+
+void SAADCModel::end() {
+    started_ = false;
+    set_reg(kResultAmount, result_amount_);
+    raise_event(kEventsEnd);
+}
+
+}  // namespace mock
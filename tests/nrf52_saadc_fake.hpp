@@ -0,0 +1,199 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/**
+ * @file
+ *
+ * Behavioral model of nRF52 SAADC with EasyDMA.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+
+namespace mock {
+
+/**
+ * @brief SAADC device model.
+ *
+ * - TASKS_START latches RESULT.PTR and RESULT.MAXCNT and raises STARTED.
+ * - TASKS_SAMPLE converts all of the channels with PSELP set, in the channel order.
+ *   The conversion of each channel takes its TACQ time and 2 us more. After that the
+ *   result is stored into the buffer, raising DONE and RESULTDONE. END is raised when
+ *   the buffer is full. Samples triggered while there is no buffer, while the conversion
+ *   or the calibration is in progress are lost.
+ * - With OVERSAMPLE each result is the average of 2^OVERSAMPLE conversions. The channels
+ *   with BURST set do all of them on a single SAMPLE task, otherwise each task does one.
+ * - TASKS_CALIBRATEOFFSET raises CALIBRATEDONE after the calibration time.
+ * - TASKS_STOP finishes the buffer early, updating RESULT.AMOUNT, and raises STOPPED.
+ * - INTEN, INTENSET and INTENCLR are supported. The enabled events are dispatched
+ *   to the interrupt handler through nvic_dispatch().
+ *
+ * The values of the samples come from the input function, see set_input().
+ */
+class SAADCModel : public IOHandlerStub {
+    public:
+        using InputFunc = std::function<int16_t(unsigned int channel)>;
+
+        static constexpr uint32_t kBase = 0x40007000;
+        static constexpr int kIrqN = 7;
+        static constexpr unsigned int kNumChannels = 8;
+
+        static constexpr uint64_t kCyclesPerUs = 64;
+        static constexpr unsigned int kConversionTimeUs = 2;
+        // Assumed duration of the offset calibration
+        static constexpr unsigned int kCalibrationTimeUs = 100;
+
+        // Register offsets
+        static constexpr uint32_t kTasksStart = 0x000;
+        static constexpr uint32_t kTasksSample = 0x004;
+        static constexpr uint32_t kTasksStop = 0x008;
+        static constexpr uint32_t kTasksCalibrateOffset = 0x00c;
+
+        static constexpr uint32_t kEventsStarted = 0x100;
+        static constexpr uint32_t kEventsEnd = 0x104;
+        static constexpr uint32_t kEventsDone = 0x108;
+        static constexpr uint32_t kEventsResultDone = 0x10c;
+        static constexpr uint32_t kEventsCalibrateDone = 0x110;
+        static constexpr uint32_t kEventsStopped = 0x114;
+
+        static constexpr uint32_t kInten = 0x300;
+        static constexpr uint32_t kIntenSet = 0x304;
+        static constexpr uint32_t kIntenClr = 0x308;
+
+        static constexpr uint32_t kChPselp = 0x510;
+        static constexpr uint32_t kChConfig = 0x514;
+        static constexpr uint32_t kConfigBurst = (1 << 24);
+        static constexpr uint32_t kResolution = 0x5f0;
+        static constexpr uint32_t kOversample = 0x5f4;
+        static constexpr uint32_t kResultPtr = 0x62c;
+        static constexpr uint32_t kResultMaxCnt = 0x630;
+        static constexpr uint32_t kResultAmount = 0x634;
+
+        static constexpr uint32_t kRegBlockSize = 0x1000;
+
+        /**
+         * @brief Register the model as the IO handler for the peripheral's registers.
+         *
+         * The memory should be reset before that. The model needs virtual time,
+         * so the scheduler should be attached to the memory.
+         */
+        void install(Memory& mem, Scheduler& sched);
+
+        uint32_t write32(uint32_t addr, uint32_t old_value, uint32_t new_value) override;
+        uint32_t read32(uint32_t addr, uint32_t value) override;
+
+        /**
+         * @brief Set the function that provides the value of each conversion.
+         *
+         * By default all of the samples are zero.
+         */
+        void set_input(InputFunc input) {
+            input_ = std::move(input);
+        }
+
+        /**
+         * @brief Set the function to be called with the address of every event raised.
+         *
+         * E.g. to connect the model to PPIModel::event_raised().
+         */
+        void set_event_listener(std::function<void(uint32_t)> listener) {
+            event_listener_ = std::move(listener);
+        }
+
+        bool is_started() const {
+            return started_;
+        }
+
+        bool is_calibrating() const {
+            return calibrating_;
+        }
+
+        unsigned int get_calibration_count() const {
+            return calibration_count_;
+        }
+
+        /**
+         * @brief Time of one channel's conversion in CPU cycles, for a single SAMPLE task.
+         */
+        Scheduler::Cycles get_conversion_cycles(unsigned int channel) const;
+
+        /**
+         * @brief Number of samples stored into the result buffers.
+         */
+        unsigned int get_sample_count() const {
+            return sample_count_;
+        }
+
+        /**
+         * @brief Number of samples lost, because there was no buffer or the SAADC was busy.
+         */
+        unsigned int get_lost_count() const {
+            return lost_count_;
+        }
+
+    private:
+        uint32_t reg(uint32_t offset) const {
+            return get_mem_value(kBase + offset);
+        }
+
+        void set_reg(uint32_t offset, uint32_t value) {
+            set_mem_value(kBase + offset, value);
+        }
+
+        void raise_event(uint32_t offset);
+
+        void start();
+        void sample();
+        void stop();
+        void end();
+        void conversion_done();
+        void calibrate();
+
+        bool is_channel_enabled(unsigned int channel) const {
+            return reg(kChPselp + channel * 16);
+        }
+
+        bool is_burst(unsigned int channel) const {
+            return reg(kChConfig + channel * 16) & kConfigBurst;
+        }
+
+        Scheduler* sched_ = nullptr;
+        bool irq_pending_ = false;
+        std::function<void(uint32_t)> event_listener_;
+        InputFunc input_;
+
+        bool started_ = false;
+        bool converting_ = false;
+        Scheduler::EventId conversion_event_ = 0;
+        bool calibrating_ = false;
+        unsigned int calibration_count_ = 0;
+        // Oversampling without BURST: conversions done so far and their sums
+        unsigned int accumulated_ = 0;
+        int32_t accumulator_[kNumChannels] = {};
+        int16_t* result_ptr_ = nullptr;
+        uint32_t result_maxcnt_ = 0;
+        uint32_t result_amount_ = 0;
+
+        unsigned int sample_count_ = 0;
+        unsigned int lost_count_ = 0;
+};
+
+}  // namespace mock
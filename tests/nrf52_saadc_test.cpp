@@ -16,14 +16,23 @@
 
 #include "third_party/catch2/catch.hpp"
 
+#include <array>
 #include <cstring>
+#include <vector>
 
 #include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+#include "nrf52_ppi_fake.hpp"
+#include "nrf52_saadc_fake.hpp"
+#include "nrf52_timer_fake.hpp"
 
 #include "driver/adc.hpp"
 #include "nrf52/pinctrl.hpp"
+#include "nrf52/timer.hpp"
 
 constexpr uint32_t saadc_base = 0x40007000;
+// The first free TIMER triggers the conversions of the stream
+constexpr uint32_t timer0_base = 0x40008000;
 
 // Offsets for various registers
 constexpr auto saadc_enable = 0x500;
@@ -31,6 +40,14 @@ constexpr auto chx_pselp(unsigned int x) {
     return 0x510 + 16 * x;
 }
 
+constexpr auto chx_config(unsigned int x) {
+    return chx_pselp(x) + 4;
+}
+
+constexpr uint32_t config_burst = (1 << 24);
+
+constexpr auto saadc_resolution = 0x5f0;
+constexpr auto saadc_oversample = 0x5f4;
 constexpr auto result_ptr = 0x62c;
 constexpr auto result_maxcnt = 0x630;
 
@@ -40,6 +57,57 @@ constexpr auto task_sample = 4;
 constexpr auto event_started = 0x100;
 constexpr auto event_done = 0x108;
 
+namespace {
+
+class BufferCollector : public driver::EventHandler {
+    public:
+        explicit BufferCollector(const driver::ADC& adc) : adc_{adc} {}
+
+        void handle_event(driver::EventInfo* e_info) override {
+            CHECK(e_info->evt_id == driver::ADC::Event::BUFFER_DONE);
+            const auto* data = static_cast<const int16_t*>(e_info->data);
+            pointers.push_back(data);
+            buffers.emplace_back(data, data + adc_.get_stream_buffer_len());
+        }
+
+        std::vector<const int16_t*> pointers;
+        std::vector<std::vector<int16_t>> buffers;
+
+    private:
+        const driver::ADC& adc_;
+};
+
+// SAADC with the timer and PPI it needs for the continuous sampling
+struct SaadcSim {
+    SaadcSim(mock::Memory& mem, mock::Scheduler& sched) {
+        ppi.install(mem);
+        timer.install(mem, sched);
+        model.install(mem, sched);
+
+        auto route_event = [this](uint32_t addr) {
+            ppi.event_raised(addr);
+        };
+        timer.set_event_listener(route_event);
+        model.set_event_listener(route_event);
+
+        model.set_input([this](unsigned int ch) -> int16_t {
+            return ch * 1000 + counts[ch]++;
+        });
+
+        // The channels are configured only by the first request(), and the
+        // memory could have been reset since then.
+        using ps = pinctrl::saadc;
+        mem.set_value_at(saadc_base + chx_pselp(0), ps::AIN3);
+        mem.set_value_at(saadc_base + chx_pselp(2), ps::AIN5);
+    }
+
+    mock::PPIModel ppi;
+    mock::TimerModel timer{timer0_base};
+    mock::SAADCModel model;
+    std::array<int16_t, mock::SAADCModel::kNumChannels> counts{};
+};
+
+}  // namespace
 
 TEST_CASE("Test ADC API") {
     auto& mem = mock::get_global_memory();
@@ -107,3 +175,226 @@ TEST_CASE("Test ADC API") {
         CHECK(saadc->get_result(2, 2) == 0x2b3);
     }
 }
+
+TEST_CASE("Test ADC Streaming") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    SaadcSim sim{mem, sched};
+    auto& model = sim.model;
+    auto& timer = sim.timer;
+
+    auto* saadc = driver::ADC::request_by_id(driver::ADC::ID::ADC0);
+    REQUIRE(saadc != nullptr);
+    REQUIRE(saadc->get_num_channels() == 2);
+
+    int16_t buffer[2 * 2 * 8];
+    BufferCollector collector{*saadc};
+
+    SECTION("Invalid parameters") {
+        CHECK(saadc->start_stream(0, buffer, 32, &collector) == 0);
+        CHECK(saadc->start_stream(1000, buffer, 3, &collector) == 0);
+        CHECK(saadc->start_stream(1000 * 1000, buffer, 32, &collector) == 0);
+        CHECK_FALSE(model.is_started());
+    }
+
+    SECTION("No free TIMER") {
+        auto* pool = nrf52::TimerPool::request();
+        std::vector<int> timers;
+        for (int id = pool->alloc(); id >= 0; id = pool->alloc()) {
+            timers.push_back(id);
+        }
+
+        CHECK(saadc->start_stream(1000, buffer, 32, &collector) == 0);
+        CHECK_FALSE(model.is_started());
+        CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+        for (auto id : timers) {
+            pool->free(id);
+        }
+
+        // The stream gets the TIMER once it is returned
+        REQUIRE(saadc->start_stream(1000, buffer, 32, &collector) == 1000);
+        saadc->stop();
+    }
+
+    SECTION("Continuous sampling") {
+        REQUIRE(saadc->start_stream(1000, buffer, 32, &collector) == 1000);
+        CHECK(saadc->get_stream_buffer_len() == 16);
+
+        // One stream at a time, and no blocking measurements in between
+        CHECK(saadc->start_stream(1000, buffer, 32, &collector) == 0);
+        CHECK(saadc->start(1) == 0);
+
+        const auto start = sched.now();
+        const auto reads_before = mem.get_op_count(mock::Memory::Op::READ32);
+        const auto writes_before = mem.get_op_count(mock::Memory::Op::WRITE32);
+        while (sched.run_next() && collector.buffers.size() < 4);
+        const auto elapsed = sched.now() - start;
+
+        REQUIRE(collector.buffers.size() == 4);
+        for (unsigned int i = 0; i < collector.buffers.size(); ++i) {
+            CAPTURE(i);
+            CHECK(collector.pointers[i] == buffer + (i % 2) * 16);
+
+            const auto& data = collector.buffers[i];
+            for (unsigned int sample = 0; sample < 8; ++sample) {
+                CAPTURE(sample);
+                CHECK(data[sample * 2] == static_cast<int16_t>(i * 8 + sample));
+                CHECK(data[sample * 2 + 1] == static_cast<int16_t>(2000 + i * 8 + sample));
+            }
+        }
+
+        CHECK(model.get_lost_count() == 0);
+        // 32 sampling periods of 1 ms, with the conversion time of the last one
+        const uint64_t period = 64 * 1000;
+        CHECK(elapsed >= 32 * period);
+        CHECK(elapsed < 33 * period);
+
+        // The samples are triggered and stored by the hardware, the CPU only switches the buffers
+        CHECK(mem.get_op_count(mock::Memory::Op::WRITE32, saadc_base + task_sample) == 0);
+        CHECK(mem.get_op_count(mock::Memory::Op::READ32) - reads_before < 4 * 10);
+        CHECK(mem.get_op_count(mock::Memory::Op::WRITE32) - writes_before < 4 * 10);
+
+        saadc->stop();
+        CHECK_FALSE(model.is_started());
+        CHECK_FALSE(timer.is_running());
+        CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+
+        const auto samples = model.get_sample_count();
+        sched.advance(10 * period);
+        CHECK(model.get_sample_count() == samples);
+        CHECK(collector.buffers.size() == 4);
+
+        // The blocking API is available again, with its own buffer size
+        mem.set_value_at(saadc_base + event_done, 1);
+        CHECK(saadc->start(1) == 1);
+        CHECK(mem.get_value_at(saadc_base + result_maxcnt) == 64);
+    }
+}
+
+TEST_CASE("Test ADC Configuration") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    SaadcSim sim{mem, sched};
+    auto& model = sim.model;
+
+    auto* saadc = driver::ADC::request_by_id(driver::ADC::ID::ADC0);
+    REQUIRE(saadc != nullptr);
+
+    auto get_reg_value = [&mem](uint32_t offset) -> uint32_t {
+        return mem.get_value_at(saadc_base + offset);
+    };
+
+    int16_t buffer[2 * 2 * 8];
+    BufferCollector collector{*saadc};
+
+    SECTION("Channel configuration") {
+        driver::ADC::ChannelConfig config;
+        config.gain = driver::ADC::Gain::GAIN1_4;
+        config.reference = driver::ADC::Reference::VDD_DIV4;
+        // Rounded up to 15 us
+        config.acq_time_us = 12;
+        REQUIRE(saadc->configure_channel(0, config) == 0);
+        CHECK(get_reg_value(chx_config(0)) == ((2 << 8) | (1 << 12) | (3 << 16)));
+
+        config.acq_time_us = 100;
+        CHECK(saadc->configure_channel(0, config) < 0);
+        CHECK(saadc->configure_channel(8, config) < 0);
+
+        CHECK(saadc->set_resolution(14) == 0);
+        CHECK(get_reg_value(saadc_resolution) == 3);
+        CHECK(saadc->set_resolution(8) == 0);
+        CHECK(get_reg_value(saadc_resolution) == 0);
+        CHECK(saadc->set_resolution(9) < 0);
+        CHECK(saadc->set_resolution(16) < 0);
+    }
+
+    SECTION("Oversampling") {
+        // Rounded down to the power of two
+        REQUIRE(saadc->set_oversample(6) == 4);
+        CHECK(get_reg_value(saadc_oversample) == 2);
+        // Each channel is oversampled on a single trigger
+        CHECK((get_reg_value(chx_config(0)) & config_burst) == config_burst);
+        CHECK((get_reg_value(chx_config(2)) & config_burst) == config_burst);
+
+        // Each sample takes 4 conversions of 12 us for each of the two channels
+        CHECK(saadc->start_stream(20000, buffer, 32, &collector) == 0);
+
+        REQUIRE(saadc->start_stream(1000, buffer, 32, &collector) == 1000);
+        CHECK(saadc->set_oversample(1) == 0);
+        while (sched.run_next() && collector.buffers.empty());
+        saadc->stop();
+
+        REQUIRE(collector.buffers.size() == 1);
+        const auto& data = collector.buffers[0];
+        for (unsigned int sample = 0; sample < 8; ++sample) {
+            CAPTURE(sample);
+            // Average of (4 * sample) ... (4 * sample + 3)
+            CHECK(data[sample * 2] == static_cast<int16_t>(4 * sample + 1));
+            CHECK(data[sample * 2 + 1] == static_cast<int16_t>(2000 + 4 * sample + 1));
+        }
+        CHECK(model.get_lost_count() == 0);
+
+        CHECK(saadc->set_oversample(1) == 1);
+        CHECK(get_reg_value(saadc_oversample) == 0);
+        CHECK((get_reg_value(chx_config(0)) & config_burst) == 0);
+    }
+
+    SECTION("Calibration") {
+        REQUIRE(saadc->calibrate() == 0);
+        CHECK(model.get_calibration_count() == 1);
+
+        REQUIRE(saadc->start_stream(1000, buffer, 32, &collector) == 1000);
+        CHECK(saadc->calibrate() < 0);
+        saadc->stop();
+    }
+
+    SECTION("Periodic calibration while streaming") {
+        saadc->set_calibration_interval(2);
+        REQUIRE(saadc->start_stream(1000, buffer, 32, &collector) == 1000);
+        // Calibrated before the first buffer
+        CHECK(model.get_calibration_count() == 1);
+
+        while (sched.run_next() && collector.buffers.size() < 6);
+        // ... and after each two buffers
+        CHECK(model.get_calibration_count() == 3);
+        CHECK(model.is_calibrating());
+        while (sched.run_next() && model.is_calibrating());
+        CHECK(model.get_calibration_count() == 4);
+        saadc->stop();
+
+        // The calibration fits between two samples, none of them are lost
+        REQUIRE(collector.buffers.size() == 6);
+        for (unsigned int i = 0; i < collector.buffers.size(); ++i) {
+            CAPTURE(i);
+            CHECK(collector.pointers[i] == buffer + (i % 2) * 16);
+            for (unsigned int sample = 0; sample < 8; ++sample) {
+                CAPTURE(sample);
+                CHECK(collector.buffers[i][sample * 2] == static_cast<int16_t>(i * 8 + sample));
+            }
+        }
+        CHECK(model.get_lost_count() == 0);
+
+        // Blocking measurements are counted too
+        const auto calibrations = model.get_calibration_count();
+        mem.set_value_at(saadc_base + event_done, 1);
+        saadc->start(1);
+        saadc->start(1);
+        CHECK(model.get_calibration_count() == calibrations);
+        saadc->start(1);
+        CHECK(model.get_calibration_count() == calibrations + 1);
+    }
+
+    // The driver object outlives the test
+    saadc->set_calibration_interval(0);
+    saadc->set_oversample(1);
+    saadc->set_resolution(10);
+    saadc->configure_channel(0, driver::ADC::ChannelConfig());
+}
@@ -0,0 +1,230 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "nrf52_spim_fake.hpp"
+
+#include <algorithm>
+
+#include "nvic.h"
+
+namespace mock {
+
+namespace {
+
+struct FrequencyConfig {
+    uint32_t conf_value;
+    unsigned int freq;
+};
+
+constexpr FrequencyConfig frequencies[] = {
+    { .conf_value = 0x02000000, .freq = 125 * 1000 },
+    { .conf_value = 0x04000000, .freq = 250 * 1000 },
+    { .conf_value = 0x08000000, .freq = 500 * 1000 },
+    { .conf_value = 0x10000000, .freq = 1000 * 1000 },
+    { .conf_value = 0x20000000, .freq = 2 * 1000 * 1000 },
+    { .conf_value = 0x40000000, .freq = 4 * 1000 * 1000 },
+    { .conf_value = 0x80000000, .freq = 8 * 1000 * 1000 },
+};
+
+}  // namespace
+
+void SPISlaveModel::select(bool selected) {
+    if (selected && !selected_) {
+        transactions_.emplace_back();
+    }
+    selected_ = selected;
+}
+
+uint8_t SPISlaveModel::exchange(uint8_t mosi) {
+    if (!selected_) {
+        ++unselected_bytes_;
+        return 0xff;
+    }
+
+    transactions_.back().push_back(mosi);
+    if (miso_.empty()) {
+        return 0xff;
+    }
+
+    const auto byte = miso_.front();
+    miso_.pop_front();
+    return byte;
+}
+
+void SPIMModel::install(Memory& mem, Scheduler& sched) {
+    set_memory(&mem);
+    sched_ = &sched;
+    mem.set_addr_io_handler(base_, base_ + kRegBlockSize, this);
+}
+
+uint32_t SPIMModel::write32(uint32_t addr, uint32_t old_value, uint32_t new_value) {
+    const auto offset = addr - base_;
+    (void)old_value;
+    // Tasks are write only
+    switch (offset) {
+    case kTasksStart:
+        if (new_value & 1) {
+            start();
+        }
+        return 0;
+    case kTasksStop:
+        if (new_value & 1) {
+            if (busy_) {
+                stop_pending_ = true;
+            } else {
+                raise_event(kEventsStopped);
+            }
+        }
+        return 0;
+    case kIntenSet:
+        set_reg(kInten, reg(kInten) | new_value);
+        return reg(kInten);
+    case kIntenClr:
+        set_reg(kInten, reg(kInten) & ~new_value);
+        return reg(kInten);
+    default:
+        break;
+    }
+
+    return new_value;
+}
+
+uint32_t SPIMModel::read32(uint32_t addr, uint32_t value) {
+    const auto offset = addr - base_;
+    if (offset == kIntenSet || offset == kIntenClr) {
+        return reg(kInten);
+    }
+
+    return value;
+}
+
+unsigned int SPIMModel::get_frequency() const {
+    const auto conf_value = reg(kFrequency);
+    for (const auto& config : frequencies) {
+        if (config.conf_value == conf_value) {
+            return config.freq;
+        }
+    }
+
+    return 0;
+}
+
+Scheduler::Cycles SPIMModel::get_byte_cycles() const {
+    const auto freq = get_frequency();
+    if (!freq) {
+        // Nothing is going to be transferred with the broken configuration
+        return ~Scheduler::Cycles{0} / 2;
+    }
+
+    return (kCpuFrequency * kBitsPerByte + freq - 1) / freq;
+}
+
+void SPIMModel::raise_event(uint32_t offset) {
+    set_reg(offset, 1);
+    if (event_listener_) {
+        event_listener_(base_ + offset);
+    }
+
+    if (offset == kEventsEnd && (reg(kShorts) & kShortEndStart)) {
+        start();
+    }
+
+    const uint32_t event_mask = 1 << ((offset - 0x100) / 4);
+    if ((reg(kInten) & event_mask) && !irq_pending_) {
+        // Several events raised at the same time result in a single interrupt
+        irq_pending_ = true;
+        sched_->schedule_in(0, [this]() {
+            irq_pending_ = false;
+            nvic_dispatch(irq_n_);
+        });
+    }
+}
+
+void SPIMModel::start() {
+    if (busy_) {
+        return;
+    }
+
+    // MAXCNT registers are 8 bits wide on nRF52832
+    tx_ptr_ = static_cast<const uint8_t*>(get_mem_ptr(base_ + kTxdPtr));
+    tx_maxcnt_ = reg(kTxdMaxCnt) & 0xff;
+    if (tx_ptr_ && !is_dma_accessible(tx_ptr_, tx_maxcnt_)) {
+        tx_ptr_ = nullptr;
+    }
+    rx_ptr_ = static_cast<uint8_t*>(get_mem_ptr(base_ + kRxdPtr));
+    rx_maxcnt_ = reg(kRxdMaxCnt) & 0xff;
+    if (rx_ptr_ && !is_dma_accessible(rx_ptr_, rx_maxcnt_)) {
+        rx_ptr_ = nullptr;
+    }
+
+    // The next transfer of the list uses the next item
+    if (reg(kTxdList) == 1) {
+        set_mem_ptr(base_ + kTxdPtr, tx_ptr_ ? const_cast<uint8_t*>(tx_ptr_) + tx_maxcnt_ : nullptr);
+    }
+    if (reg(kRxdList) == 1) {
+        set_mem_ptr(base_ + kRxdPtr, rx_ptr_ ? rx_ptr_ + rx_maxcnt_ : nullptr);
+    }
+
+    busy_ = true;
+    stop_pending_ = false;
+    count_ = 0;
+    ++start_count_;
+    raise_event(kEventsStarted);
+    next_byte();
+}
+
+void SPIMModel::next_byte() {
+    if (stop_pending_) {
+        busy_ = false;
+        stop_pending_ = false;
+        set_reg(kTxdAmount, std::min(count_, tx_maxcnt_));
+        set_reg(kRxdAmount, std::min(count_, rx_maxcnt_));
+        raise_event(kEventsStopped);
+        return;
+    }
+
+    if (count_ == std::max(tx_maxcnt_, rx_maxcnt_)) {
+        end();
+        return;
+    }
+
+    sched_->schedule_in(get_byte_cycles(), [this]() {
+        byte_done();
+    });
+}
+
+void SPIMModel::byte_done() {
+    const uint8_t mosi = (count_ < tx_maxcnt_ && tx_ptr_) ? tx_ptr_[count_] : reg(kOrc) & 0xff;
+    const uint8_t miso = slave_ ? slave_->exchange(mosi) : 0xff;
+    if (count_ < rx_maxcnt_ && rx_ptr_) {
+        rx_ptr_[count_] = miso;
+    }
+
+    ++count_;
+    next_byte();
+}
+
+void SPIMModel::end() {
+    set_reg(kTxdAmount, tx_maxcnt_);
+    set_reg(kRxdAmount, rx_maxcnt_);
+    busy_ = false;
+
+    raise_event(kEventsEndRx);
+    raise_event(kEventsEndTx);
+    raise_event(kEventsEnd);
+}
+
+}  // namespace mock
@@ -0,0 +1,233 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/**
+ * @file
+ *
+ * Behavioral model of nRF52 SPIM (SPI master with EasyDMA) and of the SPI slave devices.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+
+namespace mock {
+
+/**
+ * @brief SPI slave, recording the bytes written by the master.
+ *
+ * The bytes clocked while the slave is selected are recorded as one transaction
+ * per selection. The slave answers with the bytes pushed by push_miso(), and with 0xff
+ * when there are none left. The bytes clocked while the slave is not selected are
+ * only counted.
+ */
+class SPISlaveModel {
+    public:
+        virtual ~SPISlaveModel() {}
+
+        /**
+         * @brief Called when the chip select line changes.
+         */
+        virtual void select(bool selected);
+
+        /**
+         * @brief Called for each byte clocked by the master.
+         *
+         * @return The byte on MISO line.
+         */
+        virtual uint8_t exchange(uint8_t mosi);
+
+        bool is_selected() const {
+            return selected_;
+        }
+
+        void push_miso(const std::vector<uint8_t>& data) {
+            miso_.insert(miso_.end(), data.begin(), data.end());
+        }
+
+        /**
+         * @brief MOSI bytes of each selection.
+         */
+        const std::vector<std::vector<uint8_t>>& get_transactions() const {
+            return transactions_;
+        }
+
+        size_t get_unselected_bytes() const {
+            return unselected_bytes_;
+        }
+
+    private:
+        bool selected_ = false;
+        std::deque<uint8_t> miso_;
+        std::vector<std::vector<uint8_t>> transactions_;
+        size_t unselected_bytes_ = 0;
+};
+
+/**
+ * @brief SPIM device model.
+ *
+ * The model handles the whole register block of the peripheral and uses the virtual time
+ * of the Scheduler to transfer the data at the configured frequency, 8 SCK cycles per byte.
+ *
+ * - TASKS_START raises STARTED and clocks the larger of TXD.MAXCNT and RXD.MAXCNT bytes.
+ *   The bytes past TXD.MAXCNT are sent as ORC, the bytes past RXD.MAXCNT are dropped.
+ *   ENDRX, ENDTX and END are raised together after the last byte.
+ * - TASKS_STOP stops the transfer after the current byte, and raises STOPPED.
+ * - With TXD.LIST or RXD.LIST set to ArrayList the pointer is incremented by MAXCNT
+ *   on each start.
+ * - END_START shortcut, INTEN, INTENSET and INTENCLR are supported. The enabled events
+ *   are dispatched to the interrupt handler through nvic_dispatch().
+ *
+ * The chip select is not a part of SPIM, the slave is selected by the test,
+ * e.g. from GPIOTEModel's pin listener.
+ */
+class SPIMModel : public IOHandlerStub {
+    public:
+        static constexpr uint64_t kCpuFrequency = 64 * 1000 * 1000;
+        static constexpr unsigned kBitsPerByte = 8;
+
+        // Register offsets
+        static constexpr uint32_t kTasksStart = 0x010;
+        static constexpr uint32_t kTasksStop = 0x014;
+
+        static constexpr uint32_t kEventsStopped = 0x104;
+        static constexpr uint32_t kEventsEndRx = 0x110;
+        static constexpr uint32_t kEventsEnd = 0x118;
+        static constexpr uint32_t kEventsEndTx = 0x120;
+        static constexpr uint32_t kEventsStarted = 0x14c;
+
+        static constexpr uint32_t kShorts = 0x200;
+        static constexpr uint32_t kShortEndStart = (1 << 17);
+
+        static constexpr uint32_t kInten = 0x300;
+        static constexpr uint32_t kIntenSet = 0x304;
+        static constexpr uint32_t kIntenClr = 0x308;
+
+        static constexpr uint32_t kEnable = 0x500;
+        static constexpr uint32_t kPselSck = 0x508;
+        static constexpr uint32_t kPselMosi = 0x50c;
+        static constexpr uint32_t kPselMiso = 0x510;
+        static constexpr uint32_t kFrequency = 0x524;
+        static constexpr uint32_t kRxdPtr = 0x534;
+        static constexpr uint32_t kRxdMaxCnt = 0x538;
+        static constexpr uint32_t kRxdAmount = 0x53c;
+        static constexpr uint32_t kRxdList = 0x540;
+        static constexpr uint32_t kTxdPtr = 0x544;
+        static constexpr uint32_t kTxdMaxCnt = 0x548;
+        static constexpr uint32_t kTxdAmount = 0x54c;
+        static constexpr uint32_t kTxdList = 0x550;
+        static constexpr uint32_t kConfig = 0x554;
+        static constexpr uint32_t kOrc = 0x5c0;
+
+        static constexpr uint32_t kRegBlockSize = 0x1000;
+
+        /**
+         * @param base Base address of the peripheral.
+         * @param irq_n Interrupt number for the enabled events.
+         */
+        SPIMModel(uint32_t base, int irq_n) : base_{base}, irq_n_{irq_n} {}
+
+        /**
+         * @brief Register the model as the IO handler for the peripheral's registers.
+         *
+         * The memory should be reset before that. The model needs virtual time,
+         * so the scheduler should be attached to the memory.
+         */
+        void install(Memory& mem, Scheduler& sched);
+
+        uint32_t write32(uint32_t addr, uint32_t old_value, uint32_t new_value) override;
+        uint32_t read32(uint32_t addr, uint32_t value) override;
+
+        /**
+         * @brief Set the function to be called with the address of every event raised.
+         *
+         * E.g. to connect the model to PPIModel::event_raised().
+         */
+        void set_event_listener(std::function<void(uint32_t)> listener) {
+            event_listener_ = std::move(listener);
+        }
+
+        /**
+         * @brief Connect the slave to the bus. The slave must outlive the model.
+         */
+        void set_slave(SPISlaveModel* slave) {
+            slave_ = slave;
+        }
+
+        /**
+         * @brief SCK frequency for the value in FREQUENCY register.
+         *
+         * Returns 0 for unsupported values.
+         */
+        unsigned int get_frequency() const;
+
+        /**
+         * @brief Duration of one byte on the bus in CPU cycles at the current frequency.
+         */
+        Scheduler::Cycles get_byte_cycles() const;
+
+        bool is_busy() const {
+            return busy_;
+        }
+
+        /**
+         * @brief Number of the transfers started.
+         */
+        unsigned int get_start_count() const {
+            return start_count_;
+        }
+
+    private:
+        uint32_t reg(uint32_t offset) const {
+            return get_mem_value(base_ + offset);
+        }
+
+        void set_reg(uint32_t offset, uint32_t value) {
+            set_mem_value(base_ + offset, value);
+        }
+
+        void raise_event(uint32_t offset);
+
+        void start();
+        void next_byte();
+        void byte_done();
+        void end();
+
+        const uint32_t base_;
+        const int irq_n_;
+        Scheduler* sched_ = nullptr;
+        bool irq_pending_ = false;
+        std::function<void(uint32_t)> event_listener_;
+        SPISlaveModel* slave_ = nullptr;
+
+        bool busy_ = false;
+        bool stop_pending_ = false;
+        const uint8_t* tx_ptr_ = nullptr;
+        uint32_t tx_maxcnt_ = 0;
+        uint8_t* rx_ptr_ = nullptr;
+        uint32_t rx_maxcnt_ = 0;
+        uint32_t count_ = 0;
+
+        unsigned int start_count_ = 0;
+};
+
+}  // namespace mock
@@ -0,0 +1,250 @@
+#include "third_party/catch2/catch.hpp"
+
+#include <vector>
+
+#include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+#include "nrf52_gpiote_fake.hpp"
+#include "nrf52_ppi_fake.hpp"
+#include "nrf52_spim_fake.hpp"
+#include "nrf52_timer_fake.hpp"
+
+#include "driver/spi.hpp"
+#include "nrf52/timer.hpp"
+
+namespace {
+
+constexpr uint32_t spim0_base = 0x40003000;
+constexpr uint32_t spim2_base = 0x40023000;
+
+#define REGISTER(name, off) \
+    constexpr uint32_t name(uint32_t base) {\
+        return base + (off);\
+    }
+
+REGISTER(psel_sck, 0x508);
+REGISTER(psel_mosi, 0x50c);
+REGISTER(psel_miso, 0x510);
+REGISTER(spim_config, 0x554);
+
+struct XferCounter : public driver::EventHandler {
+    void handle_event(driver::EventInfo* e_info) override {
+        events.push_back(e_info->evt_id);
+        data = e_info->data;
+        times.push_back(sched->now());
+    }
+
+    mock::Scheduler* sched = nullptr;
+    std::vector<int> events;
+    const void* data = nullptr;
+    std::vector<mock::Scheduler::Cycles> times;
+};
+
+}  // namespace
+
+TEST_CASE("Test SPIM Request") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+
+    SECTION("SPIM0") {
+        auto* spi = driver::SPI::request_by_id(driver::SPI::ID::SPIM0);
+        REQUIRE(spi != nullptr);
+
+        // Pin number values are taken from nrf52_board_fake
+        CHECK(mem.get_value_at(psel_sck(spim0_base)) == 25);
+        CHECK(mem.get_value_at(psel_mosi(spim0_base)) == 26);
+        CHECK(mem.get_value_at(psel_miso(spim0_base)) == 27);
+        spi->release();
+    }
+
+    SECTION("SPIM2") {
+        auto* spi = driver::SPI::request_by_id(driver::SPI::ID::SPIM2);
+        REQUIRE(spi != nullptr);
+
+        CHECK(mem.get_value_at(psel_sck(spim2_base)) == 19);
+        CHECK(mem.get_value_at(psel_mosi(spim2_base)) == 20);
+        CHECK(mem.get_value_at(psel_miso(spim2_base)) == 0xffffffff);
+    }
+
+    SECTION("Not configured") {
+        CHECK(driver::SPI::request_by_id(driver::SPI::ID::SPIM1) == nullptr);
+    }
+}
+
+TEST_CASE("Test SPIM Transfers") {
+    // The first free TIMER counts the items
+    constexpr uint32_t timer0_base = 0x40008000;
+    constexpr unsigned int kCsPin = 28;
+
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    mock::SPIMModel model{spim0_base, 3};
+    model.install(mem, sched);
+    mock::PPIModel ppi;
+    ppi.install(mem);
+    mock::TimerModel counter{timer0_base};
+    counter.install(mem);
+    mock::GPIOTEModel gpiote;
+    gpiote.install(mem);
+    model.set_event_listener([&ppi](uint32_t addr) {
+        ppi.event_raised(addr);
+    });
+    counter.set_event_listener([&ppi](uint32_t addr) {
+        ppi.event_raised(addr);
+    });
+
+    mock::SPISlaveModel flash;
+    model.set_slave(&flash);
+    gpiote.set_pin_listener([&flash](unsigned int pin, bool high) {
+        if (pin == kCsPin) {
+            flash.select(!high);
+        }
+    });
+
+    auto* spi = driver::SPI::request_by_id(driver::SPI::ID::SPIM0);
+    REQUIRE(spi != nullptr);
+    CHECK(spi->set_frequency(10 * 1000 * 1000) == 8 * 1000 * 1000);
+    CHECK(spi->set_frequency(3 * 1000 * 1000) == 2 * 1000 * 1000);
+    CHECK(spi->set_frequency(100 * 1000) == 0);
+    CHECK(spi->set_frequency(8 * 1000 * 1000) == 8 * 1000 * 1000);
+    CHECK(model.get_frequency() == 8 * 1000 * 1000);
+    const auto byte_cycles = model.get_byte_cycles();
+
+    CHECK(spi->set_mode(driver::SPI::Mode::MODE3) == 0);
+    CHECK(mem.get_value_at(spim_config(spim0_base)) == 6);
+    CHECK(spi->set_mode(driver::SPI::Mode::MODE0) == 0);
+    CHECK(mem.get_value_at(spim_config(spim0_base)) == 0);
+
+    XferCounter handler;
+    handler.sched = &sched;
+    // The register accesses of the driver, before the first byte and after the last one
+    constexpr mock::Scheduler::Cycles kDriverCycles = 64;
+
+    SECTION("Command and response") {
+        const uint8_t cmd[] = {0x9f};
+        uint8_t id[4] = {};
+        flash.push_miso({0x00, 0xef, 0x40, 0x18});
+
+        const auto start = sched.now();
+        REQUIRE(spi->transfer(cmd, sizeof(cmd), id, sizeof(id), &handler) == 0);
+        CHECK(spi->is_busy());
+        CHECK(flash.is_selected());
+        CHECK(spi->transfer(cmd, sizeof(cmd), id, sizeof(id), &handler) < 0);
+        while (sched.run_next());
+
+        REQUIRE(handler.events.size() == 1);
+        CHECK(handler.events[0] == driver::SPI::Event::XFER_DONE);
+        CHECK(handler.data == id);
+        CHECK_FALSE(spi->is_busy());
+        CHECK(handler.times[0] - start - 4 * byte_cycles < kDriverCycles);
+
+        // The larger of the buffers is clocked, in a single selection
+        REQUIRE(flash.get_transactions().size() == 1);
+        REQUIRE(flash.get_transactions()[0].size() == 4);
+        CHECK(flash.get_transactions()[0][0] == 0x9f);
+        CHECK(std::vector<uint8_t>(id, id + sizeof(id)) == std::vector<uint8_t>({0x00, 0xef, 0x40, 0x18}));
+
+        // The chip select is released, the channels are returned
+        CHECK(gpiote.get_pin_level(kCsPin));
+        CHECK_FALSE(flash.is_selected());
+        CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+    }
+
+    SECTION("Long transfer in chunks") {
+        std::vector<uint8_t> page(600);
+        for (size_t i = 0; i < page.size(); ++i) {
+            page[i] = i * 7;
+        }
+
+        const auto start = sched.now();
+        REQUIRE(spi->transfer(page.data(), page.size(), nullptr, 0, &handler) == 0);
+        while (sched.run_next());
+
+        REQUIRE(handler.events.size() == 1);
+        CHECK(model.get_start_count() == 3);
+        REQUIRE(flash.get_transactions().size() == 1);
+        CHECK(flash.get_transactions()[0] == page);
+        CHECK(flash.get_unselected_bytes() == 0);
+        CHECK_FALSE(flash.is_selected());
+
+        // Each chunk is started from the interrupt of the previous one
+        CHECK(handler.times[0] - start - page.size() * byte_cycles < 3 * kDriverCycles);
+    }
+
+    SECTION("Stream") {
+        constexpr size_t kLineSize = 4;
+        constexpr size_t kLines = 8;
+        std::vector<uint8_t> lines(kLineSize * kLines);
+        for (size_t i = 0; i < lines.size(); ++i) {
+            lines[i] = i + 1;
+        }
+        std::vector<uint8_t> status(kLines * 2, 0);
+        std::vector<uint8_t> miso;
+        for (size_t i = 0; i < kLines * kLineSize; ++i) {
+            miso.push_back(0x80 | i);
+        }
+        flash.push_miso(miso);
+
+        const auto start = sched.now();
+        REQUIRE(spi->stream(lines.data(), kLineSize, status.data(), 2, kLines, &handler) == 0);
+        CHECK(spi->stream(lines.data(), kLineSize, status.data(), 2, kLines, &handler) < 0);
+        while (sched.run_next());
+
+        // The items follow each other in a single selection, restarted by the hardware
+        REQUIRE(handler.events.size() == 1);
+        CHECK(handler.events[0] == driver::SPI::Event::XFER_DONE);
+        CHECK(handler.data == status.data());
+        CHECK(model.get_start_count() == kLines);
+        REQUIRE(flash.get_transactions().size() == 1);
+        CHECK(flash.get_transactions()[0] == lines);
+        CHECK(handler.times[0] - start - lines.size() * byte_cycles < kDriverCycles);
+
+        // First two bytes of each item
+        for (size_t i = 0; i < kLines; ++i) {
+            CHECK(status[2 * i] == miso[kLineSize * i]);
+            CHECK(status[2 * i + 1] == miso[kLineSize * i + 1]);
+        }
+
+        // The chip select is released after the last item, the counter is stopped
+        CHECK(gpiote.get_pin_level(kCsPin));
+        CHECK(flash.get_unselected_bytes() == 0);
+        CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+        CHECK_FALSE(counter.is_running());
+
+        // Single item doesn't need the chain
+        REQUIRE(spi->stream(lines.data(), kLineSize, nullptr, 0, 1, &handler) == 0);
+        while (sched.run_next());
+        REQUIRE(handler.events.size() == 2);
+        REQUIRE(flash.get_transactions().size() == 2);
+        CHECK(flash.get_transactions()[1] == std::vector<uint8_t>(lines.begin(), lines.begin() + kLineSize));
+        CHECK_FALSE(flash.is_selected());
+    }
+
+    SECTION("Rejected") {
+        uint8_t data[300] = {};
+        CHECK(spi->transfer(nullptr, 0, nullptr, 0, &handler) < 0);
+        CHECK(spi->stream(data, sizeof(data), nullptr, 0, 1, &handler) < 0);
+        CHECK(spi->stream(data, 4, nullptr, 0, 0, &handler) < 0);
+
+        // No counter for the items while the other drivers hold all the TIMERs
+        auto* pool = nrf52::TimerPool::request();
+        std::vector<int> timers;
+        for (int id = pool->alloc(); id >= 0; id = pool->alloc()) {
+            timers.push_back(id);
+        }
+        CHECK(spi->stream(data, 4, nullptr, 0, 8, &handler) < 0);
+        CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+        for (auto id : timers) {
+            pool->free(id);
+        }
+
+        CHECK_FALSE(spi->is_busy());
+        CHECK(handler.events.empty());
+    }
+
+    spi->release();
+}
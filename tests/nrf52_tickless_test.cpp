@@ -0,0 +1,130 @@
+#include "third_party/catch2/catch.hpp"
+
+#include "mock_memio.hpp"
+#include "nrf52_rtc_fake.hpp"
+
+#include "nvic.h"
+#include "core/tickless.hpp"
+#include "driver/timer.hpp"
+
+namespace {
+
+constexpr uint32_t clock_base = 0x40000000;
+constexpr uint32_t rtc0_base = 0x4000b000;
+constexpr uint32_t scb_scr = 0xe000ed10;
+
+class TickCounter : public driver::EventHandler {
+    public:
+        void handle_event(driver::EventInfo* e_info) override {
+            (void)e_info;
+            ++ticks;
+        }
+
+        int ticks = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Tickless idle on RTC") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    mem.set_value_at(clock_base + 0x104, 1);
+    mem.set_value_at(clock_base + 0x418, (1 << 16) | 1);
+
+    mock::RTCModel model{rtc0_base};
+    model.install(mem);
+
+    auto* rtc = driver::Timer::request_by_id(driver::Timer::ID::RTC0);
+    REQUIRE(rtc != nullptr);
+    REQUIRE(rtc->get_num_channels() == 3);
+    CHECK(rtc->get_counter_mask() == 0xffffff);
+    CHECK(rtc->get_compare_event(1) == 17);
+    CHECK(rtc->get_compare_event(3) < 0);
+    CHECK(rtc->set_compare(3, 0) < 0);
+
+    TickCounter tick_handler;
+    os::TicklessIdle idle{&tick_handler};
+    CHECK(idle.init(rtc, 3) < 0);
+    REQUIRE(idle.init(rtc, 1) == 0);
+    CHECK((mem.get_value_at(scb_scr) & (1 << 4)) != 0);
+
+    rtc->add_event_handler(0, &tick_handler);
+    rtc->enable_tick_interrupt();
+    rtc->start();
+    REQUIRE(model.is_running());
+
+    constexpr uint32_t kCompare1 = (1 << 17);
+
+    SECTION("Regular ticks") {
+        model.advance(3);
+        nvic_dispatch(rtc->get_irq_num());
+        CHECK(tick_handler.ticks == 1);
+    }
+
+    SECTION("Woken up by the compare channel") {
+        model.set_counter(0xfffff0);
+        REQUIRE(idle.suppress(100));
+        CHECK(mem.get_value_at(rtc0_base + 0x544) == ((0xfffff0 + 100) & 0xffffff));
+        CHECK((model.get_inten() & 1) == 0);
+        CHECK((model.get_inten() & kCompare1) == kCompare1);
+
+        // No ticks while sleeping
+        model.advance(100);
+        CHECK(mem.get_value_at(rtc0_base + 0x100) == 0);
+        CHECK(mem.get_value_at(rtc0_base + 0x144) == 1);
+
+        CHECK(idle.resume() == 99);
+        CHECK((model.get_inten() & 1) == 1);
+
+        // The compare event is the last tick
+        nvic_dispatch(rtc->get_irq_num());
+        CHECK(tick_handler.ticks == 1);
+        CHECK((model.get_inten() & kCompare1) == 0);
+
+        // Back to the regular ticks, the compare channel doesn't fire again
+        model.advance(1);
+        nvic_dispatch(rtc->get_irq_num());
+        CHECK(tick_handler.ticks == 2);
+        CHECK(mem.get_value_at(rtc0_base + 0x100) == 0);
+    }
+
+    SECTION("Woken up by another interrupt") {
+        model.set_counter(0x1000);
+        REQUIRE(idle.suppress(100));
+        model.advance(30);
+        CHECK(idle.resume() == 30);
+        CHECK((model.get_inten() & kCompare1) == 0);
+        CHECK((model.get_inten() & 1) == 1);
+
+        // The compare channel is rearmed by the next sleep, without the stale event
+        model.advance(70);
+        CHECK(mem.get_value_at(rtc0_base + 0x144) == 1);
+        REQUIRE(idle.suppress(10));
+        CHECK(mem.get_value_at(rtc0_base + 0x144) == 0);
+        CHECK(idle.resume() == 0);
+    }
+
+    SECTION("Late wakeup") {
+        REQUIRE(idle.suppress(10));
+        model.advance(15);
+        CHECK(idle.resume() == 9);
+        nvic_dispatch(rtc->get_irq_num());
+        CHECK(tick_handler.ticks == 1);
+    }
+
+    SECTION("Too short or too long") {
+        CHECK_FALSE(idle.suppress(1));
+        CHECK((model.get_inten() & 1) == 1);
+        CHECK((model.get_inten() & kCompare1) == 0);
+
+        const auto start = model.get_counter();
+        REQUIRE(idle.suppress(0xffffffff));
+        CHECK(mem.get_value_at(rtc0_base + 0x544) == ((start + idle.get_max_sleep_ticks()) & 0xffffff));
+        CHECK(idle.resume() == 0);
+    }
+
+    rtc->disable_interrupts(kCompare1);
+    rtc->disable_tick_interrupt();
+    rtc->stop();
+    rtc->release();
+}
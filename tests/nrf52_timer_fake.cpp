@@ -0,0 +1,199 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "nrf52_timer_fake.hpp"
+
+#include "cutils.h"
+
+namespace mock {
+
+void TimerModel::install(Memory& mem) {
+    mem.set_addr_io_handler(base_, base_ + kRegBlockSize, this);
+}
+
+void TimerModel::install(Memory& mem, Scheduler& sched) {
+    sched_ = &sched;
+    origin_ = sched.now();
+    install(mem);
+}
+
+uint32_t TimerModel::bit_mask() const {
+    switch (reg(kBitMode) & 3) {
+    case 0:
+        return 0xffff;
+    case 1:
+        return 0xff;
+    case 2:
+        return 0xffffff;
+    default:
+        return 0xffffffff;
+    }
+}
+
+bool TimerModel::is_timer_mode() const {
+    return reg(kMode) == kModeTimer;
+}
+
+Scheduler::Cycles TimerModel::get_tick_cycles() const {
+    const auto prescaler = MIN(reg(kPrescaler) & 0xf, 9u);
+    return (kCpuFrequency / kBaseFrequency) << prescaler;
+}
+
+uint32_t TimerModel::get_counter() const {
+    auto counter = counter_;
+    if (sched_ && running_ && is_timer_mode()) {
+        counter += (sched_->now() - origin_) / get_tick_cycles();
+    }
+
+    return counter & bit_mask();
+}
+
+void TimerModel::sync() {
+    if (!sched_) {
+        return;
+    }
+
+    if (running_ && is_timer_mode()) {
+        const auto tick = get_tick_cycles();
+        const auto ticks = (sched_->now() - origin_) / tick;
+        counter_ += ticks;
+        origin_ += ticks * tick;
+    } else {
+        origin_ = sched_->now();
+    }
+}
+
+void TimerModel::schedule_compare() {
+    if (!sched_) {
+        return;
+    }
+
+    sched_->cancel(compare_event_);
+    if (!running_ || !is_timer_mode()) {
+        return;
+    }
+
+    sync();
+    const uint64_t mask = bit_mask();
+    const auto counter = counter_ & mask;
+    // Full wrap around, if the counter is already at CC[n]
+    uint64_t ticks = mask + 1;
+    for (unsigned int n = 0; n < kNumCC; ++n) {
+        const uint64_t delta = (reg(kCC + n * 4) - counter) & mask;
+        if (delta) {
+            ticks = MIN(ticks, delta);
+        }
+    }
+
+    compare_event_ = sched_->schedule_at(origin_ + ticks * get_tick_cycles(), [this]() {
+        compare_reached();
+    });
+}
+
+void TimerModel::compare_reached() {
+    sync();
+    const auto mask = bit_mask();
+    const auto counter = counter_ & mask;
+    const auto shorts = reg(kShorts);
+    bool clear = false;
+    bool stop = false;
+    for (unsigned int n = 0; n < kNumCC; ++n) {
+        if ((reg(kCC + n * 4) & mask) != counter) {
+            continue;
+        }
+
+        clear |= shorts & (kShortCompareClear << n);
+        stop |= shorts & (kShortCompareStop << n);
+        set_mem_value(base_ + kEventsCompare + n * 4, 1);
+        if (event_listener_) {
+            event_listener_(base_ + kEventsCompare + n * 4);
+        }
+    }
+
+    if (clear) {
+        counter_ = 0;
+    }
+    if (stop) {
+        running_ = false;
+    }
+
+    schedule_compare();
+}
+
+uint32_t TimerModel::write32(uint32_t addr, uint32_t old_value, uint32_t new_value) {
+    const auto offset = addr - base_;
+    if (offset >= kTasksCapture && offset < kTasksCapture + kNumCC * 4) {
+        if (new_value & 1) {
+            set_mem_value(base_ + kCC + (offset - kTasksCapture), get_counter());
+            schedule_compare();
+        }
+        return 0;
+    }
+
+    switch (offset) {
+    case kTasksStart:
+        if ((new_value & 1) && !running_) {
+            sync();
+            running_ = true;
+            schedule_compare();
+        }
+        return 0;
+    case kTasksStop:
+        if (new_value & 1) {
+            sync();
+            running_ = false;
+            schedule_compare();
+        }
+        return 0;
+    case kTasksCount:
+        if ((new_value & 1) && running_ && !is_timer_mode()) {
+            ++counter_;
+            for (unsigned int n = 0; n < kNumCC; ++n) {
+                if ((reg(kCC + n * 4) & bit_mask()) == get_counter()) {
+                    compare_reached();
+                    break;
+                }
+            }
+        }
+        return 0;
+    case kTasksClear:
+        if (new_value & 1) {
+            sync();
+            counter_ = 0;
+            schedule_compare();
+        }
+        return 0;
+    case kMode:
+    case kBitMode:
+    case kPrescaler:
+        sync();
+        set_mem_value(addr, new_value);
+        schedule_compare();
+        return new_value;
+    default:
+        break;
+    }
+
+    if (offset >= kCC && offset < kCC + kNumCC * 4) {
+        set_mem_value(addr, new_value);
+        schedule_compare();
+    }
+
+    (void)old_value;
+    return new_value;
+}
+
+}  // namespace mock
@@ -0,0 +1,123 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/**
+ * @file
+ *
+ * Behavioral model of nRF52 TIMER.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+
+namespace mock {
+
+/**
+ * @brief TIMER model.
+ *
+ * In the counter modes TASKS_COUNT increments the counter while the timer is running.
+ * In the timer mode the counter runs on the virtual time of the Scheduler, at 16 MHz
+ * divided by 2^PRESCALER, when the model is installed with one.
+ *
+ * TASKS_CAPTURE[n] copies the counter into CC[n]. When the counter reaches CC[n],
+ * COMPARE[n] event is raised, and COMPARE[n]_CLEAR and COMPARE[n]_STOP shortcuts
+ * are applied. Interrupts are not modelled.
+ */
+class TimerModel : public IOHandlerStub {
+    public:
+        static constexpr unsigned int kNumCC = 6;
+
+        static constexpr uint32_t kTasksStart = 0x000;
+        static constexpr uint32_t kTasksStop = 0x004;
+        static constexpr uint32_t kTasksCount = 0x008;
+        static constexpr uint32_t kTasksClear = 0x00c;
+        static constexpr uint32_t kTasksCapture = 0x040;
+        static constexpr uint32_t kEventsCompare = 0x140;
+        static constexpr uint32_t kShorts = 0x200;
+        static constexpr uint32_t kMode = 0x504;
+        static constexpr uint32_t kBitMode = 0x508;
+        static constexpr uint32_t kPrescaler = 0x510;
+        static constexpr uint32_t kCC = 0x540;
+
+        static constexpr uint32_t kModeTimer = 0;
+        static constexpr uint32_t kShortCompareClear = (1 << 0);
+        static constexpr uint32_t kShortCompareStop = (1 << 8);
+
+        static constexpr uint64_t kCpuFrequency = 64 * 1000 * 1000;
+        static constexpr uint64_t kBaseFrequency = 16 * 1000 * 1000;
+
+        static constexpr uint32_t kRegBlockSize = 0x1000;
+
+        explicit TimerModel(uint32_t base) : base_{base} {}
+
+        /**
+         * @brief Register the model as the IO handler for the timer's registers.
+         */
+        void install(Memory& mem);
+
+        /**
+         * @brief Same as above, the timer mode will be using the virtual time.
+         */
+        void install(Memory& mem, Scheduler& sched);
+
+        uint32_t write32(uint32_t addr, uint32_t old_value, uint32_t new_value) override;
+
+        /**
+         * @brief Set the function to be called with the address of every event raised.
+         *
+         * E.g. to connect the model to PPIModel::event_raised().
+         */
+        void set_event_listener(std::function<void(uint32_t)> listener) {
+            event_listener_ = std::move(listener);
+        }
+
+        uint32_t get_counter() const;
+
+        bool is_running() const {
+            return running_;
+        }
+
+    private:
+        uint32_t reg(uint32_t offset) const {
+            return get_mem_value(base_ + offset);
+        }
+
+        uint32_t bit_mask() const;
+        bool is_timer_mode() const;
+        Scheduler::Cycles get_tick_cycles() const;
+
+        // Bring counter_ up to date with the virtual time
+        void sync();
+        void schedule_compare();
+        void compare_reached();
+
+        const uint32_t base_;
+        Scheduler* sched_ = nullptr;
+        std::function<void(uint32_t)> event_listener_;
+
+        bool running_ = false;
+        uint32_t counter_ = 0;
+        // Time of the last tick counted in counter_
+        Scheduler::Cycles origin_ = 0;
+        Scheduler::EventId compare_event_ = 0;
+};
+
+}  // namespace mock
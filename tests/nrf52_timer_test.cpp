@@ -16,10 +16,17 @@
 
 #include "third_party/catch2/catch.hpp"
 
+#include <vector>
+
 #include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+#include "nrf52_gpiote_fake.hpp"
+#include "nrf52_ppi_fake.hpp"
+#include "nrf52_timer_fake.hpp"
 
 #include "nvic.h"
 #include "driver/timer.hpp"
+#include "nrf52/timer.hpp"
 
 namespace {
 
@@ -33,6 +40,15 @@ const uint32_t timer_base[] = {
 
 const int timer_irq[] = {8, 9, 10, 26, 27};
 
+class DummyEventHandler : public driver::EventHandler {
+    public:
+        void handle_event(driver::EventInfo* e_info) override {
+            evt_ids.push_back(e_info->evt_id);
+        }
+
+        std::vector<int> evt_ids;
+};
+
 const driver::Timer::ID timer_id[] = {
     driver::Timer::ID::TIMER0,
     driver::Timer::ID::TIMER1,
@@ -100,6 +116,190 @@ TEST_CASE("Timer API") {
             // Request even larger rate
             new_rate = timer->request_rate(23'000'000);
             CHECK(new_rate == 16'000'000);
+
+            timer->release();
+        }
+    }
+}
+
+TEST_CASE("Timer pool") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+
+    auto* pool = nrf52::TimerPool::request();
+    auto* timer0 = driver::Timer::request_by_id(driver::Timer::ID::TIMER0);
+    REQUIRE(timer0 != nullptr);
+    CHECK(driver::Timer::request_by_id(driver::Timer::ID::TIMER0) == timer0);
+
+    // The drivers get the TIMERs nobody else uses
+    const int counter = pool->alloc();
+    CHECK(counter == 9);
+    CHECK(driver::Timer::request_by_id(driver::Timer::ID::TIMER1) == nullptr);
+    CHECK(pool->reserve(9) < 0);
+    CHECK(pool->reserve(11) < 0);
+    pool->free(counter);
+    auto* timer1 = driver::Timer::request_by_id(driver::Timer::ID::TIMER1);
+    REQUIRE(timer1 != nullptr);
+
+    std::vector<int> allocated;
+    for (int id = pool->alloc(); id >= 0; id = pool->alloc()) {
+        allocated.push_back(id);
+    }
+    CHECK(allocated == std::vector<int>{10, 26, 27});
+    for (auto id : allocated) {
+        pool->free(id);
+    }
+
+    timer0->start();
+    timer0->release();
+    CHECK(mem.get_value_at(timer_base[0] + 4) == 1);
+    CHECK(pool->reserve(8) == 0);
+    pool->free(8);
+    timer1->release();
+}
+
+TEST_CASE("Timer channels") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    constexpr uint32_t timer2_base = 0x4000a000;
+    mock::TimerModel model{timer2_base};
+    model.install(mem, sched);
+
+    auto* timer = driver::Timer::request_by_id(driver::Timer::ID::TIMER2);
+    REQUIRE(timer != nullptr);
+    // The last channel reads the counter
+    CHECK(timer->get_num_channels() == 3);
+    auto* timer3 = driver::Timer::request_by_id(driver::Timer::ID::TIMER3);
+    REQUIRE(timer3 != nullptr);
+    CHECK(timer3->get_num_channels() == 5);
+    timer3->release();
+    CHECK(timer->get_compare_event(2) == 18);
+    CHECK(timer->get_compare_event(3) < 0);
+    CHECK(timer->set_compare(3, 0) < 0);
+    CHECK(timer->set_compare_action(3, driver::Timer::CompareAction::CLEAR) < 0);
+
+    CHECK(timer->set_counter_width(12) < 0);
+    REQUIRE(timer->set_counter_width(32) == 0);
+    CHECK(mem.get_value_at(timer2_base + 0x508) == 3);
+    CHECK(timer->get_counter_mask() == 0xffffffff);
+    REQUIRE(timer->set_counter_width(16) == 0);
+    CHECK(timer->get_counter_mask() == 0xffff);
+
+    // 1 MHz, 4 CPU cycles per timer tick at 16 MHz, times 16
+    constexpr uint64_t kCyclesPerTick = 64;
+    REQUIRE(timer->request_rate(1000 * 1000) == 1000 * 1000);
+
+    SECTION("Capture") {
+        uint32_t value = 0;
+        CHECK(timer->capture(3, &value) < 0);
+        timer->start();
+        sched.advance(100 * kCyclesPerTick);
+        REQUIRE(timer->capture(1, &value) == 0);
+        CHECK(value == 100);
+        CHECK(mem.get_value_at(timer2_base + 0x544) == 100);
+        timer->stop();
+    }
+
+    SECTION("Counter") {
+        CHECK(timer->get_counter() == 0);
+        timer->start();
+        sched.advance(250 * kCyclesPerTick);
+        CHECK(timer->get_counter() == 250);
+        CHECK(mem.get_value_at(timer2_base + 0x54c) == 250);
+        sched.advance(0x10000 * kCyclesPerTick);
+        CHECK(timer->get_counter() == 250);
+        timer->stop();
+    }
+
+    SECTION("Periodic tick") {
+        DummyEventHandler handler;
+        timer->add_event_handler(16, &handler);
+        REQUIRE(timer->set_compare(0, 1000) == 0);
+        REQUIRE(timer->set_compare_action(0, driver::Timer::CompareAction::CLEAR) == 0);
+        CHECK(mem.get_value_at(timer2_base + 0x200) == 1);
+        timer->enable_tick_interrupt();
+        CHECK((mem.get_value_at(timer2_base + 0x304) & (1 << 16)) != 0);
+        timer->start();
+
+        for (int i = 0; i < 3; ++i) {
+            sched.advance(1000 * kCyclesPerTick);
+            CHECK(mem.get_value_at(timer2_base + 0x140) == 1);
+            nvic_dispatch(timer->get_irq_num());
         }
+        CHECK(handler.evt_ids == std::vector<int>{16, 16, 16});
+
+        timer->disable_tick_interrupt();
+        timer->add_event_handler(16, nullptr);
+        timer->stop();
     }
+
+    SECTION("Stop on compare") {
+        REQUIRE(timer->set_compare(2, 500) == 0);
+        REQUIRE(timer->set_compare_action(2, driver::Timer::CompareAction::STOP) == 0);
+        CHECK(mem.get_value_at(timer2_base + 0x200) == (1 << 10));
+        timer->start();
+        sched.advance(2000 * kCyclesPerTick);
+        CHECK_FALSE(model.is_running());
+        CHECK(model.get_counter() == 500);
+
+        REQUIRE(timer->set_compare_action(2, driver::Timer::CompareAction::NONE) == 0);
+        CHECK(mem.get_value_at(timer2_base + 0x200) == 0);
+    }
+
+    SECTION("PWM output") {
+        mock::PPIModel ppi;
+        ppi.install(mem);
+        mock::GPIOTEModel gpiote;
+        gpiote.install(mem);
+        model.set_event_listener([&ppi](uint32_t addr) {
+            ppi.event_raised(addr);
+        });
+
+        constexpr unsigned int kPin = 17;
+        std::vector<std::pair<uint64_t, bool>> edges;
+        gpiote.set_pin_listener([&edges, &sched](unsigned int pin, bool high) {
+            if (pin == kPin) {
+                edges.emplace_back(sched.now(), high);
+            }
+        });
+
+        CHECK(timer->connect_pin(3, kPin, driver::Timer::PinAction::SET) < 0);
+        REQUIRE(timer->set_compare(1, 1000) == 0);
+        REQUIRE(timer->set_compare_action(1, driver::Timer::CompareAction::CLEAR) == 0);
+        REQUIRE(timer->connect_pin(1, kPin, driver::Timer::PinAction::SET) == 0);
+        REQUIRE(timer->set_compare(0, 250) == 0);
+        REQUIRE(timer->connect_pin(0, kPin, driver::Timer::PinAction::CLEAR) == 0);
+        // Driven low until the first event
+        REQUIRE(edges.size() == 1);
+        CHECK_FALSE(edges[0].second);
+        edges.clear();
+
+        timer->start();
+        // Without any interrupts, exactly 25% of the 1 ms period high
+        sched.advance(3100 * kCyclesPerTick);
+        REQUIRE(edges.size() == 6);
+        for (unsigned int i = 0; i < 3; ++i) {
+            CHECK_FALSE(edges[2 * i].second);
+            CHECK(edges[2 * i + 1].second);
+            CHECK(edges[2 * i + 1].first - edges[2 * i].first == 750 * kCyclesPerTick);
+            if (i > 0) {
+                CHECK(edges[2 * i].first - edges[2 * i - 1].first == 250 * kCyclesPerTick);
+            }
+        }
+
+        timer->stop();
+        timer->disconnect_pins();
+        CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+        CHECK(mem.get_value_at(mock::GPIOTEModel::kBase + 0x510) == 0);
+        CHECK(mem.get_value_at(mock::GPIOTEModel::kBase + 0x514) == 0);
+    }
+
+    timer->set_compare_action(0, driver::Timer::CompareAction::NONE);
+    timer->set_compare_action(1, driver::Timer::CompareAction::NONE);
+    timer->set_compare_action(2, driver::Timer::CompareAction::NONE);
+    timer->release();
 }
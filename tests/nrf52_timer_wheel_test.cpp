@@ -0,0 +1,240 @@
+#include "third_party/catch2/catch.hpp"
+
+#include <vector>
+
+#include "mock_memio.hpp"
+#include "nrf52_rtc_fake.hpp"
+
+#include "nvic.h"
+#include "driver/timer.hpp"
+#include "driver/timer_wheel.hpp"
+
+namespace {
+
+constexpr uint32_t clock_base = 0x40000000;
+constexpr uint32_t rtc1_base = 0x40011000;
+constexpr unsigned int kChannel = 2;
+constexpr uint32_t kCompareEvent = rtc1_base + 0x140 + kChannel * 4;
+constexpr uint32_t kCompareMask = (1 << (16 + kChannel));
+
+using SoftTimer = driver::TimerWheel::SoftTimer;
+
+struct ExpiryLog : public driver::EventHandler {
+    void handle_event(driver::EventInfo* e_info) override {
+        CHECK(e_info->evt_id == driver::TimerWheel::Event::EXPIRED);
+        auto* t = static_cast<const SoftTimer*>(e_info->data);
+        timers.push_back(t);
+        counters.push_back(model->get_counter());
+        // Cancel the other one of the pair
+        if (t == peers[0] || t == peers[1]) {
+            wheel->cancel(t == peers[0] ? peers[1] : peers[0]);
+        }
+        if (restart) {
+            auto* r = restart;
+            restart = nullptr;
+            CHECK(wheel->start(r, restart_delay) == 0);
+        }
+    }
+
+    mock::RTCModel* model = nullptr;
+    driver::TimerWheel* wheel = nullptr;
+    SoftTimer* peers[2] = {};
+    SoftTimer* restart = nullptr;
+    uint32_t restart_delay = 0;
+
+    std::vector<const SoftTimer*> timers;
+    std::vector<uint32_t> counters;
+};
+
+struct WakeCounter : public driver::EventHandler {
+    void handle_event(driver::EventInfo* e_info) override {
+        (void)e_info;
+        ++wakeups;
+    }
+
+    int wakeups = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Timer wheel on RTC") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    mem.set_value_at(clock_base + 0x104, 1);
+    mem.set_value_at(clock_base + 0x418, (1 << 16) | 1);
+
+    mock::RTCModel model{rtc1_base};
+    model.install(mem);
+
+    auto* rtc = driver::Timer::request_by_id(driver::Timer::ID::RTC1);
+    REQUIRE(rtc != nullptr);
+    rtc->start();
+    REQUIRE(model.is_running());
+
+    driver::TimerWheel wheel{rtc, kChannel};
+    SoftTimer t1;
+    CHECK(wheel.start(&t1, 10) < 0);
+    driver::TimerWheel bad_channel{rtc, 4};
+    CHECK(bad_channel.init() < 0);
+
+    ExpiryLog log;
+    log.model = &model;
+    log.wheel = &wheel;
+
+    // Run the RTC tick by tick, taking the compare interrupts
+    int interrupts = 0;
+    const auto run = [&](uint32_t ticks) {
+        for (; ticks > 0; --ticks) {
+            model.advance(1);
+            if (mem.get_value_at(kCompareEvent) && (model.get_inten() & kCompareMask)) {
+                ++interrupts;
+                nvic_dispatch(rtc->get_irq_num());
+            }
+        }
+    };
+
+    SECTION("One-shot timers on all levels") {
+        model.set_counter(0x1234);
+        REQUIRE(wheel.init() == 0);
+
+        SoftTimer timers[5];
+        const uint32_t delays[] = {300000, 5, 5000, 70, 5};
+        for (unsigned int i = 0; i < 5; ++i) {
+            timers[i].handler = &log;
+            REQUIRE(wheel.start(&timers[i], delays[i]) == 0);
+            CHECK(wheel.is_active(&timers[i]));
+        }
+
+        run(300000);
+        REQUIRE(log.timers.size() == 5);
+        // The ones with the same expiry in any order
+        CHECK(log.counters[0] == 0x1234 + 5);
+        CHECK(log.counters[1] == 0x1234 + 5);
+        CHECK(log.timers[2] == &timers[3]);
+        CHECK(log.counters[2] == 0x1234 + 70);
+        CHECK(log.timers[3] == &timers[2]);
+        CHECK(log.counters[3] == 0x1234 + 5000);
+        CHECK(log.timers[4] == &timers[0]);
+        CHECK(log.counters[4] == 0x1234 + 300000);
+        for (const auto& t : timers) {
+            CHECK_FALSE(wheel.is_active(&t));
+        }
+
+        // Only at the slots that have the timers, not at every tick
+        CHECK(interrupts < 20);
+        CHECK((model.get_inten() & kCompareMask) == 0);
+    }
+
+    SECTION("Counter wrap around") {
+        model.set_counter(0xffff00);
+        REQUIRE(wheel.init() == 0);
+        t1.handler = &log;
+        REQUIRE(wheel.start(&t1, 1000) == 0);
+        run(2000);
+        REQUIRE(log.counters.size() == 1);
+        CHECK(log.counters[0] == ((0xffff00 + 1000) & 0xffffff));
+
+        // Started after a long idle time, more than a full turn of the counter
+        model.set_counter(0xfff000);
+        REQUIRE(wheel.start(&t1, 0x2000) == 0);
+        run(0x2000);
+        REQUIRE(log.counters.size() == 2);
+        CHECK(log.counters[1] == 0x1000);
+    }
+
+    SECTION("Cancel") {
+        REQUIRE(wheel.init() == 0);
+        SoftTimer t2;
+        SoftTimer t3;
+        t1.handler = &log;
+        t2.handler = &log;
+        t3.handler = &log;
+        REQUIRE(wheel.start(&t1, 100) == 0);
+        REQUIRE(wheel.start(&t2, 100) == 0);
+        REQUIRE(wheel.start(&t3, 4000) == 0);
+
+        wheel.cancel(&t3);
+        CHECK_FALSE(wheel.is_active(&t3));
+        // Cancelled by the handler of the other one with the same expiry
+        log.peers[0] = &t1;
+        log.peers[1] = &t2;
+        run(5000);
+        REQUIRE(log.timers.size() == 1);
+        CHECK_FALSE(wheel.is_active(&t1));
+        CHECK_FALSE(wheel.is_active(&t2));
+        log.peers[0] = nullptr;
+        log.peers[1] = nullptr;
+
+        // Restarted before the expiry
+        REQUIRE(wheel.start(&t1, 100) == 0);
+        run(50);
+        REQUIRE(wheel.start(&t1, 100) == 0);
+        run(200);
+        REQUIRE(log.counters.size() == 2);
+        CHECK(log.counters[1] == 5000 + 150);
+    }
+
+    SECTION("Periodic and restarted from the handler") {
+        REQUIRE(wheel.init() == 0);
+        t1.handler = &log;
+        t1.period = 100;
+        REQUIRE(wheel.start(&t1, 100) == 0);
+
+        SoftTimer t2;
+        t2.handler = &log;
+        log.restart = &t2;
+        log.restart_delay = 30;
+        REQUIRE(wheel.start(&t2, 20) == 0);
+
+        run(350);
+        REQUIRE(log.counters.size() == 5);
+        CHECK(log.timers[0] == &t2);
+        CHECK(log.counters[0] == 20);
+        CHECK(log.timers[1] == &t2);
+        CHECK(log.counters[1] == 50);
+        for (unsigned int i = 2; i < 5; ++i) {
+            CHECK(log.timers[i] == &t1);
+            CHECK(log.counters[i] == (i - 1) * 100);
+        }
+
+        wheel.cancel(&t1);
+        run(1000);
+        CHECK(log.counters.size() == 5);
+    }
+
+    SECTION("Deferred") {
+        REQUIRE(wheel.init() == 0);
+        WakeCounter wake;
+        wheel.set_deferred_handler(&wake);
+
+        SoftTimer t2;
+        t1.handler = &log;
+        t1.deferred = true;
+        t2.handler = &log;
+        t2.deferred = true;
+        t2.period = 10;
+        REQUIRE(wheel.start(&t1, 10) == 0);
+        REQUIRE(wheel.start(&t2, 10) == 0);
+
+        run(35);
+        CHECK(wake.wakeups == 3);
+        CHECK(log.timers.empty());
+        CHECK(wheel.is_active(&t1));
+
+        // The periodic one is called once for its coalesced expiries
+        wheel.run_deferred();
+        REQUIRE(log.timers.size() == 2);
+        CHECK_FALSE(wheel.is_active(&t1));
+        CHECK(wheel.is_active(&t2));
+
+        run(10);
+        wheel.cancel(&t2);
+        wheel.run_deferred();
+        CHECK(log.timers.size() == 2);
+    }
+
+    rtc->disable_interrupts(kCompareMask);
+    rtc->add_event_handler(16 + kChannel, nullptr);
+    rtc->stop();
+    rtc->release();
+}
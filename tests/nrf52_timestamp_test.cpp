@@ -0,0 +1,109 @@
+#include "third_party/catch2/catch.hpp"
+
+#include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+#include "nrf52_rtc_fake.hpp"
+#include "nrf52_timer_fake.hpp"
+
+#include "nvic.h"
+#include "driver/timer.hpp"
+#include "driver/timestamp.hpp"
+#include "nrf52/timer.hpp"
+
+namespace {
+
+constexpr uint32_t clock_base = 0x40000000;
+constexpr uint32_t rtc2_base = 0x40024000;
+constexpr unsigned int rtc2_irq = 36;
+constexpr uint32_t timer4_base = 0x4001b000;
+constexpr unsigned int timer4_irq = 27;
+
+}  // namespace
+
+TEST_CASE("RTC timestamps") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    mem.set_value_at(clock_base + 0x104, 1);
+    mem.set_value_at(clock_base + 0x418, (1 << 16) | 1);
+
+    mock::RTCModel model{rtc2_base};
+    model.install(mem);
+    model.set_counter(0x1234);
+
+    // Not while another driver uses the RTC
+    auto* rtc2 = driver::Timer::request_by_id(driver::Timer::ID::RTC2);
+    REQUIRE(rtc2 != nullptr);
+    CHECK(driver::time::init() < 0);
+    rtc2->release();
+
+    REQUIRE(driver::time::init() == 0);
+    CHECK(model.is_running());
+    // The RTC is kept from the other users, not from init() itself
+    CHECK(driver::Timer::request_by_id(driver::Timer::ID::RTC2) == nullptr);
+    REQUIRE(driver::time::init() == 0);
+    CHECK(driver::time::get_tick_rate() == 32768);
+    CHECK(mem.get_value_at(rtc2_base + 0x508) == 0);
+    CHECK(driver::time::now_ticks() == 0);
+
+    model.advance(100);
+    CHECK(driver::time::now_ticks() == 100);
+
+    model.set_counter(0xfffff0);
+    model.advance(0x20);
+    // Before the overflow interrupt, e.g. with the interrupts disabled
+    CHECK(driver::time::now_ticks() == 0x1000010);
+    nvic_dispatch(rtc2_irq);
+    CHECK(mem.get_value_at(rtc2_base + 0x104) == 0);
+    CHECK(driver::time::now_ticks() == 0x1000010);
+
+    model.advance(0x1000000);
+    nvic_dispatch(rtc2_irq);
+    CHECK(driver::time::now_ticks() == 0x2000010);
+
+    // The reads are cheap, no register writes
+    const auto writes = mem.get_op_count(mock::Memory::Op::WRITE32);
+    const auto counter_reads = mem.get_op_count(mock::Memory::Op::READ32, rtc2_base + 0x504);
+    driver::time::now_ticks();
+    CHECK(mem.get_op_count(mock::Memory::Op::WRITE32) == writes);
+    CHECK(mem.get_op_count(mock::Memory::Op::READ32, rtc2_base + 0x504) == counter_reads + 1);
+}
+
+TEST_CASE("High resolution timestamps") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    mock::TimerModel model{timer4_base};
+    model.install(mem, sched);
+
+    REQUIRE(driver::time::init_hires() == 0);
+    CHECK(model.is_running());
+    CHECK(driver::time::get_hires_rate() == 16 * 1000 * 1000);
+
+    // The TIMER is kept from the other users, not from init_hires() itself
+    CHECK(driver::Timer::request_by_id(driver::Timer::ID::TIMER4) == nullptr);
+    CHECK(nrf52::TimerPool::request()->reserve(timer4_irq) < 0);
+    REQUIRE(driver::time::init_hires() == 0);
+
+    constexpr uint64_t kCyclesPerTick = mock::TimerModel::kCpuFrequency / mock::TimerModel::kBaseFrequency;
+    sched.advance(1000 * kCyclesPerTick);
+    const auto t1 = driver::time::now_hires_ticks();
+    CHECK(t1 >= 1000);
+    CHECK(t1 < 1100);
+
+    // Past the 32 bit wrap around
+    sched.advance((1ull << 32) * kCyclesPerTick);
+    const auto t2 = driver::time::now_hires_ticks();
+    CHECK(t2 - t1 >= (1ull << 32));
+    CHECK(t2 - t1 < (1ull << 32) + 100);
+
+    nvic_dispatch(timer4_irq);
+    CHECK(mem.get_value_at(timer4_base + 0x150) == 0);
+    const auto t3 = driver::time::now_hires_ticks();
+    CHECK(t3 >= t2);
+    CHECK(t3 - t2 < 100);
+
+    mem.set_scheduler(nullptr);
+}
@@ -0,0 +1,300 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "nrf52_twim_fake.hpp"
+
+#include "nvic.h"
+
+namespace mock {
+
+namespace {
+
+struct FrequencyConfig {
+    uint32_t conf_value;
+    unsigned int freq;
+};
+
+constexpr FrequencyConfig frequencies[] = {
+    { .conf_value = 0x01980000, .freq = 100 * 1000 },
+    { .conf_value = 0x04000000, .freq = 250 * 1000 },
+    { .conf_value = 0x06400000, .freq = 400 * 1000 },
+};
+
+}  // namespace
+
+void I2CSlaveModel::start(bool read) {
+    ptr_pending_ = !read;
+}
+
+bool I2CSlaveModel::write(uint8_t byte) {
+    if (ptr_pending_) {
+        ptr_pending_ = false;
+        reg_ptr_ = byte;
+        return true;
+    }
+
+    if (reg_ptr_ >= regs_.size()) {
+        return false;
+    }
+
+    regs_[reg_ptr_++] = byte;
+    return true;
+}
+
+uint8_t I2CSlaveModel::read() {
+    if (static_cast<int>(reg_ptr_) == fifo_reg_) {
+        if (fifo_.empty()) {
+            return 0;
+        }
+
+        const auto byte = fifo_.front();
+        fifo_.pop_front();
+        return byte;
+    }
+
+    if (reg_ptr_ >= regs_.size()) {
+        return 0xff;
+    }
+
+    return regs_[reg_ptr_++];
+}
+
+void TWIMModel::install(Memory& mem, Scheduler& sched) {
+    set_memory(&mem);
+    sched_ = &sched;
+    mem.set_addr_io_handler(base_, base_ + kRegBlockSize, this);
+}
+
+uint32_t TWIMModel::write32(uint32_t addr, uint32_t old_value, uint32_t new_value) {
+    const auto offset = addr - base_;
+    // Tasks are write only
+    switch (offset) {
+    case kTasksStartRx:
+        if (new_value & 1) {
+            start(State::RX);
+        }
+        return 0;
+    case kTasksStartTx:
+        if (new_value & 1) {
+            start(State::TX);
+        }
+        return 0;
+    case kTasksStop:
+        if (new_value & 1) {
+            if (state_ == State::TX || state_ == State::RX) {
+                stop_pending_ = true;
+            } else {
+                stop();
+            }
+        }
+        return 0;
+    case kIntenSet:
+        set_reg(kInten, reg(kInten) | new_value);
+        return reg(kInten);
+    case kIntenClr:
+        set_reg(kInten, reg(kInten) & ~new_value);
+        return reg(kInten);
+    case kErrorSrc:
+        // Write one to clear
+        return old_value & ~new_value;
+    default:
+        break;
+    }
+
+    return new_value;
+}
+
+uint32_t TWIMModel::read32(uint32_t addr, uint32_t value) {
+    const auto offset = addr - base_;
+    if (offset == kIntenSet || offset == kIntenClr) {
+        return reg(kInten);
+    }
+
+    return value;
+}
+
+unsigned int TWIMModel::get_frequency() const {
+    const auto conf_value = reg(kFrequency);
+    for (const auto& config : frequencies) {
+        if (config.conf_value == conf_value) {
+            return config.freq;
+        }
+    }
+
+    return 0;
+}
+
+Scheduler::Cycles TWIMModel::get_byte_cycles() const {
+    const auto freq = get_frequency();
+    if (!freq) {
+        // Nothing is going to be transferred with the broken configuration
+        return ~Scheduler::Cycles{0} / 2;
+    }
+
+    return (kCpuFrequency * kBitsPerByte + freq - 1) / freq;
+}
+
+void TWIMModel::raise_event(uint32_t offset) {
+    set_reg(offset, 1);
+    if (event_listener_) {
+        event_listener_(base_ + offset);
+    }
+
+    const auto shorts = reg(kShorts);
+    if (offset == kEventsLastTx) {
+        if (shorts & kShortLastTxStartRx) {
+            start(State::RX);
+        }
+        if (shorts & kShortLastTxStop) {
+            stop();
+        }
+    } else if (offset == kEventsLastRx) {
+        if (shorts & kShortLastRxStartTx) {
+            start(State::TX);
+        }
+        if (shorts & kShortLastRxStop) {
+            stop();
+        }
+    }
+
+    const uint32_t event_mask = 1 << ((offset - 0x100) / 4);
+    if ((reg(kInten) & event_mask) && !irq_pending_) {
+        // Several events raised at the same time result in a single interrupt
+        irq_pending_ = true;
+        sched_->schedule_in(0, [this]() {
+            irq_pending_ = false;
+            nvic_dispatch(irq_n_);
+        });
+    }
+}
+
+void TWIMModel::start(State state) {
+    if (state_ == State::TX || state_ == State::RX || state_ == State::STOPPING) {
+        return;
+    }
+
+    const bool rx = state == State::RX;
+    const auto ptr_offset = rx ? kRxdPtr : kTxdPtr;
+    ptr_ = static_cast<uint8_t*>(get_mem_ptr(base_ + ptr_offset));
+    maxcnt_ = reg(rx ? kRxdMaxCnt : kTxdMaxCnt) & 0xff;
+    if (ptr_ && !is_dma_accessible(ptr_, maxcnt_)) {
+        ptr_ = nullptr;
+    }
+    amount_ = 0;
+    // The next transfer of the list uses the next item
+    if (reg(rx ? kRxdList : kTxdList) == 1) {
+        set_mem_ptr(base_ + ptr_offset, ptr_ ? ptr_ + maxcnt_ : nullptr);
+    }
+
+    state_ = state;
+    stop_pending_ = false;
+    ++start_count_;
+    raise_event(rx ? kEventsRxStarted : kEventsTxStarted);
+
+    // The start condition and the address byte
+    sched_->schedule_in(get_byte_cycles(), [this]() {
+        address_done();
+    });
+}
+
+void TWIMModel::address_done() {
+    const uint8_t address = reg(kAddress) & 0x7f;
+    slave_ = nullptr;
+    for (auto* slave : slaves_) {
+        if (slave->get_address() == address) {
+            slave_ = slave;
+            break;
+        }
+    }
+
+    if (!slave_) {
+        error(kErrorAddressNack);
+        return;
+    }
+
+    slave_->start(state_ == State::RX);
+    next_byte();
+}
+
+void TWIMModel::next_byte() {
+    if (stop_pending_ || amount_ == maxcnt_) {
+        last_byte();
+        return;
+    }
+
+    sched_->schedule_in(get_byte_cycles(), [this]() {
+        byte_done();
+    });
+}
+
+void TWIMModel::byte_done() {
+    if (state_ == State::RX) {
+        const auto byte = slave_->read();
+        if (ptr_) {
+            ptr_[amount_] = byte;
+        }
+    } else if (!slave_->write(ptr_ ? ptr_[amount_] : 0)) {
+        ++amount_;
+        error(kErrorDataNack);
+        return;
+    }
+
+    ++amount_;
+    next_byte();
+}
+
+void TWIMModel::last_byte() {
+    const bool rx = state_ == State::RX;
+    set_reg(rx ? kRxdAmount : kTxdAmount, amount_);
+    state_ = State::HOLD;
+
+    if (stop_pending_) {
+        stop();
+        return;
+    }
+
+    raise_event(rx ? kEventsLastRx : kEventsLastTx);
+}
+
+void TWIMModel::stop() {
+    if (state_ == State::STOPPING) {
+        return;
+    }
+
+    state_ = State::STOPPING;
+    stop_pending_ = false;
+    sched_->schedule_in(get_byte_cycles() / kBitsPerByte, [this]() {
+        if (slave_) {
+            slave_->stop();
+            slave_ = nullptr;
+        }
+        state_ = State::IDLE;
+        raise_event(kEventsStopped);
+    });
+}
+
+void TWIMModel::error(uint32_t src) {
+    set_reg(state_ == State::RX ? kRxdAmount : kTxdAmount, amount_);
+    set_reg(kErrorSrc, reg(kErrorSrc) | src);
+    state_ = State::HOLD;
+
+    if (stop_pending_) {
+        stop();
+    }
+    raise_event(kEventsError);
+}
+
+}  // namespace mock
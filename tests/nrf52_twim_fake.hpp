@@ -0,0 +1,294 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/**
+ * @file
+ *
+ * Behavioral model of nRF52 TWIM (I2C master with EasyDMA) and of the I2C slave devices.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+
+namespace mock {
+
+/**
+ * @brief I2C slave with a register file, e.g. a sensor.
+ *
+ * The first byte of the write transaction sets the register pointer, the rest of the bytes
+ * are written into the registers starting from it. Read transactions read the registers
+ * starting from the register pointer. The pointer is incremented after each byte.
+ *
+ * One of the registers can be the FIFO: reading it pops the bytes from the FIFO,
+ * see push_fifo(), and doesn't increment the register pointer.
+ *
+ * Writes past the last register are not acknowledged.
+ */
+class I2CSlaveModel {
+    public:
+        I2CSlaveModel(uint8_t address, size_t num_regs) : address_{address}, regs_(num_regs) {}
+        virtual ~I2CSlaveModel() {}
+
+        uint8_t get_address() const {
+            return address_;
+        }
+
+        // The bus interface, used by the master
+
+        /**
+         * @brief Called after the slave acknowledged its address.
+         */
+        virtual void start(bool read);
+
+        /**
+         * @brief Called for each byte written by the master.
+         *
+         * @return True if the byte is acknowledged.
+         */
+        virtual bool write(uint8_t byte);
+
+        /**
+         * @brief Called for each byte read by the master.
+         */
+        virtual uint8_t read();
+
+        /**
+         * @brief Called on the stop condition.
+         */
+        virtual void stop() {
+            ++transaction_count_;
+        }
+
+        uint8_t get_reg(uint8_t reg) const {
+            return regs_.at(reg);
+        }
+
+        void set_reg(uint8_t reg, uint8_t value) {
+            regs_.at(reg) = value;
+        }
+
+        void set_fifo_reg(uint8_t reg) {
+            fifo_reg_ = reg;
+        }
+
+        void push_fifo(const std::vector<uint8_t>& data) {
+            fifo_.insert(fifo_.end(), data.begin(), data.end());
+        }
+
+        size_t get_fifo_size() const {
+            return fifo_.size();
+        }
+
+        /**
+         * @brief Number of the transactions completed with the stop condition.
+         */
+        unsigned int get_transaction_count() const {
+            return transaction_count_;
+        }
+
+    private:
+        static constexpr int kNoFifo = -1;
+
+        const uint8_t address_;
+        std::vector<uint8_t> regs_;
+        int fifo_reg_ = kNoFifo;
+        std::deque<uint8_t> fifo_;
+
+        size_t reg_ptr_ = 0;
+        // The first byte of the write sets the register pointer
+        bool ptr_pending_ = false;
+        unsigned int transaction_count_ = 0;
+};
+
+/**
+ * @brief TWIM device model.
+ *
+ * The model handles the whole register block of the peripheral and uses the virtual time
+ * of the Scheduler to transfer the data at the configured frequency. Each byte, including
+ * the address, takes 9 SCL cycles.
+ *
+ * - TASKS_STARTTX sends the start condition (repeated, if the bus is held) and ADDRESS,
+ *   then the TXD.MAXCNT bytes from TXD.PTR. LASTTX is raised after the last byte.
+ * - TASKS_STARTRX does the same for the read, storing the bytes into RXD.PTR.
+ *   LASTRX is raised after the last byte.
+ * - TASKS_STOP sends the stop condition after the current byte, and raises STOPPED.
+ * - The address or the data not acknowledged raise ERROR and set ERRORSRC. The bus is held
+ *   until TASKS_STOP.
+ * - With TXD.LIST or RXD.LIST set to ArrayList the pointer is incremented by MAXCNT
+ *   after each transfer.
+ * - LASTTX_STARTRX, LASTTX_STOP, LASTRX_STARTTX and LASTRX_STOP shortcuts, INTEN, INTENSET
+ *   and INTENCLR are supported. The enabled events are dispatched to the interrupt handler
+ *   through nvic_dispatch().
+ *
+ * SUSPEND and RESUME tasks and the clock stretching are not modelled.
+ */
+class TWIMModel : public IOHandlerStub {
+    public:
+        static constexpr uint64_t kCpuFrequency = 64 * 1000 * 1000;
+        static constexpr unsigned kBitsPerByte = 9;
+
+        // Register offsets
+        static constexpr uint32_t kTasksStartRx = 0x000;
+        static constexpr uint32_t kTasksStartTx = 0x008;
+        static constexpr uint32_t kTasksStop = 0x014;
+
+        static constexpr uint32_t kEventsStopped = 0x104;
+        static constexpr uint32_t kEventsError = 0x124;
+        static constexpr uint32_t kEventsRxStarted = 0x14c;
+        static constexpr uint32_t kEventsTxStarted = 0x150;
+        static constexpr uint32_t kEventsLastRx = 0x15c;
+        static constexpr uint32_t kEventsLastTx = 0x160;
+
+        static constexpr uint32_t kShorts = 0x200;
+        static constexpr uint32_t kShortLastTxStartRx = (1 << 7);
+        static constexpr uint32_t kShortLastTxStop = (1 << 9);
+        static constexpr uint32_t kShortLastRxStartTx = (1 << 10);
+        static constexpr uint32_t kShortLastRxStop = (1 << 12);
+
+        static constexpr uint32_t kInten = 0x300;
+        static constexpr uint32_t kIntenSet = 0x304;
+        static constexpr uint32_t kIntenClr = 0x308;
+
+        static constexpr uint32_t kErrorSrc = 0x4c4;
+        static constexpr uint32_t kErrorAddressNack = (1 << 1);
+        static constexpr uint32_t kErrorDataNack = (1 << 2);
+
+        static constexpr uint32_t kEnable = 0x500;
+        static constexpr uint32_t kFrequency = 0x524;
+        static constexpr uint32_t kRxdPtr = 0x534;
+        static constexpr uint32_t kRxdMaxCnt = 0x538;
+        static constexpr uint32_t kRxdAmount = 0x53c;
+        static constexpr uint32_t kRxdList = 0x540;
+        static constexpr uint32_t kTxdPtr = 0x544;
+        static constexpr uint32_t kTxdMaxCnt = 0x548;
+        static constexpr uint32_t kTxdAmount = 0x54c;
+        static constexpr uint32_t kTxdList = 0x550;
+        static constexpr uint32_t kAddress = 0x588;
+
+        static constexpr uint32_t kRegBlockSize = 0x1000;
+
+        /**
+         * @param base Base address of the peripheral.
+         * @param irq_n Interrupt number for the enabled events.
+         */
+        TWIMModel(uint32_t base, int irq_n) : base_{base}, irq_n_{irq_n} {}
+
+        /**
+         * @brief Register the model as the IO handler for the peripheral's registers.
+         *
+         * The memory should be reset before that. The model needs virtual time,
+         * so the scheduler should be attached to the memory.
+         */
+        void install(Memory& mem, Scheduler& sched);
+
+        uint32_t write32(uint32_t addr, uint32_t old_value, uint32_t new_value) override;
+        uint32_t read32(uint32_t addr, uint32_t value) override;
+
+        /**
+         * @brief Set the function to be called with the address of every event raised.
+         *
+         * E.g. to connect the model to PPIModel::event_raised().
+         */
+        void set_event_listener(std::function<void(uint32_t)> listener) {
+            event_listener_ = std::move(listener);
+        }
+
+        /**
+         * @brief Connect the slave to the bus. The slave must outlive the model.
+         */
+        void add_slave(I2CSlaveModel* slave) {
+            slaves_.push_back(slave);
+        }
+
+        /**
+         * @brief SCL frequency for the value in FREQUENCY register.
+         *
+         * Returns 0 for unsupported values.
+         */
+        unsigned int get_frequency() const;
+
+        /**
+         * @brief Duration of one byte on the bus in CPU cycles at the current frequency.
+         */
+        Scheduler::Cycles get_byte_cycles() const;
+
+        /**
+         * @brief True between the start and the stop conditions.
+         */
+        bool is_bus_busy() const {
+            return state_ != State::IDLE;
+        }
+
+        /**
+         * @brief Number of the start conditions, including the repeated ones.
+         */
+        unsigned int get_start_count() const {
+            return start_count_;
+        }
+
+    private:
+        enum class State {
+            IDLE,
+            TX,
+            RX,
+            // Waiting for the next task with the bus held
+            HOLD,
+            STOPPING,
+        };
+
+        uint32_t reg(uint32_t offset) const {
+            return get_mem_value(base_ + offset);
+        }
+
+        void set_reg(uint32_t offset, uint32_t value) {
+            set_mem_value(base_ + offset, value);
+        }
+
+        void raise_event(uint32_t offset);
+
+        void start(State state);
+        void address_done();
+        void next_byte();
+        void byte_done();
+        void last_byte();
+        void stop();
+        void error(uint32_t src);
+
+        const uint32_t base_;
+        const int irq_n_;
+        Scheduler* sched_ = nullptr;
+        bool irq_pending_ = false;
+        std::function<void(uint32_t)> event_listener_;
+        std::vector<I2CSlaveModel*> slaves_;
+
+        State state_ = State::IDLE;
+        bool stop_pending_ = false;
+        I2CSlaveModel* slave_ = nullptr;
+        uint8_t* ptr_ = nullptr;
+        uint32_t maxcnt_ = 0;
+        uint32_t amount_ = 0;
+
+        unsigned int start_count_ = 0;
+};
+
+}  // namespace mock
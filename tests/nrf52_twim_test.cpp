@@ -1,10 +1,19 @@
 #include "third_party/catch2/catch.hpp"
 
+#include <vector>
+
 #include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+#include "nrf52_ppi_fake.hpp"
+#include "nrf52_timer_fake.hpp"
+#include "nrf52_twim_fake.hpp"
 
 #include "driver/i2c.hpp"
+#include "driver/spi.hpp"
 #include "nrf52/peripheral.hpp"
 #include "nrf52/pinctrl.hpp"
+#include "nrf52/timer.hpp"
+#include "nvic.h"
 #include "pinctrl.hpp"
 
 constexpr uint32_t twim0_base = 0x40003000;
@@ -40,5 +49,264 @@ TEST_CASE("Test Request") {
 
         // Check that pins are also input and the correct drive
         // strength is set.
+        twim->release();
+    }
+
+    SECTION("Shared with SPIM0") {
+        auto* twim = driver::I2C::request_by_id(nrf52::TWIM0);
+        REQUIRE(twim != nullptr);
+        CHECK(driver::I2C::request_by_id(nrf52::TWIM0) == twim);
+        CHECK(mem.get_value_at(twim0_base + 0x500) == 6);
+
+        // SPIM0 doesn't take over the instance
+        CHECK(driver::SPI::request_by_id(driver::SPI::ID::SPIM0) == nullptr);
+        CHECK(mem.get_value_at(twim0_base + 0x500) == 6);
+
+        twim->release();
+        CHECK(mem.get_value_at(twim0_base + 0x500) == 0);
+        auto* spi = driver::SPI::request_by_id(driver::SPI::ID::SPIM0);
+        REQUIRE(spi != nullptr);
+        CHECK(mem.get_value_at(twim0_base + 0x500) == 7);
+        CHECK(driver::I2C::request_by_id(nrf52::TWIM0) == nullptr);
+        spi->release();
+    }
+}
+
+namespace {
+
+struct XferCounter : public driver::EventHandler {
+    void handle_event(driver::EventInfo* e_info) override {
+        events.push_back(e_info->evt_id);
+        data = e_info->data;
+    }
+
+    std::vector<int> events;
+    const void* data = nullptr;
+};
+
+irq_handler_func_t twim_irq_driver_handler = nullptr;
+unsigned int twim_irq_count = 0;
+
+// Counts the interrupts taken by the driver
+void twim_irq_counting_handler() {
+    ++twim_irq_count;
+    twim_irq_driver_handler();
+}
+
+}  // namespace
+
+TEST_CASE("Test TWIM Transfers") {
+    // The first free TIMER counts the samples
+    constexpr uint32_t timer0_base = 0x40008000;
+    constexpr int timer0_irq = 8;
+    constexpr uint8_t kSensorAddr = 0x1d;
+    constexpr uint8_t kFifoReg = 0x10;
+
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    mock::TWIMModel model{twim0_base, 3};
+    model.install(mem, sched);
+    mock::PPIModel ppi;
+    ppi.install(mem);
+    mock::TimerModel counter{timer0_base};
+    counter.install(mem);
+    model.set_event_listener([&ppi](uint32_t addr) {
+        ppi.event_raised(addr);
+    });
+    counter.set_event_listener([&ppi, &mem, &sched](uint32_t addr) {
+        ppi.event_raised(addr);
+        // The model doesn't raise the interrupts
+        const bool enabled = mem.get_value_at(timer0_base + 0x304) & (1 << 17);
+        if (addr == timer0_base + mock::TimerModel::kEventsCompare + 4 && enabled) {
+            sched.schedule_in(0, []() {
+                nvic_dispatch(timer0_irq);
+            });
+        }
+    });
+
+    mock::I2CSlaveModel sensor{kSensorAddr, 0x20};
+    sensor.set_fifo_reg(kFifoReg);
+    model.add_slave(&sensor);
+
+    auto* twim = driver::I2C::request_by_id(nrf52::TWIM0);
+    REQUIRE(twim != nullptr);
+    CHECK(twim->set_frequency(1000 * 1000) == 400 * 1000);
+    CHECK(twim->set_frequency(300 * 1000) == 250 * 1000);
+    CHECK(twim->set_frequency(50 * 1000) == 0);
+    CHECK(twim->set_frequency(100 * 1000) == 100 * 1000);
+    CHECK(model.get_frequency() == 100 * 1000);
+
+    XferCounter handler;
+
+    SECTION("Write") {
+        const uint8_t data[] = {0x04, 0x11, 0x22, 0x33};
+        REQUIRE(twim->write(kSensorAddr, data, sizeof(data), &handler) == 0);
+        CHECK(twim->is_busy());
+        CHECK(twim->write(kSensorAddr, data, sizeof(data), &handler) < 0);
+        while (sched.run_next());
+
+        CHECK_FALSE(twim->is_busy());
+        CHECK_FALSE(model.is_bus_busy());
+        REQUIRE(handler.events.size() == 1);
+        CHECK(handler.events[0] == driver::I2C::Event::XFER_DONE);
+        CHECK(handler.data == data);
+        CHECK(sensor.get_reg(4) == 0x11);
+        CHECK(sensor.get_reg(5) == 0x22);
+        CHECK(sensor.get_reg(6) == 0x33);
+        CHECK(sensor.get_transaction_count() == 1);
+        // Address and 4 bytes, 9 bits each, and the stop condition
+        CHECK(sched.now() >= 5 * 9 * 640);
+
+        // Address probe without the data is not supported
+        CHECK(twim->write(kSensorAddr, data, 0, &handler) < 0);
+        CHECK_FALSE(twim->is_busy());
+        CHECK(handler.events.size() == 1);
     }
+
+    SECTION("Read") {
+        sensor.set_reg(0, 0xa5);
+        sensor.set_reg(1, 0x5a);
+        uint8_t data[2] = {};
+        REQUIRE(twim->read(kSensorAddr, data, sizeof(data), &handler) == 0);
+        while (sched.run_next());
+
+        REQUIRE(handler.events.size() == 1);
+        CHECK(handler.events[0] == driver::I2C::Event::XFER_DONE);
+        CHECK(handler.data == data);
+        CHECK(data[0] == 0xa5);
+        CHECK(data[1] == 0x5a);
+        CHECK(twim->read(kSensorAddr, data, 0, &handler) < 0);
+    }
+
+    SECTION("Write then read") {
+        sensor.set_reg(0x0f, 0x33);
+        const uint8_t reg = 0x0f;
+        uint8_t who_am_i = 0;
+        REQUIRE(twim->write_read(kSensorAddr, &reg, 1, &who_am_i, 1, &handler) == 0);
+        while (sched.run_next());
+
+        REQUIRE(handler.events.size() == 1);
+        CHECK(handler.events[0] == driver::I2C::Event::XFER_DONE);
+        CHECK(who_am_i == 0x33);
+        // The read is started with the repeated start, in the same transaction
+        CHECK(model.get_start_count() == 2);
+        CHECK(sensor.get_transaction_count() == 1);
+    }
+
+    SECTION("Address not acknowledged") {
+        const uint8_t data[] = {0x00, 0x01};
+        REQUIRE(twim->write(kSensorAddr + 1, data, sizeof(data), &handler) == 0);
+        while (sched.run_next());
+
+        CHECK_FALSE(twim->is_busy());
+        CHECK_FALSE(model.is_bus_busy());
+        REQUIRE(handler.events.size() == 1);
+        CHECK(handler.events[0] == driver::I2C::Event::XFER_ERROR);
+        CHECK(mem.get_value_at(twim0_base + mock::TWIMModel::kErrorSrc) == 0);
+        CHECK(sensor.get_reg(0) == 0);
+
+        // The next transfer is fine
+        REQUIRE(twim->write(kSensorAddr, data, sizeof(data), &handler) == 0);
+        while (sched.run_next());
+        REQUIRE(handler.events.size() == 2);
+        CHECK(handler.events[1] == driver::I2C::Event::XFER_DONE);
+        CHECK(sensor.get_reg(0) == 1);
+    }
+
+    SECTION("Data not acknowledged") {
+        uint8_t data[] = {0x1e, 0x01, 0x02, 0x03};
+        REQUIRE(twim->write(kSensorAddr, data, sizeof(data), &handler) == 0);
+        while (sched.run_next());
+
+        REQUIRE(handler.events.size() == 1);
+        CHECK(handler.events[0] == driver::I2C::Event::XFER_ERROR);
+        CHECK(sensor.get_reg(0x1f) == 0x02);
+        CHECK(sensor.get_transaction_count() == 1);
+    }
+
+    SECTION("Batched samples") {
+        constexpr size_t kSampleSize = 6;
+        constexpr size_t kSamples = 10;
+        std::vector<uint8_t> fifo;
+        for (size_t i = 0; i < kSampleSize * kSamples + 4; ++i) {
+            fifo.push_back(i * 3);
+        }
+        sensor.push_fifo(fifo);
+
+        uint8_t samples[kSampleSize * kSamples] = {};
+        REQUIRE(twim->read_samples(kSensorAddr, kFifoReg, samples, kSampleSize, kSamples, &handler) == 0);
+        CHECK(twim->read_samples(kSensorAddr, kFifoReg, samples, kSampleSize, kSamples, &handler) < 0);
+        auto* vector_table = nvic_get_table();
+        twim_irq_driver_handler = vector_table[3 - IRQ_OFFSET];
+        twim_irq_count = 0;
+        vector_table[3 - IRQ_OFFSET] = twim_irq_counting_handler;
+        while (sched.run_next());
+        vector_table[3 - IRQ_OFFSET] = twim_irq_driver_handler;
+
+        // The hardware repeated the transactions, and the counter completed the batch
+        // without any TWIM interrupts
+        CHECK(twim_irq_count == 0);
+        REQUIRE(handler.events.size() == 1);
+        CHECK(handler.events[0] == driver::I2C::Event::XFER_DONE);
+        CHECK(handler.data == samples);
+        CHECK(sensor.get_transaction_count() == kSamples);
+        CHECK(sensor.get_fifo_size() == 4);
+        CHECK(std::vector<uint8_t>(samples, samples + sizeof(samples)) ==
+              std::vector<uint8_t>(fifo.begin(), fifo.begin() + sizeof(samples)));
+
+        // The channels are returned, the counter is stopped
+        CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+        CHECK_FALSE(counter.is_running());
+
+        // Single sample doesn't need the chain
+        uint8_t sample[kSampleSize] = {};
+        REQUIRE(twim->read_samples(kSensorAddr, kFifoReg, sample, kSampleSize, 1, &handler) == 0);
+        vector_table[3 - IRQ_OFFSET] = twim_irq_counting_handler;
+        while (sched.run_next());
+        vector_table[3 - IRQ_OFFSET] = twim_irq_driver_handler;
+        REQUIRE(handler.events.size() == 2);
+        CHECK(handler.events[1] == driver::I2C::Event::XFER_DONE);
+        CHECK(twim_irq_count == 1);
+        CHECK(sensor.get_fifo_size() == 0);
+        CHECK(sample[0] == fifo[kSampleSize * kSamples]);
+        CHECK(sample[3] == fifo[kSampleSize * kSamples + 3]);
+        CHECK(sample[4] == 0);
+    }
+
+    SECTION("Batch without a free TIMER") {
+        auto* pool = nrf52::TimerPool::request();
+        std::vector<int> timers;
+        for (int id = pool->alloc(); id >= 0; id = pool->alloc()) {
+            timers.push_back(id);
+        }
+
+        uint8_t samples[4 * 8] = {};
+        CHECK(twim->read_samples(kSensorAddr, kFifoReg, samples, 4, 8, &handler) < 0);
+        CHECK_FALSE(twim->is_busy());
+        CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+        CHECK(mem.get_op_count(mock::Memory::Op::WRITE32, timer0_base) == 0);
+
+        for (auto id : timers) {
+            pool->free(id);
+        }
+    }
+
+    SECTION("Batch stopped by an error") {
+        sensor.push_fifo(std::vector<uint8_t>(64, 0x42));
+        uint8_t samples[4 * 8] = {};
+        REQUIRE(twim->read_samples(kSensorAddr + 1, kFifoReg, samples, 4, 8, &handler) == 0);
+        while (sched.run_next());
+
+        REQUIRE(handler.events.size() == 1);
+        CHECK(handler.events[0] == driver::I2C::Event::XFER_ERROR);
+        CHECK(sensor.get_fifo_size() == 64);
+        CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+        CHECK_FALSE(twim->is_busy());
+    }
+
+    twim->release();
 }
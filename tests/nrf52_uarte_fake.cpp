@@ -0,0 +1,294 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "nrf52_uarte_fake.hpp"
+
+#include "nrf52/uarte.hpp"
+#include "nvic.h"
+
+namespace mock {
+
+void UARTEModel::install(Memory& mem, Scheduler& sched) {
+    set_memory(&mem);
+    sched_ = &sched;
+    mem.set_addr_io_handler(base_, base_ + kRegBlockSize, this);
+}
+
+uint32_t UARTEModel::write32(uint32_t addr, uint32_t old_value, uint32_t new_value) {
+    const auto offset = addr - base_;
+    // Tasks are write only
+    switch (offset) {
+    case kTasksStartRx:
+        if (new_value & 1) {
+            start_rx();
+        }
+        return 0;
+    case kTasksStopRx:
+        if (new_value & 1) {
+            stop_rx();
+        }
+        return 0;
+    case kTasksStartTx:
+        if (new_value & 1) {
+            start_tx();
+        }
+        return 0;
+    case kTasksStopTx:
+        if (new_value & 1) {
+            stop_tx();
+        }
+        return 0;
+    case kTasksFlushRx:
+        if (new_value & 1) {
+            flush_rx();
+        }
+        return 0;
+    case kIntenSet:
+        set_reg(kInten, reg(kInten) | new_value);
+        return reg(kInten);
+    case kIntenClr:
+        set_reg(kInten, reg(kInten) & ~new_value);
+        return reg(kInten);
+    case kErrorSrc:
+        // Write one to clear
+        return old_value & ~new_value;
+    default:
+        break;
+    }
+
+    return new_value;
+}
+
+uint32_t UARTEModel::read32(uint32_t addr, uint32_t value) {
+    const auto offset = addr - base_;
+    if (offset == kIntenSet || offset == kIntenClr) {
+        return reg(kInten);
+    }
+
+    return value;
+}
+
+void UARTEModel::receive(const std::vector<uint8_t>& data) {
+    const bool line_idle = rx_line_.empty();
+    rx_line_.insert(rx_line_.end(), data.begin(), data.end());
+    if (line_idle && !rx_line_.empty()) {
+        sched_->schedule_in(get_frame_cycles(), [this]() {
+            rx_frame_done();
+        });
+    }
+}
+
+unsigned int UARTEModel::get_baudrate() const {
+    const auto conf_value = reg(kBaudrate);
+    for (const auto& config : nrf52::uarte::supported_rates) {
+        if (config.conf_value == conf_value) {
+            return config.actual_rate;
+        }
+    }
+
+    return 0;
+}
+
+Scheduler::Cycles UARTEModel::get_frame_cycles() const {
+    const auto rate = get_baudrate();
+    if (!rate) {
+        // Nothing is going to be transferred with the broken configuration
+        return ~Scheduler::Cycles{0} / 2;
+    }
+
+    return (kCpuFrequency * kBitsPerFrame + rate - 1) / rate;
+}
+
+void UARTEModel::raise_event(uint32_t offset) {
+    set_reg(offset, 1);
+    if (event_listener_) {
+        event_listener_(base_ + offset);
+    }
+
+    if (offset == kEventsEndRx) {
+        const auto shorts = reg(kShorts);
+        if (shorts & kShortEndRxStartRx) {
+            start_rx();
+        }
+        if (shorts & kShortEndRxStopRx) {
+            stop_rx();
+        }
+    }
+
+    const uint32_t event_mask = 1 << ((offset - kEventsCts) / 4);
+    if ((reg(kInten) & event_mask) && !irq_pending_) {
+        // The interrupt is taken before the next instruction. Several events raised
+        // at the same time result in a single interrupt.
+        irq_pending_ = true;
+        sched_->schedule_in(0, [this]() {
+            irq_pending_ = false;
+            nvic_dispatch(irq_n_);
+        });
+    }
+}
+
+void UARTEModel::start_tx() {
+    if (tx_active_) {
+        return;
+    }
+
+    const auto maxcnt = reg(kTxdMaxCnt);
+    const auto* ptr = static_cast<const uint8_t*>(get_mem_ptr(base_ + kTxdPtr));
+    // TXD.PTR and TXD.MAXCNT are double buffered: the values are latched here,
+    // the firmware may prepare the next transfer right after TXSTARTED.
+    tx_buffer_.assign(maxcnt, 0);
+    if (ptr && is_dma_accessible(ptr, maxcnt)) {
+        tx_buffer_.assign(ptr, ptr + maxcnt);
+    } else if (maxcnt) {
+        ++dma_error_count_;
+    }
+    tx_pos_ = 0;
+    tx_active_ = true;
+    raise_event(kEventsTxStarted);
+
+    if (tx_buffer_.empty()) {
+        tx_active_ = false;
+        set_reg(kTxdAmount, 0);
+        raise_event(kEventsEndTx);
+        return;
+    }
+
+    tx_event_ = sched_->schedule_in(get_frame_cycles(), [this]() {
+        tx_frame_done();
+    });
+}
+
+void UARTEModel::stop_tx() {
+    if (tx_active_) {
+        sched_->cancel(tx_event_);
+        tx_active_ = false;
+        set_reg(kTxdAmount, tx_pos_);
+        raise_event(kEventsEndTx);
+    }
+
+    raise_event(kEventsTxStopped);
+}
+
+void UARTEModel::tx_frame_done() {
+    tx_sink_.push_back(tx_buffer_[tx_pos_++]);
+    raise_event(kEventsTxdRdy);
+
+    if (tx_pos_ == tx_buffer_.size()) {
+        tx_active_ = false;
+        set_reg(kTxdAmount, tx_pos_);
+        raise_event(kEventsEndTx);
+    } else {
+        tx_event_ = sched_->schedule_in(get_frame_cycles(), [this]() {
+            tx_frame_done();
+        });
+    }
+}
+
+void UARTEModel::start_rx() {
+    if (rx_active_) {
+        return;
+    }
+
+    rx_ptr_ = static_cast<uint8_t*>(get_mem_ptr(base_ + kRxdPtr));
+    rx_maxcnt_ = reg(kRxdMaxCnt);
+    if (rx_ptr_ && !is_dma_accessible(rx_ptr_, rx_maxcnt_)) {
+        ++dma_error_count_;
+        rx_ptr_ = nullptr;
+    }
+    rx_amount_ = 0;
+    rx_active_ = true;
+    raise_event(kEventsRxStarted);
+
+    // RXDRDY was already raised for the bytes waiting in the FIFO
+    while (!rx_fifo_.empty() && rx_amount_ < rx_maxcnt_) {
+        store_rx_byte(rx_fifo_.front());
+        rx_fifo_.pop_front();
+    }
+
+    if (rx_amount_ == rx_maxcnt_) {
+        end_rx();
+    }
+}
+
+void UARTEModel::stop_rx() {
+    if (rx_active_) {
+        end_rx();
+    }
+
+    raise_event(kEventsRxTo);
+}
+
+void UARTEModel::end_rx() {
+    rx_active_ = false;
+    set_reg(kRxdAmount, rx_amount_);
+    raise_event(kEventsEndRx);
+}
+
+void UARTEModel::flush_rx() {
+    if (rx_active_) {
+        return;
+    }
+
+    rx_ptr_ = static_cast<uint8_t*>(get_mem_ptr(base_ + kRxdPtr));
+    rx_maxcnt_ = reg(kRxdMaxCnt);
+    if (rx_ptr_ && !is_dma_accessible(rx_ptr_, rx_maxcnt_)) {
+        ++dma_error_count_;
+        rx_ptr_ = nullptr;
+    }
+    rx_amount_ = 0;
+    while (!rx_fifo_.empty() && rx_amount_ < rx_maxcnt_) {
+        store_rx_byte(rx_fifo_.front());
+        rx_fifo_.pop_front();
+    }
+
+    set_reg(kRxdAmount, rx_amount_);
+    raise_event(kEventsEndRx);
+}
+
+void UARTEModel::rx_frame_done() {
+    const auto byte = rx_line_.front();
+    rx_line_.pop_front();
+
+    if (rx_active_ && rx_amount_ < rx_maxcnt_) {
+        store_rx_byte(byte);
+        raise_event(kEventsRxdRdy);
+        if (rx_amount_ == rx_maxcnt_) {
+            end_rx();
+        }
+    } else if (rx_fifo_.size() < kRxFifoSize) {
+        rx_fifo_.push_back(byte);
+        raise_event(kEventsRxdRdy);
+    } else {
+        ++overrun_count_;
+        set_reg(kErrorSrc, reg(kErrorSrc) | kErrorOverrun);
+        raise_event(kEventsError);
+    }
+
+    if (!rx_line_.empty()) {
+        sched_->schedule_in(get_frame_cycles(), [this]() {
+            rx_frame_done();
+        });
+    }
+}
+
+void UARTEModel::store_rx_byte(uint8_t byte) {
+    if (rx_ptr_) {
+        rx_ptr_[rx_amount_] = byte;
+    }
+    ++rx_amount_;
+}
+
+}  // namespace mock
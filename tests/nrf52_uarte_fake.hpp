@@ -0,0 +1,233 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/**
+ * @file
+ *
+ * Behavioral model of nRF52 UARTE peripheral with EasyDMA.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+
+namespace mock {
+
+/**
+ * @brief UARTE device model.
+ *
+ * The model handles the whole register block of the peripheral and uses
+ * the virtual time of the Scheduler to transfer the data at the configured baud rate.
+ *
+ * - TASKS_STARTTX takes TXD.PTR and TXD.MAXCNT, and shifts the bytes out one by one
+ *   into the TX sink (see get_tx_data()), raising TXDRDY after each byte and ENDTX
+ *   after the last one.
+ * - TASKS_STARTRX takes RXD.PTR and RXD.MAXCNT. The bytes passed to receive() are
+ *   stored into that buffer as they arrive, raising RXDRDY after each byte and ENDRX
+ *   when the buffer is full. Bytes arriving while the receiver is stopped go into
+ *   the 4 byte hardware FIFO, the rest is lost with an overrun error.
+ * - TASKS_STOPTX and TASKS_STOPRX finish the transfer early and update the AMOUNT registers.
+ * - ENDRX_STARTRX and ENDRX_STOPRX shortcuts, INTEN, INTENSET and INTENCLR are supported.
+ *   The enabled events are dispatched to the interrupt handler through nvic_dispatch().
+ *
+ * Each frame is 10 bits long (start bit, 8 data bits, stop bit). Parity and
+ * hardware flow control are not modelled.
+ */
+class UARTEModel : public IOHandlerStub {
+    public:
+        static constexpr uint64_t kCpuFrequency = 64 * 1000 * 1000;
+        static constexpr unsigned kBitsPerFrame = 10;
+        static constexpr size_t kRxFifoSize = 4;
+
+        // Register offsets
+        static constexpr uint32_t kTasksStartRx = 0x000;
+        static constexpr uint32_t kTasksStopRx = 0x004;
+        static constexpr uint32_t kTasksStartTx = 0x008;
+        static constexpr uint32_t kTasksStopTx = 0x00c;
+        static constexpr uint32_t kTasksFlushRx = 0x02c;
+
+        static constexpr uint32_t kEventsCts = 0x100;
+        static constexpr uint32_t kEventsNcts = 0x104;
+        static constexpr uint32_t kEventsRxdRdy = 0x108;
+        static constexpr uint32_t kEventsEndRx = 0x110;
+        static constexpr uint32_t kEventsTxdRdy = 0x11c;
+        static constexpr uint32_t kEventsEndTx = 0x120;
+        static constexpr uint32_t kEventsError = 0x124;
+        static constexpr uint32_t kEventsRxTo = 0x144;
+        static constexpr uint32_t kEventsRxStarted = 0x14c;
+        static constexpr uint32_t kEventsTxStarted = 0x150;
+        static constexpr uint32_t kEventsTxStopped = 0x158;
+
+        static constexpr uint32_t kShorts = 0x200;
+        static constexpr uint32_t kShortEndRxStartRx = (1 << 5);
+        static constexpr uint32_t kShortEndRxStopRx = (1 << 6);
+
+        static constexpr uint32_t kInten = 0x300;
+        static constexpr uint32_t kIntenSet = 0x304;
+        static constexpr uint32_t kIntenClr = 0x308;
+
+        static constexpr uint32_t kErrorSrc = 0x480;
+        static constexpr uint32_t kErrorOverrun = (1 << 0);
+
+        static constexpr uint32_t kBaudrate = 0x524;
+        static constexpr uint32_t kRxdPtr = 0x534;
+        static constexpr uint32_t kRxdMaxCnt = 0x538;
+        static constexpr uint32_t kRxdAmount = 0x53c;
+        static constexpr uint32_t kTxdPtr = 0x544;
+        static constexpr uint32_t kTxdMaxCnt = 0x548;
+        static constexpr uint32_t kTxdAmount = 0x54c;
+
+        static constexpr uint32_t kRegBlockSize = 0x1000;
+
+        /**
+         * @param base Base address of the peripheral.
+         * @param irq_n Interrupt number for the enabled events.
+         */
+        UARTEModel(uint32_t base, int irq_n) : base_{base}, irq_n_{irq_n} {}
+
+        /**
+         * @brief Register the model as the IO handler for the peripheral's registers.
+         *
+         * The memory should be reset before that. The model needs virtual time,
+         * so the scheduler should be attached to the memory.
+         */
+        void install(Memory& mem, Scheduler& sched);
+
+        uint32_t write32(uint32_t addr, uint32_t old_value, uint32_t new_value) override;
+        uint32_t read32(uint32_t addr, uint32_t value) override;
+
+        /**
+         * @brief Set the function to be called with the address of every event raised.
+         *
+         * E.g. to connect the model to PPIModel::event_raised().
+         */
+        void set_event_listener(std::function<void(uint32_t)> listener) {
+            event_listener_ = std::move(listener);
+        }
+
+        /**
+         * @brief Start sending the data to the RXD line.
+         *
+         * The bytes follow each other without gaps, after the ones that are
+         * already on the line.
+         */
+        void receive(const std::vector<uint8_t>& data);
+
+        void receive(const std::string& data) {
+            receive(std::vector<uint8_t>(data.begin(), data.end()));
+        }
+
+        /**
+         * @brief All of the bytes transmitted on TXD line.
+         */
+        const std::vector<uint8_t>& get_tx_data() const {
+            return tx_sink_;
+        }
+
+        void clear_tx_data() {
+            tx_sink_.clear();
+        }
+
+        /**
+         * @brief Actual baud rate for the value in BAUDRATE register.
+         *
+         * Returns 0 for unsupported values.
+         */
+        unsigned int get_baudrate() const;
+
+        /**
+         * @brief Duration of one frame in CPU cycles at the current baud rate.
+         */
+        Scheduler::Cycles get_frame_cycles() const;
+
+        bool is_tx_active() const {
+            return tx_active_;
+        }
+
+        bool is_rx_active() const {
+            return rx_active_;
+        }
+
+        /**
+         * @brief Number of bytes lost because of RX FIFO overruns.
+         */
+        unsigned int get_overrun_count() const {
+            return overrun_count_;
+        }
+
+        /**
+         * @brief Number of transfers that pointed EasyDMA outside of RAM.
+         *
+         * The data of such transfers is lost, see Memory::add_flash_region().
+         */
+        unsigned int get_dma_error_count() const {
+            return dma_error_count_;
+        }
+
+    private:
+        uint32_t reg(uint32_t offset) const {
+            return get_mem_value(base_ + offset);
+        }
+
+        void set_reg(uint32_t offset, uint32_t value) {
+            set_mem_value(base_ + offset, value);
+        }
+
+        void raise_event(uint32_t offset);
+
+        void start_tx();
+        void stop_tx();
+        void tx_frame_done();
+
+        void start_rx();
+        void stop_rx();
+        void end_rx();
+        void flush_rx();
+        void rx_frame_done();
+        void store_rx_byte(uint8_t byte);
+
+        const uint32_t base_;
+        const int irq_n_;
+        Scheduler* sched_ = nullptr;
+        bool irq_pending_ = false;
+        std::function<void(uint32_t)> event_listener_;
+
+        bool tx_active_ = false;
+        std::vector<uint8_t> tx_buffer_;
+        size_t tx_pos_ = 0;
+        Scheduler::EventId tx_event_ = 0;
+        std::vector<uint8_t> tx_sink_;
+
+        bool rx_active_ = false;
+        uint8_t* rx_ptr_ = nullptr;
+        uint32_t rx_maxcnt_ = 0;
+        uint32_t rx_amount_ = 0;
+        std::deque<uint8_t> rx_fifo_;
+
+        // Bytes on the RXD line, the first one is being received
+        std::deque<uint8_t> rx_line_;
+        unsigned int overrun_count_ = 0;
+        unsigned int dma_error_count_ = 0;
+};
+
+}  // namespace mock
@@ -20,10 +20,18 @@
 #include <tuple>
 
 #include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+#include "nrf52_ppi_fake.hpp"
+#include "nrf52_timer_fake.hpp"
+#include "nrf52_uarte_fake.hpp"
 
+#include "core/spsc_ring.hpp"
 #include "driver/uart.hpp"
+#include "memio.h"
+#include "nvic.h"
 #include "pinctrl.hpp"
 #include "nrf52/pinctrl.hpp"
+#include "nrf52/timer.hpp"
 
 constexpr uint32_t uarte0_base = 0x40002000;
 constexpr uint32_t uarte1_base = 0x40028000;
@@ -47,6 +55,39 @@ constexpr auto config = 0x56c;
 
 constexpr auto event_endtx = 0x120;
 
+namespace {
+
+class TxDoneCounter : public driver::EventHandler {
+    public:
+        void handle_event(driver::EventInfo* e_info) override {
+            CHECK(e_info->evt_id == driver::UART::Event::TX_DONE);
+            data = e_info->data;
+            ++count;
+        }
+
+        int count = 0;
+        const void* data = nullptr;
+};
+
+// Runs the driver's interrupt handler after a delay, like a long higher priority ISR would
+irq_handler_func_t late_irq_driver_handler = nullptr;
+mock::Scheduler::Cycles late_irq_latency = 0;
+bool late_irq_pending = false;
+
+void late_irq_handler() {
+    if (late_irq_pending) {
+        return;
+    }
+
+    late_irq_pending = true;
+    mock::get_global_scheduler().schedule_in(late_irq_latency, []() {
+        late_irq_pending = false;
+        late_irq_driver_handler();
+    });
+}
+
+}  // namespace
+
 
 TEST_CASE("TEST UARTE API") {
     auto& mem = mock::get_global_memory();
@@ -127,14 +168,159 @@ TEST_CASE("TEST UARTE API") {
         SECTION("Test Write") {
             std::string hello{"Hello!"};
 
-            mock::IgnoreWrites event_sink;
-            mem.set_addr_io_handler(uarte0_base + event_endtx, &event_sink);
-            mem.set_value_at(uarte0_base + event_endtx, 1);
+            auto& sched = mock::get_global_scheduler();
+            sched.reset();
+            mem.set_scheduler(&sched);
+            mock::UARTEModel model{uarte0_base, 2};
+            model.install(mem, sched);
+
+            const auto start = sched.now();
             CHECK(uarte0->write_str(hello.c_str()) == hello.size());
+            const auto elapsed = sched.now() - start;
 
             CHECK(mem.get_value_at(uarte0_base + txd_maxcnt) == hello.size());
+            CHECK(mem.get_value_at(uarte0_base + txd_amount) == hello.size());
+            CHECK(std::string(model.get_tx_data().begin(), model.get_tx_data().end()) == hello);
+
+            // The driver waits for the whole transfer, but not much longer
+            CHECK(elapsed >= hello.size() * model.get_frame_cycles());
+            CHECK(elapsed < (hello.size() + 1) * model.get_frame_cycles());
+        }
+
+    }
+
+    SECTION("Async Write") {
+        auto* uarte0 = driver::UART::request_by_id(driver::UART::ID::UARTE0);
+        REQUIRE(uarte0 != nullptr);
+
+        auto& sched = mock::get_global_scheduler();
+        sched.reset();
+        mem.set_scheduler(&sched);
+        mock::UARTEModel model{uarte0_base, 2};
+        model.install(mem, sched);
+        uarte0->set_baudrate(1000 * 1000);
+
+        TxDoneCounter done;
+        std::vector<uint8_t> data(100);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = i;
         }
 
+        const auto start = sched.now();
+        REQUIRE(uarte0->write(data.data(), data.size(), &done) == 0);
+        CHECK(uarte0->is_tx_busy());
+
+        // Only one transmission at a time
+        CHECK(uarte0->write(data.data(), data.size(), &done) < 0);
+        CHECK(uarte0->write_str("Hello") == 0);
+
+        const auto reads_before = mem.get_op_count(mock::Memory::Op::READ32);
+        while (sched.run_next() && !done.count);
+        const auto elapsed = sched.now() - start;
+
+        CHECK(done.count == 1);
+        CHECK(done.data == data.data());
+        CHECK_FALSE(uarte0->is_tx_busy());
+        CHECK(model.get_tx_data() == data);
+
+        // The link stays busy all the time: the next chunk is started right at ENDTX
+        CHECK(elapsed < (data.size() + 1) * model.get_frame_cycles());
+        // The CPU is not polling the events
+        CHECK(mem.get_op_count(mock::Memory::Op::READ32) - reads_before < 50);
+
+        // The interrupts are disabled after the transmission, so that the blocking
+        // API can be used again.
+        CHECK((mem.get_value_at(uarte0_base + 0x300) & ((1 << 8) | (1 << 20))) == 0);
+        CHECK(uarte0->write_str("Hello") == 5);
+    }
+
+    SECTION("Zero-copy Write") {
+        auto* uarte0 = driver::UART::request_by_id(driver::UART::ID::UARTE0);
+        REQUIRE(uarte0 != nullptr);
+
+        auto& sched = mock::get_global_scheduler();
+        sched.reset();
+        mem.set_scheduler(&sched);
+        mock::UARTEModel model{uarte0_base, 2};
+        model.install(mem, sched);
+        uarte0->set_baudrate(1000 * 1000);
+
+        const auto starttx_count = [&mem]() {
+            return mem.get_op_count(mock::Memory::Op::WRITE32, uarte0_base + 0x008);
+        };
+
+        SECTION("RAM string") {
+            std::string line(100, 'x');
+            CHECK(uarte0->write_str(line.c_str()) == line.size());
+
+            // One transfer straight from the string
+            CHECK(starttx_count() == 1);
+            CHECK(mem.get_ptr_at(uarte0_base + txd_ptr) == line.c_str());
+            CHECK(std::string(model.get_tx_data().begin(), model.get_tx_data().end()) == line);
+        }
+
+        SECTION("Flash string") {
+            static const char flash_line[] = "This string is too long for a single bounce buffer";
+            mem.add_flash_region(flash_line, sizeof(flash_line));
+
+            CHECK(uarte0->write_str(flash_line) == sizeof(flash_line) - 1);
+            CHECK(starttx_count() == 2);
+            CHECK(mem.get_ptr_at(uarte0_base + txd_ptr) != flash_line);
+            CHECK(std::string(model.get_tx_data().begin(), model.get_tx_data().end()) == flash_line);
+            CHECK(model.get_dma_error_count() == 0);
+        }
+
+        SECTION("Async RAM buffer") {
+            TxDoneCounter done;
+            std::vector<uint8_t> frame(600, 0x55);
+
+            REQUIRE(uarte0->write(frame.data(), frame.size(), &done) == 0);
+            while (sched.run_next() && !done.count);
+
+            CHECK(done.count == 1);
+            CHECK(model.get_tx_data() == frame);
+            // Chunks of MAXCNT bytes
+            CHECK(starttx_count() == 3);
+            CHECK(model.get_dma_error_count() == 0);
+        }
+
+        SECTION("Late interrupt") {
+            TxDoneCounter done;
+            std::vector<uint8_t> frame(600);
+            for (size_t i = 0; i < frame.size(); ++i) {
+                frame[i] = i;
+            }
+
+            REQUIRE(uarte0->write(frame.data(), frame.size(), &done) == 0);
+            // TXSTARTED and ENDTX of the same chunk are both pending when the handler runs
+            auto* vector_table = nvic_get_table();
+            late_irq_driver_handler = vector_table[2 - IRQ_OFFSET];
+            late_irq_latency = 300 * model.get_frame_cycles();
+            late_irq_pending = false;
+            vector_table[2 - IRQ_OFFSET] = late_irq_handler;
+
+            while (sched.run_next() && !done.count);
+            vector_table[2 - IRQ_OFFSET] = late_irq_driver_handler;
+
+            CHECK(done.count == 1);
+            CHECK(model.get_tx_data() == frame);
+            CHECK(starttx_count() == 3);
+            CHECK_FALSE(uarte0->is_tx_busy());
+        }
+
+        SECTION("Async flash buffer") {
+            TxDoneCounter done;
+            static const uint8_t flash_frame[40] = {1, 2, 3};
+            mem.add_flash_region(flash_frame, sizeof(flash_frame));
+
+            REQUIRE(uarte0->write(flash_frame, sizeof(flash_frame), &done) == 0);
+            while (sched.run_next() && !done.count);
+
+            CHECK(done.count == 1);
+            CHECK(model.get_tx_data() == std::vector<uint8_t>(flash_frame, flash_frame + sizeof(flash_frame)));
+            CHECK(starttx_count() == 2);
+            CHECK(model.get_dma_error_count() == 0);
+        }
     }
 
     SECTION("UARTE1") {
@@ -142,3 +328,377 @@ TEST_CASE("TEST UARTE API") {
         REQUIRE(uarte1 != nullptr);
     }
 }
+
+namespace {
+
+int uarte_irq_count = 0;
+
+void uarte_irq_handler() {
+    ++uarte_irq_count;
+}
+
+}  // namespace
+
+TEST_CASE("Test UARTE model") {
+    constexpr uint32_t tasks_startrx = 0x000;
+    constexpr uint32_t tasks_stoprx = 0x004;
+    constexpr uint32_t tasks_starttx = 0x008;
+    constexpr uint32_t tasks_stoptx = 0x00c;
+    constexpr uint32_t event_rxdrdy = 0x108;
+    constexpr uint32_t event_endrx = 0x110;
+    constexpr uint32_t event_error = 0x124;
+    constexpr uint32_t event_rxto = 0x144;
+    constexpr uint32_t event_txstopped = 0x158;
+    constexpr uint32_t shorts = 0x200;
+    constexpr uint32_t intenset = 0x304;
+    constexpr uint32_t errorsrc = 0x480;
+
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    mock::UARTEModel model{uarte0_base, 2};
+    model.install(mem, sched);
+
+    // 1 Mbaud, 10 bits per frame
+    raw_write32(uarte0_base + baudrate, 0x10000000);
+    CHECK(model.get_baudrate() == 1000 * 1000);
+    CHECK(model.get_frame_cycles() == 640);
+
+    uint8_t tx_buffer[4] = {1, 2, 3, 4};
+    uint8_t rx_buffer[4] = {};
+    raw_writeptr(uarte0_base + txd_ptr, tx_buffer);
+    raw_writeptr(uarte0_base + rxd_ptr, rx_buffer);
+    raw_write32(uarte0_base + txd_maxcnt, sizeof(tx_buffer));
+    raw_write32(uarte0_base + rxd_maxcnt, sizeof(rx_buffer));
+
+    SECTION("Transmit") {
+        raw_write32(uarte0_base + tasks_starttx, 1);
+        CHECK(model.is_tx_active());
+
+        // The buffer is latched at the start of the transfer
+        tx_buffer[0] = 0xff;
+
+        sched.advance(3 * 640);
+        CHECK(model.get_tx_data() == std::vector<uint8_t> {1, 2, 3});
+        CHECK(mem.get_value_at(uarte0_base + event_endtx) == 0);
+
+        sched.advance(640);
+        CHECK(model.get_tx_data() == std::vector<uint8_t> {1, 2, 3, 4});
+        CHECK(mem.get_value_at(uarte0_base + event_endtx) == 1);
+        CHECK(mem.get_value_at(uarte0_base + txd_amount) == 4);
+        CHECK_FALSE(model.is_tx_active());
+    }
+
+    SECTION("Stop transmission") {
+        raw_write32(uarte0_base + tasks_starttx, 1);
+        sched.advance(640);
+        raw_write32(uarte0_base + tasks_stoptx, 1);
+
+        CHECK(mem.get_value_at(uarte0_base + event_endtx) == 1);
+        CHECK(mem.get_value_at(uarte0_base + event_txstopped) == 1);
+        CHECK(mem.get_value_at(uarte0_base + txd_amount) == 1);
+
+        sched.advance(10 * 640);
+        CHECK(model.get_tx_data().size() == 1);
+    }
+
+    SECTION("Receive") {
+        raw_write32(uarte0_base + tasks_startrx, 1);
+        model.receive(std::vector<uint8_t> {5, 6, 7, 8, 9});
+
+        sched.advance(640);
+        CHECK(mem.get_value_at(uarte0_base + event_rxdrdy) == 1);
+        CHECK(rx_buffer[0] == 5);
+
+        sched.advance(3 * 640);
+        CHECK(mem.get_value_at(uarte0_base + event_endrx) == 1);
+        CHECK(mem.get_value_at(uarte0_base + rxd_amount) == 4);
+        CHECK(rx_buffer[3] == 8);
+        CHECK_FALSE(model.is_rx_active());
+
+        SECTION("FIFO") {
+            // The last byte is kept in the FIFO until the next STARTRX
+            sched.advance(640);
+            raw_write32(uarte0_base + rxd_maxcnt, 2);
+            raw_write32(uarte0_base + tasks_startrx, 1);
+            raw_write32(uarte0_base + tasks_stoprx, 1);
+
+            CHECK(rx_buffer[0] == 9);
+            CHECK(mem.get_value_at(uarte0_base + rxd_amount) == 1);
+            CHECK(mem.get_value_at(uarte0_base + event_rxto) == 1);
+        }
+
+        SECTION("Overrun") {
+            model.receive(std::vector<uint8_t>(6, 0));
+            sched.advance(10 * 640);
+
+            CHECK(model.get_overrun_count() == 3);
+            CHECK(mem.get_value_at(uarte0_base + event_error) == 1);
+            CHECK(raw_read32(uarte0_base + errorsrc) == 1);
+            raw_write32(uarte0_base + errorsrc, 1);
+            CHECK(raw_read32(uarte0_base + errorsrc) == 0);
+        }
+    }
+
+    SECTION("Shortcut and interrupts") {
+        nvic_init();
+        nvic_set_handler(2, uarte_irq_handler);
+        uarte_irq_count = 0;
+
+        // ENDRX_STARTRX shortcut, ENDRX interrupt
+        raw_write32(uarte0_base + shorts, 1 << 5);
+        raw_write32(uarte0_base + intenset, 1 << 4);
+        raw_write32(uarte0_base + tasks_startrx, 1);
+
+        model.receive(std::string("abcdefgh"));
+        sched.advance(8 * 640);
+
+        CHECK(uarte_irq_count == 2);
+        CHECK(model.is_rx_active());
+        CHECK(std::string(rx_buffer, rx_buffer + 4) == "efgh");
+    }
+}
+
+TEST_CASE("Test UARTE continuous receive") {
+    // The first free TIMER counts the received bytes
+    constexpr uint32_t timer0_base = 0x40008000;
+
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    mock::UARTEModel model{uarte0_base, 2};
+    model.install(mem, sched);
+    mock::PPIModel ppi;
+    ppi.install(mem);
+    mock::TimerModel counter{timer0_base};
+    counter.install(mem);
+    model.set_event_listener([&ppi](uint32_t addr) {
+        ppi.event_raised(addr);
+    });
+
+    auto* uarte0 = driver::UART::request_by_id(driver::UART::ID::UARTE0);
+    REQUIRE(uarte0 != nullptr);
+    uarte0->set_baudrate(1000 * 1000);
+
+    struct RxCounter : public driver::EventHandler {
+        void handle_event(driver::EventInfo* e_info) override {
+            CHECK(e_info->evt_id == driver::UART::Event::RX_DATA);
+            ++count;
+        }
+
+        int count = 0;
+    } rx_handler;
+
+    os::SpscRingStatic<uint8_t, 256> ring;
+    std::vector<uint8_t> sent;
+    std::vector<uint8_t> received;
+    const auto send = [&model, &sent](size_t size) {
+        std::vector<uint8_t> data(size);
+        for (auto& byte : data) {
+            byte = sent.size() * 7 + (&byte - data.data());
+        }
+        sent.insert(sent.end(), data.begin(), data.end());
+        model.receive(data);
+    };
+    const auto drain = [&ring, &received]() {
+        uint8_t batch[64];
+        size_t n;
+        while ((n = ring.read(batch, sizeof(batch)))) {
+            received.insert(received.end(), batch, batch + n);
+        }
+    };
+
+    // Not without a TIMER
+    auto* pool = nrf52::TimerPool::request();
+    std::vector<int> timers;
+    for (int id = pool->alloc(); id >= 0; id = pool->alloc()) {
+        timers.push_back(id);
+    }
+    CHECK(uarte0->start_rx(&ring, &rx_handler) < 0);
+    CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+    for (auto id : timers) {
+        pool->free(id);
+    }
+
+    REQUIRE(uarte0->start_rx(&ring, &rx_handler) == 0);
+    CHECK(uarte0->start_rx(&ring, &rx_handler) < 0);
+    CHECK(counter.is_running());
+
+    send(100);
+    while (sched.run_next());
+
+    // Three full buffers are delivered by the interrupts, nothing is lost in between
+    CHECK(counter.get_counter() == 100);
+    CHECK(ring.size() == 96);
+    CHECK(rx_handler.count == 3);
+    CHECK(model.get_overrun_count() == 0);
+
+    // The line is idle, get the rest
+    CHECK(uarte0->poll_rx() == 4);
+    CHECK(uarte0->poll_rx() == 0);
+    drain();
+    CHECK(received == sent);
+
+    // Partially delivered buffer is completed by the interrupt
+    send(10);
+    while (sched.run_next());
+    CHECK(uarte0->poll_rx() == 10);
+    send(30);
+    while (sched.run_next());
+    CHECK(ring.size() == 28);
+    CHECK(uarte0->poll_rx() == 12);
+    drain();
+    CHECK(received == sent);
+
+    SECTION("Stop") {
+        send(5);
+        while (sched.run_next());
+        uarte0->stop_rx();
+        while (sched.run_next());
+
+        drain();
+        CHECK(received == sent);
+        CHECK_FALSE(model.is_rx_active());
+        CHECK_FALSE(counter.is_running());
+        CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+
+        // Can be started again
+        REQUIRE(uarte0->start_rx(&ring, &rx_handler) == 0);
+        uarte0->stop_rx();
+        while (sched.run_next());
+    }
+
+    SECTION("Ring overflow") {
+        send(300);
+        while (sched.run_next());
+        uarte0->poll_rx();
+
+        CHECK(ring.size() == ring.capacity());
+        drain();
+        CHECK(std::vector<uint8_t>(sent.begin(), sent.begin() + received.size()) == received);
+
+        uarte0->stop_rx();
+        while (sched.run_next());
+    }
+}
+
+TEST_CASE("Test UARTE receive idle timeout") {
+    // The byte counter and the idle timer
+    constexpr uint32_t timer0_base = 0x40008000;
+    constexpr uint32_t timer1_base = 0x40009000;
+    constexpr int timer1_irq = 9;
+
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    mock::UARTEModel model{uarte0_base, 2};
+    model.install(mem, sched);
+    mock::PPIModel ppi;
+    ppi.install(mem);
+    mock::TimerModel counter{timer0_base};
+    counter.install(mem);
+    mock::TimerModel idle{timer1_base};
+    idle.install(mem, sched);
+    model.set_event_listener([&ppi](uint32_t addr) {
+        ppi.event_raised(addr);
+    });
+    idle.set_event_listener([&sched, &mem](uint32_t addr) {
+        // The model doesn't raise the interrupts
+        const bool enabled = mem.get_value_at(timer1_base + 0x304) & (1 << 16);
+        if (addr == timer1_base + mock::TimerModel::kEventsCompare && enabled) {
+            sched.schedule_in(0, []() {
+                nvic_dispatch(timer1_irq);
+            });
+        }
+    });
+
+    auto* uarte0 = driver::UART::request_by_id(driver::UART::ID::UARTE0);
+    REQUIRE(uarte0 != nullptr);
+    // 10 us per byte
+    uarte0->set_baudrate(1000 * 1000);
+
+    struct RxCounter : public driver::EventHandler {
+        void handle_event(driver::EventInfo* e_info) override {
+            (void)e_info;
+            ++count;
+        }
+
+        int count = 0;
+    } rx_handler;
+
+    os::SpscRingStatic<uint8_t, 256> ring;
+    REQUIRE(uarte0->set_rx_idle_timeout(100) == 0);
+    REQUIRE(uarte0->start_rx(&ring, &rx_handler) == 0);
+    CHECK(uarte0->set_rx_idle_timeout(50) < 0);
+    CHECK_FALSE(idle.is_running());
+
+    // The partial buffer is delivered without poll_rx()
+    model.receive(std::vector<uint8_t>(10, 0x55));
+    const auto start = sched.now();
+    while (sched.run_next());
+    CHECK(ring.size() == 10);
+    CHECK(rx_handler.count == 1);
+    CHECK_FALSE(idle.is_running());
+    // 10 bytes and the timeout after the last one
+    CHECK(sched.now() - start >= 200 * 64);
+    CHECK(sched.now() - start < 220 * 64);
+
+    // The full buffer by ENDRX, the rest by the timeout
+    model.receive(std::vector<uint8_t>(40, 0xaa));
+    while (sched.run_next());
+    CHECK(ring.size() == 50);
+    CHECK(rx_handler.count == 3);
+    CHECK(uarte0->poll_rx() == 0);
+
+    uarte0->stop_rx();
+    while (sched.run_next());
+    CHECK_FALSE(idle.is_running());
+    CHECK(mem.get_value_at(mock::PPIModel::kBase + mock::PPIModel::kChen) == 0);
+    CHECK(mem.get_value_at(timer1_base + 0x308) == (1 << 16));
+    REQUIRE(nrf52::TimerPool::request()->reserve(9) == 0);
+    nrf52::TimerPool::request()->free(9);
+
+    REQUIRE(uarte0->set_rx_idle_timeout(0) == 0);
+}
+
+TEST_CASE("UARTE throughput", "[.][benchmark]") {
+    auto& mem = mock::get_global_memory();
+    auto& sched = mock::get_global_scheduler();
+
+    mock::UARTEModel model{uarte0_base, 2};
+    const std::string line(200, 'x');
+    // Busy waiting produces a lot of reads, don't record them
+    mem.set_journal_mode(mock::Memory::JournalMode::OFF);
+
+    for (auto rate : {115200u, 1000u * 1000}) {
+        mem.reset();
+        sched.reset();
+        mem.set_scheduler(&sched);
+        model.install(mem, sched);
+        model.clear_tx_data();
+
+        auto* uarte0 = driver::UART::request_by_id(driver::UART::ID::UARTE0);
+        auto actual_rate = uarte0->set_baudrate(rate);
+
+        const auto start = sched.now();
+        BENCHMARK("write_str, 200 bytes at " + std::to_string(actual_rate) + " baud") {
+            uarte0->write_str(line.c_str());
+        }
+        const auto cycles = sched.now() - start;
+        const auto bytes = model.get_tx_data().size();
+        // Bytes per second of virtual time
+        WARN("Throughput at " << actual_rate << " baud: "
+             << bytes * mock::UARTEModel::kCpuFrequency / cycles << " B/s");
+    }
+
+    mem.set_journal_mode(mock::Memory::JournalMode::FULL);
+}
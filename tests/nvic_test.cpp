@@ -63,6 +63,30 @@ TEST_CASE("Test Interrupt Dispatch") {
     CHECK(counter == 3);
 }
 
+TEST_CASE("Test Critical Section") {
+    nvic_set_handler(IRQ_NMI, intr_handler);
+    nvic_set_handler(0, intr_handler);
+    counter = 0;
+
+    const auto outer = nvic_save_and_disable_irqs();
+    CHECK(nvic_dispatch(0) == 0);
+    CHECK(counter == 0);
+    // NMI is not masked
+    CHECK(nvic_dispatch(IRQ_NMI) == 0);
+    CHECK(counter == 1);
+
+    const auto inner = nvic_save_and_disable_irqs();
+    nvic_restore_irqs(inner);
+    CHECK(counter == 1);
+
+    // The masked interrupt runs once, when the outermost section ends
+    CHECK(nvic_dispatch(0) == 0);
+    nvic_restore_irqs(outer);
+    CHECK(counter == 2);
+    CHECK(nvic_dispatch(0) == 0);
+    CHECK(counter == 3);
+}
+
 TEST_CASE("Test Setting Off Interrupts") {
     const uint32_t icsr_addr = 0xe000ed04;
     auto& mem = mock::get_global_memory();
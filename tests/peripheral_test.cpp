@@ -24,9 +24,7 @@
 
 namespace {
 
-using handlers_t = driver::Peripheral::HandlerContainerT;
-
-handlers_t evt_handlers(3, nullptr);
+driver::Peripheral::HandlerTable<3> evt_handlers;
 
 class TestPeriph : public driver::Peripheral {
     public:
@@ -76,12 +74,17 @@ TEST_CASE("Test IRQ Setting") {
     nvic_init();
 
     DummyEventHandler event_handler;
+    DummyEventHandler idle_handler;
 
     test_periph.set_irq_handler(dummy_handler);
     CHECK(test_periph.add_event_handler(1, &event_handler) >= 0);
+    CHECK(test_periph.add_event_handler(0, &idle_handler) >= 0);
+    CHECK(test_periph.add_event_handler(3, &idle_handler) < 0);
     CHECK(event_handler.counter == 0);
     nvic_dispatch(test_periph.get_irq_num());
     CHECK(event_handler.counter == 1);
+    // Only the pending events are dispatched
+    CHECK(idle_handler.counter == 0);
 
     CHECK(test_periph.is_clear == true);
 }
@@ -0,0 +1,86 @@
+#include "third_party/catch2/catch.hpp"
+
+#include "driver/prescaler.hpp"
+
+namespace {
+
+using driver::prescaler::Scale;
+using driver::prescaler::Space;
+
+constexpr Space kLinear{Scale::LINEAR, 1, 4096};
+constexpr Space kPow2{Scale::POW2, 0, 9};
+constexpr Space kReload{Scale::LINEAR, 1, (1 << 24) - 1};
+
+// Solved by the compiler
+constexpr auto kTick = driver::prescaler::for_rate(kLinear, 32768, 128);
+static_assert(kTick.is_valid() && kTick.presc == 256 && kTick.rate == 128 && kTick.error_ppm == 0, "");
+static_assert(!driver::prescaler::for_rate(kPow2, 16'000'000, 31'249).is_valid(), "");
+
+}  // namespace
+
+TEST_CASE("Prescaler Solver") {
+    SECTION("Linear") {
+        auto config = driver::prescaler::for_rate(kLinear, 32768, 823);
+        CHECK(config.presc == 40);
+        CHECK(config.rate == 819);
+        // 32768 / 40 = 819.2
+        CHECK(config.error_ppm == 4617);
+
+        config = driver::prescaler::for_rate(kLinear, 32768, 8);
+        CHECK(config.presc == 4096);
+        CHECK(config.rate == 8);
+        CHECK(config.error_ppm == 0);
+
+        CHECK_FALSE(driver::prescaler::for_rate(kLinear, 32768, 7).is_valid());
+        CHECK_FALSE(driver::prescaler::for_rate(kLinear, 32768, 0).is_valid());
+
+        // Clamped to the base rate
+        config = driver::prescaler::for_rate(kLinear, 32768, 65536);
+        CHECK(config.presc == 1);
+        CHECK(config.rate == 32768);
+        CHECK(config.error_ppm == 500'000);
+    }
+
+    SECTION("Power of two") {
+        auto config = driver::prescaler::for_rate(kPow2, 16'000'000, 1'000'000);
+        CHECK(config.presc == 4);
+        CHECK(config.rate == 1'000'000);
+        CHECK(config.error_ppm == 0);
+
+        config = driver::prescaler::for_rate(kPow2, 16'000'000, 1'500'000);
+        CHECK(config.presc == 4);
+        CHECK(config.rate == 1'000'000);
+        CHECK(config.error_ppm == 333'333);
+
+        config = driver::prescaler::for_rate(kPow2, 16'000'000, 23'000'000);
+        CHECK(config.presc == 0);
+        CHECK(config.rate == 16'000'000);
+
+        config = driver::prescaler::for_rate(kPow2, 16'000'000, 31'250);
+        CHECK(config.presc == 9);
+        CHECK(config.rate == 31'250);
+    }
+
+    SECTION("Minimum prescaler") {
+        constexpr Space from_two{Scale::LINEAR, 2, 16};
+        auto config = driver::prescaler::for_rate(from_two, 1000, 1000);
+        CHECK(config.presc == 2);
+        CHECK(config.rate == 500);
+    }
+
+    SECTION("Period") {
+        // 3 ms isn't a whole number of Hz
+        auto config = driver::prescaler::for_period_us(kReload, 64'000'000, 3000);
+        CHECK(config.presc == 192'000);
+        CHECK(config.error_ppm == 0);
+        CHECK(driver::prescaler::for_rate(kReload, 64'000'000, 333).error_ppm > 0);
+
+        config = driver::prescaler::for_period_us(kLinear, 32768, 1000);
+        CHECK(config.presc == 33);
+        // 33 / 32768 s = 1007.08 us
+        CHECK(config.error_ppm == 7080);
+
+        CHECK_FALSE(driver::prescaler::for_period_us(kReload, 64'000'000, 1000 * 1000).is_valid());
+        CHECK_FALSE(driver::prescaler::for_period_us(kReload, 64'000'000, 0).is_valid());
+    }
+}
@@ -0,0 +1,94 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "third_party/catch2/catch.hpp"
+
+#include "mock_memio.hpp"
+
+#include "reg.hpp"
+
+namespace {
+
+constexpr uint32_t kCtrlAddr = 0x40002000;
+
+using Ctrl = reg::Reg<kCtrlAddr>;
+using Len = reg::Field<Ctrl, 0, 4>;
+using Mode = reg::Field<Ctrl, 8, 2>;
+using Enable = reg::Field<Ctrl, 31, 1>;
+using Whole = reg::Field<Ctrl, 0, 32>;
+
+using Status = reg::Reg<kCtrlAddr + 4, reg::Access::RO>;
+using Ready = reg::Field<Status, 0, 1>;
+
+// Computed at compile time
+static_assert(Mode::kMask == 0x300, "Mode mask");
+static_assert(Enable::kMask == 0x80000000, "Enable mask");
+static_assert(Whole::kMask == 0xffffffff, "Whole mask");
+static_assert((Len::value(5) | Mode::value(2)).mask == 0x30f, "Combined mask");
+static_assert((Len::value(5) | Mode::value(2)).bits == 0x205, "Combined bits");
+static_assert(Len::value(0x15).bits == 0x5, "Value truncated to the field");
+
+}  // namespace
+
+TEST_CASE("Test Register Fields") {
+    using Op = mock::Memory::Op;
+
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+
+    SECTION("Modify") {
+        mem.set_value_at(kCtrlAddr, 0x12345678);
+        Ctrl::modify(Len::value(3), Mode::value(1), Enable::value(1));
+
+        // A single read-modify-write
+        CHECK(mem.get_op_count(Op::READ32, kCtrlAddr) == 1);
+        CHECK(mem.get_op_count(Op::WRITE32, kCtrlAddr) == 1);
+        CHECK(mem.get_value_at(kCtrlAddr) == ((0x12345678 & ~0x8000030f) | 0x80000103));
+
+        CHECK(Len::read() == 3);
+        CHECK(Mode::read() == 1);
+        CHECK(Enable::read() == 1);
+    }
+
+    SECTION("Write") {
+        mem.set_value_at(kCtrlAddr, 0xffffffff);
+        Ctrl::write(Len::value(7), Mode::value(3));
+
+        // No read, the rest of the register is cleared
+        CHECK(mem.get_op_count(Op::READ32, kCtrlAddr) == 0);
+        CHECK(mem.get_op_count(Op::WRITE32, kCtrlAddr) == 1);
+        CHECK(mem.get_value_at(kCtrlAddr) == 0x307);
+
+        Ctrl::write(0xabcd);
+        CHECK(mem.get_value_at(kCtrlAddr) == 0xabcd);
+        Whole::write(0xdeadbeef);
+        CHECK(Ctrl::read() == 0xdeadbeef);
+    }
+
+    SECTION("Single field") {
+        mem.set_value_at(kCtrlAddr, 0x1000);
+        Mode::write(2);
+        CHECK(mem.get_value_at(kCtrlAddr) == 0x1200);
+        Mode::write(0);
+        CHECK(mem.get_value_at(kCtrlAddr) == 0x1000);
+    }
+
+    SECTION("Read only") {
+        mem.set_value_at(kCtrlAddr + 4, 1);
+        CHECK(Ready::read() == 1);
+        CHECK(Status::read() == 1);
+    }
+}
@@ -0,0 +1,207 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "sam4s_uart_fake.hpp"
+
+#include "nvic.h"
+
+namespace mock {
+
+namespace {
+
+constexpr uint32_t kMrParMask = (7 << 9);
+constexpr uint32_t kMrParNo = (4 << 9);
+
+}  // namespace
+
+void UARTModel::install(Memory& mem, Scheduler& sched) {
+    set_memory(&mem);
+    sched_ = &sched;
+    mem.set_addr_io_handler(base_, base_ + kRegBlockSize, this);
+}
+
+uint32_t UARTModel::write32(uint32_t addr, uint32_t old_value, uint32_t new_value) {
+    const auto offset = addr - base_;
+    switch (offset) {
+    case kCr:
+        if (new_value & kCrRstTx) {
+            sched_->cancel(tx_event_);
+            shifting_ = false;
+            thr_full_ = false;
+            tx_enabled_ = false;
+        }
+        if (new_value & kCrTxEn) {
+            tx_enabled_ = true;
+        }
+        if (new_value & kCrTxDis) {
+            tx_enabled_ = false;
+        }
+        pdc_feed();
+        update_irq();
+        break;
+    case kIer:
+        set_reg(kImr, reg(kImr) | new_value);
+        update_irq();
+        break;
+    case kIdr:
+        set_reg(kImr, reg(kImr) & ~new_value);
+        break;
+    case kImr:
+    case kSr:
+    case kPtsr:
+        // Read only
+        return old_value;
+    case kThr:
+        if (tx_enabled_) {
+            load_thr(new_value & 0xff);
+            update_irq();
+        }
+        break;
+    case kTcr:
+    case kTncr:
+        // Writing any of the counters acknowledges ENDTX
+        set_reg(offset, new_value & 0xffff);
+        end_tx_ = false;
+        pdc_feed();
+        update_irq();
+        return reg(offset);
+    case kPtcr:
+        if (new_value & kPdcTxTEn) {
+            set_reg(kPtsr, reg(kPtsr) | kPdcTxTEn);
+        }
+        if (new_value & kPdcTxTDis) {
+            set_reg(kPtsr, reg(kPtsr) & ~kPdcTxTEn);
+        }
+        pdc_feed();
+        update_irq();
+        // Write only
+        return 0;
+    default:
+        break;
+    }
+
+    return new_value;
+}
+
+uint32_t UARTModel::read32(uint32_t addr, uint32_t value) {
+    if (addr - base_ == kSr) {
+        return get_status();
+    }
+
+    return value;
+}
+
+Scheduler::Cycles UARTModel::get_frame_cycles() const {
+    const auto cd = reg(kBrgr) & 0xffff;
+    if (!cd) {
+        // The baud rate clock is disabled
+        return ~Scheduler::Cycles{0} / 2;
+    }
+
+    const unsigned bits = (reg(kMr) & kMrParMask) == kMrParNo ? 10 : 11;
+    return Scheduler::Cycles{16} * cd * bits;
+}
+
+uint32_t UARTModel::get_status() const {
+    uint32_t status = 0;
+    if (tx_enabled_ && !thr_full_) {
+        status |= kSrTxRdy;
+        if (!shifting_) {
+            status |= kSrTxEmpty;
+        }
+    }
+
+    if (end_tx_) {
+        status |= kSrEndTx;
+    }
+
+    if (!reg(kTcr) && !reg(kTncr)) {
+        status |= kSrTxBufE;
+    }
+
+    return status;
+}
+
+void UARTModel::load_thr(uint8_t byte) {
+    if (shifting_) {
+        // Overwrites the previous value, the same way the hardware does
+        thr_ = byte;
+        thr_full_ = true;
+        return;
+    }
+
+    shifting_ = true;
+    tx_event_ = sched_->schedule_in(get_frame_cycles(), [this, byte]() {
+        tx_sink_.push_back(byte);
+        tx_frame_done();
+    });
+}
+
+void UARTModel::tx_frame_done() {
+    shifting_ = false;
+    if (thr_full_) {
+        thr_full_ = false;
+        load_thr(thr_);
+    }
+
+    pdc_feed();
+    update_irq();
+}
+
+void UARTModel::pdc_feed() {
+    auto reload = [this]() {
+        set_mem_ptr(base_ + kTpr, get_mem_ptr(base_ + kTnpr));
+        set_reg(kTcr, reg(kTncr));
+        set_reg(kTncr, 0);
+    };
+
+    if (!reg(kTcr) && reg(kTncr)) {
+        reload();
+    }
+
+    while ((reg(kPtsr) & kPdcTxTEn) && tx_enabled_ && !thr_full_ && reg(kTcr)) {
+        auto* ptr = static_cast<uint8_t*>(get_mem_ptr(base_ + kTpr));
+        const uint8_t byte = ptr ? *ptr : 0;
+        set_mem_ptr(base_ + kTpr, ptr ? ptr + 1 : nullptr);
+
+        const auto count = reg(kTcr) - 1;
+        set_reg(kTcr, count);
+        if (!count) {
+            end_tx_ = true;
+            if (reg(kTncr)) {
+                reload();
+            }
+        }
+
+        load_thr(byte);
+    }
+}
+
+void UARTModel::update_irq() {
+    if ((get_status() & reg(kImr)) && !irq_pending_) {
+        // The interrupt is level triggered, it is taken again if the handler
+        // didn't clear the condition.
+        irq_pending_ = true;
+        sched_->schedule_in(0, [this]() {
+            irq_pending_ = false;
+            if (nvic_dispatch(irq_n_) == 0) {
+                update_irq();
+            }
+        });
+    }
+}
+
+}  // namespace mock
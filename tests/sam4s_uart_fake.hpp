@@ -0,0 +1,157 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+/**
+ * @file
+ *
+ * Behavioral model of SAM4S UART transmitter with the Peripheral DMA Controller.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+
+namespace mock {
+
+/**
+ * @brief SAM4S UART device model.
+ *
+ * The model handles the register block of the peripheral, including the PDC
+ * registers, and uses the virtual time of the Scheduler to transmit the data
+ * at the baud rate configured in BRGR.
+ *
+ * - The transmitter has a holding register (THR) and a shift register. TXRDY is set
+ *   while THR is empty, TXEMPTY when both of them are.
+ * - When TXTEN is set in PTCR, the PDC moves the bytes from TPR into THR, as long as
+ *   TCR is not zero. When TCR reaches zero, TNPR and TNCR are moved into TPR and TCR.
+ * - ENDTX is set when TCR reaches zero and is cleared by writing TCR or TNCR.
+ *   TXBUFE is set while both TCR and TNCR are zero.
+ * - IER, IDR and IMR are supported. The interrupt is level triggered: it is dispatched
+ *   through nvic_dispatch() as long as any of the enabled status bits is set.
+ *
+ * The receiver is not modelled.
+ */
+class UARTModel : public IOHandlerStub {
+    public:
+        // Register offsets
+        static constexpr uint32_t kCr = 0x00;
+        static constexpr uint32_t kCrRstTx = (1 << 3);
+        static constexpr uint32_t kCrTxEn = (1 << 6);
+        static constexpr uint32_t kCrTxDis = (1 << 7);
+
+        static constexpr uint32_t kMr = 0x04;
+        static constexpr uint32_t kIer = 0x08;
+        static constexpr uint32_t kIdr = 0x0c;
+        static constexpr uint32_t kImr = 0x10;
+
+        static constexpr uint32_t kSr = 0x14;
+        static constexpr uint32_t kSrTxRdy = (1 << 1);
+        static constexpr uint32_t kSrEndTx = (1 << 4);
+        static constexpr uint32_t kSrTxEmpty = (1 << 9);
+        static constexpr uint32_t kSrTxBufE = (1 << 11);
+
+        static constexpr uint32_t kThr = 0x1c;
+        static constexpr uint32_t kBrgr = 0x20;
+
+        static constexpr uint32_t kTpr = 0x108;
+        static constexpr uint32_t kTcr = 0x10c;
+        static constexpr uint32_t kTnpr = 0x118;
+        static constexpr uint32_t kTncr = 0x11c;
+        static constexpr uint32_t kPtcr = 0x120;
+        static constexpr uint32_t kPtsr = 0x124;
+        static constexpr uint32_t kPdcTxTEn = (1 << 8);
+        static constexpr uint32_t kPdcTxTDis = (1 << 9);
+
+        static constexpr uint32_t kRegBlockSize = 0x200;
+
+        /**
+         * @param base Base address of the peripheral.
+         * @param irq_n Interrupt number of the peripheral.
+         */
+        UARTModel(uint32_t base, int irq_n) : base_{base}, irq_n_{irq_n} {}
+
+        /**
+         * @brief Register the model as the IO handler for the peripheral's registers.
+         *
+         * The memory should be reset before that. The model needs virtual time,
+         * so the scheduler should be attached to the memory.
+         */
+        void install(Memory& mem, Scheduler& sched);
+
+        uint32_t write32(uint32_t addr, uint32_t old_value, uint32_t new_value) override;
+        uint32_t read32(uint32_t addr, uint32_t value) override;
+
+        /**
+         * @brief All of the bytes transmitted on TXD line.
+         */
+        const std::vector<uint8_t>& get_tx_data() const {
+            return tx_sink_;
+        }
+
+        void clear_tx_data() {
+            tx_sink_.clear();
+        }
+
+        /**
+         * @brief Duration of one frame in CPU cycles.
+         *
+         * The UART is clocked by MCK, which runs at the CPU frequency:
+         * each bit takes 16 * CD cycles.
+         */
+        Scheduler::Cycles get_frame_cycles() const;
+
+        bool is_tx_enabled() const {
+            return tx_enabled_;
+        }
+
+        /**
+         * @brief Current value of the status register.
+         */
+        uint32_t get_status() const;
+
+    private:
+        uint32_t reg(uint32_t offset) const {
+            return get_mem_value(base_ + offset);
+        }
+
+        void set_reg(uint32_t offset, uint32_t value) {
+            set_mem_value(base_ + offset, value);
+        }
+
+        void load_thr(uint8_t byte);
+        void tx_frame_done();
+        void pdc_feed();
+        void update_irq();
+
+        const uint32_t base_;
+        const int irq_n_;
+        Scheduler* sched_ = nullptr;
+        bool irq_pending_ = false;
+
+        bool tx_enabled_ = false;
+        bool thr_full_ = false;
+        uint8_t thr_ = 0;
+        bool shifting_ = false;
+        Scheduler::EventId tx_event_ = 0;
+        bool end_tx_ = false;
+        std::vector<uint8_t> tx_sink_;
+};
+
+}  // namespace mock
@@ -17,12 +17,16 @@
 #include "third_party/catch2/catch.hpp"
 
 #include <cstring>
+#include <vector>
 
 #include "mock_memio.hpp"
+#include "mock_scheduler.hpp"
+#include "sam4s_uart_fake.hpp"
 
 #include "clk.h"
 #include "sam4s/clk.h"
 #include "driver/uart.hpp"
+#include "memio.h"
 
 constexpr auto pmc_base = 0x400E0400;
 constexpr auto pmc_pcer0 = pmc_base + 0x10;
@@ -100,6 +104,18 @@ class RegEDS : public mock::RegSetClearStub {
         }
 };
 
+class TxDoneCounter : public driver::EventHandler {
+    public:
+        void handle_event(driver::EventInfo* e_info) override {
+            CHECK(e_info->evt_id == driver::UART::Event::TX_DONE);
+            data = e_info->data;
+            ++count;
+        }
+
+        int count = 0;
+        const void* data = nullptr;
+};
+
 }  // namespace
 
 TEST_CASE("Test UART API") {
@@ -233,3 +249,96 @@ TEST_CASE("Test Baud Rate Setting") {
         CHECK(br == pck_rate / (16 * cd));
     }
 }
+
+TEST_CASE("Test UART PDC Write") {
+    auto& mem = mock::get_global_memory();
+    mem.reset();
+    auto& sched = mock::get_global_scheduler();
+    sched.reset();
+    mem.set_scheduler(&sched);
+
+    RegEDS pclk0{pmc_pcer(0)};
+    RegEDS::install(mem, &pclk0);
+    RegEDS per_b{pio_per(1)};
+    RegEDS::install(mem, &per_b);
+
+    mock::UARTModel model{uart1_base, 9};
+    model.install(mem, sched);
+
+    auto* uart = driver::UART::request_by_id(driver::UART::ID::UART1);
+    REQUIRE(uart != nullptr);
+    // The transmitter is enabled only by the first request(), and the
+    // memory could have been reset since then.
+    raw_write32(uart_cr(1), (1 << 6));
+    uart->set_parity(driver::UART::PARITY::NONE);
+    // CD = 4
+    raw_write32(uart_brgr(1), 4);
+    REQUIRE(model.get_frame_cycles() == 16 * 4 * 10);
+
+    SECTION("Async write") {
+        TxDoneCounter done;
+        std::vector<uint8_t> data(100);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = 0x80 + i;
+        }
+
+        const auto start = sched.now();
+        REQUIRE(uart->write(data.data(), data.size(), &done) == 0);
+        CHECK(uart->is_tx_busy());
+
+        // Only one transmission at a time
+        CHECK(uart->write(data.data(), data.size(), &done) < 0);
+        CHECK(uart->write_str("Hello") == 0);
+
+        const auto reads_before = mem.get_op_count(mock::Memory::Op::READ32);
+        while (sched.run_next() && !done.count);
+
+        CHECK(done.count == 1);
+        CHECK(done.data == data.data());
+        CHECK_FALSE(uart->is_tx_busy());
+
+        // The buffer is released when the PDC is done with it,
+        // the last bytes are still being transmitted.
+        const auto elapsed = sched.now() - start;
+        CHECK(elapsed < data.size() * model.get_frame_cycles());
+        // The CPU doesn't touch the individual bytes
+        CHECK(mem.get_op_count(mock::Memory::Op::WRITE32, uart_thr(1)) == 0);
+        CHECK(mem.get_op_count(mock::Memory::Op::READ32) - reads_before < 10);
+
+        while (sched.run_next());
+        CHECK(model.get_tx_data() == data);
+
+        // The interrupts and the PDC transmitter are disabled after the transmission
+        CHECK(mem.get_value_at(uart_base(1) + 0x10) == 0);
+        CHECK((mem.get_value_at(uart_base(1) + 0x124) & (1 << 8)) == 0);
+
+        model.clear_tx_data();
+        CHECK(uart->write_str("Hello") == 5);
+        while (sched.run_next());
+        CHECK(model.get_tx_data() == std::vector<uint8_t>{'H', 'e', 'l', 'l', 'o'});
+    }
+
+    SECTION("Transfer longer than PDC counter") {
+        TxDoneCounter done;
+        std::vector<uint8_t> data(0x10000 + 0x8000 + 5);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = i * 7;
+        }
+
+        // Speed up the simulation
+        raw_write32(uart_brgr(1), 1);
+        REQUIRE(uart->write(data.data(), data.size(), &done) == 0);
+        while (sched.run_next());
+
+        CHECK(done.count == 1);
+        CHECK_FALSE(uart->is_tx_busy());
+        CHECK(model.get_tx_data() == data);
+    }
+
+    SECTION("Empty write") {
+        TxDoneCounter done;
+        REQUIRE(uart->write(nullptr, 0, &done) == 0);
+        CHECK(done.count == 1);
+        CHECK_FALSE(uart->is_tx_busy());
+    }
+}
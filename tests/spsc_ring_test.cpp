@@ -0,0 +1,71 @@
+/*******************************************************************************
+    Copyright 2020 Google LLC
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*******************************************************************************/
+
+#include "third_party/catch2/catch.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include "core/spsc_ring.hpp"
+
+TEST_CASE("Test SPSC Ring") {
+    os::SpscRingStatic<uint8_t, 8> ring;
+
+    CHECK(ring.capacity() == 8);
+    CHECK(ring.empty());
+
+    const uint8_t data[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    uint8_t out[10] = {};
+
+    SECTION("Write and read") {
+        CHECK(ring.write(data, 5) == 5);
+        CHECK(ring.size() == 5);
+
+        CHECK(ring.read(out, 3) == 3);
+        CHECK(std::vector<uint8_t>(out, out + 3) == std::vector<uint8_t> {1, 2, 3});
+        CHECK(ring.size() == 2);
+
+        CHECK(ring.read(out, 10) == 2);
+        CHECK(out[1] == 5);
+        CHECK(ring.empty());
+        CHECK(ring.read(out, 1) == 0);
+    }
+
+    SECTION("Full ring") {
+        CHECK(ring.write(data, 10) == 8);
+        CHECK(ring.write(data, 1) == 0);
+        CHECK(ring.read(out, 10) == 8);
+        CHECK(std::vector<uint8_t>(out, out + 8) == std::vector<uint8_t>(data, data + 8));
+    }
+
+    SECTION("Wrap around") {
+        std::vector<uint8_t> received;
+        uint8_t next = 0;
+        for (int i = 0; i < 100; ++i) {
+            uint8_t chunk[3] = {next, static_cast<uint8_t>(next + 1), static_cast<uint8_t>(next + 2)};
+            REQUIRE(ring.write(chunk, 3) == 3);
+            next += 3;
+
+            const auto n = ring.read(out, 3);
+            received.insert(received.end(), out, out + n);
+        }
+
+        for (size_t i = 0; i < received.size(); ++i) {
+            REQUIRE(received[i] == static_cast<uint8_t>(i));
+        }
+        CHECK(received.size() == 300);
+    }
+}